@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <cstring>
+#include <type_traits>
 #include <tl/expected.hpp>
 
 #include "pool.h"
@@ -8,21 +10,29 @@
 
 namespace fk {
 
-template <typename T> class collection {
+/**
+ * Pool allocated list, appending and size are constant time. Items live
+ * in nodes of ChunkSize so that larger chunks trade some wasted space at
+ * the tail for fewer allocations and contiguous iteration. Sequential
+ * get(index) calls pick up where the previous one left off.
+ */
+template <typename T, size_t ChunkSize = 1> class collection {
+    static_assert(ChunkSize > 0, "collection chunks should hold at least one item.");
+
 private:
     struct item_t {
-        T item;
-        item_t *np{ nullptr };
-
-        item_t() {
-        }
-
-        item_t(T &&item) : item(std::move(item)) {
-        }
+        T items[ChunkSize];
+        item_t *np;
     };
 
     Pool *pool_{ nullptr };
     item_t *head_{ nullptr };
+    item_t *tail_{ nullptr };
+    size_t size_{ 0 };
+    size_t tail_used_{ 0 };
+    item_t *cursor_{ nullptr };
+    size_t cursor_index_{ 0 };
+    uint32_t generation_{ 0 };
 
 public:
     explicit collection() {
@@ -34,10 +44,21 @@ public:
     collection(Pool *pool) : pool_(pool) {
     }
 
-    collection(collection &&o) : pool_(exchange(o.pool_, nullptr)), head_(exchange(o.head_, nullptr)) {
+    collection(collection &&o)
+        : pool_(exchange(o.pool_, nullptr)), head_(exchange(o.head_, nullptr)), tail_(exchange(o.tail_, nullptr)),
+          size_(exchange(o.size_, (size_t)0)), tail_used_(exchange(o.tail_used_, (size_t)0)), generation_(o.generation_) {
+        o.cursor_ = nullptr;
+        o.generation_++;
     }
 
-    explicit collection(collection const &o) : pool_(o.pool_), head_(o.head_) {
+    /**
+     * Copies every item into new nodes from the same pool, sharing nodes
+     * would leave the two collections disagreeing about the tail.
+     */
+    explicit collection(collection const &o) : pool_(o.pool_) {
+        for (T const &i : o) {
+            add(i);
+        }
     }
 
 public:
@@ -46,6 +67,12 @@ public:
     collection &operator=(collection &&other) {
         pool_ = exchange(other.pool_, nullptr);
         head_ = exchange(other.head_, nullptr);
+        tail_ = exchange(other.tail_, nullptr);
+        size_ = exchange(other.size_, (size_t)0);
+        tail_used_ = exchange(other.tail_used_, (size_t)0);
+        cursor_ = other.cursor_ = nullptr;
+        generation_++;
+        other.generation_++;
         return *this;
     }
 
@@ -53,31 +80,43 @@ public:
         return pool_;
     }
 
+    /**
+     * Changes whenever items are added, moved around or replaced, so that
+     * anything holding pointers to items can tell when they're stale.
+     */
+    uint32_t generation() const {
+        return generation_;
+    }
+
 public:
     class iterator {
     public:
-        iterator(item_t *iter) : iter_(iter) {
+        iterator(item_t *iter, size_t index = 0) : iter_(iter), index_(index) {
         }
 
     public:
         iterator operator++() {
-            iter_ = iter_->np;
+            if (++index_ == ChunkSize) {
+                iter_ = iter_->np;
+                index_ = 0;
+            }
             return *this;
         }
         bool operator!=(const iterator &other) const {
-            return iter_ != other.iter_;
+            return iter_ != other.iter_ || index_ != other.index_;
         }
 
         T &operator*() const {
-            return iter_->item;
+            return iter_->items[index_];
         }
 
         T *operator->() const {
-            return &iter_->item;
+            return &iter_->items[index_];
         }
 
     private:
         item_t *iter_;
+        size_t index_;
     };
 
 public:
@@ -86,27 +125,24 @@ public:
     }
 
     iterator end() const {
-        return iterator(nullptr);
+        if (tail_ == nullptr || tail_used_ == ChunkSize) {
+            return iterator(nullptr);
+        }
+        return iterator(tail_, tail_used_);
     }
 
     void add(T value) {
-        auto node = pool_->malloc<item_t>();
-        node->np = nullptr;
-        node->item = std::move(value);
-        append(node);
+        *allocate() = std::move(value);
     }
 
-    void add(collection<T> &other) {
+    void add(collection<T, ChunkSize> &other) {
         for (T &i : other) {
             add(i);
         }
     }
 
     template <class... Args> void emplace(Args &&...args) {
-        auto node = pool_->malloc<item_t>();
-        node->np = nullptr;
-        node->item = T(std::forward<Args>(args)...);
-        append(node);
+        *allocate() = T(std::forward<Args>(args)...);
     }
 
     bool valid() const {
@@ -114,71 +150,92 @@ public:
     }
 
     size_t size() const {
-        size_t i = 0;
-        for (auto iter = head_; iter != nullptr; iter = iter->np, i++) {
-        }
-        return i;
+        return size_;
     }
 
     bool only_one() const {
-        return head_ != nullptr && head_->np == nullptr;
+        return size_ == 1;
     }
 
     T *get(size_t index) {
-        for (auto iter = head_; iter != nullptr; iter = iter->np, index--) {
-            if (iter != nullptr && index == 0) {
-                return &iter->item;
-            }
+        if (index >= size_) {
+            return nullptr;
         }
-        return nullptr;
+
+        auto base = index - (index % ChunkSize);
+        if (base == size_ - tail_used_) {
+            return &tail_->items[index - base];
+        }
+
+        if (cursor_ == nullptr || base < cursor_index_) {
+            cursor_ = head_;
+            cursor_index_ = 0;
+        }
+
+        while (cursor_index_ < base) {
+            cursor_ = cursor_->np;
+            cursor_index_ += ChunkSize;
+        }
+
+        return &cursor_->items[index - base];
     }
 
     template <typename SortKeyFn> bool sort(SortKeyFn key_fn) {
         auto modified = false;
-        if (head_ == nullptr) {
+        if (size_ < 2) {
             return modified;
         }
 
+        auto unsorted = size_;
         auto sorted = false;
-        auto l = head_;
-        auto r = (item_t *)nullptr;
         do {
             sorted = true;
-            l = head_;
 
-            while (l->np != r) {
-                auto lkey = key_fn(l->item);
-                auto rkey = key_fn(l->np->item);
+            auto l = begin();
+            auto r = begin();
+            ++r;
+
+            for (auto i = (size_t)1; i < unsorted; ++i, ++l, ++r) {
+                auto lkey = key_fn(*l);
+                auto rkey = key_fn(*r);
 
                 if (lkey > rkey) {
-                    auto temp = l->item;
-                    l->item = l->np->item;
-                    l->np->item = temp;
+                    auto temp = *l;
+                    *l = *r;
+                    *r = temp;
                     sorted = false;
                     modified = true;
                 }
-
-                l = l->np;
             }
 
-            r = l;
+            unsorted--;
         } while (!sorted);
 
+        if (modified) {
+            generation_++;
+        }
+
         return modified;
     }
 
 private:
-    void append(item_t *node) {
-        if (head_ != nullptr) {
-            for (auto iter = head_;; iter = iter->np) {
-                if (iter->np == nullptr) {
-                    iter->np = node;
-                    break;
-                }
+    T *allocate() {
+        if (tail_ == nullptr || tail_used_ == ChunkSize) {
+            auto node = pool_->malloc<item_t>();
+            node->np = nullptr;
+            if (tail_ != nullptr) {
+                tail_->np = node;
+            } else {
+                head_ = node;
             }
-        } else {
-            head_ = node;
+            tail_ = node;
+            tail_used_ = 0;
         }
+
+        size_++;
+        generation_++;
+
+        return &tail_->items[tail_used_++];
     }
 };
 
@@ -317,4 +374,185 @@ public:
     }
 };
 
+/**
+ * FNV-1a, a word at a time with the high half folded in at the end since
+ * pool_map only ever uses the low bits. Cheap and good enough to spread
+ * the short keys we index.
+ */
+inline uint32_t pool_map_hash(uint8_t const *data, size_t size) {
+    auto hash = 2166136261u;
+    auto i = 0u;
+    for (; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t)) {
+        uint32_t word;
+        memcpy(&word, data + i, sizeof(uint32_t));
+        hash = (hash ^ word) * 16777619u;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash ^ (hash >> 16);
+}
+
+/**
+ * Hashing and equality for pool_map keys. By default keys are compared
+ * byte for byte, so they should be plain structs without padding.
+ */
+template <typename K> struct pool_map_key {
+    static_assert(!std::is_pointer<K>::value, "pointer keys would be compared by address, provide a Key.");
+
+    static uint32_t hash(K const &key) {
+        return pool_map_hash(reinterpret_cast<uint8_t const *>(&key), sizeof(K));
+    }
+
+    static bool equal(K const &a, K const &b) {
+        return memcmp(&a, &b, sizeof(K)) == 0;
+    }
+};
+
+/**
+ * Smallest power of two that keeps a table of Capacity entries no more
+ * than two thirds full.
+ */
+constexpr size_t pool_map_slots(size_t capacity, size_t slots = 1) {
+    return slots > capacity + capacity / 2 ? slots : pool_map_slots(capacity, slots * 2);
+}
+
+/**
+ * Fixed size, open addressing map with linear probing. Slots are stored
+ * inline so the map is a single allocation alongside its owner, usually in
+ * a Pool, and never allocates on put. Holds at most Capacity entries.
+ * Default construction is constant, so these are safe to use as statics
+ * that are filled in from constructor functions.
+ */
+template <typename K, typename V, size_t Capacity, typename Key = pool_map_key<K>> class pool_map {
+public:
+    static constexpr size_t NumberOfSlots = pool_map_slots(Capacity);
+
+private:
+    static constexpr size_t Mask = NumberOfSlots - 1;
+
+    struct slot_t {
+        K key;
+        V value;
+        bool used;
+    };
+
+    slot_t slots_[NumberOfSlots];
+    size_t size_;
+
+public:
+    constexpr pool_map() : slots_{}, size_{ 0 } {
+    }
+
+public:
+    size_t size() const {
+        return size_;
+    }
+
+    constexpr size_t capacity() const {
+        return Capacity;
+    }
+
+    bool full() const {
+        return size_ == Capacity;
+    }
+
+    bool get(K const &key, V &value) const {
+        auto slot = lookup(key);
+        if (slot == nullptr) {
+            return false;
+        }
+        value = slot->value;
+        return true;
+    }
+
+    V *find(K const &key) {
+        auto slot = const_cast<slot_t *>(lookup(key));
+        if (slot == nullptr) {
+            return nullptr;
+        }
+        return &slot->value;
+    }
+
+    /**
+     * Adds or replaces the value for key, returns false if the key is new
+     * and the map is already full.
+     */
+    bool put(K const &key, V const &value) {
+        auto i = home(key);
+        for (auto n = 0u; n < NumberOfSlots; ++n, i = (i + 1) & Mask) {
+            auto &slot = slots_[i];
+            if (!slot.used) {
+                if (full()) {
+                    return false;
+                }
+                slot.key = key;
+                slot.value = value;
+                slot.used = true;
+                size_++;
+                return true;
+            }
+            if (Key::equal(slot.key, key)) {
+                slot.value = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool remove(K const &key) {
+        auto slot = lookup(key);
+        if (slot == nullptr) {
+            return false;
+        }
+
+        // Shift the rest of the run back so lookups never need tombstones.
+        auto i = (size_t)(slot - slots_);
+        auto j = i;
+        slots_[i].used = false;
+        while (true) {
+            j = (j + 1) & Mask;
+            if (!slots_[j].used) {
+                break;
+            }
+            auto h = home(slots_[j].key);
+            auto movable = (i <= j) ? (h <= i || h > j) : (h <= i && h > j);
+            if (movable) {
+                slots_[i] = slots_[j];
+                slots_[j].used = false;
+                i = j;
+            }
+        }
+
+        size_--;
+        return true;
+    }
+
+    void clear() {
+        for (auto &slot : slots_) {
+            slot.used = false;
+        }
+        size_ = 0;
+    }
+
+private:
+    static size_t home(K const &key) {
+        return Key::hash(key) & Mask;
+    }
+
+    slot_t const *lookup(K const &key) const {
+        auto i = home(key);
+        for (auto n = 0u; n < NumberOfSlots; ++n, i = (i + 1) & Mask) {
+            auto &slot = slots_[i];
+            if (!slot.used) {
+                return nullptr;
+            }
+            if (Key::equal(slot.key, key)) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+};
+
 } // namespace fk
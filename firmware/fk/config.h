@@ -153,11 +153,56 @@ constexpr uint32_t ConfigurationCheckIntervalMs = 500;
  */
 constexpr size_t StandardPageSize = 8192;
 
+/**
+ * How often a task waiting on a standard page checks for a free one.
+ */
+constexpr uint32_t StandardPageWaitPollMs = 10;
+
+/**
+ * How long a StandardPool waits for a page to grow into before giving up,
+ * rather than rebooting the moment pages run out. Tasks holding locks
+ * never wait.
+ */
+constexpr uint32_t StandardPoolGrowWaitMs = FiveSecondsMs;
+
 /**
  * Size of the circular buffer that stores logs.
  */
 constexpr size_t InMemoryLogBufferSize = 32768;
 
+/**
+ * Largest binary log record, after encoding. Longer ones are truncated
+ * by dropping trailing arguments.
+ */
+constexpr size_t BinaryLogMaximumRecordSize = 192;
+
+/**
+ * String arguments are copied into binary log records, this long at most.
+ */
+constexpr size_t BinaryLogMaximumStringLength = 48;
+
+/**
+ * Number of records tasks can log before the idle task drains the ring
+ * into the log buffer, after which records are written synchronously
+ * under the RTT lock. At LogRingSlotSize each this is a little over 4k
+ * of RAM.
+ */
+constexpr size_t LogRingSlots = 16;
+
+/**
+ * How long a log ring slot can sit reserved but unpublished, holding up
+ * everything logged after it, before the drain gives up on it. Only a
+ * task stopped midway through logging should ever get near this.
+ */
+constexpr uint32_t LogRingStalledSlotMs = 1000;
+
+/**
+ * Largest record in the log ring. Binary records always fit, text lines
+ * get about 200 characters after their prefix and longer ones are
+ * truncated. Binary records are already held to less than this.
+ */
+constexpr size_t LogRingSlotSize = 256;
+
 /**
  * Size of the network buffers.
  */
@@ -183,6 +228,13 @@ constexpr size_t IoBufferSize = 1024;
  */
 constexpr size_t LinkedBufferSize = 256;
 
+/**
+ * Number of items in each segment of a protobuf array that's grown while
+ * decoding. Segments are never copied, so this only bounds the waste in the
+ * last one.
+ */
+constexpr size_t ProtobufArraySegmentItems = 8;
+
 /**
  * Maximum size to use for buffers allocated on the stack.
  */
@@ -404,10 +456,21 @@ constexpr size_t HttpFixedRoutes = 7;
 
 /**
  * The maximum number of HTTP routes that can be registered. Trying to register
- * more than this will fail. This is a function of the maximum number of modules
- * and the number of fixed routes.
+ * more than this will fail. Modules share a single route, with their position
+ * as a path parameter, and so this is the fixed routes and that one.
  */
-constexpr size_t HttpMaximumRoutes = MaximumNumberOfPhysicalModules + HttpFixedRoutes;
+constexpr size_t HttpMaximumRoutes = HttpFixedRoutes + 1;
+
+/**
+ * The maximum number of path segments, across all routes, in the compiled
+ * route table. Routes sharing a prefix share those segments.
+ */
+constexpr size_t HttpMaximumRouteNodes = HttpMaximumRoutes * 3;
+
+/**
+ * The maximum number of path parameters in a single route.
+ */
+constexpr size_t HttpMaximumRouteParameters = 2;
 
 /**
  * Maximum size of all the headers in an HTTP request.
@@ -419,6 +482,26 @@ constexpr size_t HttpMaximumHeaderSize = 1024;
  */
 constexpr size_t HttpConnectionBufferSize = 1024;
 
+/**
+ * Replies up to this size are encoded once and held in the pool while
+ * they're written, anything larger is sized and then encoded again
+ * straight to the connection.
+ */
+constexpr size_t HttpMaximumBufferedReplySize = 4096;
+
+/**
+ * Maximum number of requests served over one kept alive connection,
+ * after this the reply says Connection: close. Every request allocates
+ * from the connection's pool, so this bounds how much that can grow.
+ */
+constexpr uint32_t HttpKeepAliveMaximumRequests = 8;
+
+/**
+ * Size of the buffer holding the last encoded status reply, larger
+ * replies are encoded every time.
+ */
+constexpr size_t StatusReplyCacheSize = 4096;
+
 /**
  * Maximum length of API urls.
  */
@@ -481,6 +564,51 @@ constexpr int32_t StorageAvailableBlockLookAhead = 10;
 #endif
 constexpr size_t StorageMaximumNumberOfMemoryBanks = FK_MAXIMUM_NUMBER_OF_MEMORY_BANKS;
 
+/**
+ * Number of flash pages Storage keeps in its write-back cache. These share
+ * a single standard page, so this is capped by how many of the memory's
+ * pages fit in one.
+ */
+#define FK_STORAGE_CACHE_PAGES 4
+constexpr size_t StorageCachePages = FK_STORAGE_CACHE_PAGES;
+
+/**
+ * Which of phylum's page caches dhara uses to remember where sectors live,
+ * saving a walk of its radix tree on flash for every sector it finds.
+ */
+#define FK_PHYLUM_PAGE_CACHE_NONE   0
+#define FK_PHYLUM_PAGE_CACHE_SIMPLE 1
+#define FK_PHYLUM_PAGE_CACHE_CLOCK  2
+#if !defined(FK_PHYLUM_PAGE_CACHE)
+#define FK_PHYLUM_PAGE_CACHE FK_PHYLUM_PAGE_CACHE_CLOCK
+#endif
+
+/**
+ * Standard pages to leave free for everybody else when mounting, the
+ * phylum page cache takes a page of its own only if there are more than
+ * this many free.
+ */
+constexpr size_t PhylumPageCacheReservedPages = 8;
+
+/**
+ * Mounted storage keeps several standard pages, when a borrower is done
+ * and fewer than this many are free the session unmounts to give them
+ * back.
+ */
+constexpr size_t StorageSessionReservedPages = 4;
+
+/**
+ * Backups append new records to a segment file on the SD card until it
+ * grows past this, and then start a new segment.
+ */
+constexpr uint32_t BackupSegmentSize = 1024 * 1024;
+
+/**
+ * Number of records a backup copies before closing the segment and
+ * saving its progress, an interrupted backup resumes from there.
+ */
+constexpr uint32_t BackupRecordsPerCommit = 1000;
+
 // -------------------------------------------------------------------------------------------
 // Debug
 
@@ -522,6 +650,12 @@ constexpr uint32_t OtherBankAddress = FK_MEMORY_FLASH_ADDRESS_UPGRADE_BASE;
  */
 constexpr size_t NumberOfWorkerTasks = 2;
 
+/**
+ * Number of workers that can wait for a free worker task, launching more
+ * than this while every task is busy drops them.
+ */
+constexpr size_t WorkerQueueSize = 8;
+
 #if !defined(FK_TASK_STACK_SIZE_BYTES)
 #define FK_TASK_STACK_SIZE_BYTES (4096 + 2048)
 #endif
@@ -119,15 +119,15 @@ bool fill_calibration(fk_data_Calibration *cfg, calibration_t *cal) {
 
     if (cfg->points.arg != nullptr) {
         auto points_array = reinterpret_cast<pb_array_t *>(cfg->points.arg);
-        auto points = reinterpret_cast<fk_data_CalibrationPoint *>(points_array->buffer);
         for (auto i = 0u; i < points_array->length; ++i) {
-            auto uncalibrated_array = reinterpret_cast<pb_array_t *>(points[i].uncalibrated.arg);
-            auto references_array = reinterpret_cast<pb_array_t *>(points[i].references.arg);
-            auto factory_array = reinterpret_cast<pb_array_t *>(points[i].factory.arg);
-            auto uncalibrated = reinterpret_cast<float *>(uncalibrated_array->buffer);
-            auto references = reinterpret_cast<float *>(references_array->buffer);
-            auto factory = reinterpret_cast<float *>(factory_array->buffer);
-            loginfo("curve[%d]: uncal=%f ref=%f factory=%f", i, uncalibrated[0], references[0], factory[0]);
+            auto point = points_array->item<fk_data_CalibrationPoint>(i);
+            auto uncalibrated_array = reinterpret_cast<pb_array_t *>(point->uncalibrated.arg);
+            auto references_array = reinterpret_cast<pb_array_t *>(point->references.arg);
+            auto factory_array = reinterpret_cast<pb_array_t *>(point->factory.arg);
+            auto uncalibrated = uncalibrated_array->item<float>(0);
+            auto references = references_array->item<float>(0);
+            auto factory = factory_array->item<float>(0);
+            loginfo("curve[%d]: uncal=%f ref=%f factory=%f", i, *uncalibrated, *references, *factory);
         }
     } else {
         logwarn("load-cal: curve missing points");
@@ -161,9 +161,8 @@ bool fill_calibration(fk_data_Calibration *cfg, calibration_t *cal) {
         return false;
     }
 
-    auto values = reinterpret_cast<float *>(values_array->buffer);
     for (auto i = 0u; i < values_array->length; ++i) {
-        cal->coefficients[i] = values[i];
+        cal->coefficients[i] = *values_array->item<float>(i);
     }
     cal->type = curve_type;
     cal->kind = cfg->kind;
@@ -187,9 +186,8 @@ bool fill_calibration_config(fk_data_ModuleConfiguration *cfg, calibration_confi
     if (cfg->calibrations.arg != nullptr) {
         loginfo("load-cal: multiple");
         auto calibrations_array = reinterpret_cast<pb_array_t *>(cfg->calibrations.arg);
-        auto calibrations = reinterpret_cast<fk_data_Calibration *>(calibrations_array->buffer);
         for (auto i = 0u; i < calibrations_array->length; ++i) {
-            if (!fill_calibration(&calibrations[i], &cal->calibrations[i])) {
+            if (!fill_calibration(calibrations_array->item<fk_data_Calibration>(i), &cal->calibrations[i])) {
                 return false;
             }
         }
@@ -148,6 +148,10 @@ void HomeView::tick(ViewController *views, Pool &pool) {
 
     auto index = 0u;
     for (auto &info : workers) {
+        // Only running workers have a spot on the screen.
+        if (info.queued || index == NumberOfWorkerTasks) {
+            continue;
+        }
         screen.workers[index].visible = info.visible;
         screen.workers[index].name = info.name;
         screen.workers[index].progress = info.progress;
@@ -3,6 +3,7 @@
 #include "hal/hal.h"
 #include "hal/memory.h"
 #include "hal/sd_card.h"
+#include "storage/storage_session.h"
 #include "hal/clock.h"
 
 #include "records.h"
@@ -20,13 +21,14 @@ ExportDataWorker::ExportDataWorker(DataMemory *data_memory) : data_memory_(data_
 void ExportDataWorker::run(Pool &pool) {
     auto lock = storage_mutex.acquire(UINT32_MAX);
 
-    StatisticsMemory memory{ data_memory_ };
-    Storage storage{ &memory, pool };
-    if (!storage.begin()) {
+    BorrowedStorage borrowed{ lock, data_memory_ };
+    if (!borrowed) {
         logerror("error opening storage");
         return;
     }
 
+    auto &storage = *borrowed;
+
     auto sd = get_sd_card();
     if (!sd->begin()) {
         logerror("error opening sd card");
@@ -205,21 +207,20 @@ bool ExportDataWorker::lookup_meta(uint32_t meta_record_number, FileReader *meta
 
 bool ExportDataWorker::write_header() {
     auto modules_array = reinterpret_cast<pb_array_t *>(meta_record_.record()->modules.arg);
-    auto modules = reinterpret_cast<fk_data_ModuleInfo *>(modules_array->buffer);
 
     StackBufferedWriter<StackBufferSize> writer{ writing_ };
 
     writer.write("time,unix_time,data_record,meta_record,uptime,gps,latitude,longitude,altitude,gps_time,note");
 
     for (auto i = 0u; i < modules_array->length; ++i) {
-        auto &module = modules[i];
+        auto &module = *modules_array->item<fk_data_ModuleInfo>(i);
         auto sensors_array = reinterpret_cast<pb_array_t *>(module.sensors.arg);
-        auto sensors = reinterpret_cast<fk_data_SensorInfo *>(sensors_array->buffer);
 
         writer.write(",module_index,module_position,module_name");
 
         for (auto j = 0u; j < sensors_array->length; ++j) {
-            writer.write(",%s,%s_raw_v", (const char *)sensors[j].name.arg, (const char *)sensors[j].name.arg);
+            auto name = (const char *)sensors_array->item<fk_data_SensorInfo>(j)->name.arg;
+            writer.write(",%s,%s_raw_v", name, name);
         }
     }
 
@@ -233,9 +234,6 @@ ExportDataWorker::WriteStatus ExportDataWorker::write_row(fk_data_DataRecord &re
     auto modules_array = reinterpret_cast<pb_array_t *>(meta_record_.record()->modules.arg);
     auto sensor_groups_array = reinterpret_cast<pb_array_t *>(record.readings.sensorGroups.arg);
 
-    auto modules = reinterpret_cast<fk_data_ModuleInfo *>(modules_array->buffer);
-    auto sensor_groups = reinterpret_cast<fk_data_SensorGroup *>(sensor_groups_array->buffer);
-
     StackBufferedWriter<StackBufferSize> writer{ writing_ };
 
     FormattedTime formatted{ (uint32_t)record.readings.time, TimeFormatReadable };
@@ -251,16 +249,16 @@ ExportDataWorker::WriteStatus ExportDataWorker::write_row(fk_data_DataRecord &re
     }
 
     for (auto i = 0u; i < sensor_groups_array->length; ++i) {
-        auto &sensor_group = sensor_groups[i];
+        auto &sensor_group = *sensor_groups_array->item<fk_data_SensorGroup>(i);
         auto sensor_values_array = reinterpret_cast<pb_array_t *>(sensor_group.readings.arg);
-        auto sensor_values = reinterpret_cast<fk_data_SensorAndValue *>(sensor_values_array->buffer);
 
-        auto &module = modules[i];
+        auto &module = *modules_array->item<fk_data_ModuleInfo>(i);
 
         writer.write(",%d,%d,%s", i, sensor_group.module, (const char *)module.name.arg);
 
         for (auto j = 0u; j < sensor_values_array->length; ++j) {
-            writer.write(",%f,%f", sensor_values[j].calibrated.calibratedValue, sensor_values[j].uncalibrated.uncalibratedValue);
+            auto sensor_value = sensor_values_array->item<fk_data_SensorAndValue>(j);
+            writer.write(",%f,%f", sensor_value->calibrated.calibratedValue, sensor_value->uncalibrated.uncalibratedValue);
         }
     }
 
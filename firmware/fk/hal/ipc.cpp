@@ -4,6 +4,15 @@
 
 namespace fk {
 
+uint32_t worker_category_limit(WorkerCategory category) {
+    switch (category) {
+    case WorkerCategory::None:
+        return NumberOfWorkerTasks + WorkerQueueSize;
+    default:
+        return 1;
+    }
+}
+
 class SingleThreadedIPC : public IPC {
 public:
     bool available() override {
@@ -18,6 +18,12 @@ enum class WorkerCategory {
     Lora,
 };
 
+/**
+ * How many workers of a category may run or wait to run at once, unless
+ * they were launched with concurrency allowed.
+ */
+uint32_t worker_category_limit(WorkerCategory category);
+
 class IPC {
 public:
     virtual bool available() = 0;
@@ -45,6 +51,14 @@ public:
 
     virtual bool fork_worker(WorkerCategory category, TaskWorker *worker) = 0;
 
+    /**
+     * Launches the worker only if a task is free right now, rather than
+     * queueing it behind other workers.
+     */
+    virtual bool try_launch_worker(WorkerCategory category, TaskWorker *worker) {
+        return launch_worker(category, worker, true);
+    }
+
     virtual bool launch_worker(TaskWorker *worker) {
         return launch_worker(WorkerCategory::None, worker);
     }
@@ -53,6 +67,15 @@ public:
         return false;
     }
 
+    /**
+     * Called by a worker task when its worker is done, returns the queued
+     * worker that task should run next or nullptr if there isn't one.
+     */
+    virtual TaskWorker *next_worker(TaskWorker *finished) {
+        remove_worker(finished);
+        return nullptr;
+    }
+
     virtual bool signal_workers(WorkerCategory category, uint32_t signal) {
         return true;
     }
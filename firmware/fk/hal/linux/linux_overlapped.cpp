@@ -0,0 +1,62 @@
+#include "hal/linux/linux_overlapped.h"
+
+#if defined(linux)
+
+namespace fk {
+
+void LinuxOverlappedWriter::ChunkQueue::enqueue(Chunk *chunk) {
+    {
+        std::lock_guard<std::mutex> lock{ mutex_ };
+        FK_ASSERT(size_ < NumberOfSlots);
+        chunks_[(head_ + size_) % NumberOfSlots] = chunk;
+        size_++;
+    }
+    cv_.notify_one();
+}
+
+OverlappedWriter::Chunk *LinuxOverlappedWriter::ChunkQueue::dequeue() {
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    cv_.wait(lock, [this] { return size_ > 0; });
+    auto chunk = chunks_[head_];
+    head_ = (head_ + 1) % NumberOfSlots;
+    size_--;
+    return chunk;
+}
+
+LinuxOverlappedWriter::LinuxOverlappedWriter() {
+}
+
+LinuxOverlappedWriter::~LinuxOverlappedWriter() {
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool LinuxOverlappedWriter::start() {
+    thread_ = std::thread{ [this] { consume(); } };
+    return true;
+}
+
+void LinuxOverlappedWriter::join() {
+    thread_.join();
+}
+
+OverlappedWriter::Chunk *LinuxOverlappedWriter::take_queued() {
+    return queued_.dequeue();
+}
+
+void LinuxOverlappedWriter::put_queued(Chunk *chunk) {
+    queued_.enqueue(chunk);
+}
+
+OverlappedWriter::Chunk *LinuxOverlappedWriter::take_written() {
+    return written_.dequeue();
+}
+
+void LinuxOverlappedWriter::put_written(Chunk *chunk) {
+    written_.enqueue(chunk);
+}
+
+} // namespace fk
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+#if defined(linux)
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "hal/overlapped.h"
+
+namespace fk {
+
+class LinuxOverlappedWriter : public OverlappedWriter {
+private:
+    class ChunkQueue {
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        Chunk *chunks_[NumberOfSlots];
+        size_t head_{ 0 };
+        size_t size_{ 0 };
+
+    public:
+        void enqueue(Chunk *chunk);
+        Chunk *dequeue();
+    };
+
+    ChunkQueue queued_;
+    ChunkQueue written_;
+    std::thread thread_;
+
+public:
+    LinuxOverlappedWriter();
+    ~LinuxOverlappedWriter() override;
+
+protected:
+    bool start() override;
+    void join() override;
+    Chunk *take_queued() override;
+    void put_queued(Chunk *chunk) override;
+    Chunk *take_written() override;
+    void put_written(Chunk *chunk) override;
+};
+
+} // namespace fk
+
+#endif
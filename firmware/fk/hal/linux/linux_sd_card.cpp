@@ -1,5 +1,9 @@
 #include "hal/linux/linux.h"
 
+#if defined(linux)
+
+#include <cstring>
+
 namespace fk {
 
 LinuxSdCard::LinuxSdCard() {
@@ -26,55 +30,137 @@ bool LinuxSdCard::close_logs() {
 }
 
 bool LinuxSdCard::is_file(const char *path) {
-    return false;
+    return files_.find(path) != files_.end();
 }
 
 bool LinuxSdCard::is_directory(const char *path) {
-    return false;
+    return directories_.find(path) != directories_.end();
 }
 
 bool LinuxSdCard::mkdir(const char *path) {
+    directories_.emplace(path);
     return true;
 }
 
 bool LinuxSdCard::unlink(const char *path) {
-    return false;
+    return files_.erase(path) > 0;
 }
 
 SdCardFile *LinuxSdCard::open(const char *path, OpenFlags flags, Pool &pool) {
+    auto existing = files_.find(path);
+
+    // Same as the flags used on hardware, only Read and AppendExisting
+    // open a file that's already there.
+    switch (flags) {
+    case OpenFlags::Read: {
+        if (existing == files_.end()) {
+            return new (pool) LinuxSdCardFile();
+        }
+        return new (pool) LinuxSdCardFile(&existing->second, false);
+    }
+    case OpenFlags::AppendExisting: {
+        return new (pool) LinuxSdCardFile(&files_[path], true);
+    }
+    case OpenFlags::Write:
+    case OpenFlags::Append: {
+        if (existing != files_.end()) {
+            return new (pool) LinuxSdCardFile();
+        }
+        return new (pool) LinuxSdCardFile(&files_[path], true);
+    }
+    }
+
     return new (pool) LinuxSdCardFile();
 }
 
 bool LinuxSdCard::format() {
-    return false;
+    clear();
+    return true;
+}
+
+std::vector<uint8_t> *LinuxSdCard::file(const char *path) {
+    auto existing = files_.find(path);
+    if (existing == files_.end()) {
+        return nullptr;
+    }
+    return &existing->second;
+}
+
+void LinuxSdCard::clear() {
+    files_.clear();
+    directories_.clear();
+}
+
+LinuxSdCardFile::LinuxSdCardFile() {
+}
+
+LinuxSdCardFile::LinuxSdCardFile(std::vector<uint8_t> *data, bool writable)
+    : data_(data), position_(writable ? data->size() : 0), writable_(writable) {
 }
 
 int32_t LinuxSdCardFile::write(uint8_t const *buffer, size_t size) {
-    return 0;
+    if (data_ == nullptr || !writable_) {
+        return -1;
+    }
+
+    data_->insert(data_->end(), buffer, buffer + size);
+    position_ = data_->size();
+
+    return size;
 }
 
 int32_t LinuxSdCardFile::read(uint8_t *buffer, size_t size) {
-    return 0;
+    if (data_ == nullptr) {
+        return -1;
+    }
+
+    auto reading = std::min(size, data_->size() - position_);
+    memcpy(buffer, data_->data() + position_, reading);
+    position_ += reading;
+
+    return reading;
 }
 
 int32_t LinuxSdCardFile::seek_beginning() {
+    position_ = 0;
     return 0;
 }
 
 int32_t LinuxSdCardFile::seek_end() {
+    if (data_ != nullptr) {
+        position_ = data_->size();
+    }
     return 0;
 }
 
 int32_t LinuxSdCardFile::seek_from_end(int32_t offset) {
+    if (data_ != nullptr) {
+        position_ = data_->size() - std::min<size_t>(offset, data_->size());
+    }
     return 0;
 }
 
+bool LinuxSdCardFile::truncate(size_t size) {
+    if (data_ == nullptr || !writable_ || size > data_->size()) {
+        return false;
+    }
+
+    data_->resize(size);
+    position_ = std::min(position_, size);
+
+    return true;
+}
+
 size_t LinuxSdCardFile::file_size() {
-    return 0;
+    return data_ == nullptr ? 0 : data_->size();
 }
 
 bool LinuxSdCardFile::close() {
-    return true;
+    auto was_open = data_ != nullptr;
+    data_ = nullptr;
+    return was_open;
 }
 
 } // namespace fk
+
+#endif
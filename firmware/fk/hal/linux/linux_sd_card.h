@@ -1,10 +1,25 @@
 #pragma once
 
+#if defined(linux)
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
 #include "hal/sd_card.h"
 
 namespace fk {
 
+/**
+ * Keeps files in memory so that hosted tests can check what was written
+ * and workers can read back what they wrote earlier.
+ */
 class LinuxSdCard : public SdCard {
+private:
+    std::map<std::string, std::vector<uint8_t>> files_;
+    std::set<std::string> directories_;
+
 public:
     LinuxSdCard();
 
@@ -20,20 +35,43 @@ public:
     bool unlink(const char *path) override;
     SdCardFile *open(const char *path, OpenFlags flags, Pool &pool) override;
     bool format() override;
+
+public:
+    /**
+     * Contents of the file at path, or nullptr if there isn't one.
+     */
+    std::vector<uint8_t> *file(const char *path);
+
+    /**
+     * Removes every file and directory.
+     */
+    void clear();
 };
 
 class LinuxSdCardFile : public SdCardFile {
+private:
+    std::vector<uint8_t> *data_{ nullptr };
+    size_t position_{ 0 };
+    bool writable_{ false };
+
+public:
+    LinuxSdCardFile();
+    LinuxSdCardFile(std::vector<uint8_t> *data, bool writable);
+
 public:
     int32_t write(uint8_t const *buffer, size_t size) override;
     int32_t read(uint8_t *buffer, size_t size) override;
     int32_t seek_beginning() override;
     int32_t seek_end() override;
     int32_t seek_from_end(int32_t offset) override;
+    bool truncate(size_t size) override;
     size_t file_size() override;
     bool close() override;
     bool is_open() const override {
-        return false;
+        return data_ != nullptr;
     }
 };
 
 } // namespace fk
+
+#endif
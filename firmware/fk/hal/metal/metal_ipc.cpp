@@ -105,47 +105,100 @@ bool MetalIPC::dequeue_topology(Activity **ptr, uint32_t to) {
     return true;
 }
 
-bool MetalIPC::can_launch(WorkerCategory category, Lock & /*required_lock*/) {
-    if (category == WorkerCategory::None) {
-        return true;
-    }
+uint32_t MetalIPC::running(WorkerCategory category, Lock & /*required_lock*/) {
+    auto n = 0u;
 
     for (auto i = 0u; i < NumberOfWorkerTasks; ++i) {
         if (os_task_is_running(&worker_tasks[i])) {
             if (running_[i] == category) {
-                return false;
+                n++;
             }
         }
     }
 
-    return true;
+    return n;
+}
+
+bool MetalIPC::can_launch(WorkerCategory category, Lock &required_lock) {
+    // Queued workers count against the limit, so we don't wind up with
+    // the same work waiting twice.
+    return running(category, required_lock) + queue_.count(category) < worker_category_limit(category);
+}
+
+void MetalIPC::start_task(size_t task, WorkerCategory category, TaskWorker *worker, uint32_t now) {
+    os_task_set_name(&worker_tasks[task], worker->name());
+    running_[task] = category;
+    workers_[task] = worker;
+    started_[task] = now;
+
+    auto priority = worker->priority();
+    OS_CHECK(os_task_start_options(&worker_tasks[task], priority, worker));
+}
+
+bool MetalIPC::start_worker(WorkerCategory category, TaskWorker *worker, Lock & /*required_lock*/) {
+    for (auto i = 0u; i < NumberOfWorkerTasks; ++i) {
+        if (!os_task_is_running(&worker_tasks[i])) {
+            start_task(i, category, worker, fk_uptime());
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t MetalIPC::start_queued(Lock &lock) {
+    if (queue_.empty()) {
+        return 0;
+    }
+
+    auto now = fk_uptime();
+    return queue_.start_idle(
+        NumberOfWorkerTasks, now, [&](size_t task) { return !os_task_is_running(&worker_tasks[task]); },
+        [&](WorkerCategory category, bool concurrency_allowed) {
+            return concurrency_allowed || running(category, lock) < worker_category_limit(category);
+        },
+        [&](size_t task, QueuedWorker &queued) {
+            loginfo("starting queued %s waited %" PRIu32 "ms (%zu queued)", queued.worker->name(), now - queued.queued, queue_.size());
+            start_task(task, queued.category, queued.worker, now);
+        });
 }
 
 bool MetalIPC::launch_worker(WorkerCategory category, TaskWorker *worker, bool concurrency_allowed) {
     auto lock = workers_mutex.acquire(UINT32_MAX);
     FK_ASSERT(lock);
 
+    // Anything still queued has waited longer than we have.
+    start_queued(lock);
+
     if (!concurrency_allowed && !can_launch(category, lock)) {
         logwarn("unable to launch %s, already running", worker->name());
         delete worker;
         return false;
     }
 
-    for (auto i = 0u; i < NumberOfWorkerTasks; ++i) {
-        if (!os_task_is_running(&worker_tasks[i])) {
-            os_task_set_name(&worker_tasks[i], worker->name());
-            running_[i] = category;
-            workers_[i] = worker;
-            started_[i] = fk_uptime();
+    if (start_worker(category, worker, lock)) {
+        return true;
+    }
 
-            auto priority = worker->priority();
-            OS_CHECK(os_task_start_options(&worker_tasks[i], priority, worker));
+    if (!queue_.push(category, worker, concurrency_allowed, fk_uptime())) {
+        logwarn("all workers are busy, queue full");
+        delete worker;
+        return false;
+    }
 
-            return true;
-        }
+    loginfo("queued %s (%zu queued)", worker->name(), queue_.size());
+
+    return true;
+}
+
+bool MetalIPC::try_launch_worker(WorkerCategory category, TaskWorker *worker) {
+    auto lock = workers_mutex.acquire(UINT32_MAX);
+    FK_ASSERT(lock);
+
+    if (start_worker(category, worker, lock)) {
+        return true;
     }
 
-    logwarn("all workers are busy");
     delete worker;
     return false;
 }
@@ -171,12 +224,56 @@ bool MetalIPC::remove_worker(TaskWorker *worker) {
     return false;
 }
 
+TaskWorker *MetalIPC::next_worker(TaskWorker *finished) {
+    auto lock = workers_mutex.acquire(UINT32_MAX);
+    FK_ASSERT(lock);
+
+    for (auto i = 0u; i < NumberOfWorkerTasks; ++i) {
+        if (workers_[i] == finished) {
+            running_[i] = WorkerCategory::None;
+            workers_[i] = nullptr;
+            started_[i] = 0;
+
+            auto now = fk_uptime();
+            QueuedWorker next;
+            auto found = queue_.pop(next, now, [&](WorkerCategory category, bool concurrency_allowed) {
+                return concurrency_allowed || running(category, lock) < worker_category_limit(category);
+            });
+            if (!found) {
+                return nullptr;
+            }
+
+            auto &stats = queue_.statistics();
+            loginfo("dequeued %s waited %" PRIu32 "ms (%zu queued, %" PRIu32 "ms avg, %" PRIu32 "ms max, %" PRIu32 " dropped)",
+                    next.worker->name(), now - next.queued, queue_.size(), stats.total_wait / stats.started, stats.longest_wait,
+                    stats.dropped);
+
+            // We're still running on this task, so it picks up the next
+            // worker as soon as we return.
+            os_task_set_name(&worker_tasks[i], next.worker->name());
+            OS_CHECK(os_task_set_priority(&worker_tasks[i], next.worker->priority()));
+            running_[i] = next.category;
+            workers_[i] = next.worker;
+            started_[i] = now;
+
+            return next.worker;
+        }
+    }
+
+    return nullptr;
+}
+
 bool MetalIPC::signal_workers(WorkerCategory category, uint32_t signal) {
     auto lock = workers_mutex.acquire(UINT32_MAX);
     FK_ASSERT(lock);
 
     logdebug("signaling workers (%" PRIu32 ")", signal);
 
+    auto removed = queue_.remove(category, [](TaskWorker *worker) { delete worker; });
+    if (removed > 0) {
+        loginfo("removed %zu queued workers", removed);
+    }
+
     for (auto i = 0u; i < NumberOfWorkerTasks; ++i) {
         if (os_task_is_running(&worker_tasks[i])) {
             if (running_[i] == category) {
@@ -204,6 +301,14 @@ collection<TaskDisplayInfo> MetalIPC::get_workers_display_info(Pool &pool) {
         }
     }
 
+    auto now = fk_uptime();
+    for (auto i = 0u; i < queue_.size(); ++i) {
+        auto info = queue_[i].worker->display_info();
+        info.queued = true;
+        info.waiting = now - queue_[i].queued;
+        infos.emplace(info);
+    }
+
     return infos;
 }
 
@@ -259,7 +364,11 @@ bool MetalIPC::has_any_running_worker() {
     auto lock = workers_mutex.acquire(UINT32_MAX);
     FK_ASSERT(lock);
 
-    auto found = false;
+    // We're polled before sleeping, so this is where workers queued while
+    // a task was finishing get started.
+    start_queued(lock);
+
+    auto found = !queue_.empty();
 
     for (auto i = 0u; i < NumberOfWorkerTasks; ++i) {
         if (os_task_is_running(&worker_tasks[i])) {
@@ -277,6 +386,9 @@ void MetalIPC::verify() {
             FK_ASSERT_ADDRESS(workers_[i]);
         }
     }
+    for (auto i = 0u; i < queue_.size(); ++i) {
+        FK_ASSERT_ADDRESS(queue_[i].worker);
+    }
 }
 
 bool MetalMutex::create() {
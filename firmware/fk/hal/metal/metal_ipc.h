@@ -7,6 +7,7 @@
 #include "config.h"
 #include "hal/ipc.h"
 #include "hal/mutex.h"
+#include "hal/worker_queue.h"
 
 namespace fk {
 
@@ -15,6 +16,7 @@ private:
     WorkerCategory running_[NumberOfWorkerTasks];
     uint32_t started_[NumberOfWorkerTasks];
     TaskWorker *workers_[NumberOfWorkerTasks];
+    WorkerQueue queue_;
 
 public:
     MetalIPC();
@@ -34,7 +36,9 @@ public:
 public:
     bool launch_worker(WorkerCategory category, TaskWorker *worker, bool concurrency_allowed) override;
     bool fork_worker(WorkerCategory category, TaskWorker *worker) override;
+    bool try_launch_worker(WorkerCategory category, TaskWorker *worker) override;
     bool remove_worker(TaskWorker *worker) override;
+    TaskWorker *next_worker(TaskWorker *finished) override;
     bool signal_workers(WorkerCategory category, uint32_t signal) override;
     collection<TaskDisplayInfo> get_workers_display_info(Pool &pool) override;
     bool has_running_worker(WorkerCategory category) override;
@@ -43,6 +47,10 @@ public:
 
 private:
     bool can_launch(WorkerCategory category, Lock &required_lock);
+    uint32_t running(WorkerCategory category, Lock &required_lock);
+    bool start_worker(WorkerCategory category, TaskWorker *worker, Lock &required_lock);
+    void start_task(size_t task, WorkerCategory category, TaskWorker *worker, uint32_t now);
+    size_t start_queued(Lock &required_lock);
 };
 
 class MetalMutex : public Mutex {
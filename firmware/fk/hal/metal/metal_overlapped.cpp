@@ -0,0 +1,86 @@
+#include "hal/metal/metal_overlapped.h"
+#include "hal/hal.h"
+
+#if defined(__SAMD51__)
+
+namespace fk {
+
+FK_DECLARE_LOGGER("overlapped");
+
+class MetalOverlappedWriter::ConsumerWorker : public Worker {
+private:
+    MetalOverlappedWriter *writer_;
+
+public:
+    ConsumerWorker(MetalOverlappedWriter *writer) : writer_(writer) {
+    }
+
+public:
+    void run(Pool &pool) override {
+        writer_->consume();
+
+        // This is our last touch of the writer, which may be gone as
+        // soon as this is dequeued. Our own pool goes with the worker.
+        Chunk *none = nullptr;
+        OS_CHECK(os_queue_enqueue(&writer_->done_, &none, UINT32_MAX).status);
+    }
+
+    const char *name() const override {
+        return "ovw-write";
+    }
+
+    TaskDisplayInfo display_info() const override {
+        return {
+            .name = name(),
+            .progress = 0.0f,
+            .visible = false,
+        };
+    }
+};
+
+FK_ENABLE_TYPE_NAME(MetalOverlappedWriter::ConsumerWorker);
+
+MetalOverlappedWriter::MetalOverlappedWriter() {
+    OS_CHECK(os_queue_create(&queued_, &queued_def_));
+    OS_CHECK(os_queue_create(&written_, &written_def_));
+    OS_CHECK(os_queue_create(&done_, &done_def_));
+}
+
+MetalOverlappedWriter::~MetalOverlappedWriter() {
+}
+
+bool MetalOverlappedWriter::start() {
+    // Writes happen on one of the other worker tasks, if there's one
+    // free. Waiting in the queue would only stall the transfer, so we
+    // only go if there's a task free right now.
+    auto worker = create_pool_worker<ConsumerWorker>(this);
+    return get_ipc()->try_launch_worker(WorkerCategory::Transfer, worker);
+}
+
+void MetalOverlappedWriter::join() {
+    OS_CHECK(os_queue_dequeue(&done_, UINT32_MAX).status);
+}
+
+OverlappedWriter::Chunk *MetalOverlappedWriter::take_queued() {
+    auto tuple = os_queue_dequeue(&queued_, UINT32_MAX);
+    OS_CHECK(tuple.status);
+    return reinterpret_cast<Chunk *>(tuple.value.ptr);
+}
+
+void MetalOverlappedWriter::put_queued(Chunk *chunk) {
+    OS_CHECK(os_queue_enqueue(&queued_, &chunk, UINT32_MAX).status);
+}
+
+OverlappedWriter::Chunk *MetalOverlappedWriter::take_written() {
+    auto tuple = os_queue_dequeue(&written_, UINT32_MAX);
+    OS_CHECK(tuple.status);
+    return reinterpret_cast<Chunk *>(tuple.value.ptr);
+}
+
+void MetalOverlappedWriter::put_written(Chunk *chunk) {
+    OS_CHECK(os_queue_enqueue(&written_, &chunk, UINT32_MAX).status);
+}
+
+} // namespace fk
+
+#endif
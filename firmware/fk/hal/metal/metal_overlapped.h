@@ -0,0 +1,40 @@
+#pragma once
+
+#if defined(__SAMD51__)
+
+#include <os.h>
+
+#include "hal/overlapped.h"
+
+namespace fk {
+
+class MetalOverlappedWriter : public OverlappedWriter {
+private:
+    class ConsumerWorker;
+
+    uint8_t queued_buffer_[NumberOfSlots * sizeof(Chunk *)];
+    uint8_t written_buffer_[NumberOfSlots * sizeof(Chunk *)];
+    uint8_t done_buffer_[sizeof(Chunk *)];
+    os_queue_definition_t queued_def_{ "ovw-queued", NumberOfSlots, sizeof(Chunk *), OS_QUEUE_FLAGS_QUEUE_ONLY, queued_buffer_ };
+    os_queue_definition_t written_def_{ "ovw-written", NumberOfSlots, sizeof(Chunk *), OS_QUEUE_FLAGS_QUEUE_ONLY, written_buffer_ };
+    os_queue_definition_t done_def_{ "ovw-done", 1, sizeof(Chunk *), OS_QUEUE_FLAGS_QUEUE_ONLY, done_buffer_ };
+    os_queue_t queued_{ };
+    os_queue_t written_{ };
+    os_queue_t done_{ };
+
+public:
+    MetalOverlappedWriter();
+    ~MetalOverlappedWriter() override;
+
+protected:
+    bool start() override;
+    void join() override;
+    Chunk *take_queued() override;
+    void put_queued(Chunk *chunk) override;
+    Chunk *take_written() override;
+    void put_written(Chunk *chunk) override;
+};
+
+} // namespace fk
+
+#endif
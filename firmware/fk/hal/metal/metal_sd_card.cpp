@@ -391,6 +391,8 @@ SdCardFile *MetalSdCard::open(const char *path, OpenFlags flags, Pool &pool) {
         sd_flags = O_RDONLY;
     } else if (flags == OpenFlags::Append) {
         sd_flags = O_WRONLY | O_CREAT | O_EXCL | O_APPEND;
+    } else if (flags == OpenFlags::AppendExisting) {
+        sd_flags = O_WRONLY | O_CREAT | O_APPEND;
     } else if (flags == OpenFlags::Write) {
         sd_flags = O_WRONLY | O_CREAT | O_EXCL;
     }
@@ -442,6 +444,10 @@ int32_t MetalSdCardFile::seek_from_end(int32_t offset) {
     return 0;
 }
 
+bool MetalSdCardFile::truncate(size_t size) {
+    return file_.truncate(size);
+}
+
 size_t MetalSdCardFile::file_size() {
     return file_.fileSize();
 }
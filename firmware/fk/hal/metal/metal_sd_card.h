@@ -61,6 +61,7 @@ public:
     int32_t seek_beginning() override;
     int32_t seek_end() override;
     int32_t seek_from_end(int32_t offset) override;
+    bool truncate(size_t size) override;
     size_t file_size() override;
     bool is_open() const override;
     bool close() override;
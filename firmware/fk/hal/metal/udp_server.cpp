@@ -11,6 +11,7 @@
 #include "state_ref.h"
 #include "varint.h"
 #include "storage/storage.h"
+#include "storage/storage_session.h"
 
 namespace fk {
 
@@ -560,14 +561,13 @@ bool UDPServer::service(Pool *pool) {
             auto old_level = (LogLevels)log_get_level();
             log_configure_level(LogLevels::INFO);
 
-            StatisticsMemory memory_{ MemoryFactory::get_data_memory() };
-            Storage storage{ &memory_, *pool };
-            if (!storage.begin()) {
+            BorrowedStorage storage{ lock };
+            if (!storage) {
                 logerror("begin failed");
                 return false;
             }
 
-            auto file_reader = storage.file_reader(Storage::Data, *pool);
+            auto file_reader = storage->file_reader(Storage::Data, *pool);
 
             packet_require_t require;
             while (incoming->dequeue(require)) {
@@ -39,6 +39,13 @@ public:
     }
 };
 
+/**
+ * Number of locks the calling task is holding. Tasks holding any
+ * shouldn't block waiting on something another task may need those locks
+ * to give back.
+ */
+uint32_t fk_task_locks_held();
+
 class Mutex;
 class Lock;
 
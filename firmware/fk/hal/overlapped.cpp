@@ -0,0 +1,109 @@
+#include "hal/overlapped.h"
+#include "hal/hal.h"
+#include "hal/metal/metal_overlapped.h"
+#include "hal/linux/linux_overlapped.h"
+#include "platform.h"
+
+namespace fk {
+
+FK_DECLARE_LOGGER("overlapped");
+
+OverlappedWriter::~OverlappedWriter() {
+}
+
+bool OverlappedWriter::begin(Writer *writer) {
+    FK_ASSERT(!running_);
+
+    writer_ = writer;
+    head_ = 0;
+    queued_ = 0;
+    failed_ = false;
+
+    if (!start()) {
+        logwarn("unable to start");
+        return false;
+    }
+
+    running_ = true;
+
+    return true;
+}
+
+void OverlappedWriter::write(uint8_t const *buffer, int32_t size) {
+    FK_ASSERT(running_);
+    FK_ASSERT(writable());
+
+    auto slot = &slots_[(head_ + queued_) % NumberOfSlots];
+    *slot = Chunk{ buffer, size, 0 };
+    queued_++;
+
+    put_queued(slot);
+}
+
+bool OverlappedWriter::written(Chunk &chunk) {
+    if (queued_ == 0) {
+        return false;
+    }
+
+    // Chunks are written in order, so this is always the one at head_.
+    auto slot = take_written();
+    FK_ASSERT(slot == &slots_[head_]);
+
+    head_ = (head_ + 1) % NumberOfSlots;
+    queued_--;
+
+    chunk = *slot;
+
+    return true;
+}
+
+void OverlappedWriter::stop() {
+    if (!running_) {
+        return;
+    }
+
+    FK_ASSERT(queued_ == 0);
+
+    put_queued(&stop_);
+
+    join();
+
+    running_ = false;
+}
+
+void OverlappedWriter::consume() {
+    while (true) {
+        auto slot = take_queued();
+        if (slot == &stop_) {
+            break;
+        }
+
+        if (failed_) {
+            slot->size = -1;
+        } else {
+            auto started = fk_uptime();
+            auto nwrote = writer_->write(slot->buffer, slot->size);
+            slot->write_time = fk_uptime() - started;
+            if (nwrote != slot->size) {
+                failed_ = true;
+                slot->size = -1;
+            }
+        }
+
+        put_written(slot);
+    }
+}
+
+OverlappedWriter *create_overlapped_writer(Pool &pool) {
+#if defined(FK_HARDWARE_FULL)
+#if defined(FK_IPC_SINGLE_THREADED)
+    return nullptr;
+#else
+    return new (pool) MetalOverlappedWriter();
+#endif
+#else
+    return new (pool) LinuxOverlappedWriter();
+#endif
+}
+
+} // namespace fk
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "common.h"
+#include "pool.h"
+#include "io.h"
+
+namespace fk {
+
+/**
+ * Writes chunks to a Writer on another task, so the caller can go on
+ * reading the next chunk while the last one is being written. Chunks
+ * aren't copied, their buffers have to stay put until they're handed
+ * back by written.
+ */
+class OverlappedWriter {
+public:
+    struct Chunk {
+        uint8_t const *buffer;
+        int32_t size;
+        uint32_t write_time;
+    };
+
+    static constexpr size_t NumberOfSlots = 2;
+
+private:
+    Chunk slots_[NumberOfSlots];
+    Chunk stop_{ nullptr, 0, 0 };
+    Writer *writer_{ nullptr };
+    size_t head_{ 0 };
+    size_t queued_{ 0 };
+    volatile bool failed_{ false };
+    bool running_{ false };
+
+public:
+    virtual ~OverlappedWriter();
+
+public:
+    /**
+     * Starts writing queued chunks to writer in the background.
+     */
+    bool begin(Writer *writer);
+
+    /**
+     * Whether another chunk can be queued without waiting for one to be
+     * written first.
+     */
+    bool writable() const {
+        return queued_ < NumberOfSlots;
+    }
+
+    /**
+     * Queues size bytes from buffer to be written, there has to be a
+     * free slot.
+     */
+    void write(uint8_t const *buffer, int32_t size);
+
+    /**
+     * Waits for the oldest queued chunk to be written and hands it back
+     * so its buffer can be reused. The size of a chunk that failed, or
+     * that was skipped after an earlier one failed, is < 0. Returns
+     * false if nothing is queued.
+     */
+    bool written(Chunk &chunk);
+
+    /**
+     * Stops the background task and waits for it to finish, every chunk
+     * has to be handed back first.
+     */
+    void stop();
+
+protected:
+    /**
+     * Writes chunks until we're stopped, this is what runs on the other
+     * task.
+     */
+    void consume();
+
+    virtual bool start() = 0;
+    virtual void join() = 0;
+    virtual Chunk *take_queued() = 0;
+    virtual void put_queued(Chunk *slot) = 0;
+    virtual Chunk *take_written() = 0;
+    virtual void put_written(Chunk *slot) = 0;
+};
+
+/**
+ * Returns nullptr when there's no way to write concurrently, callers
+ * should then read and write serially.
+ */
+OverlappedWriter *create_overlapped_writer(Pool &pool);
+
+} // namespace fk
@@ -1,15 +1,38 @@
 #include <exchange.h>
+#include <os.h>
 
 #include "hal/mutex.h"
 #include "platform.h"
 
 namespace fk {
 
+static uint32_t *task_locks_held() {
+#if defined(__SAMD51__)
+    // Before the scheduler starts everything is one task.
+    static uint32_t starting = 0;
+    auto task = os_task_self();
+    if (task == nullptr) {
+        return &starting;
+    }
+    return &os_task_user_data_get(task)->locks_held;
+#else
+    static thread_local uint32_t held = 0;
+    return &held;
+#endif
+}
+
+uint32_t fk_task_locks_held() {
+    return *task_locks_held();
+}
+
 Lock::Lock() : releasable_(nullptr) {
 }
 
 Lock::Lock(bool exclusive, Releasable *releasable) : exclusive_(exclusive), releasable_(releasable) {
     acquired_ = fk_uptime();
+    if (releasable_ != nullptr) {
+        (*task_locks_held())++;
+    }
 }
 
 Lock::Lock(Lock &&rhs) : exclusive_(rhs.exclusive_), releasable_(exchange(rhs.releasable_, nullptr)), acquired_(rhs.acquired_) {
@@ -21,6 +44,11 @@ Lock::~Lock() {
         FK_ASSERT(releasable_->release(elapsed, exclusive_));
         releasable_ = nullptr;
         acquired_ = 0;
+
+        auto held = task_locks_held();
+        if (*held > 0) {
+            (*held)--;
+        }
     }
 }
 
@@ -16,6 +16,7 @@ public:
     virtual int32_t seek_beginning() = 0;
     virtual int32_t seek_end() = 0;
     virtual int32_t seek_from_end(int32_t offset) = 0;
+    virtual bool truncate(size_t size) = 0;
     virtual bool is_open() const = 0;
 
     operator bool() const {
@@ -23,7 +24,11 @@ public:
     }
 };
 
-enum OpenFlags { Read = 1, Write = 2, Append = 4 };
+/**
+ * Write and Append both create a new file and fail if it already exists,
+ * AppendExisting opens a file to append to it, creating it if necessary.
+ */
+enum OpenFlags { Read = 1, Write = 2, Append = 4, AppendExisting = 8 };
 
 /*
 inline OpenFlags operator|(OpenFlags a, OpenFlags b) {
@@ -0,0 +1,42 @@
+#include "hal/worker_queue.h"
+#include "hal/ipc.h"
+
+namespace fk {
+
+bool WorkerQueue::push(WorkerCategory category, TaskWorker *worker, bool concurrency_allowed, uint32_t now) {
+    FK_ASSERT(worker != nullptr);
+
+    if (size_ == WorkerQueueSize) {
+        statistics_.dropped++;
+        return false;
+    }
+
+    entries_[size_++] = QueuedWorker{ worker, category, concurrency_allowed, now };
+    statistics_.queued++;
+
+    return true;
+}
+
+size_t WorkerQueue::count(WorkerCategory category) const {
+    auto n = 0u;
+    for (auto i = 0u; i < size_; ++i) {
+        if (entries_[i].category == category) {
+            n++;
+        }
+    }
+    return n;
+}
+
+QueuedWorker WorkerQueue::remove_at(size_t index) {
+    FK_ASSERT(index < size_);
+
+    auto removed = entries_[index];
+    for (auto i = index; i + 1 < size_; ++i) {
+        entries_[i] = entries_[i + 1];
+    }
+    size_--;
+
+    return removed;
+}
+
+} // namespace fk
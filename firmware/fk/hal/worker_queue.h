@@ -0,0 +1,141 @@
+#pragma once
+
+#include "common.h"
+#include "config.h"
+#include "worker.h"
+
+namespace fk {
+
+enum class WorkerCategory;
+
+struct QueuedWorker {
+    TaskWorker *worker;
+    WorkerCategory category;
+    bool concurrency_allowed;
+    uint32_t queued;
+};
+
+struct WorkerQueueStatistics {
+    uint32_t queued;
+    uint32_t started;
+    uint32_t dropped;
+    uint32_t total_wait;
+    uint32_t longest_wait;
+};
+
+/**
+ * Workers waiting for a free worker task, started highest priority first
+ * and in the order they were launched otherwise.
+ */
+class WorkerQueue {
+private:
+    QueuedWorker entries_[WorkerQueueSize];
+    size_t size_{ 0 };
+    WorkerQueueStatistics statistics_{};
+
+public:
+    /**
+     * Returns false when the queue is full, the caller still owns the
+     * worker in that case.
+     */
+    bool push(WorkerCategory category, TaskWorker *worker, bool concurrency_allowed, uint32_t now);
+
+    /**
+     * Removes the highest priority worker that can_launch(category,
+     * concurrency_allowed) allows to start.
+     */
+    template <typename Fn> bool pop(QueuedWorker &popped, uint32_t now, Fn can_launch) {
+        auto selected = -1;
+        for (auto i = 0u; i < size_; ++i) {
+            auto &entry = entries_[i];
+            if (selected >= 0 && entry.worker->priority() <= entries_[selected].worker->priority()) {
+                continue;
+            }
+            if (can_launch(entry.category, entry.concurrency_allowed)) {
+                selected = i;
+            }
+        }
+
+        if (selected < 0) {
+            return false;
+        }
+
+        popped = remove_at(selected);
+
+        auto waited = now - popped.queued;
+        statistics_.started++;
+        statistics_.total_wait += waited;
+        if (waited > statistics_.longest_wait) {
+            statistics_.longest_wait = waited;
+        }
+
+        return true;
+    }
+
+    /**
+     * Starts queued workers on idle tasks. A task that found nothing
+     * queued when it finished is still running for a moment afterwards,
+     * anything launched then is queued and nobody would start it. The
+     * idle(task) function says whether a task can be started, can_launch
+     * is as for pop and start(task, popped) starts the worker. Returns
+     * how many workers were started.
+     */
+    template <typename Idle, typename CanLaunch, typename Start>
+    size_t start_idle(size_t ntasks, uint32_t now, Idle idle, CanLaunch can_launch, Start start) {
+        auto started = 0u;
+        for (auto i = 0u; i < ntasks && !empty(); ++i) {
+            if (!idle(i)) {
+                continue;
+            }
+
+            QueuedWorker popped;
+            if (!pop(popped, now, can_launch)) {
+                break;
+            }
+
+            start(i, popped);
+            started++;
+        }
+        return started;
+    }
+
+    /**
+     * Removes every worker in the category, returning how many were
+     * removed. Their workers are passed to fn.
+     */
+    template <typename Fn> size_t remove(WorkerCategory category, Fn fn) {
+        auto removed = 0u;
+        for (auto i = 0u; i < size_;) {
+            if (entries_[i].category == category) {
+                fn(remove_at(i).worker);
+                removed++;
+            } else {
+                ++i;
+            }
+        }
+        return removed;
+    }
+
+    size_t count(WorkerCategory category) const;
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    QueuedWorker const &operator[](size_t i) const {
+        return entries_[i];
+    }
+
+    WorkerQueueStatistics const &statistics() const {
+        return statistics_;
+    }
+
+private:
+    QueuedWorker remove_at(size_t index);
+};
+
+} // namespace fk
@@ -3,6 +3,8 @@
 
 #include "io.h"
 #include "config.h"
+#include "platform.h"
+#include "protobuf.h"
 
 namespace fk {
 
@@ -232,6 +234,186 @@ int32_t LimitReader::read(uint8_t *buffer, size_t size) {
     return read;
 }
 
+/**
+ * Largest delimiter we'll ever need, the varint of a 32 bit size.
+ */
+static constexpr size_t MaximumDelimiterSize = 5;
+
+/**
+ * Chunks double as the message grows, up to this.
+ */
+static constexpr size_t MaximumEncoderChunkSize = StandardPageSize / 4;
+
+PoolEncoder::PoolEncoder(Pool &pool, bool delimited, size_t chunk_size)
+    : pool_(&pool), delimited_(delimited), chunk_size_(chunk_size) {
+}
+
+PoolEncoder::PoolEncoder(Pool &pool, uint8_t *buffer, size_t size) : pool_(&pool), chunk_size_(size), buffer_(buffer) {
+}
+
+bool PoolEncoder::encode(pb_msgdesc_t const *fields, void const *src) {
+    FK_ASSERT(head_ == nullptr || !delimited_);
+
+    if (head_ == nullptr) {
+        auto reserved = delimited_ ? MaximumDelimiterSize : 0u;
+        if (buffer_ != nullptr) {
+            head_ = tail_ = new (*pool_) chunk_t{ buffer_, chunk_size_, 0, nullptr };
+        } else if (!grow(chunk_size_ + reserved, chunk_size_ + reserved)) {
+            return false;
+        }
+
+        head_->position = reserved;
+    }
+
+    auto ostream = pb_ostream_from_writable(this);
+    if (!pb_encode(&ostream, fields, src)) {
+        return false;
+    }
+
+    if (delimited_) {
+        // Right against the message, so the two are contiguous.
+        delimiter_ = pb_varint_size(size_);
+        auto stream = pb_ostream_from_buffer(begin(), delimiter_);
+        if (!pb_encode_varint(&stream, size_)) {
+            return false;
+        }
+    }
+
+    // Give back whatever's left of the last chunk, if nothing else has
+    // been allocated since.
+    if (owned(tail_) && pool_->shrink(tail_, sizeof(chunk_t) + tail_->size, sizeof(chunk_t) + tail_->position)) {
+        tail_->size = tail_->position;
+    }
+
+    return true;
+}
+
+int32_t PoolEncoder::write(uint8_t const *buffer, size_t size) {
+    if (size > maximum_ - size_) {
+        exceeded_ = true;
+        return -1;
+    }
+
+    auto remaining = size;
+    while (remaining > 0) {
+        if (tail_->position == tail_->size) {
+            if (!grow(std::min(tail_->size * 2, MaximumEncoderChunkSize), remaining)) {
+                return -1;
+            }
+        }
+
+        auto copying = std::min(remaining, tail_->size - tail_->position);
+        memcpy(tail_->ptr + tail_->position, buffer + (size - remaining), copying);
+        tail_->position += copying;
+        remaining -= copying;
+    }
+
+    size_ += size;
+
+    return size;
+}
+
+bool PoolEncoder::grow(size_t size, size_t minimum) {
+    // Growing in place keeps the message in one piece, even if only by
+    // as much as this write needs.
+    if (tail_ != nullptr && owned(tail_)) {
+        auto allocated = sizeof(chunk_t) + tail_->size;
+        for (auto growing : { size, std::min(size, minimum) }) {
+            if (pool_->extend(tail_, allocated, allocated + growing)) {
+                tail_->size += growing;
+                return true;
+            }
+        }
+    }
+
+    auto chunk = (chunk_t *)pool_->malloc(sizeof(chunk_t) + size);
+    if (chunk == nullptr) {
+        return false;
+    }
+
+    chunk->ptr = (uint8_t *)(chunk + 1);
+    chunk->size = size;
+    chunk->position = 0;
+    chunk->np = nullptr;
+
+    if (tail_ == nullptr) {
+        head_ = chunk;
+    } else {
+        tail_->np = chunk;
+    }
+    tail_ = chunk;
+
+    return true;
+}
+
+bool PoolEncoder::owned(chunk_t const *chunk) const {
+    return chunk->ptr == (uint8_t const *)(chunk + 1);
+}
+
+uint8_t *PoolEncoder::begin() {
+    auto reserved = delimited_ ? MaximumDelimiterSize : 0u;
+    return head_->ptr + reserved - delimiter_;
+}
+
+BufferPtr *PoolEncoder::chain() {
+    FK_ASSERT(head_ != nullptr);
+
+    // Chunks only link forward, so the chain is built back to front.
+    BufferPtr *link = nullptr;
+    chunk_t *previous = nullptr;
+    while (previous != head_) {
+        auto chunk = head_;
+        while (chunk->np != previous) {
+            chunk = chunk->np;
+        }
+
+        auto ptr = chunk == head_ ? begin() : chunk->ptr;
+        auto size = chunk->position - (ptr - chunk->ptr);
+        link = new (*pool_) BufferPtr(size, size, ptr, link);
+
+        previous = chunk;
+    }
+
+    return link;
+}
+
+BufferPtr *PoolEncoder::contiguous() {
+    FK_ASSERT(head_ != nullptr);
+
+    if (head_ == tail_) {
+        return new (*pool_) BufferPtr(size(), size(), begin());
+    }
+
+    auto buffer = (uint8_t *)pool_->malloc(size());
+    auto position = 0u;
+    for (auto chunk = head_; chunk != nullptr; chunk = chunk->np) {
+        auto ptr = chunk == head_ ? begin() : chunk->ptr;
+        auto copying = chunk->position - (ptr - chunk->ptr);
+        memcpy(buffer + position, ptr, copying);
+        position += copying;
+    }
+
+    FK_ASSERT(position == size());
+
+    return new (*pool_) BufferPtr(position, position, buffer);
+}
+
+TimedWriter::TimedWriter(Writer *target) : target_(target) {
+}
+
+int32_t TimedWriter::write(uint8_t const *buffer, size_t size) {
+    auto started = fk_uptime();
+    auto wrote = target_->write(buffer, size);
+    elapsed_ += fk_uptime() - started;
+
+    if (wrote != (int32_t)size) {
+        failed_ = true;
+        return -1;
+    }
+
+    return wrote;
+}
+
 CopyIntoBuffers::CopyIntoBuffers(BufferAllocator *buffer_alloc) : buffer_alloc_(buffer_alloc), head_(nullptr), position_(0) {
 }
 
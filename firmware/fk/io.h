@@ -4,6 +4,7 @@
 #include <pb_encode.h>
 
 #include "common.h"
+#include "config.h"
 #include "buffers.h"
 #include "pool.h"
 
@@ -173,6 +174,118 @@ public:
     int32_t write(uint8_t const *buffer, size_t size) override;
 };
 
+/**
+ * Encodes a message in a single pass into buffers allocated from a pool,
+ * growing the last one in place while nothing else has been allocated
+ * since and chaining more otherwise. Delimited messages get room for the
+ * largest possible delimiter ahead of them, which is back-patched once the
+ * size is known, so nobody has to size a message before encoding it.
+ */
+class PoolEncoder : public Writer {
+private:
+    struct chunk_t {
+        uint8_t *ptr;
+        size_t size;
+        size_t position;
+        chunk_t *np;
+    };
+
+    Pool *pool_{ nullptr };
+    bool delimited_{ false };
+    size_t chunk_size_{ 0 };
+    uint8_t *buffer_{ nullptr };
+    chunk_t *head_{ nullptr };
+    chunk_t *tail_{ nullptr };
+    size_t size_{ 0 };
+    size_t delimiter_{ 0 };
+    size_t maximum_{ SIZE_MAX };
+    bool exceeded_{ false };
+
+public:
+    PoolEncoder(Pool &pool, bool delimited, size_t chunk_size = LinkedBufferSize);
+
+    /**
+     * Encodes into the given buffer first, only chaining buffers from the
+     * pool once it's full. These are never delimited.
+     */
+    PoolEncoder(Pool &pool, uint8_t *buffer, size_t size);
+
+public:
+    /**
+     * Encodes another message, undelimited ones may be followed by more
+     * and end up back to back.
+     */
+    bool encode(pb_msgdesc_t const *fields, void const *src);
+
+    /**
+     * Fails encoding any message larger than maximum bytes, rather than
+     * allocating room for all of it.
+     */
+    void limit(size_t maximum) {
+        maximum_ = maximum;
+    }
+
+    /**
+     * Whether encoding failed because the message was over the limit.
+     */
+    bool exceeded() const {
+        return exceeded_;
+    }
+
+    /**
+     * Size of the encoded message, including the delimiter.
+     */
+    size_t size() const {
+        return delimiter_ + size_;
+    }
+
+    /**
+     * Returns the encoded message as a chain of buffers, suitable for
+     * Writer::write_buffers.
+     */
+    BufferPtr *chain();
+
+    /**
+     * Returns the encoded message in a single buffer, copying it into one
+     * if it had to be chained. Prefer chain() when a chain will do.
+     */
+    BufferPtr *contiguous();
+
+public:
+    int32_t write(uint8_t const *buffer, size_t size) override;
+
+private:
+    bool grow(size_t size, size_t minimum);
+    bool owned(chunk_t const *chunk) const;
+    uint8_t *begin();
+};
+
+/**
+ * Forwards writes to another writer, keeping track of the time spent in
+ * them and whether any were short.
+ */
+class TimedWriter : public Writer {
+private:
+    Writer *target_{ nullptr };
+    uint32_t elapsed_{ 0 };
+    bool failed_{ false };
+
+public:
+    TimedWriter(Writer *target);
+
+public:
+    int32_t write(uint8_t const *buffer, size_t size) override;
+
+public:
+    uint32_t elapsed() const {
+        return elapsed_;
+    }
+
+    bool failed() const {
+        return failed_;
+    }
+};
+
 pb_ostream_t pb_ostream_from_writable(Writer *s);
 
 pb_istream_t pb_istream_from_readable(Reader *s, size_t bytes_left = SIZE_MAX);
@@ -0,0 +1,694 @@
+#include <loading.h>
+#include <tiny_printf.h>
+
+#include "log_binary.h"
+#include "config.h"
+
+#if defined(__SAMD51__)
+#include <Arduino.h>
+#endif
+
+extern const struct fkb_header_t fkb_header;
+
+namespace fk {
+
+/**
+ * Largest raw record, before COBS encoding which adds a byte for every
+ * 254 and the marker.
+ */
+constexpr size_t MaximumPayloadSize = BinaryLogMaximumRecordSize - 1 - (BinaryLogMaximumRecordSize / 254) - 1;
+
+enum class ArgumentKind : uint8_t {
+    None,
+    Int,
+    Long,
+    LongLong,
+    Size,
+    IntMax,
+    PtrDiff,
+    Double,
+    String,
+    Pointer,
+    Ignored,
+};
+
+struct FormatSpec {
+    const char *begin;
+    size_t length;
+    uint8_t stars;
+    ArgumentKind kind;
+    bool is_signed;
+};
+
+/**
+ * Parses the conversion starting at the '%' in f. Returns false when
+ * there's no conversion to parse, for "%%" the kind is None.
+ */
+static bool parse_spec(const char *f, FormatSpec &spec) {
+    spec = FormatSpec{ f, 0, 0, ArgumentKind::None, false };
+
+    auto p = f + 1;
+
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+        p++;
+    }
+
+    if (*p == '*') {
+        spec.stars++;
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec.stars++;
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+    }
+
+    auto kind = ArgumentKind::Int;
+    switch (*p) {
+    case 'h':
+        p++;
+        if (*p == 'h') {
+            p++;
+        }
+        break;
+    case 'l':
+        p++;
+        kind = ArgumentKind::Long;
+        if (*p == 'l') {
+            p++;
+            kind = ArgumentKind::LongLong;
+        }
+        break;
+    case 'z':
+        p++;
+        kind = ArgumentKind::Size;
+        break;
+    case 'j':
+        p++;
+        kind = ArgumentKind::IntMax;
+        break;
+    case 't':
+        p++;
+        kind = ArgumentKind::PtrDiff;
+        break;
+    default:
+        break;
+    }
+
+    switch (*p) {
+    case 'd':
+    case 'i':
+        spec.is_signed = true;
+        spec.kind = kind;
+        break;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+    case 'b':
+    case 'c':
+        spec.kind = kind;
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+        spec.kind = ArgumentKind::Double;
+        break;
+    case 's':
+        spec.kind = ArgumentKind::String;
+        break;
+    case 'p':
+        spec.kind = ArgumentKind::Pointer;
+        break;
+    case 'n':
+        spec.kind = ArgumentKind::Ignored;
+        break;
+    case '%':
+        spec.kind = ArgumentKind::None;
+        break;
+    default:
+        return false;
+    }
+
+    spec.length = (p - f) + 1;
+
+    return true;
+}
+
+class PayloadWriter {
+private:
+    uint8_t *buffer_;
+    size_t size_;
+    size_t position_{ 0 };
+    bool overflowed_{ false };
+
+public:
+    PayloadWriter(uint8_t *buffer, size_t size) : buffer_(buffer), size_(size) {
+    }
+
+public:
+    size_t position() const {
+        return position_;
+    }
+
+    bool overflowed() const {
+        return overflowed_;
+    }
+
+    void varint(uint64_t value) {
+        uint8_t temp[10];
+        auto n = 0u;
+        do {
+            temp[n] = (uint8_t)(value & 0x7f);
+            value >>= 7;
+            if (value != 0) {
+                temp[n] |= 0x80;
+            }
+            n++;
+        } while (value != 0);
+        write(temp, n);
+    }
+
+    void signed_varint(int64_t value) {
+        varint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+    }
+
+    void string(const char *str) {
+        if (str == nullptr) {
+            str = "(null)";
+        }
+        auto length = strnlen(str, BinaryLogMaximumStringLength);
+        varint(length);
+        write((uint8_t const *)str, length);
+    }
+
+    void write(uint8_t const *data, size_t size) {
+        if (overflowed_ || position_ + size > size_) {
+            overflowed_ = true;
+            return;
+        }
+        memcpy(buffer_ + position_, data, size);
+        position_ += size;
+    }
+
+    /**
+     * Undoes a partially written argument, so that truncated records
+     * only ever lose whole arguments.
+     */
+    void rewind(size_t position) {
+        position_ = position;
+    }
+};
+
+class PayloadReader {
+private:
+    uint8_t const *buffer_;
+    size_t size_;
+    size_t position_{ 0 };
+    bool failed_{ false };
+
+public:
+    PayloadReader(uint8_t const *buffer, size_t size) : buffer_(buffer), size_(size) {
+    }
+
+public:
+    bool failed() const {
+        return failed_;
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        auto shift = 0u;
+        while (true) {
+            if (position_ >= size_ || shift >= 64) {
+                failed_ = true;
+                return 0;
+            }
+            auto b = buffer_[position_++];
+            value |= (uint64_t)(b & 0x7f) << shift;
+            if ((b & 0x80) == 0) {
+                return value;
+            }
+            shift += 7;
+        }
+    }
+
+    int64_t signed_varint() {
+        auto value = varint();
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    size_t string(char *str, size_t size) {
+        auto length = (size_t)varint();
+        if (failed_ || position_ + length > size_ || length >= size) {
+            failed_ = true;
+            str[0] = 0;
+            return 0;
+        }
+        memcpy(str, buffer_ + position_, length);
+        str[length] = 0;
+        position_ += length;
+        return length;
+    }
+
+    double f64() {
+        double value = 0;
+        if (position_ + sizeof(value) > size_) {
+            failed_ = true;
+            return 0;
+        }
+        memcpy(&value, buffer_ + position_, sizeof(value));
+        position_ += sizeof(value);
+        return value;
+    }
+};
+
+static bool write_argument(PayloadWriter &writer, FormatSpec &spec, va_list *args) {
+    for (auto i = 0u; i < spec.stars; ++i) {
+        writer.signed_varint(va_arg(*args, int));
+    }
+
+    switch (spec.kind) {
+    case ArgumentKind::Int:
+        if (spec.is_signed) {
+            writer.signed_varint(va_arg(*args, int));
+        } else {
+            writer.varint(va_arg(*args, unsigned int));
+        }
+        break;
+    case ArgumentKind::Long:
+        if (spec.is_signed) {
+            writer.signed_varint(va_arg(*args, long));
+        } else {
+            writer.varint(va_arg(*args, unsigned long));
+        }
+        break;
+    case ArgumentKind::LongLong:
+        if (spec.is_signed) {
+            writer.signed_varint(va_arg(*args, long long));
+        } else {
+            writer.varint(va_arg(*args, unsigned long long));
+        }
+        break;
+    case ArgumentKind::Size:
+        writer.varint(va_arg(*args, size_t));
+        break;
+    case ArgumentKind::IntMax:
+        writer.signed_varint(va_arg(*args, intmax_t));
+        break;
+    case ArgumentKind::PtrDiff:
+        writer.signed_varint(va_arg(*args, ptrdiff_t));
+        break;
+    case ArgumentKind::Double: {
+        auto value = va_arg(*args, double);
+        writer.write((uint8_t const *)&value, sizeof(value));
+        break;
+    }
+    case ArgumentKind::String:
+        writer.string(va_arg(*args, const char *));
+        break;
+    case ArgumentKind::Pointer:
+        writer.varint((uintptr_t)va_arg(*args, void *));
+        break;
+    case ArgumentKind::Ignored:
+        va_arg(*args, void *);
+        break;
+    case ArgumentKind::None:
+        break;
+    }
+
+    return !writer.overflowed();
+}
+
+static size_t cobs_encode(uint8_t const *data, size_t size, uint8_t *encoded) {
+    auto code_position = 0u;
+    auto position = 1u;
+    uint8_t code = 1;
+
+    for (auto i = 0u; i < size; ++i) {
+        if (data[i] == 0) {
+            encoded[code_position] = code;
+            code_position = position++;
+            code = 1;
+        } else {
+            encoded[position++] = data[i];
+            code++;
+            if (code == 0xff) {
+                encoded[code_position] = code;
+                code_position = position++;
+                code = 1;
+            }
+        }
+    }
+
+    encoded[code_position] = code;
+
+    return position;
+}
+
+static size_t cobs_decode(uint8_t const *encoded, size_t size, uint8_t *data) {
+    auto position = 0u;
+    auto i = 0u;
+
+    while (i < size) {
+        auto code = encoded[i++];
+        if (code == 0) {
+            return 0;
+        }
+        for (auto j = 1u; j < code; ++j) {
+            if (i >= size) {
+                return 0;
+            }
+            data[position++] = encoded[i++];
+        }
+        if (code != 0xff && i < size) {
+            data[position++] = 0;
+        }
+    }
+
+    return position;
+}
+
+uint32_t log_binary_image_id() {
+    static uint32_t id = 0;
+    static bool calculated = false;
+
+    // The image hash is stamped into the header after linking, the
+    // timestamp covers images built without one.
+    if (!calculated) {
+        auto &firmware = fkb_header.firmware;
+        auto value = firmware.timestamp;
+        for (auto i = 0u; i < firmware.hash_size && i < sizeof(firmware.hash); ++i) {
+            value ^= (uint32_t)firmware.hash[i] << ((i % 4) * 8);
+        }
+        id = value;
+        calculated = true;
+    }
+
+    return id;
+}
+
+size_t log_binary_encode(uint8_t *buffer, size_t size, LogMessage const *m, const char *task, const char *fstring, va_list args) {
+    return log_binary_encode(buffer, size, log_binary_image_id(), m, task, fstring, args);
+}
+
+size_t log_binary_encode(uint8_t *buffer, size_t size, uint32_t image, LogMessage const *m, const char *task, const char *fstring,
+                         va_list args) {
+    uint8_t payload[MaximumPayloadSize];
+    PayloadWriter writer{ payload, sizeof(payload) };
+
+    writer.varint(image);
+    writer.varint(m->uptime);
+    writer.varint(m->level);
+    writer.varint((uintptr_t)task);
+    writer.varint((uintptr_t)m->facility);
+    writer.varint((uintptr_t)fstring);
+    writer.string(m->scope);
+
+    if (writer.overflowed()) {
+        return 0;
+    }
+
+    va_list copy;
+    va_copy(copy, args);
+
+    for (auto f = fstring; *f != 0; ++f) {
+        if (*f != '%') {
+            continue;
+        }
+
+        FormatSpec spec;
+        if (!parse_spec(f, spec)) {
+            break;
+        }
+
+        auto position = writer.position();
+        if (!write_argument(writer, spec, &copy)) {
+            writer.rewind(position);
+            break;
+        }
+
+        f += spec.length - 1;
+    }
+
+    va_end(copy);
+
+    // Encoding needs the marker, the COBS overhead and the payload.
+    auto required = 1 + writer.position() + (writer.position() / 254) + 1;
+    if (required > size) {
+        return 0;
+    }
+
+    buffer[0] = BinaryLogMarker;
+
+    return 1 + cobs_encode(payload, writer.position(), buffer + 1);
+}
+
+struct RenderState {
+    log_render_out_fn_t out;
+    void *arg;
+    int32_t written;
+};
+
+static void render_string(RenderState &rs, const char *str) {
+    for (auto p = str; *p != 0; ++p) {
+        rs.out(*p, rs.arg);
+        rs.written++;
+    }
+}
+
+static void render_argument(RenderState &rs, PayloadReader &reader, FormatSpec &spec) {
+    char format[24];
+    char value[BinaryLogMaximumStringLength + 16];
+
+    // Substitute any '*' with their values so we only ever pass the
+    // argument itself.
+    auto fp = 0u;
+    for (auto i = 0u; i < spec.length && fp < sizeof(format) - 12; ++i) {
+        if (spec.begin[i] == '*') {
+            fp += tiny_snprintf(format + fp, sizeof(format) - fp, "%d", (int32_t)reader.signed_varint());
+        } else {
+            format[fp++] = spec.begin[i];
+        }
+    }
+    format[fp] = 0;
+
+    if (reader.failed()) {
+        render_string(rs, "?");
+        return;
+    }
+
+    value[0] = 0;
+
+    switch (spec.kind) {
+    case ArgumentKind::Int:
+        if (spec.is_signed) {
+            tiny_snprintf(value, sizeof(value), format, (int)reader.signed_varint());
+        } else {
+            tiny_snprintf(value, sizeof(value), format, (unsigned int)reader.varint());
+        }
+        break;
+    case ArgumentKind::Long:
+        if (spec.is_signed) {
+            tiny_snprintf(value, sizeof(value), format, (long)reader.signed_varint());
+        } else {
+            tiny_snprintf(value, sizeof(value), format, (unsigned long)reader.varint());
+        }
+        break;
+    case ArgumentKind::LongLong:
+        if (spec.is_signed) {
+            tiny_snprintf(value, sizeof(value), format, (long long)reader.signed_varint());
+        } else {
+            tiny_snprintf(value, sizeof(value), format, (unsigned long long)reader.varint());
+        }
+        break;
+    case ArgumentKind::Size:
+        tiny_snprintf(value, sizeof(value), format, (size_t)reader.varint());
+        break;
+    case ArgumentKind::IntMax:
+        tiny_snprintf(value, sizeof(value), format, (intmax_t)reader.signed_varint());
+        break;
+    case ArgumentKind::PtrDiff:
+        tiny_snprintf(value, sizeof(value), format, (ptrdiff_t)reader.signed_varint());
+        break;
+    case ArgumentKind::Double:
+        tiny_snprintf(value, sizeof(value), format, reader.f64());
+        break;
+    case ArgumentKind::String: {
+        char str[BinaryLogMaximumStringLength + 1];
+        reader.string(str, sizeof(str));
+        tiny_snprintf(value, sizeof(value), format, str);
+        break;
+    }
+    case ArgumentKind::Pointer:
+        tiny_snprintf(value, sizeof(value), format, (void *)(uintptr_t)reader.varint());
+        break;
+    case ArgumentKind::Ignored:
+        break;
+    case ArgumentKind::None:
+        render_string(rs, "%");
+        return;
+    }
+
+    if (reader.failed()) {
+        render_string(rs, "?");
+        return;
+    }
+
+    render_string(rs, value);
+}
+
+/**
+ * Records rendered from memory saved across a reset may be junk, so only
+ * follow addresses that point somewhere we can read.
+ */
+static bool readable_string(const char *str) {
+    if (str == nullptr) {
+        return false;
+    }
+#if defined(__SAMD51__)
+    auto address = (uintptr_t)str;
+    return (address >= FLASH_ADDR && address < FLASH_ADDR + FLASH_SIZE) || (address >= HSRAM_ADDR && address < HSRAM_ADDR + HSRAM_SIZE);
+#else
+    return true;
+#endif
+}
+
+int32_t log_binary_render(uint8_t const *record, size_t size, log_render_out_fn_t out, void *arg) {
+    if (size < 2 || record[0] != BinaryLogMarker) {
+        return -1;
+    }
+
+    uint8_t payload[BinaryLogMaximumRecordSize];
+    if (size - 1 > sizeof(payload)) {
+        return -1;
+    }
+
+    auto payload_size = cobs_decode(record + 1, size - 1, payload);
+
+    PayloadReader reader{ payload, payload_size };
+    auto image = (uint32_t)reader.varint();
+    if (reader.failed() || image != log_binary_image_id()) {
+        return -1;
+    }
+
+    auto uptime = (uint32_t)reader.varint();
+    auto level = (uint8_t)reader.varint();
+    auto task = (const char *)(uintptr_t)reader.varint();
+    auto facility = (const char *)(uintptr_t)reader.varint();
+    auto fstring = (const char *)(uintptr_t)reader.varint();
+    char scope[BinaryLogMaximumStringLength + 1];
+    reader.string(scope, sizeof(scope));
+    if (reader.failed()) {
+        return -1;
+    }
+
+    if (!readable_string(task) || !readable_string(facility) || !readable_string(fstring)) {
+        return -1;
+    }
+
+    RenderState rs{ out, arg, 0 };
+
+    rs.written += tiny_fctprintf(out, arg, "%08" PRIu32 " %-10s %-7s %s%s: ", uptime, task, alog_get_log_level((LogLevels)level), scope,
+                                 facility);
+
+    for (auto f = fstring; *f != 0; ++f) {
+        if (*f != '%') {
+            out(*f, arg);
+            rs.written++;
+            continue;
+        }
+
+        FormatSpec spec;
+        if (!parse_spec(f, spec)) {
+            out(*f, arg);
+            rs.written++;
+            continue;
+        }
+
+        render_argument(rs, reader, spec);
+
+        f += spec.length - 1;
+    }
+
+    out('\n', arg);
+    rs.written++;
+
+    return rs.written;
+}
+
+size_t log_binary_render_buffer(log_buffer &lb, log_buffer::iterator &iter, log_render_out_fn_t out, void *arg) {
+    return log_binary_render_buffer(iter, lb.end(), out, arg);
+}
+
+size_t log_binary_render_buffer(log_buffer::iterator &iter, log_buffer::iterator end, log_render_out_fn_t out, void *arg) {
+    uint8_t record[BinaryLogMaximumRecordSize];
+    auto rendered = 0u;
+
+    while (iter != end) {
+        auto c = *iter;
+
+        // Text records are passed through as they are.
+        if ((uint8_t)c != BinaryLogMarker) {
+            for (; iter != end && *iter != 0; ++iter) {
+                out(*iter, arg);
+                rendered++;
+            }
+        } else {
+            auto size = 0u;
+            for (; iter != end && *iter != 0; ++iter) {
+                if (size < sizeof(record)) {
+                    record[size++] = (uint8_t)*iter;
+                }
+            }
+
+            auto err = log_binary_render(record, size, out, arg);
+            if (err > 0) {
+                rendered += err;
+            }
+        }
+
+        if (iter != end) {
+            ++iter;
+        }
+    }
+
+    return rendered;
+}
+
+size_t log_binary_render_saved(char *buffer, size_t size, log_render_out_fn_t out, void *arg) {
+    if (size == 0) {
+        return 0;
+    }
+
+    // Unless a record ends with the buffer the one at the start is the
+    // remains of a record cut off when the ring wrapped.
+    auto delimiter = size - 1;
+    if (buffer[delimiter] != 0) {
+        for (delimiter = 0; delimiter < size && buffer[delimiter] != 0; ++delimiter) {
+        }
+        if (delimiter == size) {
+            return 0;
+        }
+    }
+
+    log_buffer::iterator iter{ size, buffer, (delimiter + 1) % size };
+    log_buffer::iterator end{ size, buffer, delimiter };
+    return log_binary_render_buffer(iter, end, out, arg);
+}
+
+} // namespace fk
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdarg.h>
+
+#include <alogging/alogging.h>
+
+#include "common.h"
+#include "log_buffer.h"
+
+namespace fk {
+
+/**
+ * First byte of every binary record in the log buffer, text records
+ * never start with this.
+ */
+constexpr uint8_t BinaryLogMarker = 0x01;
+
+typedef void (*log_render_out_fn_t)(char c, void *arg);
+
+/**
+ * Identifies the running firmware image. Records only hold addresses for
+ * their task, facility and format strings, which mean nothing to another
+ * image, so each record carries this and only the image that wrote it
+ * will render it.
+ */
+uint32_t log_binary_image_id();
+
+/**
+ * Packs a log message into a compact record: the image id, uptime,
+ * level, the task, facility and format string addresses and then the
+ * arguments, with strings copied. Records are COBS encoded after the
+ * marker so they never contain a zero and can live in the log_buffer
+ * alongside text. Returns the number of bytes written to buffer.
+ */
+size_t log_binary_encode(uint8_t *buffer, size_t size, LogMessage const *m, const char *task, const char *fstring, va_list args);
+
+/**
+ * Same as above, for a record claiming to be from the given image.
+ */
+size_t log_binary_encode(uint8_t *buffer, size_t size, uint32_t image, LogMessage const *m, const char *task, const char *fstring,
+                         va_list args);
+
+/**
+ * Renders a record from log_binary_encode exactly like the plain text
+ * logs, ending with a newline. Records from another image are refused.
+ */
+int32_t log_binary_render(uint8_t const *record, size_t size, log_render_out_fn_t out, void *arg);
+
+/**
+ * Renders the records in the log buffer from iter onwards, expanding
+ * binary records and passing text ones through. Returns the number of
+ * characters rendered and leaves iter after the last record.
+ */
+size_t log_binary_render_buffer(log_buffer &lb, log_buffer::iterator &iter, log_render_out_fn_t out, void *arg);
+
+/**
+ * Renders the records from iter up to end, see above.
+ */
+size_t log_binary_render_buffer(log_buffer::iterator &iter, log_buffer::iterator end, log_render_out_fn_t out, void *arg);
+
+/**
+ * Renders a log buffer's memory when its head and tail are unknown, like
+ * after a reset. Goes around the buffer once, starting after the first
+ * record delimiter so that a record cut off by the ring wrapping is
+ * skipped. Returns the number of characters rendered.
+ */
+size_t log_binary_render_saved(char *buffer, size_t size, log_render_out_fn_t out, void *arg);
+
+} // namespace fk
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "common.h"
+
+namespace fk {
+
+/**
+ * Fixed size slots that any number of tasks can log into without taking
+ * a lock, drained in order by a single consumer at a time. Producers
+ * claim a slot with one compare and swap on the head, fill it in place
+ * and then publish it by bumping the slot's sequence. When the ring is
+ * full reserving fails rather than waiting, what to do with the record is
+ * up to the caller.
+ */
+template <size_t Slots, size_t SlotSize> class log_ring {
+    static_assert(Slots > 1 && (Slots & (Slots - 1)) == 0, "log ring slots should be a power of two.");
+
+public:
+    struct slot {
+        uint32_t sequence;
+        uint16_t size;
+        uint8_t level;
+        char data[SlotSize];
+    };
+
+private:
+    slot slots_[Slots];
+    uint32_t head_{ 0 };
+    uint32_t tail_{ 0 };
+    uint32_t dropped_{ 0 };
+
+public:
+    log_ring() {
+        clear();
+    }
+
+public:
+    /**
+     * Empties the ring, this isn't safe while anybody is logging.
+     */
+    void clear() {
+        for (auto i = 0u; i < Slots; ++i) {
+            slots_[i].sequence = i;
+            slots_[i].size = 0;
+        }
+        head_ = 0;
+        tail_ = 0;
+        dropped_ = 0;
+    }
+
+    /**
+     * Claims the next free slot, returning nullptr when the ring is
+     * full. The caller owns the slot until commit, which needs the
+     * position returned here.
+     */
+    slot *reserve(uint32_t &reserved) {
+        auto position = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+
+        while (true) {
+            auto s = &slots_[position & (Slots - 1)];
+            auto sequence = __atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE);
+            auto difference = (int32_t)(sequence - position);
+            if (difference == 0) {
+                // On failure position is reloaded with the current head.
+                if (__atomic_compare_exchange_n(&head_, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    reserved = position;
+                    return s;
+                }
+            } else if (difference < 0) {
+                return nullptr;
+            } else {
+                position = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    /**
+     * Publishes a reserved slot to the consumer. Returns false if the
+     * consumer gave up on the slot first, \see skip
+     */
+    bool commit(slot *s, uint32_t reserved, size_t size) {
+        s->size = size > SlotSize ? SlotSize : size;
+        auto expected = reserved;
+        return __atomic_compare_exchange_n(&s->sequence, &expected, reserved + 1, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * Hands the oldest published slot to fn and frees it. Only one
+     * consumer may call this at a time. Returns false when the next slot
+     * hasn't been published yet.
+     */
+    template <typename Fn> bool pop(Fn fn) {
+        auto s = &slots_[tail_ & (Slots - 1)];
+        auto sequence = __atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE);
+        if (sequence != tail_ + 1) {
+            return false;
+        }
+
+        fn(*s);
+
+        __atomic_store_n(&s->sequence, tail_ + Slots, __ATOMIC_RELEASE);
+        __atomic_store_n(&tail_, tail_ + 1, __ATOMIC_RELAXED);
+
+        return true;
+    }
+
+    /**
+     * Frees the oldest slot if it's been reserved but not published, for
+     * when its producer is never coming back, and counts its record as
+     * dropped. Should the producer commit after all its commit fails, but
+     * having written into the slot late it may garble the record of
+     * whoever reserved it next. Only one consumer may call this at a
+     * time. Returns false when there's no such slot.
+     */
+    bool skip() {
+        if (pending() == 0) {
+            return false;
+        }
+
+        auto s = &slots_[tail_ & (Slots - 1)];
+        auto expected = tail_;
+        if (!__atomic_compare_exchange_n(&s->sequence, &expected, tail_ + Slots, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+
+        __atomic_store_n(&tail_, tail_ + 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&dropped_, 1, __ATOMIC_RELAXED);
+
+        return true;
+    }
+
+    /**
+     * Position of the oldest slot, which only changes as the consumer
+     * moves past it.
+     */
+    uint32_t tail() const {
+        return __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * Pops every published slot, returning how many there were.
+     */
+    template <typename Fn> size_t drain(Fn fn) {
+        auto drained = 0u;
+        while (pop(fn)) {
+            drained++;
+        }
+        return drained;
+    }
+
+    /**
+     * Number of slots waiting for the consumer, including ones still
+     * being filled in.
+     */
+    size_t pending() const {
+        return __atomic_load_n(&head_, __ATOMIC_RELAXED) - __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+    }
+
+    uint32_t dropped() const {
+        return __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+    }
+
+    constexpr size_t capacity() const {
+        return Slots;
+    }
+};
+
+} // namespace fk
@@ -4,11 +4,14 @@
 #include <ctype.h>
 
 #include "logging.h"
+#include "log_binary.h"
+#include "log_ring.h"
 #include "platform.h"
 #include "config.h"
 #include "circular_buffer.h"
 #include "hal/sd_card.h"
 #include "memory.h"
+#include "standard_page.h"
 #include "tasks/tasks.h"
 
 namespace fk {
@@ -16,6 +19,11 @@ namespace fk {
 static static_log_buffer<InMemoryLogBufferSize> logs __attribute__((section(".noinit")));
 static log_buffer::iterator sd_card_iterator;
 static bool logs_buffer_free = true;
+static bool logs_binary = false;
+static uint8_t logs_binary_scopes = 0;
+// Set once a binary record has been logged, from then on the buffer needs
+// rendering on its way to the card.
+static volatile bool logs_binary_used = false;
 
 #if defined(__SAMD51__)
 static_assert(InMemoryLogBufferSize % StandardPageSize == 0, "log size should be divisible by standard page size.");
@@ -29,9 +37,10 @@ static bool logs_rtt_enabled = true;
 
 typedef struct saved_logs_t {
     uint8_t *pages[StandardPagesForLogs];
+    size_t size;
 } saved_logs_t;
 
-static saved_logs_t saved_logs = { .pages = { nullptr, nullptr, nullptr, nullptr } };
+static saved_logs_t saved_logs = { .pages = { nullptr, nullptr, nullptr, nullptr }, .size = 0 };
 
 static void write_logs_buffer(char c, void *arg) {
     auto app = reinterpret_cast<log_buffer::appender *>(arg);
@@ -53,15 +62,215 @@ static void write_logs_buffer(char c, void *arg) {
     }
 }
 
+struct RenderedLogsBuffer {
+    uint8_t *ptr;
+    size_t size;
+    size_t position;
+};
+
+static void write_rendered_logs(char c, void *arg) {
+    auto rendered = reinterpret_cast<RenderedLogsBuffer *>(arg);
+    rendered->ptr[rendered->position++] = c;
+    if (rendered->position == rendered->size) {
+        get_sd_card()->append_logs(rendered->ptr, rendered->position);
+        rendered->position = 0;
+    }
+}
+
 bool fk_logs_flush() {
+    fk_logs_drain();
+
     logs_buffer_free = false;
-    get_sd_card()->append_logs(logs, sd_card_iterator);
+    if (logs_binary_used) {
+        // Binary records are rendered on their way to the card, so the
+        // log files are always plain text.
+        StandardPage page{ __func__ };
+        RenderedLogsBuffer rendered{ (uint8_t *)page.ptr(), page.size(), 0 };
+        log_binary_render_buffer(logs, sd_card_iterator, write_rendered_logs, &rendered);
+        if (rendered.position > 0) {
+            get_sd_card()->append_logs(rendered.ptr, rendered.position);
+        }
+    } else {
+        get_sd_card()->append_logs(logs, sd_card_iterator);
+    }
     sd_card_iterator = logs.end();
     logs_buffer_free = true;
 
     return true;
 }
 
+static void write_rtt(char c, void *arg) {
+    SEGGER_RTT_PutChar(0, c);
+}
+
+static_assert(BinaryLogMaximumRecordSize <= LogRingSlotSize, "binary log records should fit in a log ring slot.");
+
+static log_ring<LogRingSlots, LogRingSlotSize> ring;
+static uint32_t draining = 0;
+static char drained_record[LogRingSlotSize];
+static char drained_line[LogRingSlotSize];
+static uint32_t dropped_reported = 0;
+static uint32_t stalled_tail = 0;
+static uint32_t stalled_since = 0;
+static volatile bool logs_synchronous = false;
+
+struct RenderedLine {
+    char *ptr;
+    size_t size;
+    size_t position;
+};
+
+static void write_rendered_line(char c, void *arg) {
+    auto line = reinterpret_cast<RenderedLine *>(arg);
+    if (line->position < line->size) {
+        line->ptr[line->position++] = c;
+    }
+}
+
+static void echo_line(uint8_t level, const char *line, size_t size) {
+    if (size > 0 && line[size - 1] == '\n') {
+        size--;
+    }
+
+    if ((LogLevels)level == LogLevels::ERROR) {
+        SEGGER_RTT_WriteString(0, RTT_CTRL_TEXT_RED);
+    } else if ((LogLevels)level == LogLevels::WARN) {
+        SEGGER_RTT_WriteString(0, RTT_CTRL_TEXT_MAGENTA);
+    }
+    SEGGER_RTT_Write(0, line, size);
+    SEGGER_RTT_WriteString(0, RTT_CTRL_RESET "\n");
+}
+
+static void echo_drained(uint8_t level, size_t size) {
+    if ((uint8_t)drained_record[0] == BinaryLogMarker) {
+        RenderedLine rendered{ drained_line, sizeof(drained_line), 0 };
+        log_binary_render((uint8_t *)drained_record, size, write_rendered_line, &rendered);
+        echo_line(level, drained_line, rendered.position);
+    } else {
+        echo_line(level, drained_record, size);
+    }
+}
+
+/**
+ * Records are dropped rather than making the tasks logging them wait,
+ * this leaves a line behind so that the gap is obvious.
+ */
+static void report_dropped() {
+    auto dropped = ring.dropped();
+    if (dropped == dropped_reported) {
+        return;
+    }
+
+    auto level = (uint8_t)LogLevels::WARN;
+    auto size = (size_t)tiny_snprintf(drained_line, sizeof(drained_line), "%08" PRIu32 " %-10s %-7s logs: dropped %" PRIu32 " records\n",
+                                      fk_uptime(), "logs", alog_get_log_level((LogLevels)level), dropped - dropped_reported);
+    dropped_reported = dropped;
+
+    SEGGER_RTT_LOCK();
+
+    if (logs_buffer_free) {
+        auto app = logs.start();
+
+        for (auto i = 0u; i < size; ++i) {
+            write_logs_buffer(drained_line[i], &app);
+        }
+
+        app.append((char)0);
+    }
+
+    SEGGER_RTT_UNLOCK();
+
+    if (logs_rtt_enabled) {
+        echo_line(level, drained_line, size);
+    }
+}
+
+/**
+ * Whether to give up on the slot at the ring's tail, which has been
+ * reserved and not published. Nobody's coming back for it once we're
+ * logging synchronously, otherwise we give its producer a while.
+ */
+static bool stalled(bool forced) {
+    if (ring.pending() == 0) {
+        stalled_since = 0;
+        return false;
+    }
+
+    if (forced) {
+        return true;
+    }
+
+    auto now = fk_uptime();
+    if (stalled_since == 0 || stalled_tail != ring.tail()) {
+        stalled_tail = ring.tail();
+        stalled_since = now;
+        return false;
+    }
+
+    return now - stalled_since > LogRingStalledSlotMs;
+}
+
+static void drain(bool forced) {
+    // Only one task drains at a time, anybody else finding the ring busy
+    // can just move on since their records will be drained anyway. When
+    // forced, whoever was draining may be the task that just faulted.
+    uint32_t idle = 0;
+    if (!__atomic_compare_exchange_n(&draining, &idle, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) && !forced) {
+        return;
+    }
+
+    while (true) {
+        auto size = 0u;
+        auto level = (uint8_t)0;
+
+        // The lock only protects the log buffer, echoing to RTT happens
+        // outside of it.
+        SEGGER_RTT_LOCK();
+
+        auto popped = ring.pop([&](decltype(ring)::slot &s) {
+            size = s.size;
+            level = s.level;
+            memcpy(drained_record, s.data, size);
+
+            if (logs_buffer_free && size > 0) {
+                auto app = logs.start();
+
+                for (auto i = 0u; i < size; ++i) {
+                    write_logs_buffer(drained_record[i], &app);
+                }
+
+                app.append((char)0);
+            }
+        });
+
+        SEGGER_RTT_UNLOCK();
+
+        if (!popped) {
+            if (stalled(forced) && ring.skip()) {
+                continue;
+            }
+            break;
+        }
+
+        if (logs_rtt_enabled && size > 0) {
+            echo_drained(level, size);
+        }
+    }
+
+    report_dropped();
+
+    __atomic_store_n(&draining, 0, __ATOMIC_RELEASE);
+}
+
+void fk_logs_drain() {
+    drain(false);
+}
+
+void fk_logs_synchronous() {
+    logs_synchronous = true;
+    drain(true);
+}
+
 void fk_logs_vprintf(const char *f, va_list args) {
     auto app = logs.start();
     SEGGER_RTT_vprintf(0, f, &args);
@@ -69,56 +278,48 @@ void fk_logs_vprintf(const char *f, va_list args) {
     app.append((char)0);
 }
 
+static void write_saved_logs(char c, void *arg) {
+    // Memory that survived a reset may hold junk, especially after a cold
+    // start, so only keep what's printable.
+    if (saved_logs.size < InMemoryLogBufferSize) {
+        saved_logs.pages[0][saved_logs.size++] = (isprint((uint8_t)c) || c == '\n') ? c : '?';
+    }
+}
+
 void fk_logs_saved_capture() {
-    auto source = logs.buffer();
     for (auto i = 0u; i < StandardPagesForLogs; ++i) {
         saved_logs.pages[i] = (uint8_t *)fk_standard_page_malloc(StandardPageSize, "saved-logs");
-        memcpy(saved_logs.pages[i], source, StandardPageSize);
-        source += StandardPageSize;
 
         /**
          * We'll be called very early and so the odds of us being
-         * given non-consecutive pages is zero. It's also not
-         * important but I figured I'd keep this in here just in case
-         * I ever forget that fact.
+         * given non-consecutive pages is zero. We rely on this to
+         * render into them as one buffer, so check just in case I
+         * ever forget that fact.
          */
         FK_ASSERT(i == 0 || saved_logs.pages[i] == saved_logs.pages[i - 1] + StandardPageSize);
     }
 
-    for (auto i = 0u; i < StandardPagesForLogs; ++i) {
-        auto page = saved_logs.pages[i];
-        if (page != nullptr) {
-            for (auto p = page; p < page + StandardPageSize;) {
-                if (*p == 0) {
-                    *p = '\n';
-                } else if (!isprint(*p)) {
-                    if (*p == '\n') {
-                        *p = ' ';
-                    } else {
-                        *p = '?';
-                    }
-                }
-                p++;
-            }
-        }
-    }
+    // The ring's head and tail didn't survive the reset, only its memory,
+    // which is rendered like the logs that go to the SD card. Binary
+    // records may expand past what we saved, the rest is dropped.
+    saved_logs.size = 0;
+    log_binary_render_saved(logs.buffer(), logs.capacity(), write_saved_logs, nullptr);
 }
 
 void fk_logs_saved_write(bool echo) {
     auto begin_header = "\n\n=================== raw log memory begin: remember buffer is circular!\n\n";
     auto end_footer = "\n\n=================== raw log memory end: remember buffer is circular!\n\n";
 
+    if (saved_logs.pages[0] == nullptr) {
+        return;
+    }
+
     if (echo) {
         SEGGER_RTT_LOCK();
 
         fk_logs_printf(begin_header);
 
-        for (auto i = 0u; i < StandardPagesForLogs; ++i) {
-            auto page = saved_logs.pages[i];
-            if (page != nullptr) {
-                SEGGER_RTT_Write(0, page, StandardPageSize);
-            }
-        }
+        SEGGER_RTT_Write(0, saved_logs.pages[0], saved_logs.size);
 
         fk_logs_printf(end_footer);
 
@@ -127,10 +328,9 @@ void fk_logs_saved_write(bool echo) {
 
     get_sd_card()->append_logs((uint8_t *)begin_header, strlen(begin_header));
 
-    for (auto i = 0u; i < StandardPagesForLogs; ++i) {
-        if (saved_logs.pages[i] != nullptr) {
-            get_sd_card()->append_logs(saved_logs.pages[i], StandardPageSize);
-        }
+    for (auto position = 0u; position < saved_logs.size; position += StandardPageSize) {
+        auto writing = std::min(saved_logs.size - position, StandardPageSize);
+        get_sd_card()->append_logs(saved_logs.pages[0] + position, writing);
     }
 
     get_sd_card()->append_logs((uint8_t *)end_footer, strlen(end_footer));
@@ -143,37 +343,50 @@ void fk_logs_saved_free() {
             saved_logs.pages[i] = nullptr;
         }
     }
+    saved_logs.size = 0;
 }
 
-size_t write_log(LogMessage const *m, const char *fstring, va_list args) {
-    // No reason being here if we aren't going to log anything.
-    if (!logs_rtt_enabled && !logs_buffer_free) {
-        return true;
-    }
-
+static size_t write_log_text(char *buffer, size_t size, LogMessage const *m, const char *task, const char *fstring, va_list args) {
     auto level = alog_get_log_level((LogLevels)m->level);
     auto plain_fs = "%08" PRIu32 " %-10s %-7s %s%s: ";
-    auto color_fs = "";
-    auto task = os_task_get_name_self();
-    if (task == nullptr) {
-        task = "none";
-    }
 
-    if ((LogLevels)m->level == LogLevels::ERROR) {
-        color_fs = RTT_CTRL_TEXT_GREEN "%08" PRIu32 RTT_CTRL_TEXT_CYAN " %-10s " RTT_CTRL_TEXT_RED "%-7s %s%s: ";
-    } else if ((LogLevels)m->level == LogLevels::WARN) {
-        color_fs = RTT_CTRL_TEXT_GREEN "%08" PRIu32 RTT_CTRL_TEXT_CYAN " %-10s " RTT_CTRL_TEXT_MAGENTA "%-7s %s%s: ";
-    } else {
-        color_fs = RTT_CTRL_TEXT_GREEN "%08" PRIu32 RTT_CTRL_TEXT_CYAN " %-10s " RTT_CTRL_TEXT_YELLOW "%-7s " RTT_CTRL_TEXT_GREEN
-                                       "%s" RTT_CTRL_TEXT_YELLOW "%s" RTT_CTRL_RESET ": ";
+    // Leave room for the newline, long messages are truncated.
+    auto available = size - 1;
+    auto written = (size_t)tiny_snprintf(buffer, available, plain_fs, m->uptime, task, level, m->scope, m->facility);
+    if (written < available) {
+        written += tiny_vsnprintf(buffer + written, available - written, fstring, args);
     }
+    if (written > available - 1) {
+        written = available - 1;
+    }
+
+    buffer[written++] = '\n';
+
+    return written;
+}
+
+/**
+ * Formats a record straight into the log buffer and RTT under the lock,
+ * for records that can't wait for the idle task.
+ */
+static size_t write_log_locked(LogMessage const *m, const char *task, const char *fstring, va_list args) {
+    auto level = alog_get_log_level((LogLevels)m->level);
+    auto plain_fs = "%08" PRIu32 " %-10s %-7s %s%s: ";
 
     SEGGER_RTT_LOCK();
 
     if (logs_rtt_enabled) {
-        SEGGER_RTT_printf(0, color_fs, m->uptime, task, level, m->scope, m->facility);
-        SEGGER_RTT_vprintf(0, fstring, &args);
+        va_list copy;
+        va_copy(copy, args);
+        if ((LogLevels)m->level == LogLevels::ERROR) {
+            SEGGER_RTT_WriteString(0, RTT_CTRL_TEXT_RED);
+        } else if ((LogLevels)m->level == LogLevels::WARN) {
+            SEGGER_RTT_WriteString(0, RTT_CTRL_TEXT_MAGENTA);
+        }
+        SEGGER_RTT_printf(0, plain_fs, m->uptime, task, level, m->scope, m->facility);
+        SEGGER_RTT_vprintf(0, fstring, &copy);
         SEGGER_RTT_WriteString(0, RTT_CTRL_RESET "\n");
+        va_end(copy);
     }
 
     if (logs_buffer_free) {
@@ -188,7 +401,51 @@ size_t write_log(LogMessage const *m, const char *fstring, va_list args) {
 
     SEGGER_RTT_UNLOCK();
 
-    return true;
+    return 1;
+}
+
+size_t write_log(LogMessage const *m, const char *fstring, va_list args) {
+    // No reason being here if we aren't going to log anything.
+    if (!logs_rtt_enabled && !logs_buffer_free) {
+        return true;
+    }
+
+    auto task = os_task_get_name_self();
+    if (task == nullptr) {
+        task = "none";
+    }
+
+    // Once we're faulting the idle task may never run again.
+    if (logs_synchronous) {
+        return write_log_locked(m, task, fstring, args);
+    }
+
+    // Rendering and echoing records is left to whoever drains, usually
+    // the idle task. Rather than lose a record when the ring is full it's
+    // written the slow way, ahead of anything still in the ring.
+    uint32_t reserved = 0;
+    auto s = ring.reserve(reserved);
+    if (s == nullptr) {
+        return write_log_locked(m, task, fstring, args);
+    }
+
+    auto size = 0u;
+    if (fk_logs_binary_enabled()) {
+        size = log_binary_encode((uint8_t *)s->data, sizeof(s->data), m, task, fstring, args);
+        logs_binary_used = true;
+    } else {
+        size = write_log_text(s->data, sizeof(s->data), m, task, fstring, args);
+    }
+
+    s->level = m->level;
+    ring.commit(s, reserved, size);
+
+    // Before the scheduler starts there's no idle task to drain for us.
+    if (!os_is_running()) {
+        fk_logs_drain();
+    }
+
+    return size;
 }
 
 task_stack *fk_get_task_stack() {
@@ -266,15 +523,14 @@ bool fk_logging_initialize() {
 }
 
 bool fk_logging_dump_buffer() {
+    fk_logs_drain();
+
     SEGGER_RTT_LOCK();
 
     SEGGER_RTT_WriteString(0, RTT_CTRL_RESET "\n");
 
-    for (auto c : logs) {
-        if (c != 0) {
-            SEGGER_RTT_PutChar(0, c);
-        }
-    }
+    auto iter = logs.begin();
+    log_binary_render_buffer(logs, iter, write_rtt, nullptr);
 
     SEGGER_RTT_WriteString(0, RTT_CTRL_RESET "\n");
 
@@ -293,6 +549,12 @@ void fk_logs_vprintf(const char *f, va_list args) {
     vprintf(f, args);
 }
 
+void fk_logs_drain() {
+}
+
+void fk_logs_synchronous() {
+}
+
 bool fk_logs_flush() {
     return true;
 }
@@ -312,6 +574,8 @@ void fk_logs_printf(const char *f, ...) {
     va_list args;
     va_start(args, f);
 
+    fk_logs_drain();
+
     SEGGER_RTT_LOCK();
     fk_logs_vprintf(f, args);
     SEGGER_RTT_UNLOCK();
@@ -420,6 +684,8 @@ void fk_logs_clear() {
 bool fk_log_buffer_try_lock() {
     auto success = false;
 
+    fk_logs_drain();
+
     SEGGER_RTT_LOCK();
 
     if (logs_buffer_free) {
@@ -440,6 +706,22 @@ log_buffer &fk_log_buffer() {
     return logs;
 }
 
+void fk_logs_binary(bool enabled) {
+    logs_binary = enabled;
+}
+
+bool fk_logs_binary_enabled() {
+    return logs_binary || __atomic_load_n(&logs_binary_scopes, __ATOMIC_RELAXED) > 0;
+}
+
+void fk_logs_binary_begin() {
+    __atomic_fetch_add(&logs_binary_scopes, 1, __ATOMIC_RELAXED);
+}
+
+void fk_logs_binary_end() {
+    __atomic_fetch_sub(&logs_binary_scopes, 1, __ATOMIC_RELAXED);
+}
+
 } // namespace fk
 
 namespace fk {
@@ -22,6 +22,37 @@ bool fk_logs_flush();
 
 void fk_logs_clear();
 
+/**
+ * Switches between logging text and deferred binary records, which are
+ * rendered when they're drained to RTT, flushed to the SD card or when
+ * the logs are downloaded. \see log_binary.h
+ */
+void fk_logs_binary(bool enabled);
+
+bool fk_logs_binary_enabled();
+
+/**
+ * Logs binary records until a matching fk_logs_binary_end, whatever
+ * fk_logs_binary says. These nest, \see ScopedBinaryLogs
+ */
+void fk_logs_binary_begin();
+
+void fk_logs_binary_end();
+
+/**
+ * Moves records tasks have logged from the lock-free ring into the log
+ * buffer and echoes them to RTT. This is called from the idle task and
+ * by loggers that find the ring filling up. \see log_ring.h
+ */
+void fk_logs_drain();
+
+/**
+ * For fault, assertion and panic paths. Drains whatever the ring holds,
+ * even if another task was in the middle of draining, and from then on
+ * writes every record straight to the log buffer and RTT.
+ */
+void fk_logs_synchronous();
+
 void fk_logs_printf(const char *f, ...);
 
 void fk_logs_saved_capture();
@@ -85,4 +116,19 @@ public:
     }
 };
 
+/**
+ * Logs binary records for as long as this is around, for tasks that
+ * can't afford to format their logs as they go.
+ */
+class ScopedBinaryLogs {
+public:
+    ScopedBinaryLogs() {
+        fk_logs_binary_begin();
+    }
+
+    virtual ~ScopedBinaryLogs() {
+        fk_logs_binary_end();
+    }
+};
+
 } // namespace fk
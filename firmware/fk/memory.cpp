@@ -9,16 +9,65 @@ FK_DECLARE_LOGGER("memory");
 
 constexpr size_t SizeOfStandardPagePool = FK_MEMORY_PAGES;
 
+/**
+ * Terminates the free list, page indices have to stay below this.
+ */
+constexpr uint32_t InvalidPage = 0xffff;
+
+static_assert(SizeOfStandardPagePool < InvalidPage, "too many standard pages");
+
 struct StandardPages {
     void *base{ nullptr };
     int32_t available{ 0 };
     const char *owner{ nullptr };
     uint32_t allocated{ 0 };
+    // Index of the next free page, only meaningful while this one is free.
+    uint32_t next{ InvalidPage };
 };
 
 static StandardPages pages[SizeOfStandardPagePool];
+static uint8_t *pages_memory = nullptr;
 static size_t pages_allocated = 0u;
+static int32_t pages_used = 0;
 static size_t highwater = 0u;
+// Index of the first free page in the low half, the high half is bumped on
+// every change so a compare and exchange against a stale head always fails.
+static uint32_t free_head = InvalidPage;
+static standard_page_reclaim_fn_t reclaim_hook = nullptr;
+
+static inline bool atomic_compare_exchange(int32_t *ptr, int32_t compare, int32_t exchange) {
+    return __atomic_compare_exchange_n(ptr, &compare, exchange, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_store(int32_t *ptr, int32_t value) {
+    __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t free_list_head(uint32_t head, uint32_t index) {
+    return (((head >> 16) + 1) << 16) | index;
+}
+
+static int32_t free_list_pop() {
+    auto head = __atomic_load_n(&free_head, __ATOMIC_SEQ_CST);
+    while (true) {
+        auto index = head & InvalidPage;
+        if (index == InvalidPage) {
+            return -1;
+        }
+
+        auto next = __atomic_load_n(&pages[index].next, __ATOMIC_SEQ_CST);
+        if (__atomic_compare_exchange_n(&free_head, &head, free_list_head(head, next), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            return (int32_t)index;
+        }
+    }
+}
+
+static void free_list_push(uint32_t index) {
+    auto head = __atomic_load_n(&free_head, __ATOMIC_SEQ_CST);
+    do {
+        __atomic_store_n(&pages[index].next, head & InvalidPage, __ATOMIC_SEQ_CST);
+    } while (!__atomic_compare_exchange_n(&free_head, &head, free_list_head(head, index), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+}
 
 void fk_standard_page_initialize() {
 #if defined(__SAMD51__)
@@ -32,14 +81,18 @@ void fk_standard_page_initialize() {
         FK_ASSERT(number_pages <= SizeOfStandardPagePool);
         FK_ASSERT(number_pages > 0);
 
+        pages_memory = memory;
+
         for (auto i = 0u; i < number_pages; ++i) {
             pages[i].base = memory;
             pages[i].available = true;
             pages[i].owner = nullptr;
             pages[i].allocated = 0;
+            pages[i].next = i + 1 < number_pages ? i + 1 : InvalidPage;
             memory += StandardPageSize;
         }
 
+        free_head = 0;
         pages_allocated = number_pages;
     }
 
@@ -50,6 +103,36 @@ void fk_standard_page_initialize() {
     loginfo("allocated %zd pages (%zd bytes)", pages_allocated, pages_allocated * StandardPageSize);
 }
 
+struct StandardPageOwners {
+    const char *names[SizeOfStandardPagePool];
+    size_t pages[SizeOfStandardPagePool];
+    size_t size{ 0 };
+};
+
+static void standard_page_owners(StandardPageOwners &owners) {
+    for (auto i = 0u; i < SizeOfStandardPagePool; ++i) {
+        auto owner = pages[i].owner;
+        if (pages[i].available || owner == nullptr) {
+            continue;
+        }
+
+        auto found = false;
+        for (auto j = 0u; j < owners.size; ++j) {
+            if (strcmp(owners.names[j], owner) == 0) {
+                owners.pages[j]++;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            owners.names[owners.size] = owner;
+            owners.pages[owners.size] = 1;
+            owners.size++;
+        }
+    }
+}
+
 void fk_oom() {
     logerror("oom!");
 
@@ -58,38 +141,66 @@ void fk_oom() {
             logerror("[%2d] owner = %s allocated=%" PRIu32, i, pages[i].owner, pages[i].allocated);
         }
     }
-}
-
-static inline bool atomic_compare_exchange(int32_t *ptr, int32_t compare, int32_t exchange) {
-    return __atomic_compare_exchange_n(ptr, &compare, exchange, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
-}
 
-static inline void atomic_store(int32_t *ptr, int32_t value) {
-    __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+    StandardPageOwners owners;
+    standard_page_owners(owners);
+    for (auto i = 0u; i < owners.size; ++i) {
+        logerror("'%s' owns %zd pages", owners.names[i], owners.pages[i]);
+    }
 }
 
-void *fk_standard_page_malloc(size_t size, const char *name) {
-    FK_ASSERT(size == StandardPageSize);
-
+static void *standard_page_take(const char *name) {
     if (pages_allocated == 0) {
         fk_standard_page_initialize();
     }
 
-    auto selected = -1;
+    auto selected = free_list_pop();
+    if (selected < 0) {
+        return nullptr;
+    }
 
-    for (auto i = 0u; i < SizeOfStandardPagePool; ++i) {
-        if (atomic_compare_exchange(&pages[i].available, 1, 0)) {
-            selected = i;
-            if (i > highwater) {
-                highwater = selected;
-            }
-            pages[selected].owner = name;
+    auto &page = pages[selected];
+    FK_ASSERT(page.available);
+    atomic_store(&page.available, 0);
+    page.owner = name;
 #if defined(__SAMD51__)
-            pages[selected].allocated = fk_uptime();
+    page.allocated = fk_uptime();
 #endif
-            logdebug("[%2d] malloc '%s'", selected, name);
-            return pages[selected].base;
-        }
+
+    auto used = (size_t)__atomic_add_fetch(&pages_used, 1, __ATOMIC_SEQ_CST);
+    if (used > highwater) {
+        highwater = used;
+    }
+
+    logdebug("[%2d] malloc '%s'", selected, name);
+
+    return page.base;
+}
+
+static void *standard_page_take_or_reclaim(const char *name) {
+    auto ptr = standard_page_take(name);
+    if (ptr != nullptr) {
+        return ptr;
+    }
+
+    auto reclaim = __atomic_load_n(&reclaim_hook, __ATOMIC_SEQ_CST);
+    if (reclaim == nullptr || !reclaim()) {
+        return nullptr;
+    }
+
+    return standard_page_take(name);
+}
+
+void fk_standard_page_configure_reclaim(standard_page_reclaim_fn_t reclaim) {
+    __atomic_store_n(&reclaim_hook, reclaim, __ATOMIC_SEQ_CST);
+}
+
+void *fk_standard_page_malloc(size_t size, const char *name) {
+    FK_ASSERT(size == StandardPageSize);
+
+    auto ptr = standard_page_take_or_reclaim(name);
+    if (ptr != nullptr) {
+        return ptr;
     }
 
     fk_oom();
@@ -105,38 +216,67 @@ void *fk_standard_page_malloc(size_t size, const char *name) {
     return nullptr;
 }
 
+void *fk_standard_page_malloc_wait(size_t size, const char *name, uint32_t to) {
+    FK_ASSERT(size == StandardPageSize);
+
+    // Counting our own delays rather than watching the uptime, which
+    // tests are free to stop.
+    uint32_t waited = 0;
+    while (true) {
+        auto ptr = standard_page_take_or_reclaim(name);
+        if (ptr != nullptr) {
+            if (waited > 0) {
+                logwarn("'%s' waited %" PRIu32 "ms for a page", name, waited);
+            }
+            return ptr;
+        }
+
+        if (waited >= to) {
+            break;
+        }
+
+        fk_delay(StandardPageWaitPollMs);
+        waited += StandardPageWaitPollMs;
+    }
+
+    logwarn("'%s' gave up waiting for a page after %" PRIu32 "ms", name, waited);
+
+    return nullptr;
+}
+
 void fk_standard_page_free(void *ptr) {
-    const char *owner = "<unknown>";
-    auto selected = -1;
+    auto offset = (uintptr_t)ptr - (uintptr_t)pages_memory;
+    if (pages_memory == nullptr || ptr == nullptr || (uintptr_t)ptr < (uintptr_t)pages_memory ||
+        offset >= pages_allocated * StandardPageSize || (offset % StandardPageSize) != 0) {
+        logerror("unknown page pointer: %p", ptr);
+        FK_ASSERT(false);
+        return;
+    }
 
-    for (auto i = 0u; i < SizeOfStandardPagePool; ++i) {
-        if (pages[i].base == ptr && pages[i].base != nullptr) {
-            selected = i;
+    auto selected = offset / StandardPageSize;
+    auto &page = pages[selected];
+    if (!atomic_compare_exchange(&page.available, 0, 1)) {
+        logerror("[%2zd] double free", selected);
+        FK_ASSERT(false);
+        return;
+    }
 
-            owner = pages[selected].owner;
-            FK_ASSERT(owner != nullptr);
+    auto owner = page.owner;
+    FK_ASSERT(owner != nullptr);
 
-            pages[selected].owner = nullptr;
+    page.owner = nullptr;
 
 #if defined(FK_ENABLE_MEMORY_GARBLE)
-            fk_memory_garble(ptr, StandardPageSize);
+    fk_memory_garble(ptr, StandardPageSize);
 #else
-            bzero(ptr, StandardPageSize);
+    bzero(ptr, StandardPageSize);
 #endif
 
-            atomic_store(&pages[selected].available, 1);
-            break;
-        }
-    }
-
-    if (selected == -1) {
-        logerror("unknown page pointer: %p", ptr);
-        FK_ASSERT(selected != -1);
-    }
+    __atomic_sub_fetch(&pages_used, 1, __ATOMIC_SEQ_CST);
 
-    logdebug("[%2d] free '%s'", selected, owner);
+    free_list_push(selected);
 
-    return;
+    logdebug("[%2zd] free '%s'", selected, owner);
 }
 
 StandardPageMemInfo fk_standard_page_meminfo() {
@@ -155,12 +295,28 @@ StandardPageMemInfo fk_standard_page_meminfo() {
     return info;
 }
 
+size_t fk_standard_page_owned(const char *owner) {
+    auto owned = 0u;
+    for (auto i = 0u; i < SizeOfStandardPagePool; ++i) {
+        if (!pages[i].available && pages[i].owner != nullptr && strcmp(pages[i].owner, owner) == 0) {
+            owned++;
+        }
+    }
+    return owned;
+}
+
 void fk_standard_page_log() {
     for (auto i = 0u; i < SizeOfStandardPagePool; ++i) {
         if (!pages[i].available && pages[i].base != nullptr) {
             logdebug("[%2d] owner = %s allocated=%" PRIu32, i, pages[i].owner, pages[i].allocated);
         }
     }
+
+    StandardPageOwners owners;
+    standard_page_owners(owners);
+    for (auto i = 0u; i < owners.size; ++i) {
+        logdebug("'%s' owns %zd pages", owners.names[i], owners.pages[i]);
+    }
 }
 
 void fk_memory_garble(void *ptr, size_t size) {
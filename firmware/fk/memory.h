@@ -8,8 +8,24 @@ void fk_standard_page_initialize();
 
 void *fk_standard_page_malloc(size_t size, const char *name);
 
+/**
+ * Like fk_standard_page_malloc, only when there are no free pages this
+ * waits up to `to` milliseconds for one to be freed, returning nullptr
+ * rather than asserting if none is.
+ */
+void *fk_standard_page_malloc_wait(size_t size, const char *name, uint32_t to);
+
 void fk_standard_page_free(void *ptr);
 
+/**
+ * Called when there are no free pages, before waiting or giving up, so
+ * anybody keeping pages they can do without gets to give them back.
+ * Returns true if any were.
+ */
+typedef bool (*standard_page_reclaim_fn_t)();
+
+void fk_standard_page_configure_reclaim(standard_page_reclaim_fn_t reclaim);
+
 struct StandardPageMemInfo {
     size_t free;
     size_t total;
@@ -19,6 +35,11 @@ struct StandardPageMemInfo {
 
 StandardPageMemInfo fk_standard_page_meminfo();
 
+/**
+ * Number of pages allocated under the given name.
+ */
+size_t fk_standard_page_owned(const char *owner);
+
 void fk_standard_page_log();
 
 void fk_memory_garble(void *ptr, size_t size);
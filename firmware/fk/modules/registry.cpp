@@ -1,5 +1,6 @@
 #include "modules/registry.h"
 #include "modules/unknown.h"
+#include "collections.h"
 
 namespace fk {
 
@@ -15,6 +16,18 @@ typedef struct ModuleNode {
 
 static ModuleNode nodes[FK_MODULES_BUILTIN_MAXIMUM];
 
+typedef struct ModuleKey {
+    uint32_t manufacturer;
+    uint32_t kind;
+    uint32_t version;
+} ModuleKey;
+
+/**
+ * Builtin modules by manufacturer, kind and version, every scan resolves
+ * each attached module through here.
+ */
+static pool_map<ModuleKey, ModuleMetadata const *, FK_MODULES_BUILTIN_MAXIMUM> modules_by_key;
+
 static uint32_t fk_modules_builtin_get(ModuleNode **iter);
 
 FK_DECLARE_LOGGER("modreg");
@@ -39,21 +52,13 @@ void ModuleRegistry::initialize() {
 }
 
 ModuleMetadata const *ModuleRegistry::resolve(ModuleHeader const &header) {
-    ModuleNode *iter = nullptr;
+    ModuleMetadata const *meta = nullptr;
 
-    if (fk_modules_builtin_get(&iter) != 0) {
+    if (!modules_by_key.get(ModuleKey{ header.manufacturer, header.kind, header.version }, meta)) {
         return &fk_unknown_module;
     }
 
-    for (; iter != nullptr; iter = iter->link) {
-        auto meta = iter->meta;
-
-        if (header.manufacturer == meta->manufacturer && header.kind == meta->kind && header.version == meta->version) {
-            return iter->meta;
-        }
-    }
-
-    return &fk_unknown_module;
+    return meta;
 }
 
 static uint32_t fk_modules_builtin_get(ModuleNode **iter) {
@@ -71,6 +76,7 @@ extern "C" {
 
 uint32_t fk_modules_builtin_clear() {
     bzero(nodes, sizeof(nodes));
+    modules_by_key.clear();
     return 0;
 }
 
@@ -87,6 +93,12 @@ uint32_t fk_modules_builtin_register(ModuleMetadata const *modmeta) {
             if (prev != NULL) {
                 prev->link = &nodes[i];
             }
+
+            // First registered wins, same as when we walked the list.
+            auto key = ModuleKey{ modmeta->manufacturer, modmeta->kind, modmeta->version };
+            if (modules_by_key.find(key) == nullptr) {
+                modules_by_key.put(key, modmeta);
+            }
             break;
         }
         prev = &nodes[i];
@@ -3,6 +3,7 @@
 
 #include "networking/api_handler.h"
 #include "networking/http_reply.h"
+#include "networking/status_reply_cache.h"
 
 #include "storage/storage.h"
 #include "state_manager.h"
@@ -338,9 +339,8 @@ static bool configure(HttpServerConnection *connection, fk_app_HttpQuery *query,
         loginfo("have %zd networks", networks_array->length);
 
         configuration_modified |= gsm.apply([=](GlobalState *gs) {
-            auto networks = (fk_app_NetworkInfo *)networks_array->buffer;
             for (auto i = 0u; i < nnetworks; ++i) {
-                auto &n = networks[i];
+                auto &n = *networks_array->item<fk_app_NetworkInfo>(i);
                 auto ssid = pb_get_string_if_provided(n.ssid.arg, pool);
                 auto password = pb_get_string_if_provided(n.password.arg, pool);
                 auto &nc = gs->network.config.wifi_networks[i];
@@ -515,16 +515,31 @@ static bool send_simple_success(HttpServerConnection *connection, fk_app_HttpQue
 static bool send_status(HttpServerConnection *connection, fk_app_HttpQuery *query, Pool *pool) {
     auto gs = get_global_state_ro();
 
-    HttpReply http_reply{ *pool, gs.get() };
-
     auto logs = false;
     if (query != nullptr) {
         logs = (query->flags & fk_app_QueryFlags_QUERY_FLAGS_LOGS) == fk_app_QueryFlags_QUERY_FLAGS_LOGS;
     }
 
-    FK_ASSERT(http_reply.include_status(get_clock_now(), fk_uptime(), logs, &fkb_header));
+    // Logs change constantly, so those replies are never cached.
+    if (logs) {
+        HttpReply http_reply{ *pool, gs.get() };
+
+        FK_ASSERT(http_reply.include_status(get_clock_now(), fk_uptime(), logs, &fkb_header));
+
+        connection->write(http_reply.reply(), *pool);
+    } else {
+        auto cache = get_status_reply_cache();
+        auto encoded = cache->encode(gs.get(), get_global_state_generation(), get_clock_now(), fk_uptime(), &fkb_header, *pool);
+        if (encoded.buffer == nullptr) {
+            connection->fault(*pool);
+        } else {
+            loginfo("[%" PRIu32 "] status %s encode=%" PRIu32 "ms hits=%" PRIu32 "/%" PRIu32, connection->number(),
+                    encoded.hit ? "hit" : "miss", encoded.encode_time, cache->hits(), cache->hits() + cache->misses());
+
+            connection->write(HttpStatus::Ok, "ok", encoded.buffer->buffer(), encoded.buffer->position(), *pool);
+        }
+    }
 
-    connection->write(http_reply.reply(), *pool);
     connection->close();
 
 #if defined(FK_LOGS_FLUSH_AGGRESSIVE)
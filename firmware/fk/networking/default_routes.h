@@ -34,18 +34,12 @@ private:
         { "/fk/v1/download/file", &download_handler_file },
     };
 
-    ModuleHandler *module_handlers[MaximumNumberOfPhysicalModules];
-    HttpRoute *modules[MaximumNumberOfPhysicalModules];
+    ModuleHandler module_handler;
+    HttpRoute modules{ "/fk/v1/modules/:position", &module_handler };
 
 public:
     void add_routes(HttpRouter &router, Pool *pool) {
-        // NOTE: Order is important here.
-        for (auto i = 0u; i < MaximumNumberOfPhysicalModules; ++i) {
-            auto path = pool->sprintf("/fk/v1/modules/%d", i);
-            module_handlers[i] = new (pool) ModuleHandler(ModulePosition::from(i));
-            modules[i] = new (pool) HttpRoute(path, module_handlers[i]);
-            router.add_route(modules[i]);
-        }
+        router.add_route(&modules);
         router.add_route(&downloads[0]);
         router.add_route(&downloads[1]);
         router.add_route(&downloads[2]);
@@ -5,6 +5,8 @@
 #include "progress_tracker.h"
 #include "gs_progress_callbacks.h"
 #include "storage/storage.h"
+#include "storage/storage_session.h"
+#include "networking/file_transfer.h"
 
 namespace fk {
 
@@ -49,8 +51,6 @@ tl::expected<DownloadWorker::HeaderInfo, Error> DownloadWorker::get_headers(File
 }
 
 // #define FK_TESTING_DOWNLOAD_LIMIT           (1024 * 1024 * 100)
-// #define FK_TESTING_DOWNLOAD_READS_DISABLED
-// #define FK_TESTING_DOWNLOAD_READS_GARBAGE
 
 void DownloadWorker::run(Pool &pool) {
     serve(pool);
@@ -74,21 +74,19 @@ void DownloadWorker::serve(Pool &pool) {
     // happen during periods of more intense logging, say when
     // accessing the file system.
     // You've been warned.
-    ScopedLogLevelChange change{ LogLevels::INFO };
-
-    if ((LogLevels)log_get_level() != LogLevels::INFO) {
-        logwarn("increased log verbosity will cause networking issues");
-    }
+    // Binary logging defers all of that formatting to the idle task, so
+    // then we can leave the verbosity alone.
+    ScopedBinaryLogs binary_logs;
 
     auto started = fk_uptime();
-    StatisticsMemory memory{ MemoryFactory::get_data_memory() };
-    Storage storage{ &memory, pool };
-
-    if (!storage.begin()) {
+    BorrowedStorage borrowed{ lock };
+    if (!borrowed) {
         connection_->error(HttpStatus::ServerError, "error opening storage", pool);
         return;
     }
 
+    auto &storage = *borrowed;
+
     auto file_reader = storage.file_reader(file_number_, pool);
 
     auto is_head = connection_->is_head_method();
@@ -108,7 +106,7 @@ void DownloadWorker::serve(Pool &pool) {
                 is_head ? "HEAD" : "GET");
     }
 
-    memory.log_statistics("flash usage: ");
+    storage.statistics().log("flash usage: ");
 
 #if defined(FK_TESTING_DOWNLOAD_LIMIT)
     FK_ASSERT(info.size > FK_TESTING_DOWNLOAD_LIMIT);
@@ -131,64 +129,25 @@ void DownloadWorker::serve(Pool &pool) {
         return;
     }
 
-    size_t buffer_size = NetworkBufferSize;
-    uint8_t *buffer = (uint8_t *)pool.malloc(buffer_size);
-
     GlobalStateProgressCallbacks gs_progress;
     auto tracker = ProgressTracker{ &gs_progress, Operation::Download, "download", "", info.size };
-    auto bytes_copied = 0u;
-    auto total_read_time = 0u;
-    auto total_write_time = 0u;
-    while (bytes_copied < info.size) {
-        auto to_read = std::min<int32_t>(buffer_size, info.size - bytes_copied);
-        auto read_started = fk_uptime();
-#if !defined(FK_TESTING_DOWNLOAD_READS_DISABLED)
-#if !defined(FK_TESTING_DOWNLOAD_READS_GARBAGE)
-        auto bytes_read = file_reader->read(buffer, to_read);
-#else
-        auto bytes_read = memory.read(0, buffer, to_read, MemoryReadFlags::None);
-#endif
-        FK_ASSERT(bytes_read <= to_read);
-        if (bytes_read == 0) {
-            break;
-        }
-        if (bytes_read < 0) {
-            logerror("read error (%" PRId32 " != %" PRId32 ")", bytes_read, to_read);
-            break;
-        }
-#else
-        auto bytes_read = to_read;
-        memset(buffer, 0xab, bytes_read);
-#endif
-        auto read_time = fk_uptime() - read_started;
-
-        auto write_started = fk_uptime();
-        auto wrote = connection_->write(buffer, bytes_read);
-        FK_ASSERT(wrote <= bytes_read);
-        if (wrote != bytes_read) {
-            logerror("write error (%" PRId32 " != %" PRId32 ")", wrote, bytes_read);
-            break;
-        }
-
-        auto write_time = fk_uptime() - write_started;
-
-        tracker.update(bytes_read, read_time, write_time);
-
-        bytes_copied += bytes_read;
-        total_read_time += read_time;
-        total_write_time += write_time;
-    }
+    auto transfer_started = fk_uptime();
+    auto stats = transfer_file(file_reader, connection_, info.size, tracker, pool);
 
     tracker.finished();
 
     auto elapsed = fk_uptime() - started;
-    auto speed = ((bytes_copied / 1024.0f) / (elapsed / 1000.0f));
-    loginfo("done (%d) (%" PRIu32 "ms) %.2fkbps total-read-time=%" PRIu32 " total-write-time=%" PRIu32, bytes_copied, elapsed, speed,
-            total_read_time, total_write_time);
+    auto transfer_elapsed = std::max<uint32_t>(fk_uptime() - transfer_started, 1);
+    auto speed = ((stats.bytes / 1024.0f) / (elapsed / 1000.0f));
+    auto overlap = (float)(stats.read_time + stats.write_time) / transfer_elapsed;
+    auto copies = stats.bytes > 0 ? ((float)stats.copied / stats.bytes) : 0.0f;
+    loginfo("done (%" PRIu32 ") (%" PRIu32 "ms) %.2fkbps total-read-time=%" PRIu32 " total-write-time=%" PRIu32
+            " overlapped=%d overlap=%.2f copies/byte=%.2f",
+            stats.bytes, elapsed, speed, stats.read_time, stats.write_time, stats.overlapped, overlap, copies);
 
     connection_->close();
 
-    memory.log_statistics("flash usage: ");
+    storage.statistics().log("flash usage: ");
 }
 
 bool DownloadWorker::write_headers(HeaderInfo header_info, Pool &pool) {
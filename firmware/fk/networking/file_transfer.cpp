@@ -0,0 +1,210 @@
+#include "networking/file_transfer.h"
+#include "hal/hal.h"
+#include "hal/overlapped.h"
+
+namespace fk {
+
+FK_DECLARE_LOGGER("transfer");
+
+/**
+ * Hands the file system buffers a read writes from to the overlapped
+ * writer, so the next read can happen while they're sent. They're
+ * retained until they've been written. Anything that can't be retained
+ * is only good until the read returns, so we wait for that one.
+ */
+class OverlappedSink : public Writer {
+private:
+    FileReader *file_reader_;
+    OverlappedWriter *overlapped_;
+    ProgressTracker &tracker_;
+    FileTransferStatistics &stats_;
+    bool retained_[OverlappedWriter::NumberOfSlots];
+    size_t head_{ 0 };
+    size_t pending_{ 0 };
+    uint32_t waiting_{ 0 };
+    uint32_t read_time_{ 0 };
+    bool failed_{ false };
+
+public:
+    OverlappedSink(FileReader *file_reader, OverlappedWriter *overlapped, ProgressTracker &tracker, FileTransferStatistics &stats)
+        : file_reader_(file_reader), overlapped_(overlapped), tracker_(tracker), stats_(stats) {
+    }
+
+public:
+    int32_t write(uint8_t const *buffer, size_t size) override {
+        while (!failed_ && !overlapped_->writable()) {
+            reap();
+        }
+
+        if (failed_) {
+            return -1;
+        }
+
+        auto retained = file_reader_->retain(buffer);
+        retained_[(head_ + pending_) % OverlappedWriter::NumberOfSlots] = retained;
+        pending_++;
+
+        overlapped_->write(buffer, size);
+
+        if (!retained) {
+            flush();
+            if (failed_) {
+                return -1;
+            }
+        }
+
+        return size;
+    }
+
+    /**
+     * Waits for everything queued to be written.
+     */
+    void flush() {
+        while (pending_ > 0) {
+            reap();
+        }
+    }
+
+    void read_time(uint32_t read_time) {
+        read_time_ = read_time;
+    }
+
+    uint32_t waiting() const {
+        return waiting_;
+    }
+
+    bool failed() const {
+        return failed_;
+    }
+
+private:
+    void reap() {
+        auto started = fk_uptime();
+
+        OverlappedWriter::Chunk chunk;
+        auto taken = overlapped_->written(chunk);
+        FK_ASSERT(taken);
+
+        waiting_ += fk_uptime() - started;
+
+        if (retained_[head_]) {
+            file_reader_->release(chunk.buffer);
+        }
+        head_ = (head_ + 1) % OverlappedWriter::NumberOfSlots;
+        pending_--;
+
+        if (chunk.size < 0) {
+            failed_ = true;
+            return;
+        }
+
+        tracker_.update(chunk.size, read_time_, chunk.write_time);
+
+        stats_.bytes += chunk.size;
+        stats_.write_time += chunk.write_time;
+    }
+};
+
+static FileTransferStatistics transfer_overlapped(FileReader *file_reader, OverlappedWriter *overlapped, uint32_t size,
+                                                  ProgressTracker &tracker) {
+    FileTransferStatistics stats;
+    stats.overlapped = true;
+
+    OverlappedSink sink{ file_reader, overlapped, tracker, stats };
+
+    auto position = 0u;
+    while (position < size) {
+        auto to_read = std::min<int32_t>(NetworkBufferSize, size - position);
+        auto started = fk_uptime();
+        auto waiting_before = sink.waiting();
+
+        auto bytes_read = file_reader->read(&sink, to_read);
+        FK_ASSERT(bytes_read <= to_read);
+        if (sink.failed()) {
+            break;
+        }
+        if (bytes_read == 0) {
+            break;
+        }
+        if (bytes_read < 0) {
+            logerror("read error (%" PRId32 " != %" PRId32 ")", bytes_read, to_read);
+            stats.failed = true;
+            break;
+        }
+
+        auto read_time = (fk_uptime() - started) - (sink.waiting() - waiting_before);
+        sink.read_time(read_time);
+
+        position += bytes_read;
+        stats.read_time += read_time;
+
+#if defined(FK_WDT_ENABLE)
+        fk_wdt_feed();
+#endif
+    }
+
+    sink.flush();
+
+    overlapped->stop();
+
+    if (sink.failed()) {
+        logerror("write error");
+        stats.failed = true;
+    }
+
+    return stats;
+}
+
+static FileTransferStatistics transfer_serial(FileReader *file_reader, Writer *writer, uint32_t size, ProgressTracker &tracker) {
+    FileTransferStatistics stats;
+
+    TimedWriter timed{ writer };
+
+    while (stats.bytes < size) {
+        auto to_read = std::min<int32_t>(NetworkBufferSize, size - stats.bytes);
+        auto started = fk_uptime();
+        auto write_time_before = timed.elapsed();
+
+        auto bytes_read = file_reader->read(&timed, to_read);
+        FK_ASSERT(bytes_read <= to_read);
+        if (timed.failed()) {
+            logerror("write error (%" PRId32 " != %" PRId32 ")", bytes_read, to_read);
+            stats.failed = true;
+            break;
+        }
+        if (bytes_read == 0) {
+            break;
+        }
+        if (bytes_read < 0) {
+            logerror("read error (%" PRId32 " != %" PRId32 ")", bytes_read, to_read);
+            stats.failed = true;
+            break;
+        }
+
+        auto write_time = timed.elapsed() - write_time_before;
+        auto read_time = (fk_uptime() - started) - write_time;
+
+        tracker.update(bytes_read, read_time, write_time);
+
+        stats.bytes += bytes_read;
+        stats.read_time += read_time;
+        stats.write_time += write_time;
+
+#if defined(FK_WDT_ENABLE)
+        fk_wdt_feed();
+#endif
+    }
+
+    return stats;
+}
+
+FileTransferStatistics transfer_file(FileReader *file_reader, Writer *writer, uint32_t size, ProgressTracker &tracker, Pool &pool) {
+    auto overlapped = create_overlapped_writer(pool);
+    if (overlapped != nullptr && overlapped->begin(writer)) {
+        return transfer_overlapped(file_reader, overlapped, size, tracker);
+    }
+
+    return transfer_serial(file_reader, writer, size, tracker);
+}
+
+} // namespace fk
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "common.h"
+#include "io.h"
+#include "pool.h"
+#include "progress_tracker.h"
+#include "storage/file_ops.h"
+
+namespace fk {
+
+struct FileTransferStatistics {
+    uint32_t bytes{ 0 };
+    uint32_t read_time{ 0 };
+    uint32_t write_time{ 0 };
+    uint32_t copied{ 0 };
+    bool overlapped{ false };
+    bool failed{ false };
+};
+
+/**
+ * Sends size bytes from file_reader to writer, straight from the file
+ * system's buffers. When writes can happen on another task they're
+ * overlapped with the reads, which always stay on the calling task.
+ */
+FileTransferStatistics transfer_file(FileReader *file_reader, Writer *writer, uint32_t size, ProgressTracker &tracker, Pool &pool);
+
+} // namespace fk
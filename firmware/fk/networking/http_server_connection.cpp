@@ -23,21 +23,25 @@ int32_t HttpServerConnection::plain(HttpStatus status, const char *status_descri
 
     auto length = strlen(text);
 
-    bytes_tx_ += conn_->writef("HTTP/1.1 %" PRId32 " %s\n", (int32_t)status, status_description);
-    bytes_tx_ += conn_->writef("Fk-Connection: #%" PRIu32 "\n", number_);
-    bytes_tx_ += conn_->writef("Content-Length: %zu\n", length);
-    bytes_tx_ += conn_->write("Content-Type: text/plain\n");
-    bytes_tx_ += conn_->write("Access-Control-Allow-Origin: *\n");
-    bytes_tx_ += conn_->write("Access-Control-Allow-Methods: GET, POST\n");
-    bytes_tx_ += conn_->write("Connection: close\n");
-    bytes_tx_ += conn_->write("\n");
-    bytes_tx_ += conn_->write(text);
+    BufferedWriter buffered{ this, buffer(), size_ };
+    write_headers(buffered, status, status_description, length, "text/plain");
+    buffered.write((uint8_t const *)text, length);
+    buffered.flush();
 
     req_.finished();
 
     return 0;
 }
 
+int32_t HttpServerConnection::close() {
+    if (keep_alive_) {
+        logdebug("[%" PRIu32 "] keep-alive", number_);
+        return 0;
+    }
+
+    return Connection::close();
+}
+
 int32_t HttpServerConnection::available() const {
     return req_.buffered_body_length();
 }
@@ -123,39 +127,84 @@ int32_t HttpServerConnection::write(fk_app_HttpReply const *reply, Pool &pool) {
     return write(HttpStatus::Ok, "ok", reply, fk_app_HttpReply_fields, pool);
 }
 
-int32_t HttpServerConnection::write_headers(HttpStatus status_code, const char *status_message, size_t size, Pool &pool) {
-    bytes_tx_ += conn_->write(pool.sprintf("HTTP/1.1 %" PRId32 " %s\n", (int32_t)status_code, status_message));
-    bytes_tx_ += conn_->write(pool.sprintf("Fk-Connection: #%" PRIu32 "\n", number_));
-    bytes_tx_ += conn_->write(pool.sprintf("Content-Length: %zu\n", size));
-    bytes_tx_ += conn_->write(pool.sprintf("Content-Type: %s\n", "application/octet-stream"));
-    bytes_tx_ += conn_->write("Access-Control-Allow-Origin: *\n");
-    bytes_tx_ += conn_->write("Access-Control-Allow-Methods: GET, POST\n");
-    bytes_tx_ += conn_->write("Connection: close\n");
-    bytes_tx_ += conn_->write("\n");
+uint8_t *HttpServerConnection::buffer() {
+    if (buffer_ == nullptr) {
+        size_ = HttpConnectionBufferSize;
+        buffer_ = (uint8_t *)pool_->malloc(size_);
+        position_ = 0;
+    }
+    return buffer_;
+}
+
+bool HttpServerConnection::parse(size_t nread) {
+    auto ptr = (char *)(buffer_ + position_);
+    ptr[nread] = 0;
+    auto parsed = req_.parse(ptr, nread);
+    if (parsed == 0) {
+        loginfo("[%" PRIu32 "] error parsing", number_);
+        return false;
+    }
 
-    return 0;
+    // Replies are written through the same buffer, so set aside anything
+    // after this request until we get to it.
+    if ((size_t)parsed < nread) {
+        pipelined_size_ = nread - parsed;
+        pipelined_ = (uint8_t *)pool_->copy(ptr + parsed, pipelined_size_);
+        logdebug("[%" PRIu32 "] pipelined (%zu bytes)", number_, pipelined_size_);
+    }
+
+    position_ += nread;
+
+    return true;
+}
+
+bool HttpServerConnection::can_keep_alive() const {
+    // Client connections and workers replying after service has moved on
+    // always close, as do requests whose body may still be on the wire.
+    if (router_ == nullptr || busy_ || !req_.keep_alive() || !req_.consumed()) {
+        return false;
+    }
+
+    if (requests_ + 1 >= HttpKeepAliveMaximumRequests) {
+        return false;
+    }
+
+    // Nothing is freed until the connection is, so stop once the
+    // connection's pool is getting full.
+    return pool_->used() < pool_->size() / 2;
+}
+
+int32_t HttpServerConnection::write_headers(BufferedWriter &buffered, HttpStatus status_code, const char *status_message, size_t size,
+                                            const char *content_type) {
+    keep_alive_ = can_keep_alive();
+
+    // Headers are formatted straight into the connection's buffer so they
+    // go out in the same write as the beginning of the body.
+    return buffered.write("HTTP/1.1 %" PRId32 " %s\n"
+                          "Fk-Connection: #%" PRIu32 "\n"
+                          "Content-Length: %zu\n"
+                          "Content-Type: %s\n"
+                          "Access-Control-Allow-Origin: *\n"
+                          "Access-Control-Allow-Methods: GET, POST\n"
+                          "Connection: %s\n"
+                          "\n",
+                          (int32_t)status_code, status_message, number_, size, content_type, keep_alive_ ? "keep-alive" : "close");
 }
 
 int32_t HttpServerConnection::write(HttpStatus status_code, const char *status_message, uint8_t const *data, size_t size, Pool &pool) {
     auto started = fk_uptime();
 
-    logdebug("[%" PRIu32 "] replying (%zd bytes)", number_, size);
-
-    auto err = write_headers(status_code, status_message, size, pool);
-    if (err < 0) {
-        return err;
-    }
+    auto content_size = hex_encoding_ ? size * 2 : size;
 
-    conn_->flush();
+    logdebug("[%" PRIu32 "] replying (%zd bytes)", number_, content_size);
 
-    logdebug("[%" PRIu32 "] headers done (%" PRIu32 "ms)", number_, fk_uptime() - started);
+    BufferedWriter buffered{ this, buffer(), size_ };
 
-    if (buffer_ == nullptr) {
-        size_ = HttpConnectionBufferSize;
-        buffer_ = (uint8_t *)pool_->malloc(size_);
+    auto err = write_headers(buffered, status_code, status_message, content_size, "application/octet-stream");
+    if (err < 0) {
+        return err;
     }
 
-    BufferedWriter buffered{ this, buffer_, size_ };
     HexWriter b64_writer{ &buffered };
     Writer *writer = &buffered;
 
@@ -169,12 +218,12 @@ int32_t HttpServerConnection::write(HttpStatus status_code, const char *status_m
 
     if (buffered.flush() < 0) {
         logwarn("[%" PRIu32 "] fail flush", number_);
-        return size;
+        return content_size;
     }
 
     logverbose("[%" PRIu32 "] pb done", number_);
 
-    bytes_tx_ += size;
+    bytes_tx_ += content_size;
     activity_ = fk_uptime();
 
     logverbose("[%" PRIu32 "] finished", number_);
@@ -183,39 +232,49 @@ int32_t HttpServerConnection::write(HttpStatus status_code, const char *status_m
 
     logdebug("[%" PRIu32 "] done writing (%" PRIu32 "ms)", number_, fk_uptime() - started);
 
-    return size;
+    return content_size;
 }
 
 int32_t HttpServerConnection::write(HttpStatus status, const char *status_message, void const *record, pb_msgdesc_t const *fields,
                                     Pool &pool) {
     auto started = fk_uptime();
 
-    size_t size = 0;
-    if (!pb_get_encoded_size(&size, fields, record)) {
+    // Encoding once into the pool tells us the length for the headers,
+    // rather than running the whole encoding twice. Larger replies aren't
+    // worth holding on to, so those are sized first and encoded as
+    // they're written.
+    PoolEncoder encoder{ pool, true };
+    encoder.limit(HttpMaximumBufferedReplySize);
+
+    auto buffered_reply = encoder.encode(fields, record);
+    if (!buffered_reply && !encoder.exceeded()) {
+        logdebug("[%" PRIu32 "] fail pb", number_);
         return fault(pool);
     }
 
-    size += pb_varint_size(size);
+    size_t size = 0;
+    if (buffered_reply) {
+        size = encoder.size();
+    } else {
+        if (!pb_get_encoded_size(&size, fields, record)) {
+            logdebug("[%" PRIu32 "] fail pb", number_);
+            return fault(pool);
+        }
+
+        size += pb_varint_size(size);
+    }
 
     auto content_size = hex_encoding_ ? size * 2 : size;
 
     logdebug("[%" PRIu32 "] replying (%zd bytes)", number_, content_size);
 
-    auto err = write_headers(status, status_message, size, pool);
+    BufferedWriter buffered{ this, buffer(), size_ };
+
+    auto err = write_headers(buffered, status, status_message, content_size, "application/octet-stream");
     if (err < 0) {
         return err;
     }
 
-    conn_->flush();
-
-    logdebug("[%" PRIu32 "] headers done (%" PRIu32 "ms)", number_, fk_uptime() - started);
-
-    if (buffer_ == nullptr) {
-        size_ = HttpConnectionBufferSize;
-        buffer_ = (uint8_t *)pool_->malloc(size_);
-    }
-
-    BufferedWriter buffered{ this, buffer_, size_ };
     HexWriter b64_writer{ &buffered };
     Writer *writer = &buffered;
 
@@ -225,10 +284,17 @@ int32_t HttpServerConnection::write(HttpStatus status, const char *status_messag
 
     logverbose("[%" PRIu32 "] ready to write", number_);
 
-    auto ostream = pb_ostream_from_writable(writer);
-    if (!pb_encode_delimited(&ostream, fields, record)) {
-        logdebug("[%" PRIu32 "] fail pb", number_);
-        return content_size;
+    if (buffered_reply) {
+        if (writer->write_buffers(encoder.chain()) < 0) {
+            logwarn("[%" PRIu32 "] fail write", number_);
+            return content_size;
+        }
+    } else {
+        auto ostream = pb_ostream_from_writable(writer);
+        if (!pb_encode_delimited(&ostream, fields, record)) {
+            logdebug("[%" PRIu32 "] fail pb", number_);
+            return content_size;
+        }
     }
 
     if (buffered.flush() < 0) {
@@ -256,11 +322,7 @@ bool HttpServerConnection::service() {
     }
 
     if (!req_.have_headers() && conn_->available()) {
-        if (buffer_ == nullptr) {
-            size_ = HttpConnectionBufferSize;
-            buffer_ = (uint8_t *)pool_->malloc(size_);
-            position_ = 0;
-        }
+        buffer();
 
         activity_ = fk_uptime();
 
@@ -277,15 +339,9 @@ bool HttpServerConnection::service() {
                 return false;
             }
 
-            auto ptr = (char *)(buffer_ + position_);
-            ptr[nread] = 0;
-            auto parsed = req_.parse(ptr, nread);
-            if (parsed == 0) {
-                loginfo("[%" PRIu32 "] error parsing", number_);
+            if (!parse(nread)) {
                 return false;
             }
-
-            position_ += nread;
         }
     }
 
@@ -293,6 +349,32 @@ bool HttpServerConnection::service() {
         auto size = pool_->size();
         auto used = pool_->used();
         auto elapsed = fk_uptime() - started_;
+        if (keep_alive_ && !busy_ && req_.state() == HttpRequestState::Done) {
+            loginfo("[%" PRIu32 "] keeping alive (%" PRIu32 " tx) (%" PRIu32 " rx) (%zd/%zd pooled) (%" PRIu32 "ms)", number_, bytes_tx_,
+                    bytes_rx_, used, size, elapsed);
+            req_.begin();
+            requests_++;
+            routed_ = false;
+            hex_encoding_ = false;
+            keep_alive_ = false;
+            started_ = fk_uptime();
+
+            // The client may have sent its next request along with this
+            // one, so start on what's left of it.
+            position_ = 0;
+            if (pipelined_ != nullptr) {
+                auto size = pipelined_size_;
+                memcpy(buffer_, pipelined_, size);
+                pipelined_ = nullptr;
+                pipelined_size_ = 0;
+                if (!parse(size)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
         loginfo("[%" PRIu32 "] closing (%" PRIu32 " tx) (%" PRIu32 " rx) (%zd/%zd pooled) (%" PRIu32 "ms)", number_, bytes_tx_, bytes_rx_,
                 used, size, elapsed);
         return false;
@@ -313,7 +395,7 @@ bool HttpServerConnection::service() {
                 loginfo("[%" PRIu32 "] routing '%s' qs = '%s' path = '%s' (%" PRIu32 " bytes) ('%s')", number_, req_.url(),
                         req_.query_string(), path, req_.length(), req_.user_agent());
 
-                auto handler = router_->route(path);
+                auto handler = router_->route(path, &parameters_);
                 if (handler == nullptr) {
                     plain(HttpStatus::NotFound, "not found", "404: not found, no handler", *pool_);
                 } else {
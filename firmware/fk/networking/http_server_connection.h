@@ -18,11 +18,16 @@ class HttpServerConnection : public Connection {
 private:
     HttpRouter *router_;
     HttpRequest req_;
+    HttpRouteParameters parameters_;
     uint8_t *buffer_;
     size_t size_;
     size_t position_;
+    uint8_t *pipelined_{ nullptr };
+    size_t pipelined_size_{ 0 };
+    uint32_t requests_{ 0 };
     bool routed_{ false };
     bool hex_encoding_{ false };
+    bool keep_alive_{ false };
 
 public:
     HttpServerConnection(Pool *pool, NetworkConnection *conn, uint32_t number, HttpRouter *router);
@@ -49,6 +54,12 @@ public:
 
     int32_t fault(Pool &pool);
 
+    /**
+     * Stops the connection, unless the reply told the client we'd keep
+     * it open in which case we wait for another request instead.
+     */
+    int32_t close();
+
     using Connection::busy;
     using Connection::write;
 
@@ -65,6 +76,13 @@ public:
         return req_.url_parser().find_query_param(key, pool);
     }
 
+    /**
+     * Path parameters from the route that matched this request.
+     */
+    HttpRouteParameters const &parameters() const {
+        return parameters_;
+    }
+
     bool is_get_method() const {
         return req_.is_get_method();
     }
@@ -84,7 +102,11 @@ public:
     int32_t available() const;
 
 private:
-    int32_t write_headers(HttpStatus status_code, const char *status_message, size_t size, Pool &pool);
+    uint8_t *buffer();
+    bool parse(size_t nread);
+    bool can_keep_alive() const;
+    int32_t write_headers(BufferedWriter &buffered, HttpStatus status_code, const char *status_message, size_t size,
+                          const char *content_type);
 };
 
 } // namespace fk
@@ -5,24 +5,29 @@
 #include "progress_tracker.h"
 #include "gs_progress_callbacks.h"
 #include "storage/storage.h"
+#include "log_binary.h"
 
 namespace fk {
 
 FK_DECLARE_LOGGER("sendlogs");
 
+static void count_rendered(char c, void *arg) {
+}
+
+static void write_rendered(char c, void *arg) {
+    auto writer = reinterpret_cast<BufferedWriter *>(arg);
+    writer->write(c);
+}
+
 DownloadLogsWorker::DownloadLogsWorker(HttpServerConnection *connection) : connection_(connection) {
 }
 
 DownloadLogsWorker::HeaderInfo DownloadLogsWorker::get_headers(Pool &pool) {
     fk_serial_number_t sn;
-    auto size = 0u;
-
+    // Binary records are rendered twice, once here to find the size.
     auto &lb = fk_log_buffer();
-    for (auto c : lb) {
-        if (c != 0) {
-            size++;
-        }
-    }
+    auto iter = lb.begin();
+    auto size = (uint32_t)log_binary_render_buffer(lb, iter, count_rendered, nullptr);
 
     auto gs = get_global_state_ro();
     return HeaderInfo{
@@ -61,18 +66,9 @@ void DownloadLogsWorker::serve(Pool &pool) {
     GlobalStateProgressCallbacks gs_progress;
     ProgressTracker tracker{ &gs_progress, Operation::Download, "sendlogs", "", info.size };
     BufferedWriter writer{ connection_, (uint8_t *)pool.malloc(NetworkBufferSize), NetworkBufferSize };
-    auto bytes_copied = 0u;
-
     auto &lb = fk_log_buffer();
-    for (auto c : lb) {
-        if (bytes_copied >= info.size) {
-            break;
-        }
-        if (c != 0) {
-            writer.write(c);
-            bytes_copied++;
-        }
-    }
+    auto iter = lb.begin();
+    auto bytes_copied = log_binary_render_buffer(lb, iter, write_rendered, &writer);
 
     writer.flush();
 
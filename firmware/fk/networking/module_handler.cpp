@@ -6,17 +6,25 @@ namespace fk {
 
 FK_DECLARE_LOGGER("mod-api");
 
-ModuleHandler::ModuleHandler(ModulePosition bay) : bay_(bay) {
+ModuleHandler::ModuleHandler() {
 }
 
 bool ModuleHandler::handle(HttpServerConnection *connection, Pool &pool) {
+    auto position = connection->parameters().integer("position");
+    if (position < 0 || position >= (int32_t)MaximumNumberOfPhysicalModules) {
+        connection->error(HttpStatus::NotFound, "invalid module", pool);
+        return true;
+    }
+
+    auto bay = ModulePosition::from(position);
+
     auto mm = get_modmux();
     auto lock = mm->lock();
     auto module_bus = get_board()->i2c_module();
 
     auto gs = get_global_state_ro();
     auto attached = gs.get()->dynamic.attached();
-    auto attached_module = attached->get_by_position(bay_);
+    auto attached_module = attached->get_by_position(bay);
     if (attached_module == nullptr) {
         connection->error(HttpStatus::NotFound, "invalid module", pool);
         return true;
@@ -24,7 +32,7 @@ bool ModuleHandler::handle(HttpServerConnection *connection, Pool &pool) {
 
     auto configuration = attached_module->configuration();
 
-    EnableModulePower module_power{ bay_, ModulePower::Always, configuration.timing.wake_delay };
+    EnableModulePower module_power{ bay, ModulePower::Always, configuration.timing.wake_delay };
     if (!module_power.enable()) {
         connection->error(HttpStatus::ServerError, "error powering module", pool);
         return true;
@@ -32,7 +40,7 @@ bool ModuleHandler::handle(HttpServerConnection *connection, Pool &pool) {
 
     ScanningContext ctx{ mm, gs.get()->location(pool), module_bus, pool };
 
-    auto mc = ctx.open_module(bay_, pool);
+    auto mc = ctx.open_module(bay, pool);
 
     if (!mc.open()) {
         connection->error(HttpStatus::ServerError, "error choosing module", pool);
@@ -4,12 +4,13 @@
 
 namespace fk {
 
+/**
+ * Handles module API requests, the module's position comes from the route's
+ * position parameter.
+ */
 class ModuleHandler : public HttpHandler {
-private:
-    ModulePosition bay_;
-
 public:
-    ModuleHandler(ModulePosition bay);
+    ModuleHandler();
 
 public:
     bool handle(HttpServerConnection *connection, Pool &pool) override;
@@ -15,6 +15,7 @@ FK_DECLARE_LOGGER("httpd");
 constexpr const char *HTTP_CONTENT_LENGTH = "Content-Length";
 constexpr const char *HTTP_CONTENT_TYPE = "Content-Type";
 constexpr const char *HTTP_USER_AGENT = "User-Agent";
+constexpr const char *HTTP_CONNECTION = "Connection";
 
 static inline HttpRequest *get_object(http_parser *parser) {
     return reinterpret_cast<HttpRequest *>(parser->data);
@@ -61,6 +62,18 @@ void HttpRequest::begin() {
     settings_.on_body = http_body_callback;
     settings_.on_message_complete = http_message_complete_callback;
 
+    state_ = HttpRequestState::New;
+    url_[0] = 0;
+    url_parser_ = {};
+    header_name_ = nullptr;
+    header_name_len_ = 0;
+    length_ = 0;
+    content_type_ = WellKnownContentType::Unknown;
+    buffered_body_ = nullptr;
+    buffered_body_length_ = 0;
+    user_agent_ = nullptr;
+    keep_alive_ = false;
+
     http_parser_init(&parser_, HTTP_BOTH);
     http_parser_set_max_header_size(HttpMaximumHeaderSize);
 
@@ -70,6 +83,13 @@ void HttpRequest::begin() {
 int32_t HttpRequest::parse(const char *data, size_t length) {
     auto nparsed = http_parser_execute(&parser_, &settings_, data, length);
 
+    // Paused at the end of the message, anything after that is the next
+    // request on the connection and is left for the caller.
+    if (parser_.http_errno == HPE_PAUSED) {
+        http_parser_pause(&parser_, 0);
+        return nparsed;
+    }
+
     if (parser_.http_errno > 0) {
         auto err = (enum http_errno)parser_.http_errno;
         logerror("parser: %s: %s", http_errno_name(err), http_errno_description(err));
@@ -153,6 +173,11 @@ int32_t HttpRequest::on_header_value(const char *at, size_t length) {
         logtrace("user-agent: %s", value);
     }
 
+    if (strncasecmp(header_name_, HTTP_CONNECTION, header_name_len_) == 0) {
+        keep_alive_ = length >= 10 && strncasecmp(at, "keep-alive", 10) == 0;
+        logtrace("connection: keep-alive=%d", keep_alive_);
+    }
+
     return 0;
 }
 
@@ -180,6 +205,8 @@ int32_t HttpRequest::on_message_complete() {
 
     state_ = HttpRequestState::Consumed;
 
+    http_parser_pause(&parser_, 1);
+
     return 0;
 }
 
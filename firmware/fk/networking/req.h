@@ -67,6 +67,12 @@ private:
     size_t buffered_body_length_{ 0 };
     const char *user_agent_{ nullptr };
 
+    /**
+     * True when the client asked to keep the connection open with an
+     * explicit Connection: keep-alive header.
+     */
+    bool keep_alive_{ false };
+
 public:
     HttpRequest(Pool *pool);
 
@@ -78,7 +84,9 @@ public:
     void begin();
 
     /**
-     * Parse data received from the client.
+     * Parse data received from the client. Parsing stops at the end of
+     * the request, returning fewer bytes than given when a pipelined
+     * request follows it.
      */
     int32_t parse(const char *data, size_t length);
 
@@ -175,6 +183,13 @@ public:
         return user_agent_;
     }
 
+    /**
+     * Returns true if the client sent Connection: keep-alive.
+     */
+    bool keep_alive() const {
+        return keep_alive_;
+    }
+
     /**
      * HTTP status parsed from the response.
      */
@@ -4,40 +4,218 @@ namespace fk {
 
 FK_DECLARE_LOGGER("httpd");
 
-bool HttpRoute::matches(const char *url) const {
-    auto route_len = strlen(url_);
-    if (route_len != strlen(url)) {
-        return false;
+static size_t segment_length(const char *p) {
+    auto s = p;
+    while (*s != 0 && *s != '/') {
+        s++;
+    }
+    return s - p;
+}
+
+static bool segment_equals(const char *segment, size_t length, const char *p) {
+    // Running into the end of p is a mismatch, segments never contain a 0.
+    for (auto i = 0u; i < length; ++i) {
+        if (p[i] != segment[i]) {
+            return false;
+        }
+    }
+    return p[length] == 0 || p[length] == '/';
+}
+
+static int32_t segment_integer(const char *p, size_t length) {
+    auto value = (int32_t)0;
+    for (auto i = 0u; i < length; ++i) {
+        if (p[i] < '0' || p[i] > '9' || value > (INT32_MAX - 9) / 10) {
+            return -1;
+        }
+        value = value * 10 + (p[i] - '0');
+    }
+    return value;
+}
+
+HttpRouteParameters::parameter_t const *HttpRouteParameters::find(const char *name) const {
+    auto length = strlen(name);
+    for (auto i = 0u; i < size_; ++i) {
+        auto &p = parameters_[i];
+        if (p.name_length == length && memcmp(p.name, name, length) == 0) {
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+int32_t HttpRouteParameters::integer(const char *name) const {
+    auto p = find(name);
+    if (p == nullptr) {
+        return -1;
+    }
+    return p->integer;
+}
+
+const char *HttpRouteParameters::string(const char *name, Pool &pool) const {
+    auto p = find(name);
+    if (p == nullptr) {
+        return nullptr;
     }
-    return strncmp(url_, url, route_len) == 0;
+    return pool.strndup(p->value, p->length);
 }
 
-HttpHandler *HttpRouter::route(const char *url) {
+HttpHandler *HttpRouter::route(const char *url, HttpRouteParameters *parameters) {
     if (url == nullptr) {
         return nullptr;
     }
-    for (auto i = 0u; i < maximum_number_of_routes(); ++i) {
-        if (routes_[i] == nullptr) {
-            return nullptr;
+
+    HttpRouteParameters scratch;
+    auto &captured = parameters != nullptr ? *parameters : scratch;
+    captured.clear();
+
+    if (strncmp(url, prefix_, prefix_length_) != 0) {
+        return nullptr;
+    }
+
+    auto node = match(prefix_node_, url + prefix_length_, captured);
+    if (node == nullptr) {
+        return nullptr;
+    }
+
+    return node->route->handler();
+}
+
+HttpRouter::node_t const *HttpRouter::match(node_t const *node, const char *path, HttpRouteParameters &parameters) const {
+    if (*path == 0) {
+        return node->route != nullptr ? node : nullptr;
+    }
+
+    if (*path != '/') {
+        return nullptr;
+    }
+
+    auto segment = path + 1;
+    if (*segment == 0 || *segment == '/') {
+        return nullptr;
+    }
+
+    // Literal segments take precedence over parameters, so that
+    // "/things/all" can live alongside "/things/:id".
+    node_t const *parameter = nullptr;
+    for (auto child = node->child; child != nullptr; child = child->sibling) {
+        if (child->parameter) {
+            parameter = child;
+            continue;
         }
-        if (routes_[i]->matches(url)) {
-            return routes_[i]->handler();
+        if (segment_equals(child->segment, child->length, segment)) {
+            auto found = match(child, segment + child->length, parameters);
+            if (found != nullptr) {
+                return found;
+            }
         }
     }
-    return nullptr;
+
+    if (parameter == nullptr || parameters.size_ == HttpMaximumRouteParameters) {
+        return nullptr;
+    }
+
+    auto length = segment_length(segment);
+    auto &p = parameters.parameters_[parameters.size_++];
+    p.name = parameter->segment + 1;
+    p.name_length = parameter->length - 1;
+    p.value = segment;
+    p.length = length;
+    p.integer = segment_integer(segment, length);
+
+    auto found = match(parameter, segment + length, parameters);
+    if (found == nullptr) {
+        parameters.size_--;
+    }
+
+    return found;
+}
+
+HttpRouter::node_t *HttpRouter::add_node(node_t *parent, const char *segment, size_t length) {
+    auto parameter = segment[0] == ':';
+
+    // Parameters are interchangeable, whatever they happen to be named.
+    for (auto child = parent->child; child != nullptr; child = child->sibling) {
+        if (parameter && child->parameter) {
+            return child;
+        }
+        if (!parameter && !child->parameter && child->length == length && memcmp(child->segment, segment, length) == 0) {
+            return child;
+        }
+    }
+
+    if (nnodes_ == HttpMaximumRouteNodes) {
+        return nullptr;
+    }
+
+    auto node = &nodes_[nnodes_++];
+    node->segment = segment;
+    node->length = length;
+    node->parameter = parameter;
+    node->route = nullptr;
+    node->child = nullptr;
+    node->sibling = nullptr;
+
+    // Keep children in the order they were added.
+    auto tail = &parent->child;
+    while (*tail != nullptr) {
+        tail = &(*tail)->sibling;
+    }
+    *tail = node;
+
+    return node;
 }
 
 bool HttpRouter::add_route(HttpRoute *route) {
-    for (auto i = 0u; i < maximum_number_of_routes(); ++i) {
-        if (routes_[i] == nullptr) {
-            routes_[i] = route;
-            return true;
+    auto url = route->url();
+    FK_ASSERT(url != nullptr && url[0] == '/');
+
+    if (nroutes_ == maximum_number_of_routes()) {
+        FK_ASSERT(false);
+        return false;
+    }
+
+    auto node = &nodes_[0];
+    auto p = url;
+    while (*p == '/' && *(p + 1) != 0) {
+        auto segment = p + 1;
+        auto length = segment_length(segment);
+        FK_ASSERT(length > 0);
+
+        node = add_node(node, segment, length);
+        if (node == nullptr) {
+            logerror("no room for route '%s'", url);
+            FK_ASSERT(false);
+            return false;
         }
+
+        p = segment + length;
+    }
+
+    if (node->route == nullptr) {
+        node->route = route;
+        nroutes_++;
     }
 
-    FK_ASSERT(false);
+    find_prefix();
+
+    return true;
+}
+
+void HttpRouter::find_prefix() {
+    // Follow the trie for as long as there's only one way to go.
+    auto node = &nodes_[0];
+    auto length = (size_t)0;
+    while (node->route == nullptr && node->child != nullptr && node->child->sibling == nullptr && !node->child->parameter) {
+        node = node->child;
+        length += 1 + node->length;
+    }
 
-    return false;
+    // A node's segment points into the URL that created it, and the part
+    // of that URL before the segment is the path to the node.
+    prefix_ = node == &nodes_[0] ? "" : node->segment + node->length - length;
+    prefix_length_ = length;
+    prefix_node_ = node;
 }
 
 } // namespace fk
@@ -23,9 +23,9 @@ public:
 };
 
 /**
- * Defines the relationship between a URL and a specific HttpHandler. May
- * include fancier forms of matching, like eventually headers and the like.
- * Right now we do simple URL matching.
+ * Defines the relationship between a URL and a specific HttpHandler. Path
+ * segments beginning with a ':' are parameters and match any non-empty
+ * segment, for example "/fk/v1/modules/:position".
  */
 class HttpRoute {
 private:
@@ -38,9 +38,11 @@ public:
 
 public:
     /**
-     * Test to see if the URL matches this route.
+     * The URL pattern this route is registered under.
      */
-    virtual bool matches(const char *url) const;
+    const char *url() const {
+        return url_;
+    }
 
     /**
      * The HttpHandler that should handle the requests that match this route.
@@ -50,24 +52,93 @@ public:
     }
 };
 
+/**
+ * Path parameters captured while matching a URL. Values point into the
+ * matched URL and so are not terminated, numeric values are parsed as they
+ * are matched.
+ */
+class HttpRouteParameters {
+public:
+    struct parameter_t {
+        const char *name;
+        size_t name_length;
+        const char *value;
+        size_t length;
+        int32_t integer;
+    };
+
+private:
+    parameter_t parameters_[HttpMaximumRouteParameters];
+    size_t size_{ 0 };
+
+    friend class HttpRouter;
+
+public:
+    size_t size() const {
+        return size_;
+    }
+
+    void clear() {
+        size_ = 0;
+    }
+
+    /**
+     * Returns the named parameter, or nullptr if there's no such parameter.
+     */
+    parameter_t const *find(const char *name) const;
+
+    /**
+     * Returns the named parameter as a non-negative integer, or -1 if
+     * there's no such parameter or its value isn't a number.
+     */
+    int32_t integer(const char *name) const;
+
+    /**
+     * Returns a terminated copy of the named parameter, or nullptr if there's
+     * no such parameter.
+     */
+    const char *string(const char *name, Pool &pool) const;
+};
+
 /**
  * Manages all available HTTP routes and oversees matching incoming URLs to a
- * specific HttpHandler.
+ * specific HttpHandler. Routes are compiled into a trie of path segments as
+ * they're registered, so matching a URL only ever walks that URL once.
  */
 class HttpRouter {
 private:
-    HttpRoute *routes_[HttpMaximumRoutes] = { nullptr };
+    struct node_t {
+        const char *segment;
+        size_t length;
+        bool parameter;
+        HttpRoute *route;
+        node_t *child;
+        node_t *sibling;
+    };
+
+    node_t nodes_[HttpMaximumRouteNodes] = {};
+    size_t nnodes_{ 1 };
+    size_t nroutes_{ 0 };
+
+    /**
+     * Literal segments every route starts with, like "/fk/v1", compared in
+     * one go before matching the rest of a URL from prefix_node_.
+     */
+    const char *prefix_{ "" };
+    size_t prefix_length_{ 0 };
+    node_t const *prefix_node_{ &nodes_[0] };
 
 public:
     /**
-     * Finds the correct handler for a URL. If no appropriate handler can be
-     * found, returns nullptr.
+     * Finds the correct handler for a URL, filling in any path parameters.
+     * If no appropriate handler can be found, returns nullptr.
      */
-    HttpHandler *route(const char *url);
+    HttpHandler *route(const char *url, HttpRouteParameters *parameters = nullptr);
 
     /**
      * Registers a new route. Returns true if the route was successfully added
-     * and false if an error occured, like there is no more more.
+     * and false if an error occured, like there is no more more. The first
+     * route registered for a URL is the one that's used.
      */
     bool add_route(HttpRoute *route);
 
@@ -77,6 +148,11 @@ public:
     constexpr size_t maximum_number_of_routes() {
         return HttpMaximumRoutes;
     }
+
+private:
+    node_t *add_node(node_t *parent, const char *segment, size_t length);
+    node_t const *match(node_t const *node, const char *path, HttpRouteParameters &parameters) const;
+    void find_prefix();
 };
 
 } // namespace fk
@@ -0,0 +1,126 @@
+#include "hal/network.h"
+
+#include "networking/status_reply_cache.h"
+#include "networking/http_reply.h"
+
+#include "platform.h"
+#include "config.h"
+#include "protobuf.h"
+#include "records.h"
+#include "io.h"
+
+namespace fk {
+
+FK_DECLARE_LOGGER("status");
+
+/**
+ * Writes size bytes starting at offset from a chain of buffers.
+ */
+static void write_range(pb_ostream_t *stream, BufferPtr const *buffers, size_t offset, size_t size) {
+    for (auto iter = buffers; iter != nullptr && size > 0; iter = iter->link()) {
+        if (offset >= iter->position()) {
+            offset -= iter->position();
+            continue;
+        }
+
+        auto writing = std::min(iter->position() - offset, size);
+        pb_write(stream, iter->buffer() + offset, writing);
+        offset = 0;
+        size -= writing;
+    }
+}
+
+StatusReplyCache::StatusReplyCache(uint8_t *buffer, size_t capacity) : buffer_(buffer), capacity_(capacity) {
+}
+
+void StatusReplyCache::invalidate() {
+    valid_ = false;
+}
+
+StatusReplyCache::Encoded StatusReplyCache::encode(GlobalState const *gs, uint32_t generation, uint32_t clock, uint32_t uptime,
+                                                   fkb_header_t const *fkb, Pool &pool) {
+    auto started = fk_uptime();
+    auto hit = valid_ && generation_ == generation;
+    auto encoded = (BufferPtr *)nullptr;
+
+    if (hit) {
+        hits_++;
+
+        encoded = pool.wrap(buffer_, reply_size_ + status_size_, reply_size_ + status_size_);
+    } else {
+        misses_++;
+
+        // Zero clock and uptime are left out of the encoding entirely.
+        HttpReply http_reply{ pool, gs };
+        FK_ASSERT(http_reply.include_status(0, 0, false, fkb));
+
+        auto reply = *http_reply.reply();
+        reply.has_status = false;
+
+        // Encoded straight into the cache in one pass, replies too large
+        // for it carry on into the pool.
+        valid_ = false;
+        PoolEncoder encoder{ pool, buffer_, capacity_ };
+        if (!encoder.encode(fk_app_HttpReply_fields, &reply)) {
+            logerror("encoding status");
+            return { nullptr, false, fk_uptime() - started };
+        }
+
+        auto reply_size = encoder.size();
+
+        if (!encoder.encode(fk_app_Status_fields, &http_reply.reply()->status)) {
+            logerror("encoding status");
+            return { nullptr, false, fk_uptime() - started };
+        }
+
+        reply_size_ = reply_size;
+        status_size_ = encoder.size() - reply_size;
+
+        if (encoder.size() <= capacity_) {
+            generation_ = generation;
+            valid_ = true;
+        } else {
+            logwarn("status reply too large to cache (%zu)", encoder.size());
+        }
+
+        encoded = encoder.chain();
+    }
+
+    uint8_t patch[(1 + 10) * 2];
+    auto patch_stream = pb_ostream_from_buffer(patch, sizeof(patch));
+    if (uptime > 0) {
+        pb_encode_tag(&patch_stream, PB_WT_VARINT, fk_app_Status_uptime_tag);
+        pb_encode_varint(&patch_stream, uptime);
+    }
+    if (clock > 0) {
+        pb_encode_tag(&patch_stream, PB_WT_VARINT, fk_app_Status_time_tag);
+        pb_encode_varint(&patch_stream, clock);
+    }
+
+    auto status_size = status_size_ + patch_stream.bytes_written;
+    auto message_size = reply_size_ + pb_varint_size((fk_app_HttpReply_status_tag << 3) | PB_WT_STRING) + pb_varint_size(status_size) +
+                        status_size;
+    auto size = pb_varint_size(message_size) + message_size;
+    auto buffer = (uint8_t *)pool.malloc(size);
+
+    auto stream = pb_ostream_from_buffer(buffer, size);
+    pb_encode_varint(&stream, message_size);
+    write_range(&stream, encoded, 0, reply_size_);
+    pb_encode_tag(&stream, PB_WT_STRING, fk_app_HttpReply_status_tag);
+    pb_encode_varint(&stream, status_size);
+    write_range(&stream, encoded, reply_size_, status_size_);
+    pb_write(&stream, patch, patch_stream.bytes_written);
+
+    FK_ASSERT(stream.bytes_written == size);
+
+    return { new (pool) BufferPtr(size, size, buffer), hit, fk_uptime() - started };
+}
+
+static uint8_t status_reply_buffer[StatusReplyCacheSize];
+static StatusReplyCache status_reply_cache{ status_reply_buffer, sizeof(status_reply_buffer) };
+
+StatusReplyCache *get_status_reply_cache() {
+    return &status_reply_cache;
+}
+
+} // namespace fk
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <loading.h>
+
+#include "common.h"
+#include "pool.h"
+
+namespace fk {
+
+class GlobalState;
+
+/**
+ * Keeps the encoded status reply around until the global state changes,
+ * so polling clients get the same bytes with only the clock and uptime
+ * patched in. Those two are left out of the cached status and appended
+ * to it when replying, protobuf doesn't care about field order.
+ */
+class StatusReplyCache {
+public:
+    struct Encoded {
+        BufferPtr *buffer;
+        bool hit;
+        uint32_t encode_time;
+    };
+
+private:
+    uint8_t *buffer_{ nullptr };
+    size_t capacity_{ 0 };
+    size_t reply_size_{ 0 };
+    size_t status_size_{ 0 };
+    uint32_t generation_{ 0 };
+    bool valid_{ false };
+    uint32_t hits_{ 0 };
+    uint32_t misses_{ 0 };
+
+public:
+    StatusReplyCache(uint8_t *buffer, size_t capacity);
+
+public:
+    /**
+     * Returns the delimited status reply for the given generation of the
+     * global state, allocated from pool. Only call this while holding a
+     * reference to gs.
+     */
+    Encoded encode(GlobalState const *gs, uint32_t generation, uint32_t clock, uint32_t uptime, fkb_header_t const *fkb, Pool &pool);
+
+    void invalidate();
+
+    uint32_t hits() const {
+        return hits_;
+    }
+
+    uint32_t misses() const {
+        return misses_;
+    }
+};
+
+/**
+ * The cache shared by the API handlers, which all run on the network task.
+ */
+StatusReplyCache *get_status_reply_cache();
+
+} // namespace fk
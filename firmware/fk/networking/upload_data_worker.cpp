@@ -4,9 +4,11 @@
 #include "progress_tracker.h"
 #include "gs_progress_callbacks.h"
 #include "storage/storage.h"
+#include "storage/storage_session.h"
 #include "hal/watchdog.h"
 
 #include "networking/http_connection.h"
+#include "networking/file_transfer.h"
 #include "networking/wifi_toggle_worker.h"
 
 #if defined(__SAMD51__)
@@ -65,7 +67,9 @@ RequestInfo get_request_info(ConnectionInfo const *connection, uint32_t first, u
 
 UploadDataWorker::FileUpload UploadDataWorker::upload_file(ConnectionInfo connection_info, Storage &storage, uint8_t file_number,
                                                            uint32_t first_record, const char *type, Pool &pool) {
-    ScopedLogLevelChange change{ LogLevels::INFO };
+    // Formatting logs as we go gets in the way of the WiFi module, so
+    // leave that to the idle task. \see DownloadWorker::serve
+    ScopedBinaryLogs binary_logs;
 
     auto started = fk_uptime();
     auto file = storage.file_reader(file_number, pool);
@@ -124,36 +128,18 @@ UploadDataWorker::FileUpload UploadDataWorker::upload_file(ConnectionInfo connec
 
     loginfo("uploading file...");
 
-    auto buffer = (uint8_t *)pool.malloc(NetworkBufferSize);
-    auto bytes_copied = 0u;
     GlobalStateProgressCallbacks gs_progress;
     auto tracker = ProgressTracker{ &gs_progress, Operation::Upload, "upload", "", upload_length };
-    while (bytes_copied != upload_length) {
-        auto to_read = std::min<int32_t>(NetworkBufferSize, upload_length - bytes_copied);
-        auto bytes_read = file->read(buffer, to_read);
-        if (bytes_read != to_read) {
-            logwarn("read error (%" PRId32 " != %" PRId32 ")", bytes_read, to_read);
-            break;
-        }
-
-        auto bytes_wrote = http->write(buffer, to_read);
-        if (bytes_wrote != (int32_t)to_read) {
-            logwarn("write error (%" PRId32 " != %" PRId32 ")", bytes_wrote, to_read);
-            break;
-        }
-
-        tracker.update(bytes_read);
-
-        bytes_copied += bytes_read;
-
-#if defined(FK_WDT_ENABLE)
-        fk_wdt_feed();
-#endif
-    }
+    auto stats = transfer_file(file, http, upload_length, tracker, pool);
+    auto bytes_copied = stats.bytes;
 
     auto elapsed = fk_uptime() - started;
     auto speed = ((bytes_copied / 1024.0f) / (elapsed / 1000.0f));
-    loginfo("done (%d) (%" PRIu32 "ms) %.2fkbps, waiting response", bytes_copied, elapsed, speed);
+    // The meta record is always copied into buffers before being sent.
+    auto copies = (float)(meta_size + stats.copied) / (meta_size + bytes_copied);
+    loginfo("done (%" PRIu32 ") (%" PRIu32 "ms) %.2fkbps read-time=%" PRIu32 " write-time=%" PRIu32 " overlapped=%d copies/byte=%.2f, "
+            "waiting response",
+            bytes_copied, elapsed, speed, stats.read_time, stats.write_time, stats.overlapped, copies);
 
     auto success = false;
 
@@ -236,13 +222,12 @@ void UploadDataWorker::run(Pool &pool) {
             start_records.data = 0;
         }
 
-        StatisticsMemory memory{ MemoryFactory::get_data_memory() };
-        Storage storage{ &memory, pool };
+        BorrowedStorage storage{ lock };
 
-        if (storage.begin()) {
+        if (storage) {
             auto after = start_records;
 
-            auto data_upload = upload_file(connection_info, storage, Storage::Data, start_records.data, "data", pool);
+            auto data_upload = upload_file(connection_info, *storage, Storage::Data, start_records.data, "data", pool);
             if (data_upload) {
                 after.data = data_upload.record;
             }
@@ -40,6 +40,7 @@ typedef struct os_task_options_t {
 
 struct fk_task_data_t {
     task_stack log_stack{ 10 };
+    uint32_t locks_held{ 0 };
 };
 
 typedef struct os_task_t {
@@ -29,6 +29,8 @@ extern "C" {
 #if defined(__SAMD51__)
 
 void fk_assert(const char *assertion, const char *file, int32_t line, const char *f, ...) {
+    fk::fk_logs_synchronous();
+
     logerrorf("assertion", "\"%s\" failed: file \"%s\", line %" PRIu32, assertion, file, line);
 
     fk::fk_core_dump_tasks();
@@ -212,6 +214,8 @@ void osi_debug_dump(os_panic_kind_t code) {
 }
 
 void osi_panic(os_panic_kind_t code) {
+    fk::fk_logs_synchronous();
+
     osi_debug_dump(code);
 
 #if defined(__SAMD21__) || defined(__SAMD51__)
@@ -225,6 +229,8 @@ void osi_panic(os_panic_kind_t code) {
 
 #if (defined(__SAMD21__) || defined(__SAMD51__)) && !defined(SAMD51_FREERTOS)
 void osi_hard_fault_report(uintptr_t *stack, uint32_t lr, cortex_hard_fault_t *hfr) {
+    fk::fk_logs_synchronous();
+
     alogf(LogLevels::ERROR, "error", "hard fault! stack= 0x%" PRIx32 " lr=0x%" PRIx32 "", (uint32_t)stack, lr);
     alogf(LogLevels::ERROR, "error", "hard fault! mfsr=  0x%" PRIx32 "", (uint32_t)hfr->mfsr.byte);
     alogf(LogLevels::ERROR, "error", "hard fault! bfsr=  0x%" PRIx32 "", (uint32_t)hfr->bfsr.byte);
@@ -257,6 +263,8 @@ void osi_hard_fault_report(uintptr_t *stack, uint32_t lr, void *hfr) {
 #if defined(__SAMD21__) || defined(__SAMD51__)
 
 void osi_assert(const char *assertion, const char *file, int line) {
+    fk::fk_logs_synchronous();
+
     alogf(LogLevels::ERROR, "error", "assertion \"%s\" failed: file \"%s\", line %d", assertion, file, line);
     osi_panic(OS_PANIC_ASSERTION);
 }
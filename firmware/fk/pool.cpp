@@ -7,8 +7,10 @@
 #include "pool.h"
 #include "platform.h"
 #include "protobuf.h"
+#include "io.h"
 #include "config.h"
 #include "memory.h"
+#include "hal/mutex.h"
 
 void *operator new(size_t size, fk::Pool &pool) {
     return pool.malloc(size);
@@ -110,6 +112,42 @@ void *Pool::malloc(size_t allocating) {
     return (void *)p;
 }
 
+bool Pool::shrink(void *ptr, size_t size, size_t keeping) {
+    FK_ASSERT(keeping <= size);
+
+    auto aligned = aligned_size(size);
+    if ((uint8_t *)ptr + aligned != ptr_) {
+        return false;
+    }
+
+    // Cleared pools hand out zeroed memory, so keep it that way.
+    auto giving = aligned - aligned_size(keeping);
+    ptr_ = ((uint8_t *)ptr_) - giving;
+    remaining_ += giving;
+    bzero(ptr_, giving);
+
+    return true;
+}
+
+bool Pool::extend(void *ptr, size_t size, size_t extending) {
+    FK_ASSERT(extending >= size);
+
+    auto aligned = aligned_size(size);
+    if ((uint8_t *)ptr + aligned != ptr_) {
+        return false;
+    }
+
+    auto taking = aligned_size(extending) - aligned;
+    if (taking > remaining_) {
+        return false;
+    }
+
+    ptr_ = ((uint8_t *)ptr_) + taking;
+    remaining_ -= taking;
+
+    return true;
+}
+
 void *Pool::copy(void const *ptr, size_t size) {
     void *newPtr = malloc(size);
     memcpy(newPtr, ptr, size);
@@ -177,28 +215,12 @@ BufferPtr *Pool::wrap(uint8_t *buffer, size_t size, size_t position) {
 }
 
 BufferPtr *Pool::encode(pb_msgdesc_t const *fields, void const *src, bool delimited) {
-    size_t required = 0;
-    if (!pb_get_encoded_size(&required, fields, src)) {
+    PoolEncoder encoder{ *this, delimited };
+    if (!encoder.encode(fields, src)) {
         return nullptr;
     }
 
-    required += delimited ? pb_varint_size(required) : 0;
-
-    auto buffer = (uint8_t *)malloc(required);
-    auto stream = pb_ostream_from_buffer(buffer, required);
-    if (delimited) {
-        if (!pb_encode_delimited(&stream, fields, src)) {
-            return nullptr;
-        }
-    } else {
-        if (!pb_encode(&stream, fields, src)) {
-            return nullptr;
-        }
-    }
-
-    FK_ASSERT(stream.bytes_written == required);
-
-    return new (*this) BufferPtr(stream.bytes_written, stream.bytes_written, buffer);
+    return encoder.contiguous();
 }
 
 void *Pool::decode(pb_msgdesc_t const *fields, uint8_t *src, size_t size, size_t message_size) {
@@ -290,7 +312,15 @@ void *StandardPool::malloc(size_t bytes) {
             ptr = page_source_->malloc(page_size_ + overhead);
         } else {
             size = StandardPageSize;
-            ptr = fk_standard_page_malloc(size, name());
+            // Running out is usually temporary, some other task will be
+            // done with their pages soon enough. Unless we're holding a
+            // lock they need to get there.
+            if (fk_task_locks_held() == 0) {
+                ptr = fk_standard_page_malloc_wait(size, name(), StandardPoolGrowWaitMs);
+            }
+            if (ptr == nullptr) {
+                ptr = fk_standard_page_malloc(size, name());
+            }
         }
 
         // Siblings don't need to free because if they're sourced from
@@ -302,6 +332,22 @@ void *StandardPool::malloc(size_t bytes) {
     return sibling_->malloc(bytes);
 }
 
+bool StandardPool::shrink(void *ptr, size_t size, size_t keeping) {
+    if (Pool::shrink(ptr, size, keeping)) {
+        return true;
+    }
+
+    return sibling_ != nullptr && sibling_->shrink(ptr, size, keeping);
+}
+
+bool StandardPool::extend(void *ptr, size_t size, size_t extending) {
+    if (Pool::extend(ptr, size, extending)) {
+        return true;
+    }
+
+    return sibling_ != nullptr && sibling_->extend(ptr, size, extending);
+}
+
 void StandardPool::clear() {
     child_ = nullptr;
 
@@ -80,6 +80,20 @@ public:
 
     virtual void *malloc(size_t size);
 
+    /**
+     * Gives back the end of an allocation, keeping the first `keeping`
+     * bytes. Only possible for the most recent allocation, returns false
+     * and leaves everything alone otherwise.
+     */
+    virtual bool shrink(void *ptr, size_t size, size_t keeping);
+
+    /**
+     * Grows an allocation to `extending` bytes in place. Only possible for
+     * the most recent allocation and if there's room after it, returns
+     * false and leaves everything alone otherwise.
+     */
+    virtual bool extend(void *ptr, size_t size, size_t extending);
+
     virtual void clear();
 
     void *calloc(size_t size) {
@@ -174,6 +188,10 @@ public:
 
     using Pool::malloc;
 
+    bool shrink(void *ptr, size_t size, size_t keeping) override;
+
+    bool extend(void *ptr, size_t size, size_t extending) override;
+
     void clear() override;
 
     bool can_malloc(size_t bytes) const {
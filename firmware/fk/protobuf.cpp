@@ -47,71 +47,122 @@ bool pb_decode_string(pb_istream_t *stream, const pb_field_t *, void **arg) {
     return true;
 }
 
+static inline uint8_t *pb_array_segment_next(pb_array_t const *array, uint8_t const *segment) {
+    uint8_t *next = nullptr;
+    memcpy(&next, segment + array->segment_items * array->item_size, sizeof(next));
+    return next;
+}
+
+/**
+ * Calls fn with each contiguous run of items in the array, which is the
+ * whole array unless it was grown by pb_append_array.
+ */
+template <typename Fn> static bool pb_array_for_each_run(pb_array_t const *array, Fn fn) {
+    auto ptr = (uint8_t *)array->buffer;
+    auto remaining = array->length;
+    if (array->segment_items == 0) {
+        return remaining == 0 || fn(ptr, remaining);
+    }
+
+    while (remaining > 0) {
+        FK_ASSERT(ptr != nullptr);
+        auto run = std::min(remaining, array->segment_items);
+        if (!fn(ptr, run)) {
+            return false;
+        }
+        remaining -= run;
+        ptr = pb_array_segment_next(array, ptr);
+    }
+
+    return true;
+}
+
+void *pb_array_item(pb_array_t *array, size_t index) {
+    FK_ASSERT(index < array->length);
+
+    auto ptr = (uint8_t *)array->buffer;
+    if (array->segment_items > 0) {
+        for (; index >= array->segment_items; index -= array->segment_items) {
+            ptr = pb_array_segment_next(array, ptr);
+        }
+    }
+
+    return ptr + index * array->item_size;
+}
+
 bool pb_encode_array(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
     auto array = (pb_array_t *)*arg;
     if (array == nullptr) {
         return true;
     }
 
-    auto ptr = (uint8_t *)array->buffer;
     if (array->fields != nullptr) {
-        for (size_t i = 0; i < array->length; ++i) {
-            if (!pb_encode_tag_for_field(stream, field)) {
-                return false;
-            }
+        return pb_array_for_each_run(array, [=](uint8_t *ptr, size_t run) {
+            for (size_t i = 0; i < run; ++i) {
+                if (!pb_encode_tag_for_field(stream, field)) {
+                    return false;
+                }
 
-            if (!pb_encode_submessage(stream, array->fields, ptr)) {
-                return false;
-            }
+                if (!pb_encode_submessage(stream, array->fields, ptr)) {
+                    return false;
+                }
 
-            ptr += array->item_size;
-        }
-    } else {
-        auto length = array->item_size * array->length;
+                ptr += array->item_size;
+            }
+            return true;
+        });
+    }
 
-        // Confusing that we're using PB_WT_STRING here, I know. This is wire
-        // type 2. Whic his "length delimited" and used fro string, bytes,
-        // embedded messages and packed repeated fields (us here)
-        if (!pb_encode_tag(stream, PB_WT_STRING, field->tag)) {
-            return false;
-        }
+    auto length = array->item_size * array->length;
 
-        if (!pb_encode_varint(stream, length)) {
-            return false;
-        }
+    // Confusing that we're using PB_WT_STRING here, I know. This is wire
+    // type 2. Whic his "length delimited" and used fro string, bytes,
+    // embedded messages and packed repeated fields (us here)
+    if (!pb_encode_tag(stream, PB_WT_STRING, field->tag)) {
+        return false;
+    }
 
-        if (!pb_write(stream, ptr, length)) {
-            return false;
-        }
+    if (!pb_encode_varint(stream, length)) {
+        return false;
     }
 
-    return true;
+    return pb_array_for_each_run(array, [=](uint8_t *ptr, size_t run) { return pb_write(stream, ptr, array->item_size * run); });
 }
 
 size_t pb_append_array(pb_array_t *array, void const *item) {
     FK_ASSERT(array != nullptr);
 
-    auto previous = (void const *)array->buffer;
+    // Arrays that were given a contiguous buffer can be appended to until
+    // that buffer fills, after that only segmented arrays may grow.
+    if (array->length == array->allocated) {
+        FK_ASSERT(array->buffer == nullptr || array->segment_items > 0);
+
+        array->segment_items = ProtobufArraySegmentItems;
 
-    // TODO Eventually this should just use linked lists.
-    // If we haven't allocated a buffer yet or if we've filled that buffer.
-    if (previous == nullptr || array->length == array->allocated) {
-        if (array->allocated > 0) {
-            // Double the allocated buffer and then copy the old array in.
-            array->allocated *= 2;
+        // Each segment is followed by the pointer to the next one, so
+        // filled segments never move.
+        auto items_size = array->item_size * array->segment_items;
+        auto segment = (uint8_t *)array->pool->malloc(items_size + sizeof(void *));
+        memzero(segment + items_size, sizeof(void *));
+
+        if (array->buffer == nullptr) {
+            array->buffer = segment;
         } else {
-            array->allocated = 8;
-        }
-        array->buffer = array->pool->malloc(array->item_size * array->allocated);
-        if (previous != nullptr) {
-            memcpy(array->buffer, previous, array->item_size * array->length);
+            memcpy((uint8_t *)array->tail + items_size, &segment, sizeof(segment));
         }
+
+        array->tail = segment;
+        array->allocated += array->segment_items;
     }
 
     FK_ASSERT(array->length < array->allocated);
 
-    // Append this entry. Notice previous could be wrong, here.
-    void *ptr = ((uint8_t *)array->buffer) + (array->length * array->item_size);
+    void *ptr = nullptr;
+    if (array->segment_items > 0) {
+        ptr = (uint8_t *)array->tail + (array->length % array->segment_items) * array->item_size;
+    } else {
+        ptr = ((uint8_t *)array->buffer) + (array->length * array->item_size);
+    }
     memcpy(ptr, item, array->item_size);
     array->length++;
 
@@ -124,20 +175,19 @@ bool pb_encode_uint32_array(pb_ostream_t *stream, const pb_field_t *field, void
         return true;
     }
 
-    auto ptr = (uint32_t *)array->buffer;
-    for (size_t i = 0; i < array->length; ++i) {
-        if (!pb_encode_tag_for_field(stream, field)) {
-            return false;
-        }
+    return pb_array_for_each_run(array, [=](uint8_t *ptr, size_t run) {
+        auto values = (uint32_t *)ptr;
+        for (size_t i = 0; i < run; ++i) {
+            if (!pb_encode_tag_for_field(stream, field)) {
+                return false;
+            }
 
-        if (!pb_encode_varint(stream, *ptr)) {
-            return false;
+            if (!pb_encode_varint(stream, values[i])) {
+                return false;
+            }
         }
-
-        ptr++;
-    }
-
-    return true;
+        return true;
+    });
 }
 
 bool pb_decode_array(pb_istream_t *stream, const pb_field_t *field, void **arg) {
@@ -12,10 +12,18 @@ struct pb_array_t;
 
 typedef bool (*pb_decode_array_item)(pb_istream_t *stream, pb_array_t *array);
 
+void *pb_array_item(pb_array_t *array, size_t index);
+
 bool pb_encode_string(pb_ostream_t *stream, const pb_field_t *field, void *const *arg);
 
 bool pb_decode_string(pb_istream_t *stream, const pb_field_t *field, void **arg);
 
+/**
+ * Arrays built by the encoding side point buffer at a contiguous block of
+ * items. Arrays grown with pb_append_array are instead kept as a chain of
+ * fixed size segments, starting at buffer, each followed by a pointer to
+ * the next one. Use item() to get at items rather than indexing buffer.
+ */
 typedef struct pb_array_t {
     size_t length;
     size_t allocated;
@@ -24,9 +32,11 @@ typedef struct pb_array_t {
     const pb_msgdesc_t *fields;
     pb_decode_array_item decode_item_fn;
     Pool *pool;
+    size_t segment_items;
+    void *tail;
 
     template <typename T> T *item(size_t index) {
-        return &reinterpret_cast<T *>(buffer)[index];
+        return reinterpret_cast<T *>(pb_array_item(this, index));
     }
 } pb_array_t;
 
@@ -68,6 +78,7 @@ inline pb_array_t *pb_get_array(pb_callback_s &callbacks, Pool const *pool) {
 }
 
 template <typename T> inline T *pb_get_typed_array(pb_array_t *array) {
+    FK_ASSERT(array->segment_items == 0);
     return reinterpret_cast<T *>(array->buffer);
 }
 
@@ -89,6 +100,8 @@ template <typename T> pb_array_t *fk_array_new_protobuf(pb_msgdesc_t const *fiel
     array->buffer = nullptr;
     array->fields = fields;
     array->pool = pool;
+    array->segment_items = 0;
+    array->tail = nullptr;
     return array;
 }
 
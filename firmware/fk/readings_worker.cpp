@@ -8,6 +8,7 @@
 #include "modules/scan_modules_worker.h"
 #include "update_readings_listener.h"
 #include "lora_worker.h"
+#include "storage/storage_session.h"
 
 extern const struct fkb_header_t fkb_header;
 
@@ -151,11 +152,13 @@ bool ReadingsWorker::save(Pool &pool) {
     ScopedLogLevelChange temporary_info_only{ LogLevels::INFO };
 
     // jlewallen: storage-write
-    Storage storage{ MemoryFactory::get_data_memory(), pool, false };
-    if (!storage.begin()) {
+    BorrowedStorage borrowed{ lock };
+    if (!borrowed) {
         return false;
     }
 
+    auto &storage = *borrowed;
+
     auto gs = get_global_state_ro();
 
     MetaRecord meta_record{ pool };
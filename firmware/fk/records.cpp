@@ -347,7 +347,7 @@ fk_app_HttpReply *fk_http_reply_encoding_initialize(fk_app_HttpReply *reply, Poo
         prepare_encode_array(&reply->errors, pool);
         auto array = reinterpret_cast<pb_array_t *>(reply->errors.arg);
         for (size_t i = 0; i < array->length; ++i) {
-            auto error = &((fk_app_Error *)array->buffer)[i];
+            auto error = array->item<fk_app_Error>(i);
             prepare_encode_string(&error->message, pool);
         }
     }
@@ -382,7 +382,7 @@ fk_app_HttpReply *fk_http_reply_encoding_initialize(fk_app_HttpReply *reply, Poo
         prepare_encode_array(&reply->status.memory.firmware, pool);
         auto array = reinterpret_cast<pb_array_t *>(reply->status.memory.firmware.arg);
         for (size_t i = 0; i < array->length; ++i) {
-            auto fw = &((fk_app_Firmware *)array->buffer)[i];
+            auto fw = array->item<fk_app_Firmware>(i);
 
             prepare_encode_string(&fw->version, pool);
             prepare_encode_string(&fw->build, pool);
@@ -409,7 +409,7 @@ fk_app_HttpReply *fk_http_reply_encoding_initialize(fk_app_HttpReply *reply, Poo
         prepare_encode_array(&reply->nearbyNetworks.networks, pool);
         auto array = reinterpret_cast<pb_array_t *>(reply->nearbyNetworks.networks.arg);
         for (size_t i = 0; i < array->length; ++i) {
-            auto nn = &((fk_app_NearbyNetwork *)array->buffer)[i];
+            auto nn = array->item<fk_app_NearbyNetwork>(i);
             prepare_encode_string(&nn->ssid, pool);
         }
     }
@@ -418,7 +418,7 @@ fk_app_HttpReply *fk_http_reply_encoding_initialize(fk_app_HttpReply *reply, Poo
         prepare_encode_array(&reply->modules, pool);
         auto array = reinterpret_cast<pb_array_t *>(reply->modules.arg);
         for (size_t i = 0; i < array->length; ++i) {
-            auto module = &((fk_app_ModuleCapabilities *)array->buffer)[i];
+            auto module = array->item<fk_app_ModuleCapabilities>(i);
             prepare_encode_string(&module->name, pool);
             prepare_encode_string(&module->path, pool);
             prepare_encode_data(&module->id, pool);
@@ -427,7 +427,7 @@ fk_app_HttpReply *fk_http_reply_encoding_initialize(fk_app_HttpReply *reply, Poo
                 prepare_encode_array(&module->sensors, pool);
                 auto array = reinterpret_cast<pb_array_t *>(module->sensors.arg);
                 for (size_t i = 0; i < array->length; ++i) {
-                    auto sensor = &((fk_app_SensorCapabilities *)array->buffer)[i];
+                    auto sensor = array->item<fk_app_SensorCapabilities>(i);
                     prepare_encode_string(&sensor->name, pool);
                     prepare_encode_string(&sensor->path, pool);
                     prepare_encode_string(&sensor->unitOfMeasure, pool);
@@ -441,7 +441,7 @@ fk_app_HttpReply *fk_http_reply_encoding_initialize(fk_app_HttpReply *reply, Poo
         prepare_encode_array(&reply->streams, pool);
         auto array = reinterpret_cast<pb_array_t *>(reply->streams.arg);
         for (size_t i = 0; i < array->length; ++i) {
-            auto stream = &((fk_app_DataStream *)array->buffer)[i];
+            auto stream = array->item<fk_app_DataStream>(i);
             prepare_encode_string(&stream->name, pool);
             prepare_encode_string(&stream->path, pool);
             prepare_encode_data(&stream->hash, pool);
@@ -452,7 +452,7 @@ fk_app_HttpReply *fk_http_reply_encoding_initialize(fk_app_HttpReply *reply, Poo
         prepare_encode_array(&reply->networkSettings.networks, pool);
         auto array = reinterpret_cast<pb_array_t *>(reply->networkSettings.networks.arg);
         for (size_t i = 0; i < array->length; ++i) {
-            auto network = &((fk_app_NetworkInfo *)array->buffer)[i];
+            auto network = array->item<fk_app_NetworkInfo>(i);
             prepare_encode_string(&network->ssid, pool);
             prepare_encode_string(&network->password, pool);
         }
@@ -470,12 +470,12 @@ fk_app_HttpReply *fk_http_reply_encoding_initialize(fk_app_HttpReply *reply, Poo
         prepare_encode_array(&reply->liveReadings, pool);
         auto live_readings_array = reinterpret_cast<pb_array_t *>(reply->liveReadings.arg);
         for (size_t i = 0; i < live_readings_array->length; ++i) {
-            auto live_readings = &((fk_app_LiveReadings *)live_readings_array->buffer)[i];
+            auto live_readings = live_readings_array->item<fk_app_LiveReadings>(i);
             if (live_readings->modules.arg != nullptr) {
                 prepare_encode_array(&live_readings->modules, pool);
                 auto modules_array = reinterpret_cast<pb_array_t *>(live_readings->modules.arg);
                 for (size_t j = 0; j < modules_array->length; ++j) {
-                    auto lmr = &((fk_app_LiveModuleReadings *)modules_array->buffer)[j];
+                    auto lmr = modules_array->item<fk_app_LiveModuleReadings>(j);
                     if (lmr->module.name.arg != nullptr) {
                         prepare_encode_string(&lmr->module.name, pool);
                         prepare_encode_data(&lmr->module.id, pool);
@@ -485,7 +485,7 @@ fk_app_HttpReply *fk_http_reply_encoding_initialize(fk_app_HttpReply *reply, Poo
                         prepare_encode_array(&lmr->readings, pool);
                         auto readings_array = reinterpret_cast<pb_array_t *>(lmr->readings.arg);
                         for (size_t k = 0; k < readings_array->length; ++k) {
-                            auto lsr = &((fk_app_LiveSensorReading *)readings_array->buffer)[k];
+                            auto lsr = readings_array->item<fk_app_LiveSensorReading>(k);
                             prepare_encode_string(&lsr->sensor.name, pool);
                             prepare_encode_string(&lsr->sensor.unitOfMeasure, pool);
                             prepare_encode_string(&lsr->sensor.uncalibratedUnitOfMeasure, pool);
@@ -611,7 +611,7 @@ fk_app_ModuleHttpReply *fk_module_reply_prepare_encoding(fk_app_ModuleHttpReply
         prepare_encode_array(&reply->errors, pool);
         auto array = (pb_array_t *)reply->errors.arg;
         for (auto i = 0u; i < array->length; ++i) {
-            auto error = &((fk_app_Error *)array->buffer)[i];
+            auto error = array->item<fk_app_Error>(i);
             prepare_encode_string(&error->message, pool);
         }
     }
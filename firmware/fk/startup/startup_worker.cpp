@@ -200,6 +200,9 @@ void StartupWorker::run(Pool &pool) {
 bool StartupWorker::load_or_create_state(Pool &pool) {
     loginfo("loading state");
 
+    // Mounting unmounts the storage session, so nobody can be borrowing it.
+    auto lock = storage_mutex.acquire(UINT32_MAX);
+
     Storage storage{ MemoryFactory::get_data_memory(), pool, false };
     auto gs = get_global_state_rw();
     if (!load_state(storage, gs.get(), pool)) {
@@ -293,9 +296,8 @@ bool StartupWorker::load_state(Storage &storage, GlobalState *gs, Pool &pool) {
     if (networks_array->length > 0) {
         FK_ASSERT(networks_array->length <= WifiMaximumNumberOfNetworks);
 
-        auto networks = reinterpret_cast<fk_app_NetworkInfo *>(networks_array->buffer);
         for (auto i = 0u; i < networks_array->length; ++i) {
-            auto &n = networks[i];
+            auto &n = *networks_array->item<fk_app_NetworkInfo>(i);
             auto ssid = reinterpret_cast<const char *>(n.ssid.arg);
             auto password = reinterpret_cast<const char *>(n.password.arg);
 
@@ -477,11 +479,11 @@ static void copy_cron_spec_from_pb(const char *name, Schedule &cs, fk_data_JobSc
 
     auto intervals_array = reinterpret_cast<pb_array_t *>(pb.intervals.arg);
     if (intervals_array != nullptr && intervals_array->length > 0) {
-        auto intervals_source = reinterpret_cast<fk_app_Interval *>(intervals_array->buffer);
         for (auto i = 0u; i < std::min(intervals_array->length, MaximumScheduleIntervals); ++i) {
-            cs.intervals[i].start = intervals_source[i].start;
-            cs.intervals[i].end = intervals_source[i].end;
-            cs.intervals[i].interval = intervals_source[i].interval;
+            auto source = intervals_array->item<fk_app_Interval>(i);
+            cs.intervals[i].start = source->start;
+            cs.intervals[i].end = source->end;
+            cs.intervals[i].interval = source->interval;
         }
     }
 
@@ -1,6 +1,7 @@
 #include "state.h"
 #include "state_ref.h"
 #include "storage/storage.h"
+#include "storage/storage_session.h"
 #include "l10n/l10n.h"
 
 #if defined(__SAMD51__)
@@ -18,6 +19,7 @@ FK_DECLARE_LOGGER("gs");
 DisplayTaskParameters task_display_params;
 
 static GlobalState gs;
+static uint32_t gs_generation = 0;
 
 void Schedule::recreate() {
     auto has_intervals = false;
@@ -55,12 +57,12 @@ Schedule &Schedule::operator=(const fk_app_Schedule &s) {
     }
     if (s.intervals.arg != nullptr) {
         auto intervals_array = reinterpret_cast<pb_array_t *>(s.intervals.arg);
-        auto intervals_source = reinterpret_cast<fk_app_Interval *>(intervals_array->buffer);
         for (auto i = 0u; i < std::min(intervals_array->length, MaximumScheduleIntervals); ++i) {
-            if (intervals_source[i].interval > 0 && intervals_source[i].start != intervals_source[i].end) {
-                intervals[i].start = intervals_source[i].start;
-                intervals[i].end = intervals_source[i].end;
-                intervals[i].interval = intervals_source[i].interval;
+            auto source = intervals_array->item<fk_app_Interval>(i);
+            if (source->interval > 0 && source->start != source->end) {
+                intervals[i].start = source->start;
+                intervals[i].end = source->end;
+                intervals[i].interval = source->interval;
             }
         }
     }
@@ -84,9 +86,14 @@ GlobalStateRef<const GlobalState *> get_global_state_ro() {
 GlobalStateRef<GlobalState *> get_global_state_rw() {
     auto lock = data_lock.acquire_write(UINT32_MAX);
     FK_ASSERT(lock);
+    gs_generation++;
     return { std::move(lock), false, &gs };
 }
 
+uint32_t get_global_state_generation() {
+    return gs_generation;
+}
+
 GlobalStateRef<GlobalState const *> try_get_global_state_ro() {
     auto lock = data_lock.acquire_read(0);
     if (!lock) {
@@ -143,11 +150,13 @@ bool GlobalState::flush(uint32_t timeout, Pool &pool) {
     }
 
     // jlewallen: storage-write
-    Storage storage{ MemoryFactory::get_data_memory(), pool, false };
-    if (!storage.begin()) {
+    BorrowedStorage borrowed{ lock };
+    if (!borrowed) {
         return false;
     }
 
+    auto &storage = *borrowed;
+
     ScopedLogLevelChange change{ LogLevels::INFO };
 
     MetaRecord meta_record{ pool };
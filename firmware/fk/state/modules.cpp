@@ -279,14 +279,46 @@ AttachedModule *AttachedModules::get_by_id(fk_uuid_t const &id) {
     if (!fk_uuid_is_valid(&id)) {
         return nullptr;
     }
-    for (auto &am : modules_) {
-        if (am.has_id(id)) {
-            return &am;
+
+    if (!indexed_ || indexed_generation_ != modules_.generation()) {
+        index();
+    }
+
+    AttachedModule *attached = nullptr;
+    if (by_id_.get(id, attached)) {
+        return attached;
+    }
+
+    if (!index_complete_) {
+        for (auto &am : modules_) {
+            if (am.has_id(id)) {
+                return &am;
+            }
         }
     }
+
     return nullptr;
 }
 
+void AttachedModules::index() {
+    by_id_.clear();
+    index_complete_ = true;
+
+    for (auto &am : modules_) {
+        auto id = am.id();
+        if (!fk_uuid_is_valid(&id) || by_id_.find(id) != nullptr) {
+            continue;
+        }
+        if (!by_id_.put(id, &am)) {
+            index_complete_ = false;
+            break;
+        }
+    }
+
+    indexed_generation_ = modules_.generation();
+    indexed_ = true;
+}
+
 size_t AttachedModules::number_of_sensors() const {
     size_t total = 0;
     for (auto &am : modules_) {
@@ -116,17 +116,28 @@ public:
 private:
 #endif
     void add_sensor(AttachedSensor as) {
-        sensors_.add(as);
+        sensors_.add(std::move(as));
     }
 };
 
 class AttachedModules : public ScanningListener {
 private:
     using Modules = collection<AttachedModule>;
+    using ModulesById = pool_map<fk_uuid_t, AttachedModule *, MaximumNumberOfPhysicalModules>;
     Modules modules_{ pool_ };
     Pool *pool_{ nullptr };
     bool initialized_{ false };
 
+    /**
+     * Index over modules_, rebuilt whenever modules_ has changed since.
+     * Modules without an id, and any that don't fit, are only found by
+     * walking modules_.
+     */
+    ModulesById by_id_;
+    uint32_t indexed_generation_{ 0 };
+    bool indexed_{ false };
+    bool index_complete_{ false };
+
 public:
     AttachedModules(Modules modules, Pool &pool);
     AttachedModules(Pool &pool);
@@ -157,6 +168,7 @@ public:
 
 private:
     int32_t scan(Pool &pool);
+    void index();
 
 public:
     int32_t create(Pool &pool);
@@ -167,7 +179,7 @@ public:
 private:
 #endif
     void add_module(AttachedModule am) {
-        modules_.add(am);
+        modules_.add(std::move(am));
     }
 };
 
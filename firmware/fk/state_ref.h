@@ -47,4 +47,11 @@ GlobalStateRef<GlobalState const *> try_get_global_state_ro();
 
 GlobalStateRef<GlobalState *> get_global_state_rw();
 
+/**
+ * Bumped every time the global state is opened for writing, so anything
+ * derived from it can tell when it may be stale. Read this while holding
+ * a reference to the state.
+ */
+uint32_t get_global_state_generation();
+
 } // namespace fk
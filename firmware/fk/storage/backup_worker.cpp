@@ -7,16 +7,34 @@
 #include "hal/hal.h"
 #include "hal/memory.h"
 #include "hal/sd_card.h"
+#include "modules/shared/crc.h"
+#include "storage/storage_session.h"
 
 #include "records.h"
+#include "state_ref.h"
 
 namespace fk {
 
 FK_DECLARE_LOGGER("backup");
 
+constexpr uint32_t BackupStateVersion = 2;
+constexpr size_t BackupStateSlots = 2;
+
+static uint32_t backup_state_crc(BackupState const &state) {
+    return crc32_checksum(0, (uint8_t const *)&state, sizeof(BackupState) - sizeof(uint32_t));
+}
+
+static const char *segment_path(const char *directory, uint32_t segment, Pool &pool) {
+    return pool.sprintf("%s/data-%06" PRIu32 ".fkpb", directory, segment);
+}
+
 BackupWorker::BackupWorker() : info_{ "Backup", 0.0f, true } {
 }
 
+BackupWorker::BackupWorker(uint32_t segment_size, uint32_t records_per_commit)
+    : segment_size_(segment_size), records_per_commit_(records_per_commit), info_{ "Backup", 0.0f, true } {
+}
+
 void BackupWorker::run(Pool &pool) {
     get_board()->i2c_core().begin();
 
@@ -32,149 +50,366 @@ void BackupWorker::run(Pool &pool) {
         return;
     }
 
-    StatisticsMemory memory{ MemoryFactory::get_data_memory() };
-
-    Storage storage{ &memory, pool };
-    if (!storage.begin()) {
+    BorrowedStorage borrowed{ lock };
+    if (!borrowed) {
         logerror("error opening storage");
         return;
     }
 
+    backup(*borrowed, pool);
+}
+
+bool BackupWorker::backup(Storage &storage, Pool &pool) {
     auto sd = get_sd_card();
     if (!sd->begin()) {
         logerror("error opening sd card");
-        return;
+        return false;
     }
 
-    FormattedTime formatted{ get_clock_now(), TimeFormatMachine };
-    loginfo("mkdir %s", formatted.cstr());
-    if (!sd->mkdir(formatted.cstr())) {
-        logerror("error making directory '%s'", formatted.cstr());
-        return;
+    // Each generation of the station's storage gets its own chain of
+    // segments, so wiping the station never mixes old and new records.
+    BackupState state;
+    bzero(&state, sizeof(BackupState));
+    state.version = BackupStateVersion;
+    memcpy(state.generation, get_global_state_ro().get()->general.generation, GenerationLength);
+
+    auto directory = pool.sprintf("/backup-%s", bytes_to_hex_string_pool(state.generation, 8, pool));
+    if (!sd->is_directory(directory)) {
+        loginfo("mkdir %s", directory);
+        if (!sd->mkdir(directory)) {
+            logerror("error making directory '%s'", directory);
+            return false;
+        }
     }
 
-    auto data_path = pool.sprintf("/%s/data.fkpb", formatted.cstr());
-    auto data_file = storage.file_reader(Storage::Data, pool);
-    if (!write_file(data_file, data_path, pool)) {
-        return;
+    if (load_state(directory, state, pool)) {
+        loginfo("resuming: segment=%" PRIu32 " record=%" PRIu32 " size=%" PRIu32, state.segment, state.next_record, state.total_size);
+    } else {
+        BLAKE2b b2b;
+        b2b.reset(Hash::Length);
+        b2b.saveState(state.segment_hash);
+        b2b.saveState(state.running_hash);
+        b2b.saveState(state.segment_running_hash);
+        loginfo("starting new backup");
     }
-}
 
-bool BackupWorker::write_file(FileReader *file, const char *path, Pool &pool) {
-    auto info = file->get_size(0, UINT32_MAX, pool);
-    if (!info) {
-        logerror("get-size");
+    if (!resume_segment(directory, state, pool)) {
         return false;
     }
 
-    loginfo("total size: %" PRIu32, info->size);
+    auto data_file = storage.file_reader(Storage::Data, pool);
+    return copy_records(data_file, directory, state, pool);
+}
 
+bool BackupWorker::resume_segment(const char *directory, BackupState &state, Pool &pool) {
     auto sd = get_sd_card();
-    if (!sd->begin()) {
-        return false;
+
+    auto path = segment_path(directory, state.segment, pool);
+    if (!sd->is_file(path)) {
+        if (state.segment_size == 0) {
+            return true;
+        }
+    } else {
+        auto file = sd->open(path, OpenFlags::AppendExisting, pool);
+        if (file == nullptr || !*file) {
+            logerror("unable to open '%s'", path);
+            return false;
+        }
+
+        auto file_size = file->file_size();
+        if (file_size == state.segment_size) {
+            return file->close();
+        }
+
+        // Anything past what we last saved was written by a backup that
+        // was interrupted, the saved hashes end where the state does.
+        if (file_size > state.segment_size) {
+            logwarn("'%s' truncating (%zu > %" PRIu32 ")", path, file_size, state.segment_size);
+            if (!file->truncate(state.segment_size)) {
+                logerror("unable to truncate '%s'", path);
+                file->close();
+                return false;
+            }
+            return file->close();
+        }
+
+        file->close();
     }
 
-    auto writing = sd->open(path, OpenFlags::Write, pool);
-    if (writing == nullptr || !*writing) {
+    // We've lost some of what we saved as written, so nothing in this
+    // segment can be trusted. Copy it over again from its first record.
+    logwarn("'%s' short (%" PRIu32 "), restarting from %" PRIu32, path, state.segment_size, state.segment_first_record);
+
+    if (sd->is_file(path) && !sd->unlink(path)) {
+        logerror("unable to remove '%s'", path);
         return false;
     }
 
     BLAKE2b b2b;
     b2b.reset(Hash::Length);
+    b2b.saveState(state.segment_hash);
+    memcpy(state.running_hash, state.segment_running_hash, sizeof(state.running_hash));
 
-    auto buffer = reinterpret_cast<uint8_t *>(pool.malloc(NetworkBufferSize));
-    auto bytes_copied = (uint32_t)0;
+    state.total_size -= state.segment_size;
+    state.segment_size = 0;
+    state.next_record = state.segment_first_record;
+
+    return save_state(directory, state, pool);
+}
+
+bool BackupWorker::copy_records(FileReader *file, const char *directory, BackupState &state, Pool &pool) {
+    auto remaining = file->get_size(state.next_record, UINT32_MAX, pool);
+    if (!remaining) {
+        logerror("get-size");
+        return false;
+    }
+
+    auto last_record = remaining->last_block;
+    if (state.next_record >= last_record) {
+        loginfo("up to date (%" PRIu32 " records)", state.next_record);
+        return true;
+    }
+
+    loginfo("copying records %" PRIu32 "-%" PRIu32 " (%" PRIu32 " bytes)", state.next_record, last_record, remaining->size);
+
+    BLAKE2b segment;
+    segment.restoreState(state.segment_hash);
+
+    BLAKE2b running;
+    running.restoreState(state.running_hash);
 
     ScopedLogLevelChange log_level_info_only{ LogLevels::INFO };
 
-    while (bytes_copied < info->size) {
-        auto to_read = std::min<int32_t>(NetworkBufferSize, info->size - bytes_copied);
-        auto bytes = file->read(buffer, to_read);
-        if (bytes > 0) {
-            b2b.update(buffer, bytes);
-            if (writing->write(buffer, bytes) == bytes) {
-                bytes_copied += bytes;
+    auto bytes_copied = (uint32_t)0;
+
+    // Everything a batch allocates goes in scratch and is gone before the
+    // next one, so a large backup doesn't slowly eat the caller's pool.
+    auto buffer = reinterpret_cast<uint8_t *>(pool.malloc(NetworkBufferSize));
+    StandardPool scratch{ "backup" };
+
+    while (state.next_record < last_record) {
+        scratch.clear();
+
+        if (state.segment_size >= segment_size_) {
+            if (!finish_segment(directory, state, segment, scratch)) {
+                return false;
             }
+        }
 
-            info_.progress = (float)bytes_copied / info->size;
-        } else {
-            break;
+        // Sizing the batch leaves the reader on its first record.
+        auto first = state.next_record;
+        auto last = std::min<uint32_t>(first + records_per_commit_, last_record);
+        auto batch = file->get_size(first, last == last_record ? UINT32_MAX : last, scratch);
+        if (!batch) {
+            logerror("get-size");
+            return false;
+        }
+
+        if (!append_segment(file, directory, batch->size, state, segment, running, buffer, scratch)) {
+            return false;
+        }
+
+        state.next_record = last;
+        state.total_size += batch->size;
+        segment.saveState(state.segment_hash);
+        running.saveState(state.running_hash);
+
+        if (!save_state(directory, state, scratch)) {
+            return false;
         }
+
+        bytes_copied += batch->size;
+        info_.progress = (float)bytes_copied / remaining->size;
     }
 
-    writing->close();
+    uint8_t hash[Hash::Length];
+    BLAKE2b finishing = running;
+    finishing.finalize(hash, Hash::Length);
 
-    uint8_t expected[Hash::Length];
-    b2b.finalize(&expected, Hash::Length);
+    loginfo("done copying %" PRIu32 " bytes, %" PRIu32 " records in %" PRIu32 " bytes hash=%s", bytes_copied, state.next_record,
+            state.total_size, bytes_to_hex_string_pool(hash, Hash::Length, pool));
 
-    auto expected_hex = bytes_to_hex_string_pool(expected, Hash::Length, pool);
+    return true;
+}
 
-    auto hash_writer = sd->open(pool.sprintf("%s.hash", path), OpenFlags::Write, pool);
-    if (hash_writer == nullptr || !*hash_writer) {
+bool BackupWorker::append_segment(FileReader *file, const char *directory, uint32_t size, BackupState &state, BLAKE2b &segment,
+                                  BLAKE2b &running, uint8_t *buffer, Pool &pool) {
+    auto sd = get_sd_card();
+
+    auto path = segment_path(directory, state.segment, pool);
+    auto writing = sd->open(path, OpenFlags::AppendExisting, pool);
+    if (writing == nullptr || !*writing) {
+        logerror("unable to open '%s'", path);
         return false;
     }
 
-    hash_writer->write((uint8_t *)expected_hex, strlen(expected_hex));
+    // A new segment may be left over from a backup that was interrupted
+    // before it saved any of it.
+    if (writing->file_size() != state.segment_size) {
+        logwarn("'%s' size mismatch (%zu != %" PRIu32 ")", path, writing->file_size(), state.segment_size);
+        if (state.segment_size > 0 || !writing->truncate(0)) {
+            logerror("unable to start '%s'", path);
+            writing->close();
+            return false;
+        }
+    }
 
-    hash_writer->close();
+    auto bytes_copied = (uint32_t)0;
+
+    // Hashing as we go means verifying never has to read the segment
+    // back, what we hashed is exactly what the card accepted.
+    while (bytes_copied < size) {
+        auto to_read = std::min<int32_t>(NetworkBufferSize, size - bytes_copied);
+        auto bytes = file->read(buffer, to_read);
+        if (bytes <= 0) {
+            logerror("error reading (%" PRId32 ")", bytes);
+            writing->close();
+            return false;
+        }
 
-    loginfo("done writing %" PRIu32 " bytes hash=%s", bytes_copied, expected_hex);
+        if (writing->write(buffer, bytes) != bytes) {
+            logerror("error writing '%s'", path);
+            writing->close();
+            return false;
+        }
 
-    if (bytes_copied == 0) {
-        logwarn("empty file '%s'", path);
-        return true;
+        segment.update(buffer, bytes);
+        running.update(buffer, bytes);
+
+        bytes_copied += bytes;
+    }
+
+    if (!writing->close()) {
+        logerror("error closing '%s'", path);
+        return false;
     }
 
+    state.segment_size += bytes_copied;
+
     if (verify_) {
-        uint8_t actual[Hash::Length];
-        if (!hash_file(path, actual, pool)) {
+        auto reading = sd->open(path, OpenFlags::Read, pool);
+        if (reading == nullptr || !*reading) {
+            logerror("unable to open '%s'", path);
             return false;
         }
 
-        if (memcmp(actual, expected, Hash::Length) != 0) {
-            logerror("hash mismatch!");
-            fk_dump_memory("expected ", (uint8_t *)&expected, Hash::Length);
-            fk_dump_memory("actual   ", (uint8_t *)&actual, Hash::Length);
+        auto file_size = reading->file_size();
+        reading->close();
+
+        if (file_size != state.segment_size) {
+            logerror("'%s' size mismatch (%zu != %" PRIu32 ")", path, file_size, state.segment_size);
+            return false;
         }
     }
 
     return true;
 }
 
-bool BackupWorker::hash_file(const char *path, uint8_t *hash, Pool &pool) {
+bool BackupWorker::finish_segment(const char *directory, BackupState &state, BLAKE2b const &segment, Pool &pool) {
     auto sd = get_sd_card();
 
-    auto file = sd->open(path, OpenFlags::Read, pool);
-    if (file == nullptr || !file->is_open()) {
-        logerror("unable to open '%s'", path);
+    uint8_t hash[Hash::Length];
+    BLAKE2b finishing = segment;
+    finishing.finalize(hash, Hash::Length);
+
+    auto hash_hex = bytes_to_hex_string_pool(hash, Hash::Length, pool);
+    auto path = pool.sprintf("%s.hash", segment_path(directory, state.segment, pool));
+
+    // A backup interrupted after finishing this segment will have
+    // written this once already.
+    if (sd->is_file(path) && !sd->unlink(path)) {
+        logerror("unable to remove '%s'", path);
         return false;
     }
 
-    auto file_size = file->file_size();
-    if (file_size == 0) {
-        logwarn("empty file '%s'", path);
-        return true;
+    auto hash_writer = sd->open(path, OpenFlags::Write, pool);
+    if (hash_writer == nullptr || !*hash_writer) {
+        logerror("unable to open '%s'", path);
+        return false;
     }
 
-    file->seek_beginning();
+    auto line = pool.sprintf("%s %" PRIu32 " %" PRIu32 "-%" PRIu32 "\n", hash_hex, state.segment_size, state.segment_first_record,
+                             state.next_record);
+    hash_writer->write((uint8_t *)line, strlen(line));
+    hash_writer->close();
+
+    loginfo("finished segment %" PRIu32 " (%" PRIu32 " bytes) hash=%s", state.segment, state.segment_size, hash_hex);
 
     BLAKE2b b2b;
     b2b.reset(Hash::Length);
+    b2b.saveState(state.segment_hash);
+    memcpy(state.segment_running_hash, state.running_hash, sizeof(state.segment_running_hash));
+
+    state.segment++;
+    state.segment_size = 0;
+    state.segment_first_record = state.next_record;
+
+    return true;
+}
 
-    auto total_bytes = (uint32_t)0u;
-    auto buffer = (uint8_t *)pool.malloc(NetworkBufferSize);
-    while (total_bytes < file_size) {
-        auto nread = file->read(buffer, NetworkBufferSize);
-        if (nread <= 0) {
-            break;
+bool BackupWorker::load_state(const char *directory, BackupState &state, Pool &pool) {
+    auto sd = get_sd_card();
+    auto found = false;
+
+    for (auto i = 0u; i < BackupStateSlots; ++i) {
+        auto path = pool.sprintf("%s/state-%" PRIu32, directory, (uint32_t)i);
+        if (!sd->is_file(path)) {
+            continue;
+        }
+
+        auto file = sd->open(path, OpenFlags::Read, pool);
+        if (file == nullptr || !*file) {
+            continue;
         }
 
-        b2b.update(buffer, nread);
+        BackupState saved;
+        auto nread = file->read((uint8_t *)&saved, sizeof(BackupState));
+        file->close();
+
+        if (nread != sizeof(BackupState) || saved.crc != backup_state_crc(saved)) {
+            logwarn("ignoring corrupted '%s'", path);
+            continue;
+        }
+
+        if (saved.version != BackupStateVersion || memcmp(saved.generation, state.generation, GenerationLength) != 0) {
+            logwarn("ignoring mismatched '%s'", path);
+            continue;
+        }
 
-        total_bytes += nread;
+        if (!found || saved.sequence > state.sequence) {
+            memcpy(&state, &saved, sizeof(BackupState));
+            found = true;
+        }
     }
 
-    b2b.finalize(hash, Hash::Length);
+    return found;
+}
+
+bool BackupWorker::save_state(const char *directory, BackupState &state, Pool &pool) {
+    auto sd = get_sd_card();
+
+    // Alternating between two files means there's always one good copy,
+    // even when we're interrupted halfway through writing the other.
+    state.sequence++;
+    state.crc = backup_state_crc(state);
+
+    auto path = pool.sprintf("%s/state-%" PRIu32, directory, (uint32_t)(state.sequence % BackupStateSlots));
+    if (sd->is_file(path) && !sd->unlink(path)) {
+        logerror("unable to remove '%s'", path);
+        return false;
+    }
+
+    auto file = sd->open(path, OpenFlags::Write, pool);
+    if (file == nullptr || !*file) {
+        logerror("unable to open '%s'", path);
+        return false;
+    }
+
+    auto wrote = file->write((uint8_t *)&state, sizeof(BackupState));
+    if (!file->close() || wrote != (int32_t)sizeof(BackupState)) {
+        logerror("error writing '%s'", path);
+        return false;
+    }
 
     return true;
 }
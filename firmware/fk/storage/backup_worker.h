@@ -1,5 +1,7 @@
 #pragma once
 
+#include <blake2b.h>
+
 #include "worker.h"
 #include "storage/storage.h"
 #include "storage/meta_record.h"
@@ -7,17 +9,50 @@
 
 namespace fk {
 
+/**
+ * Progress of the incremental backup, saved after every batch of records
+ * so that the next backup only copies what's new and an interrupted one
+ * picks up where it left off.
+ */
+struct BackupState {
+    uint32_t version;
+    uint32_t sequence;
+    uint8_t generation[GenerationLength];
+    uint32_t segment;
+    uint32_t segment_size;
+    uint32_t segment_first_record;
+    uint32_t next_record;
+    uint32_t total_size;
+    uint8_t segment_hash[BLAKE2b::StateSize];
+    uint8_t running_hash[BLAKE2b::StateSize];
+    /**
+     * The running hash as of the segment's first record, so a segment
+     * can be copied over again from the start.
+     */
+    uint8_t segment_running_hash[BLAKE2b::StateSize];
+    uint32_t crc;
+};
+
 class BackupWorker : public Worker {
 private:
     bool verify_{ false };
+    uint32_t segment_size_{ BackupSegmentSize };
+    uint32_t records_per_commit_{ BackupRecordsPerCommit };
     TaskDisplayInfo info_;
 
 public:
     explicit BackupWorker();
+    explicit BackupWorker(uint32_t segment_size, uint32_t records_per_commit);
 
 public:
     void run(Pool &pool) override;
 
+    /**
+     * Copies any records added since the last backup of this storage to
+     * the SD card. Expects the caller to hold storage_mutex.
+     */
+    bool backup(Storage &storage, Pool &pool);
+
 public:
     const char *name() const override {
         return "backup";
@@ -28,8 +63,13 @@ public:
     }
 
 private:
-    bool write_file(FileReader *file, const char *path, Pool &pool);
-    bool hash_file(const char *path, uint8_t *hash, Pool &pool);
+    bool resume_segment(const char *directory, BackupState &state, Pool &pool);
+    bool copy_records(FileReader *file, const char *directory, BackupState &state, Pool &pool);
+    bool append_segment(FileReader *file, const char *directory, uint32_t size, BackupState &state, BLAKE2b &segment, BLAKE2b &running,
+                        uint8_t *buffer, Pool &pool);
+    bool finish_segment(const char *directory, BackupState &state, BLAKE2b const &segment, Pool &pool);
+    bool load_state(const char *directory, BackupState &state, Pool &pool);
+    bool save_state(const char *directory, BackupState &state, Pool &pool);
 };
 
 FK_ENABLE_TYPE_NAME(BackupWorker);
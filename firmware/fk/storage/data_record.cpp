@@ -58,12 +58,13 @@ void DataRecord::include_readings(GlobalState const *gs, fkb_header_t const *fkb
         // Initialize an empty sensor group at each module position here,
         // so that if we `continue` in the loop after they're
         // initialized. This isn't ideal, continue just sucks.
-        auto empty_readings_array = pool.malloc<pb_array_t>();
-        empty_readings_array->length = 0;
-        empty_readings_array->allocated = 0;
-        empty_readings_array->item_size = sizeof(fk_data_SensorAndValue);
-        empty_readings_array->buffer = nullptr;
-        empty_readings_array->fields = fk_data_SensorAndValue_fields;
+        auto empty_readings_array = pool.malloc_with<pb_array_t>({
+            .length = 0,
+            .allocated = 0,
+            .item_size = sizeof(fk_data_SensorAndValue),
+            .buffer = nullptr,
+            .fields = fk_data_SensorAndValue_fields,
+        });
 
         for (auto i = 0u; i < nmodules; ++i) {
             auto &group = groups[i];
@@ -109,12 +110,13 @@ void DataRecord::include_readings(GlobalState const *gs, fkb_header_t const *fkb
             group.module = position.integer();
 
             if (sensors.size() > 0) {
-                auto readings_array = pool.malloc<pb_array_t>();
-                readings_array->length = sensors.size();
-                readings_array->allocated = sensors.size();
-                readings_array->item_size = sizeof(fk_data_SensorAndValue);
-                readings_array->buffer = sensor_values;
-                readings_array->fields = fk_data_SensorAndValue_fields;
+                auto readings_array = pool.malloc_with<pb_array_t>({
+                    .length = sensors.size(),
+                    .allocated = sensors.size(),
+                    .item_size = sizeof(fk_data_SensorAndValue),
+                    .buffer = sensor_values,
+                    .fields = fk_data_SensorAndValue_fields,
+                });
 
                 group.readings.funcs.encode = pb_encode_array;
                 group.readings.arg = readings_array;
@@ -126,12 +128,13 @@ void DataRecord::include_readings(GlobalState const *gs, fkb_header_t const *fkb
             group_index++;
         }
 
-        auto sensor_groups_array = pool.malloc<pb_array_t>();
-        sensor_groups_array->length = nmodules;
-        sensor_groups_array->allocated = nmodules;
-        sensor_groups_array->item_size = sizeof(fk_data_SensorGroup);
-        sensor_groups_array->buffer = groups;
-        sensor_groups_array->fields = fk_data_SensorGroup_fields;
+        auto sensor_groups_array = pool.malloc_with<pb_array_t>({
+            .length = nmodules,
+            .allocated = nmodules,
+            .item_size = sizeof(fk_data_SensorGroup),
+            .buffer = groups,
+            .fields = fk_data_SensorGroup_fields,
+        });
 
         record_->readings.sensorGroups.arg = sensor_groups_array;
     }
@@ -1,5 +1,6 @@
 #include "storage/events.h"
 #include "storage/storage.h"
+#include "storage/storage_session.h"
 #include "hal/hal.h"
 #include "records.h"
 #include "state.h"
@@ -145,15 +146,13 @@ bool Events::flush() {
 
 void EventWorker::run(Pool &pool) {
     auto lock = storage_mutex.acquire(UINT32_MAX);
-    auto data_memory = MemoryFactory::get_data_memory();
-    StatisticsMemory memory{ data_memory };
-    Storage storage{ &memory, pool };
-    if (!storage.begin()) {
+    BorrowedStorage storage{ lock };
+    if (!storage) {
         logerror("error opening storage");
         return;
     }
 
-    run(storage, pool);
+    run(*storage, pool);
 }
 
 bool LoadEventsWorker::run(Storage &storage, Pool &pool) {
@@ -22,6 +22,9 @@ void FactoryWipeWorker::run(Pool &pool) {
         return;
     }
 
+    // Wiping unmounts the storage session, so nobody can be borrowing it.
+    auto lock = storage_mutex.acquire(UINT32_MAX);
+
     auto memory = MemoryFactory::get_data_memory();
     GlobalStateProgressCallbacks progress;
     Storage storage{ memory, pool, false };
@@ -54,6 +54,15 @@ public:
 public:
     virtual bool seek_record(RecordNumber record, Pool &pool) = 0;
     virtual int32_t read(uint8_t *record, size_t size) = 0;
+    virtual int32_t read(Writer *writer, size_t size) = 0;
+    /**
+     * Keeps the file system buffer holding a pointer handed to a Writer
+     * by read around until it's released, so it can be written from
+     * after the read returns. Returns false for memory that isn't one of
+     * those buffers, which is only good until read returns.
+     */
+    virtual bool retain(uint8_t const *buffer) = 0;
+    virtual void release(uint8_t const *buffer) = 0;
     virtual int32_t read(void *record, pb_msgdesc_t const *fields) = 0;
     virtual int32_t get_file_size(size_t &file_size) = 0;
     virtual int32_t read_signed_record_bytes(SignedRecordKind kind, Writer *writer, Pool &pool) = 0;
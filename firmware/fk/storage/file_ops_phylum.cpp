@@ -259,6 +259,26 @@ int32_t FileReader::read(uint8_t *record, size_t size) {
     return err;
 }
 
+int32_t FileReader::read(Writer *writer, size_t size) {
+    FK_ASSERT(file_number_ == Storage::Data);
+    FK_ASSERT(pdf_.is_open());
+
+    auto err = pdf_.read(writer, size);
+    if (err < 0) {
+        return err;
+    }
+
+    return err;
+}
+
+bool FileReader::retain(uint8_t const *buffer) {
+    return pdf_.retain(buffer);
+}
+
+void FileReader::release(uint8_t const *buffer) {
+    pdf_.release(buffer);
+}
+
 int32_t FileReader::read(void *record, pb_msgdesc_t const *fields) {
     FK_ASSERT(file_number_ == Storage::Data);
     FK_ASSERT(pdf_.is_open());
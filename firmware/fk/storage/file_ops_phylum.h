@@ -55,6 +55,9 @@ public:
 public:
     bool seek_record(RecordNumber record, Pool &pool) override;
     int32_t read(uint8_t *record, size_t size) override;
+    int32_t read(Writer *writer, size_t size) override;
+    bool retain(uint8_t const *buffer) override;
+    void release(uint8_t const *buffer) override;
     int32_t read(void *record, pb_msgdesc_t const *fields) override;
     int32_t get_file_size(size_t &file_size) override;
     int32_t read_signed_record_bytes(SignedRecordKind kind, Writer *writer, Pool &pool) override;
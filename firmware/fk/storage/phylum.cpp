@@ -3,6 +3,8 @@
 
 namespace fk {
 
+FK_DECLARE_LOGGER("phylum");
+
 standard_page_buffer_memory::standard_page_buffer_memory(Pool *pool) : pool_(pool) {
 }
 
@@ -50,13 +52,16 @@ void standard_page_buffer_memory::free_page(void *ptr) {
     }
 }
 
-Phylum::Phylum(DataMemory *data_memory, Pool &pool)
-    : memory_(data_memory, &buffers_), pool_(&pool), sector_size_(data_memory->geometry().real_page_size) {
+Phylum::Phylum(DataMemory *data_memory, Pool &pool, bool page_cache)
+    : memory_(data_memory, &buffers_), pool_(&pool), sector_size_(data_memory->geometry().real_page_size),
+      page_cache_(&pool, page_cache) {
 }
 
 bool Phylum::begin(bool force_create) {
     buffers_.clear();
 
+    page_cache_.begin();
+
     if (sectors_.begin(force_create) != 0) {
         return false;
     }
@@ -78,7 +83,16 @@ bool Phylum::format() {
         return false;
     }
 
-    return true;
+    phylum::free_sectors_chain free_sectors{ pc(), phylum::head_tail_t{} };
+    if (free_sectors.create_if_necessary() != 0) {
+        return false;
+    }
+
+    if (dir.free_chain(free_sectors.head()) != 0) {
+        return false;
+    }
+
+    return mount_free_sectors(dir);
 }
 
 bool Phylum::mount() {
@@ -91,6 +105,31 @@ bool Phylum::mount() {
         return false;
     }
 
+    return mount_free_sectors(dir);
+}
+
+bool Phylum::mount_free_sectors(directory_type &dir) {
+    // Volumes formatted before sectors were reclaimed have no free
+    // chain, and simply keep allocating new sectors.
+    auto head = dir.free_chain();
+    if (head == phylum::InvalidSector) {
+        logwarn("no free sectors chain");
+        return true;
+    }
+
+    if (free_sectors_ == nullptr || free_sectors_->head() != head) {
+        free_sectors_ = new (pool_) phylum::free_sectors_chain{ pc(), phylum::head_tail_t{ head, phylum::InvalidSector } };
+    }
+
+    if (free_sectors_->mount() != 0) {
+        logwarn("free sectors chain missing (%" PRIu32 ")", head);
+        return true;
+    }
+
+    if (allocator_.begin(free_sectors_) != 0) {
+        return false;
+    }
+
     return true;
 }
 
@@ -99,6 +138,11 @@ bool Phylum::sync() {
         return false;
     }
 
+    // Push anything cached below us out to the chip.
+    if (memory_.flush() < 0) {
+        return false;
+    }
+
     return true;
 }
 
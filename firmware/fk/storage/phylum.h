@@ -6,11 +6,14 @@
 
 #include "hal/memory.h"
 #include "storage/phylum_flash_memory.h"
+#include "storage/phylum_page_cache.h"
 #include "pool.h"
 
 namespace fk {
 
 using directory_type = phylum::directory_tree;
+// 201 keys is the largest node that fits in a 2048 byte page, which
+// older flash chips still use.
 using index_tree_type = phylum::tree_sector<uint32_t, uint32_t, 201>;
 using file_ops_type = phylum::file_ops<directory_type, index_tree_type>;
 
@@ -47,14 +50,15 @@ private:
     Pool *pool_{ nullptr };
     size_t sector_size_;
     standard_page_buffer_memory buffer_memory_{ pool_ };
-    phylum::working_buffers buffers_{ &buffer_memory_, sector_size_, WorkingBuffersSize };
-    phylum::noop_page_cache page_cache_;
-    // phylum::simple_page_cache page_cache_{ buffers_.allocate(sector_size_) };
+    phylum::pinning_eviction_policy eviction_policy_;
+    phylum::working_buffers buffers_{ &buffer_memory_, sector_size_, WorkingBuffersSize, &eviction_policy_ };
+    PhylumPageCache page_cache_;
     phylum::dhara_sector_map sectors_{ buffers_, memory_, &page_cache_ };
     phylum::sector_allocator allocator_{ sectors_ };
+    phylum::free_sectors_chain *free_sectors_{ nullptr };
 
 public:
-    Phylum(DataMemory *data_memory, Pool &pool);
+    Phylum(DataMemory *data_memory, Pool &pool, bool page_cache = true);
 
 public:
     phylum::phyctx pc() {
@@ -63,11 +67,18 @@ public:
 
     uint32_t bytes_used();
 
+    PhylumPageCacheStatistics const &page_cache_statistics() const {
+        return page_cache_.statistics();
+    }
+
 public:
     bool begin(bool force_create);
     bool format();
     bool mount();
     bool sync();
+
+private:
+    bool mount_free_sectors(directory_type &dir);
 };
 
 } // namespace fk
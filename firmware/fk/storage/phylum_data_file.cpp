@@ -132,6 +132,20 @@ public:
     }
 };
 
+class WriterTarget : public phylum::io_writer {
+private:
+    Writer *target_;
+
+public:
+    WriterTarget(Writer *target) : target_(target) {
+    }
+
+public:
+    int32_t write(uint8_t const *buffer, size_t size) override {
+        return target_->write(buffer, size);
+    }
+};
+
 static uint8_t get_attribute_for_record_type(RecordType type) {
     switch (type) {
     case RecordType::Modules:
@@ -283,6 +297,12 @@ PhylumDataFile::appended_t PhylumDataFile::append_always(RecordType type, Reader
         return appended_t{ err };
     }
 
+    err = opened.begin_record();
+    if (err < 0) {
+        logerror("append-always: begin-record");
+        return appended_t{ err };
+    }
+
     logdebug("append-always: writers");
 
     auto record_number = records->nrecords;
@@ -512,6 +532,28 @@ int32_t PhylumDataFile::read(uint8_t *data, size_t size) {
     return err;
 }
 
+int32_t PhylumDataFile::read(Writer *writer, size_t size) {
+    assert(reader_ != nullptr);
+
+    logged_task lt{ "df-read" };
+
+    WriterTarget target{ writer };
+    auto err = reader_->read(target, size);
+    if (err < 0) {
+        return err;
+    }
+
+    return err;
+}
+
+bool PhylumDataFile::retain(uint8_t const *buffer) {
+    return reader_->retain(buffer);
+}
+
+void PhylumDataFile::release(uint8_t const *buffer) {
+    reader_->release(buffer);
+}
+
 int32_t PhylumDataFile::read(pb_msgdesc_t const *fields, void *record, Pool &pool) {
     assert(reader_ != nullptr);
 
@@ -91,6 +91,9 @@ public:
     int32_t seek_position(file_size_t position);
     int32_t read_buffered(uint8_t *data, size_t size);
     int32_t read(uint8_t *data, size_t size);
+    int32_t read(Writer *writer, size_t size);
+    bool retain(uint8_t const *buffer);
+    void release(uint8_t const *buffer);
     int32_t read(pb_msgdesc_t const *fields, void *record, Pool &pool);
     int32_t read_delimited_size(uint32_t *size, Pool &pool);
     int32_t peek_delimited_size(uint32_t *size, Pool &pool);
@@ -38,4 +38,8 @@ int32_t PhylumFlashMemory::copy_page(uint32_t source, uint32_t destiny, size_t s
     return target_->copy_page(source, destiny, size, temporary.ptr(), temporary.size());
 }
 
+int32_t PhylumFlashMemory::flush() {
+    return target_->flush();
+}
+
 } // namespace fk
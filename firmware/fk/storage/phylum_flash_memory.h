@@ -23,6 +23,9 @@ public:
     int32_t write(uint32_t address, uint8_t const *data, size_t size) override;
     int32_t read(uint32_t address, uint8_t *data, size_t size) override;
     int32_t copy_page(uint32_t source, uint32_t destiny, size_t size) override;
+
+public:
+    int32_t flush();
 };
 
 } // namespace fk
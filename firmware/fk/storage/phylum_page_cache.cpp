@@ -0,0 +1,95 @@
+#include "storage/phylum_page_cache.h"
+#include "memory.h"
+
+namespace fk {
+
+FK_DECLARE_LOGGER("phylum");
+
+PhylumPageCache::PhylumPageCache(Pool *pool, bool enabled) : pool_(pool), enabled_(enabled) {
+}
+
+PhylumPageCache::~PhylumPageCache() {
+#if FK_PHYLUM_PAGE_CACHE != FK_PHYLUM_PAGE_CACHE_NONE
+    if (cache_ != nullptr) {
+        cache_->~phylum_page_cache_type();
+        cache_ = nullptr;
+    }
+#endif
+
+    if (page_ != nullptr) {
+        fk_standard_page_free(page_);
+        page_ = nullptr;
+    }
+}
+
+void PhylumPageCache::begin() {
+    // Mounting again keeps whatever we were given the first time, dhara
+    // clears us when it begins.
+    if (page_ != nullptr || !enabled_) {
+        return;
+    }
+
+#if FK_PHYLUM_PAGE_CACHE != FK_PHYLUM_PAGE_CACHE_NONE
+    auto meminfo = fk_standard_page_meminfo();
+    if (meminfo.free <= PhylumPageCacheReservedPages) {
+        logwarn("page-cache: no spare pages (%zu free)", meminfo.free);
+        return;
+    }
+
+    page_ = fk_standard_page_malloc(StandardPageSize, "page-cache");
+    if (page_ == nullptr) {
+        return;
+    }
+
+    cache_ = new (*pool_) phylum_page_cache_type(phylum::simple_buffer{ (uint8_t *)page_, StandardPageSize });
+    statistics_.entries = cache_->size();
+
+    logdebug("page-cache: %zu entries (%zu free pages)", statistics_.entries, meminfo.free - 1);
+#endif
+}
+
+bool PhylumPageCache::get(dhara_sector_t sector, dhara_page_t *page) {
+#if FK_PHYLUM_PAGE_CACHE != FK_PHYLUM_PAGE_CACHE_NONE
+    if (cache_ != nullptr && cache_->get(sector, page)) {
+        statistics_.hits++;
+        return true;
+    }
+#endif
+    statistics_.misses++;
+    return false;
+}
+
+bool PhylumPageCache::set(dhara_sector_t sector, dhara_page_t page) {
+#if FK_PHYLUM_PAGE_CACHE != FK_PHYLUM_PAGE_CACHE_NONE
+    if (cache_ != nullptr) {
+        return cache_->set(sector, page);
+    }
+#endif
+    return true;
+}
+
+void PhylumPageCache::invalidate(dhara_sector_t sector) {
+#if FK_PHYLUM_PAGE_CACHE != FK_PHYLUM_PAGE_CACHE_NONE
+    if (cache_ != nullptr) {
+        cache_->invalidate(sector);
+    }
+#endif
+}
+
+void PhylumPageCache::relocate(dhara_page_t src, dhara_page_t dst) {
+#if FK_PHYLUM_PAGE_CACHE != FK_PHYLUM_PAGE_CACHE_NONE
+    if (cache_ != nullptr) {
+        cache_->relocate(src, dst);
+    }
+#endif
+}
+
+void PhylumPageCache::clear() {
+#if FK_PHYLUM_PAGE_CACHE != FK_PHYLUM_PAGE_CACHE_NONE
+    if (cache_ != nullptr) {
+        cache_->clear();
+    }
+#endif
+}
+
+} // namespace fk
@@ -0,0 +1,64 @@
+#pragma once
+
+#undef constrain
+
+#include <phylum_fs.h>
+
+#include "common.h"
+#include "config.h"
+#include "pool.h"
+
+namespace fk {
+
+#if FK_PHYLUM_PAGE_CACHE == FK_PHYLUM_PAGE_CACHE_SIMPLE
+using phylum_page_cache_type = phylum::simple_page_cache;
+#elif FK_PHYLUM_PAGE_CACHE == FK_PHYLUM_PAGE_CACHE_CLOCK
+using phylum_page_cache_type = phylum::clock_page_cache;
+#endif
+
+struct PhylumPageCacheStatistics {
+    uint32_t hits{ 0 };
+    uint32_t misses{ 0 };
+    size_t entries{ 0 };
+};
+
+/**
+ * Page cache handed to dhara, backed by whichever of phylum's caches the
+ * build selects. Because how much memory is spare isn't known until we
+ * mount, this starts out caching nothing until begin(), which takes a
+ * standard page for as long as this is around if there's one to spare.
+ */
+class PhylumPageCache : public phylum::sector_page_cache {
+private:
+    Pool *pool_{ nullptr };
+    bool enabled_{ true };
+#if FK_PHYLUM_PAGE_CACHE != FK_PHYLUM_PAGE_CACHE_NONE
+    phylum_page_cache_type *cache_{ nullptr };
+#endif
+    void *page_{ nullptr };
+    PhylumPageCacheStatistics statistics_;
+
+public:
+    PhylumPageCache(Pool *pool, bool enabled);
+    virtual ~PhylumPageCache();
+
+public:
+    /**
+     * Sizes the cache from the standard pages that are free right now,
+     * keeping PhylumPageCacheReservedPages of them for everybody else.
+     */
+    void begin();
+
+    PhylumPageCacheStatistics const &statistics() const {
+        return statistics_;
+    }
+
+public:
+    bool get(dhara_sector_t sector, dhara_page_t *page) override;
+    bool set(dhara_sector_t sector, dhara_page_t page) override;
+    void invalidate(dhara_sector_t sector) override;
+    void relocate(dhara_page_t src, dhara_page_t dst) override;
+    void clear() override;
+};
+
+} // namespace fk
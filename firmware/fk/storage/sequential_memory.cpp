@@ -74,30 +74,233 @@ int32_t SequentialMemory::flush() {
     return target_->flush();
 }
 
-BufferedPageMemory::BufferedPageMemory(DataMemory *target, Pool &pool) : target_(target), pool_(&pool) {
+BufferedPageMemory::BufferedPageMemory(DataMemory *target, Pool &pool, size_t npages, MemoryStatistics *statistics)
+    : target_(target), pool_(&pool), statistics_(statistics), npages_(npages) {
+    FK_ASSERT(npages > 0 && npages < INT8_MAX);
 }
 
-BufferedPageMemory::BufferedPageMemory(BufferedPageMemory &&o) : target_(o.target_), buffer_{ exchange(o.buffer_, nullptr) } {
+BufferedPageMemory::BufferedPageMemory(BufferedPageMemory &&o)
+    : target_(o.target_), pool_(o.pool_), statistics_(o.statistics_), npages_(o.npages_), pages_{ exchange(o.pages_, nullptr) },
+      buckets_{ exchange(o.buckets_, nullptr) }, buffers_{ exchange(o.buffers_, nullptr) }, clock_(o.clock_) {
 }
 
 BufferedPageMemory::~BufferedPageMemory() {
-}
-
-uint8_t *BufferedPageMemory::buffer() {
-    if (buffer_ == nullptr) {
-        buffer_ = reinterpret_cast<uint8_t *>(pool_->malloc(target_->geometry().page_size));
+    if (buffers_ != nullptr) {
+        fk_standard_page_free(buffers_);
+        buffers_ = nullptr;
     }
-    return buffer_;
 }
 
 BufferedPageMemory &BufferedPageMemory::operator=(BufferedPageMemory &&o) {
+    if (buffers_ != nullptr) {
+        fk_standard_page_free(buffers_);
+    }
     target_ = o.target_;
-    buffer_ = exchange(o.buffer_, nullptr);
-    cached_ = o.cached_;
-    dirty_ = o.dirty_;
+    pool_ = o.pool_;
+    statistics_ = o.statistics_;
+    npages_ = o.npages_;
+    pages_ = exchange(o.pages_, nullptr);
+    buckets_ = exchange(o.buckets_, nullptr);
+    buffers_ = exchange(o.buffers_, nullptr);
+    clock_ = o.clock_;
     return *this;
 }
 
+size_t BufferedPageMemory::page_size() const {
+    return target_->geometry().real_page_size;
+}
+
+size_t BufferedPageMemory::number_of_buckets() const {
+    return npages_ * 2;
+}
+
+BufferedPageMemory::CachedPage *BufferedPageMemory::pages() {
+    if (pages_ == nullptr) {
+        // Never more pages than fit in the standard page holding them.
+        auto size = page_size();
+        FK_ASSERT(size <= StandardPageSize);
+        npages_ = std::min<size_t>(npages_, StandardPageSize / size);
+
+        pages_ = reinterpret_cast<CachedPage *>(pool_->malloc(sizeof(CachedPage) * npages_));
+        for (auto i = 0u; i < npages_; ++i) {
+            new (&pages_[i]) CachedPage();
+        }
+        buckets_ = reinterpret_cast<int8_t *>(pool_->malloc(number_of_buckets()));
+        memset(buckets_, -1, number_of_buckets());
+    }
+    if (buffers_ == nullptr) {
+        auto size = page_size();
+        buffers_ = reinterpret_cast<uint8_t *>(fk_standard_page_malloc(StandardPageSize, "page-cache"));
+        for (auto i = 0u; i < npages_; ++i) {
+            pages_[i].buffer = buffers_ + i * size;
+        }
+    }
+    return pages_;
+}
+
+void BufferedPageMemory::release() {
+    if (buffers_ == nullptr) {
+        return;
+    }
+
+    for (auto i = 0u; i < npages_; ++i) {
+        unindex(i);
+        pages_[i].buffer = nullptr;
+    }
+
+    fk_standard_page_free(buffers_);
+    buffers_ = nullptr;
+}
+
+int32_t BufferedPageMemory::find(uint32_t page) {
+    if (buffers_ == nullptr) {
+        return -1;
+    }
+
+    for (auto i = buckets_[page % number_of_buckets()]; i >= 0; i = pages_[i].chain) {
+        if (pages_[i].page == page) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void BufferedPageMemory::index(int32_t i) {
+    auto &bucket = buckets_[pages_[i].page % number_of_buckets()];
+    pages_[i].chain = bucket;
+    bucket = i;
+}
+
+void BufferedPageMemory::unindex(int32_t i) {
+    auto &p = pages_[i];
+    if (p.page == UINT32_MAX) {
+        return;
+    }
+
+    auto link = &buckets_[p.page % number_of_buckets()];
+    while (*link >= 0) {
+        if (*link == i) {
+            *link = p.chain;
+            break;
+        }
+        link = &pages_[*link].chain;
+    }
+
+    p.page = UINT32_MAX;
+    p.chain = -1;
+    p.dirty_start = -1;
+    p.dirty_end = -1;
+}
+
+int32_t BufferedPageMemory::load(uint32_t page, bool overwrite, MemoryReadFlags flags) {
+    auto pages = this->pages();
+
+    auto i = find(page);
+    if (i >= 0) {
+        if (statistics_ != nullptr) {
+            statistics_->cache_hits++;
+        }
+        pages[i].used = ++clock_;
+        return i;
+    }
+
+    if (statistics_ != nullptr) {
+        statistics_->cache_misses++;
+    }
+
+    // Prefer free pages, then the least recently used clean page.
+    int32_t selected = -1;
+    for (auto j = 0u; j < npages_; ++j) {
+        auto &p = pages[j];
+        if (p.page == UINT32_MAX) {
+            selected = j;
+            break;
+        }
+        if (!p.dirty() && (selected < 0 || p.used < pages[selected].used)) {
+            selected = j;
+        }
+    }
+
+    // Everything is dirty, so write them all back in order and then take
+    // the least recently used one.
+    if (selected < 0) {
+        auto err = flush_dirty();
+        if (err < 0) {
+            return err;
+        }
+
+        for (auto j = 0u; j < npages_; ++j) {
+            if (selected < 0 || pages[j].used < pages[selected].used) {
+                selected = j;
+            }
+        }
+    }
+
+    FK_ASSERT(selected >= 0);
+
+    unindex(selected);
+
+    auto &p = pages[selected];
+    if (!overwrite) {
+        auto rv = target_->read(page * page_size(), p.buffer, page_size(), flags);
+        if (rv <= 0) {
+            return -1;
+        }
+    }
+
+    p.page = page;
+    p.used = ++clock_;
+    index(selected);
+
+    return selected;
+}
+
+int32_t BufferedPageMemory::flush_page(CachedPage &p) {
+    FK_ASSERT(p.dirty());
+
+    auto address = p.page * page_size();
+
+    logdebug("[" PRADDRESS "] flush dirty page (0x%4x - 0x%4x)", address, p.dirty_start, p.dirty_end);
+
+    auto rv = target_->write(address + p.dirty_start, p.buffer + p.dirty_start, p.dirty_end - p.dirty_start, MemoryWriteFlags::None);
+
+    p.dirty_start = -1;
+    p.dirty_end = -1;
+
+    if (rv <= 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int32_t BufferedPageMemory::flush_dirty() {
+    if (buffers_ == nullptr) {
+        return 0;
+    }
+
+    while (true) {
+        CachedPage *lowest = nullptr;
+        for (auto i = 0u; i < npages_; ++i) {
+            auto &p = pages_[i];
+            if (p.dirty() && (lowest == nullptr || p.page < lowest->page)) {
+                lowest = &p;
+            }
+        }
+
+        if (lowest == nullptr) {
+            break;
+        }
+
+        auto err = flush_page(*lowest);
+        if (err < 0) {
+            return err;
+        }
+    }
+
+    return 0;
+}
+
 bool BufferedPageMemory::begin() {
     return target_->begin();
 }
@@ -107,86 +310,120 @@ FlashGeometry BufferedPageMemory::geometry() const {
 }
 
 int32_t BufferedPageMemory::read(uint32_t address, uint8_t *data, size_t length, MemoryReadFlags flags) {
-    auto g = target_->geometry();
-    auto page = address / g.page_size;
-    if (cached_ == UINT32_MAX || page != cached_) {
-        auto rv = target_->read(page * g.page_size, buffer(), g.page_size, flags);
-        if (rv <= 0) {
-            return rv;
+    auto size = page_size();
+    auto remaining = length;
+
+    while (remaining > 0) {
+        auto page_offset = address % size;
+        auto reading = std::min<size_t>(remaining, size - page_offset);
+
+        // Reads only go through the cache while we're holding it for
+        // writes, otherwise they're passed straight through.
+        if (buffers_ == nullptr) {
+            if (statistics_ != nullptr) {
+                statistics_->cache_misses++;
+            }
+
+            auto rv = target_->read(address, data, reading, flags);
+            if (rv <= 0) {
+                return -1;
+            }
+        } else {
+            auto i = load(address / size, false, flags);
+            if (i < 0) {
+                return i;
+            }
+
+            memcpy(data, pages_[i].buffer + page_offset, reading);
         }
-        cached_ = page;
-        dirty_start_ = -1;
-        dirty_end_ = -1;
+
+        address += reading;
+        data += reading;
+        remaining -= reading;
     }
-    auto page_offset = address % g.page_size;
-    memcpy(data, buffer() + page_offset, length);
+
     return length;
 }
 
 int32_t BufferedPageMemory::write(uint32_t address, uint8_t const *data, size_t length, MemoryWriteFlags flags) {
-    auto g = target_->geometry();
-    auto page = address / g.page_size;
-    if (cached_ == UINT32_MAX || page != cached_) {
-        if (dirty_) {
-            auto rv = flush();
-            if (rv <= 0) {
-                return rv;
-            }
-        }
+    auto size = page_size();
+    auto remaining = length;
 
-        auto rv = target_->read(page * g.page_size, buffer(), g.page_size, MemoryReadFlags::None);
-        if (rv <= 0) {
-            return rv;
-        }
+    while (remaining > 0) {
+        auto page_offset = address % size;
+        auto writing = std::min<size_t>(remaining, size - page_offset);
 
-        cached_ = page;
-    }
+        // No need to read pages we're about to replace entirely.
+        auto i = load(address / size, writing == size, MemoryReadFlags::None);
+        if (i < 0) {
+            return i;
+        }
 
-    auto page_offset = address % g.page_size;
-    memcpy(buffer() + page_offset, data, length);
-    dirty_ = true;
+        auto &p = pages_[i];
+        memcpy(p.buffer + page_offset, data, writing);
+
+        auto start = (int16_t)page_offset;
+        auto end = (int16_t)(page_offset + writing);
+        if (!p.dirty()) {
+            p.dirty_start = start;
+            p.dirty_end = end;
+        } else {
+            p.dirty_start = std::min(p.dirty_start, start);
+            p.dirty_end = std::max(p.dirty_end, end);
+        }
 
-    if (dirty_start_ == -1) {
-        dirty_start_ = page_offset;
-    } else {
-        FK_ASSERT((int16_t)page_offset >= dirty_end_);
+        address += writing;
+        data += writing;
+        remaining -= writing;
     }
-    dirty_end_ = page_offset + length;
 
     return length;
 }
 
 int32_t BufferedPageMemory::erase(uint32_t address, size_t length) {
-    if (cached_ != UINT32_MAX) {
-        auto g = target_->geometry();
-        auto cached_address = cached_ * g.page_size;
-        if (cached_address >= address && cached_address < address + length) {
-            cached_ = UINT32_MAX;
-            dirty_start_ = -1;
-            dirty_end_ = -1;
-            dirty_ = false;
+    if (buffers_ != nullptr) {
+        auto size = page_size();
+        for (auto i = 0u; i < npages_; ++i) {
+            auto &p = pages_[i];
+            if (p.page != UINT32_MAX) {
+                auto page_address = p.page * size;
+                if (page_address >= address && page_address < address + length) {
+                    unindex(i);
+                }
+            }
         }
     }
     return target_->erase(address, length);
 }
 
-int32_t BufferedPageMemory::flush() {
-    if (cached_ != UINT32_MAX && dirty_) {
-        auto g = target_->geometry();
-        auto address = cached_ * g.page_size;
+int32_t BufferedPageMemory::copy_page(uint32_t source, uint32_t destiny, size_t page_size, uint8_t *buffer, size_t buffer_size) {
+    // The copy happens below us, so the source needs to be on the chip and
+    // anything we have for the destination is stale.
+    auto err = flush_dirty();
+    if (err < 0) {
+        return err;
+    }
 
-        logdebug("[" PRADDRESS "] flush dirty page (0x%4x - 0x%4x)", address, dirty_start_, dirty_end_);
+    auto i = find(destiny / this->page_size());
+    if (i >= 0) {
+        unindex(i);
+    }
 
-        auto rv = target_->write(address, buffer(), g.page_size);
-        cached_ = UINT32_MAX;
-        dirty_start_ = -1;
-        dirty_end_ = -1;
-        dirty_ = false;
-        if (rv <= 0) {
-            return rv;
-        }
+    return target_->copy_page(source, destiny, page_size, buffer, buffer_size);
+}
+
+int32_t BufferedPageMemory::flush() {
+    if (flush_dirty() < 0) {
+        return -1;
     }
+
+    release();
+
     return target_->flush();
 }
 
+void BufferedPageMemory::discard() {
+    release();
+}
+
 } // namespace fk
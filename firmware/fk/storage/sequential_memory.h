@@ -7,6 +7,7 @@
 #include "pool.h"
 #include "memory.h"
 #include "hal/memory.h"
+#include "storage/statistics_memory.h"
 
 namespace fk {
 
@@ -103,24 +104,54 @@ public:
     }
 };
 
+/**
+ * Write-back cache of whole flash pages. Pages are found by hashing their
+ * number, writes to a page are coalesced into a single dirty range and
+ * dirty pages are always written back in address order. Page buffers are
+ * carved from one standard page that's taken on the first write and handed
+ * back once we're flushed, reads in between are served from it too.
+ */
 class BufferedPageMemory : public DataMemory {
 private:
+    struct CachedPage {
+        uint32_t page{ UINT32_MAX };
+        uint8_t *buffer{ nullptr };
+        uint32_t used{ 0 };
+        int16_t dirty_start{ -1 };
+        int16_t dirty_end{ -1 };
+        int8_t chain{ -1 };
+
+        bool dirty() const {
+            return dirty_start >= 0;
+        }
+    };
+
     DataMemory *target_{ nullptr };
     Pool *pool_{ nullptr };
-    uint8_t *buffer_{ nullptr };
-    uint32_t cached_{ UINT32_MAX };
-    bool dirty_{ false };
-    int16_t dirty_start_{ -1 };
-    int16_t dirty_end_{ -1 };
+    MemoryStatistics *statistics_{ nullptr };
+    size_t npages_{ 0 };
+    CachedPage *pages_{ nullptr };
+    int8_t *buckets_{ nullptr };
+    uint8_t *buffers_{ nullptr };
+    uint32_t clock_{ 0 };
 
 public:
-    BufferedPageMemory(DataMemory *target, Pool &pool);
+    BufferedPageMemory(DataMemory *target, Pool &pool, size_t npages = 1, MemoryStatistics *statistics = nullptr);
     BufferedPageMemory(BufferedPageMemory &&o);
     BufferedPageMemory(BufferedPageMemory const &o) = delete;
     virtual ~BufferedPageMemory();
 
 private:
-    uint8_t *buffer();
+    size_t page_size() const;
+    size_t number_of_buckets() const;
+    CachedPage *pages();
+    void release();
+    int32_t find(uint32_t page);
+    void index(int32_t i);
+    void unindex(int32_t i);
+    int32_t load(uint32_t page, bool overwrite, MemoryReadFlags flags);
+    int32_t flush_page(CachedPage &p);
+    int32_t flush_dirty();
 
 public:
     BufferedPageMemory &operator=(BufferedPageMemory const &o) = delete;
@@ -132,7 +163,14 @@ public:
     int32_t read(uint32_t address, uint8_t *data, size_t length, MemoryReadFlags flags) override;
     int32_t write(uint32_t address, uint8_t const *data, size_t length, MemoryWriteFlags flags) override;
     int32_t erase(uint32_t address, size_t length) override;
-    int32_t flush();
+    int32_t copy_page(uint32_t source, uint32_t destiny, size_t page_size, uint8_t *buffer, size_t buffer_size) override;
+    int32_t flush() override;
+
+    /**
+     * Forget every cached page, dirty or not, without writing anything.
+     * For when what's underneath changed without us, like a wipe.
+     */
+    void discard();
 
 public:
     using DataMemory::read;
@@ -8,13 +8,19 @@ void MemoryStatistics::add(MemoryStatistics s) {
     nreads += s.nreads;
     nwrites += s.nwrites;
     nerases += s.nerases;
+    ncopies += s.ncopies;
     bytes_read += s.bytes_read;
     bytes_wrote += s.bytes_wrote;
+    cache_hits += s.cache_hits;
+    cache_misses += s.cache_misses;
+    nmounts += s.nmounts;
+    mount_time += s.mount_time;
 }
 
 void MemoryStatistics::log(const char *prefix) const {
-    loginfo("%s%" PRIu32 " reads (%" PRIu32 " bytes), %" PRIu32 " writes, (%" PRIu32 " bytes) %" PRIu32 " erases, %" PRIu32 " copies",
-            prefix, nreads, bytes_read, nwrites, bytes_wrote, nerases, ncopies);
+    loginfo("%s%" PRIu32 " reads (%" PRIu32 " bytes), %" PRIu32 " writes, (%" PRIu32 " bytes) %" PRIu32 " erases, %" PRIu32
+            " copies, %" PRIu32 " cache hits, %" PRIu32 " cache misses, %" PRIu32 " mounts (%" PRIu32 "ms)",
+            prefix, nreads, bytes_read, nwrites, bytes_wrote, nerases, ncopies, cache_hits, cache_misses, nmounts, mount_time);
 }
 
 bool StatisticsMemory::begin() {
@@ -11,6 +11,10 @@ typedef struct MemoryStatistics {
     uint32_t ncopies{ 0 };
     uint32_t bytes_read{ 0 };
     uint32_t bytes_wrote{ 0 };
+    uint32_t cache_hits{ 0 };
+    uint32_t cache_misses{ 0 };
+    uint32_t nmounts{ 0 };
+    uint32_t mount_time{ 0 };
 
     void add_read(uint32_t bytes) {
         nreads++;
@@ -22,6 +26,11 @@ typedef struct MemoryStatistics {
         bytes_wrote += bytes;
     }
 
+    void add_mount(uint32_t elapsed) {
+        nmounts++;
+        mount_time += elapsed;
+    }
+
     void add(MemoryStatistics s);
 
     void log(const char *prefix) const;
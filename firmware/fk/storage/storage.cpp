@@ -9,19 +9,21 @@
 #include "utilities.h"
 
 #include "storage/file_ops_phylum.h"
+#include "storage/storage_session.h"
 
 namespace fk {
 
 FK_DECLARE_LOGGER("storage");
 
 Storage::Storage(DataMemory *memory, Pool &pool, bool read_only)
-    : data_memory_(memory), pool_(&pool), memory_(memory, pool),
-      statistics_data_memory_(data_memory_), phylum_{ &statistics_data_memory_, pool }, read_only_(read_only) {
+    : data_memory_(memory), pool_(&pool), statistics_data_memory_(data_memory_),
+      memory_(&statistics_data_memory_, pool, StorageCachePages, &statistics_data_memory_.statistics()), phylum_{ &memory_, pool },
+      read_only_(read_only) {
     FK_ASSERT(memory != nullptr);
 }
 
 Storage::~Storage() {
-    if (!memory_.flush()) {
+    if (memory_.flush() < 0) {
         logerror("flush failed");
     }
 }
@@ -31,7 +33,11 @@ bool Storage::begin() {
         return false;
     }
 
+    get_storage_session()->mounting(this);
+
+    auto started = fk_uptime();
     if (phylum_.mount()) {
+        statistics().add_mount(fk_uptime() - started);
         data_ops_ = new (pool_) phylum_ops::DataOps(*this);
         meta_ops_ = new (pool_) phylum_ops::MetaOps(*this);
         bytes_used_ = phylum_.bytes_used();
@@ -46,10 +52,13 @@ bool Storage::begin() {
 bool Storage::clear() {
     loginfo("storage: clearing");
 
+    get_storage_session()->mounting(this);
+
     for (auto block = 0u; block < data_memory_->geometry().nblocks; ++block) {
         auto block_size = data_memory_->geometry().block_size;
         auto address = block * block_size;
-        if (data_memory_->erase(address, block_size) < 0) {
+        // Through the page cache, so nothing cached before the erase survives it.
+        if (memory_.erase(address, block_size) < 0) {
             logerror("erasing block=%" PRIu32, block);
         }
     }
@@ -108,9 +117,17 @@ bool Storage::flush() {
         return false;
     }
 
+    if (memory_.flush() < 0) {
+        return false;
+    }
+
     statistics_data_memory_.log_statistics("flash usage: ");
 
     return true;
 }
 
+void Storage::discard() {
+    memory_.discard();
+}
+
 } // namespace fk
@@ -27,8 +27,8 @@ public:
 private:
     DataMemory *data_memory_;
     Pool *pool_;
-    SequentialWrapper<BufferedPageMemory> memory_;
     StatisticsMemory statistics_data_memory_;
+    BufferedPageMemory memory_;
     Phylum phylum_;
     bool read_only_;
     MetaOps *meta_ops_{ nullptr };
@@ -44,6 +44,10 @@ public:
         return phylum_;
     }
 
+    MemoryStatistics &statistics() {
+        return statistics_data_memory_.statistics();
+    }
+
     DataOps *data_ops();
 
     MetaOps *meta_ops();
@@ -58,6 +62,7 @@ public:
     bool begin();
     bool clear();
     bool flush();
+    void discard();
 
 public:
     FlashGeometry geometry() const {
@@ -0,0 +1,173 @@
+#include "storage/storage_session.h"
+#include "hal/hal.h"
+#include "memory.h"
+#include "platform.h"
+
+namespace fk {
+
+FK_DECLARE_LOGGER("storage");
+
+static StorageSession storage_session;
+
+StorageSession *get_storage_session() {
+    return &storage_session;
+}
+
+static bool storage_session_reclaim() {
+    return storage_session.reclaim();
+}
+
+Storage *StorageSession::borrow(Lock &lock, DataMemory *memory) {
+    FK_ASSERT(lock);
+    FK_ASSERT(!borrowed_);
+
+    if (storage_ != nullptr && memory_ != memory) {
+        unmount();
+    }
+
+    if (storage_ == nullptr) {
+        if (!mount(memory)) {
+            return nullptr;
+        }
+    } else {
+        logdebug("storage: reusing mounted");
+    }
+
+    borrowed_ = true;
+
+    return storage_;
+}
+
+void StorageSession::release(Storage *storage) {
+    FK_ASSERT(borrowed_ && storage == storage_);
+
+    // Storage was cleared or mounted underneath us, so whatever we have
+    // cached is for what used to be on the flash.
+    if (!stale_ && !storage_->flush()) {
+        logerror("flush failed");
+        stale_ = true;
+    }
+
+    // Statistics are per borrower, so each worker logs what they did.
+    statistics_.add(storage_->statistics());
+    storage_->statistics() = {};
+
+    // Only now, flushing can allocate and that mustn't reclaim us.
+    borrowed_ = false;
+
+    if (stale_) {
+        unmount();
+        return;
+    }
+
+    if (fk_standard_page_meminfo().free < StorageSessionReservedPages) {
+        loginfo("storage: unmounting, low on pages");
+        unmount();
+    }
+}
+
+bool StorageSession::reclaim() {
+    // Checked without the lock first, this runs whenever standard pages
+    // run out.
+    if (storage_ == nullptr || borrowed_) {
+        return false;
+    }
+
+    auto lock = storage_mutex.acquire(0);
+    if (!lock || storage_ == nullptr || borrowed_) {
+        return false;
+    }
+
+    loginfo("storage: unmounting, out of pages");
+
+    unmount();
+
+    return true;
+}
+
+void StorageSession::invalidate() {
+    if (storage_ == nullptr) {
+        return;
+    }
+
+    // Whoever has this borrowed is still using it, so leave that to them.
+    if (borrowed_) {
+        stale_ = true;
+        return;
+    }
+
+    unmount();
+}
+
+void StorageSession::mounting(Storage *storage) {
+    if (storage != storage_) {
+        invalidate();
+    }
+}
+
+MemoryStatistics StorageSession::statistics() const {
+    auto statistics = statistics_;
+    if (storage_ != nullptr) {
+        statistics.add(storage_->statistics());
+    }
+    return statistics;
+}
+
+bool StorageSession::mount(DataMemory *memory) {
+    FK_ASSERT(storage_ == nullptr);
+
+    pool_ = create_standard_pool_inside("storage");
+    memory_ = memory;
+    stale_ = false;
+
+    // Not ours until it's mounted, so a page allocation along the way
+    // can't reclaim it out from under us.
+    auto storage = new (pool_) Storage(memory, *pool_, false);
+    auto mounted = storage->begin();
+    storage_ = storage;
+
+    if (!mounted) {
+        statistics_.add(storage_->statistics());
+        unmount();
+        return false;
+    }
+
+    fk_standard_page_configure_reclaim(storage_session_reclaim);
+
+    loginfo("storage: mounted (%" PRIu32 " mounts, %" PRIu32 "ms)", statistics().nmounts, statistics().mount_time);
+
+    return true;
+}
+
+void StorageSession::unmount() {
+    FK_ASSERT(!borrowed_);
+
+    if (storage_ != nullptr) {
+        // Destroying flushes, which would write stale pages over whatever
+        // replaced them.
+        if (stale_) {
+            storage_->discard();
+        }
+        storage_->~Storage();
+        storage_ = nullptr;
+    }
+
+    if (pool_ != nullptr) {
+        delete pool_;
+        pool_ = nullptr;
+    }
+
+    memory_ = nullptr;
+    stale_ = false;
+}
+
+BorrowedStorage::BorrowedStorage(Lock &lock, DataMemory *memory) : storage_(get_storage_session()->borrow(lock, memory)) {
+}
+
+BorrowedStorage::~BorrowedStorage() {
+    if (storage_ != nullptr) {
+        get_storage_session()->release(storage_);
+    }
+}
+
+} // namespace fk
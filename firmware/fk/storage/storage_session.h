@@ -0,0 +1,102 @@
+#pragma once
+
+#include "hal/memory.h"
+#include "hal/mutex.h"
+#include "storage/storage.h"
+
+namespace fk {
+
+/**
+ * Keeps storage mounted between workers, along with phylum's working
+ * buffers and the dhara map, so that each of them isn't mounting the file
+ * system all over again. Storage is borrowed while holding storage_mutex
+ * and thrown away whenever it's cleared or mounted by anybody else.
+ */
+class StorageSession {
+private:
+    Pool *pool_{ nullptr };
+    DataMemory *memory_{ nullptr };
+    Storage *storage_{ nullptr };
+    MemoryStatistics statistics_;
+    bool borrowed_{ false };
+    bool stale_{ false };
+
+public:
+    /**
+     * Returns storage mounted on the given memory, mounting it if we
+     * haven't already. Returns nullptr if storage couldn't be mounted.
+     */
+    Storage *borrow(Lock &lock, DataMemory *memory);
+
+    /**
+     * Flushes anything cached and hands storage back, still mounted unless
+     * standard pages are running low.
+     */
+    void release(Storage *storage);
+
+    /**
+     * Forgets mounted storage, the next borrower mounts again.
+     */
+    void invalidate();
+
+    /**
+     * Unmounts, giving back the pages mounted storage keeps, if nobody has
+     * it borrowed. Doesn't wait for storage_mutex, so this is safe to call
+     * from any task, and once mounted this is how running out of standard
+     * pages gets them.
+     */
+    bool reclaim();
+
+    /**
+     * Called by any Storage about to mount or clear, anything other than
+     * our own means what we have mounted may no longer be what's on the
+     * flash. Callers must hold storage_mutex.
+     */
+    void mounting(Storage *storage);
+
+    /**
+     * Statistics since startup, including mounts.
+     */
+    MemoryStatistics statistics() const;
+
+    bool mounted() const {
+        return storage_ != nullptr;
+    }
+
+private:
+    bool mount(DataMemory *memory);
+    void unmount();
+};
+
+StorageSession *get_storage_session();
+
+/**
+ * Borrows the StorageSession's storage for the lifetime of this object,
+ * storage_mutex should be held for at least as long.
+ */
+class BorrowedStorage {
+private:
+    Storage *storage_{ nullptr };
+
+public:
+    explicit BorrowedStorage(Lock &lock, DataMemory *memory = MemoryFactory::get_data_memory());
+    virtual ~BorrowedStorage();
+
+    BorrowedStorage(BorrowedStorage const &) = delete;
+    BorrowedStorage &operator=(BorrowedStorage const &) = delete;
+
+public:
+    explicit operator bool() const {
+        return storage_ != nullptr;
+    }
+
+    Storage &operator*() {
+        return *storage_;
+    }
+
+    Storage *operator->() {
+        return storage_;
+    }
+};
+
+} // namespace fk
@@ -1,6 +1,7 @@
 #include "hal/clock.h"
 #include "config.h"
 #include "memory.h"
+#include "logging.h"
 #include "status_logging.h"
 #include "tasks/tasks.h"
 
@@ -63,6 +64,8 @@ void task_handler_idle() {
     static uint32_t counter = 0u;
     static uint32_t status_at = FiveSecondsMs;
 
+    fk_logs_drain();
+
     auto now = fk_uptime();
 
     if (now > status_at) {
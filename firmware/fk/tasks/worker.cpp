@@ -9,16 +9,22 @@ FK_DECLARE_LOGGER("task");
 void task_handler_worker(void *params) {
     FK_ASSERT(params != nullptr);
 
-    auto started = fk_uptime();
     auto worker = reinterpret_cast<TaskWorker *>(params);
 
-    worker->run();
+    // Keep running queued workers until there aren't any left for us.
+    while (worker != nullptr) {
+        auto started = fk_uptime();
 
-    get_ipc()->remove_worker(worker);
+        worker->run();
 
-    delete worker;
+        auto next = get_ipc()->next_worker(worker);
 
-    loginfo("done elapsed: %" PRIu32 "ms", fk_uptime() - started);
+        delete worker;
+
+        loginfo("done elapsed: %" PRIu32 "ms", fk_uptime() - started);
+
+        worker = next;
+    }
 }
 
 } // namespace fk
@@ -25,7 +25,7 @@ int32_t UpdateReadingsListener::flush() {
             entry.sensor->reading(entry.reading);
         }
 
-        queue_ = collection<sensor_reading_t>{ pool_ };
+        queue_ = Queue{ pool_ };
 
         return 0;
     });
@@ -13,8 +13,14 @@ private:
         SensorReading reading;
     };
 
+    /**
+     * Every sensor on the station passes through here, chunks keep that
+     * to a handful of allocations.
+     */
+    using Queue = collection<sensor_reading_t, 8>;
+
     Pool &pool_;
-    collection<sensor_reading_t> queue_{ pool_ };
+    Queue queue_{ pool_ };
 
 public:
     UpdateReadingsListener(Pool &pool);
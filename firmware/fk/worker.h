@@ -13,6 +13,12 @@ struct TaskDisplayInfo {
     const char *name;
     float progress;
     bool visible;
+    /**
+     * True for workers waiting for a free worker task, waiting is how
+     * long they've been in the queue.
+     */
+    bool queued;
+    uint32_t waiting;
 };
 
 class TaskWorker {
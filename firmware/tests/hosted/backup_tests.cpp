@@ -0,0 +1,235 @@
+#include "tests.h"
+#include "common.h"
+#include "hal/linux/linux.h"
+#include "hal/linux/linux_sd_card.h"
+#include "storage/backup_worker.h"
+#include "storage_suite.h"
+
+using namespace fk;
+
+FK_DECLARE_LOGGER("tests");
+
+class BackupSuite : public StorageSuite {
+protected:
+    LinuxSdCard *sd_{ nullptr };
+
+protected:
+    void SetUp() override {
+        StorageSuite::SetUp();
+
+        sd_ = reinterpret_cast<LinuxSdCard *>(get_sd_card());
+        sd_->clear();
+
+        factory_wipe();
+    }
+
+    void TearDown() override {
+        sd_->clear();
+
+        StorageSuite::TearDown();
+    }
+
+protected:
+    void write_records(Storage &storage, uint32_t nrecords) {
+        for (auto i = 0u; i < nrecords; ++i) {
+            StandardPool loop{ "loop" };
+            fk_data_DataRecord record = fk_data_DataRecord_init_default;
+            ASSERT_TRUE(storage.data_ops()->write_readings(&record, loop));
+        }
+    }
+
+    uint32_t data_size(Storage &storage) {
+        auto attributes = storage.data_ops()->attributes(pool_);
+        return attributes ? attributes->size : 0;
+    }
+
+    uint32_t data_records(Storage &storage) {
+        auto attributes = storage.data_ops()->attributes(pool_);
+        return attributes ? attributes->records : 0;
+    }
+
+    const char *directory() {
+        auto gs = get_global_state_ro();
+        return pool_.sprintf("/backup-%s", bytes_to_hex_string_pool(gs.get()->general.generation, 8, pool_));
+    }
+
+    const char *path(const char *name) {
+        return pool_.sprintf("%s/%s", directory(), name);
+    }
+
+    const char *segment(uint32_t number) {
+        return pool_.sprintf("%s/data-%06" PRIu32 ".fkpb", directory(), number);
+    }
+
+    BackupState newest_state() {
+        BackupState newest;
+        bzero(&newest, sizeof(BackupState));
+
+        for (auto name : { "state-0", "state-1" }) {
+            auto data = sd_->file(path(name));
+            if (data != nullptr && data->size() == sizeof(BackupState)) {
+                BackupState state;
+                memcpy(&state, data->data(), sizeof(BackupState));
+                if (state.sequence > newest.sequence) {
+                    newest = state;
+                }
+            }
+        }
+
+        return newest;
+    }
+
+    uint32_t segments_size() {
+        auto size = 0u;
+        for (auto i = 0u; sd_->is_file(segment(i)); ++i) {
+            size += sd_->file(segment(i))->size();
+        }
+        return size;
+    }
+};
+
+TEST_F(BackupSuite, CopiesOnlyNewRecords) {
+    Storage storage{ memory_, pool_, false };
+    ASSERT_TRUE(storage.begin());
+
+    write_records(storage, 10);
+
+    BackupWorker first;
+    ASSERT_TRUE(first.backup(storage, pool_));
+
+    ASSERT_TRUE(sd_->is_file(segment(0)));
+    ASSERT_EQ(sd_->file(segment(0))->size(), data_size(storage));
+    ASSERT_EQ(newest_state().next_record, data_records(storage));
+
+    auto sequence = newest_state().sequence;
+
+    write_records(storage, 5);
+
+    BackupWorker second;
+    ASSERT_TRUE(second.backup(storage, pool_));
+
+    ASSERT_EQ(sd_->file(segment(0))->size(), data_size(storage));
+    ASSERT_EQ(newest_state().next_record, data_records(storage));
+    ASSERT_EQ(newest_state().sequence, sequence + 1);
+    ASSERT_FALSE(sd_->is_file(segment(1)));
+
+    BackupWorker third;
+    ASSERT_TRUE(third.backup(storage, pool_));
+    ASSERT_EQ(newest_state().sequence, sequence + 1);
+}
+
+TEST_F(BackupSuite, RollsOverToNewSegments) {
+    Storage storage{ memory_, pool_, false };
+    ASSERT_TRUE(storage.begin());
+
+    write_records(storage, 10);
+
+    // Any size will do, every batch after the first starts a segment.
+    BackupWorker worker{ 1, 4 };
+    ASSERT_TRUE(worker.backup(storage, pool_));
+
+    auto records = data_records(storage);
+    auto segments = (records + 3) / 4;
+
+    for (auto i = 0u; i < segments; ++i) {
+        ASSERT_TRUE(sd_->is_file(segment(i)));
+    }
+    ASSERT_FALSE(sd_->is_file(segment(segments)));
+
+    for (auto i = 0u; i < segments - 1; ++i) {
+        ASSERT_TRUE(sd_->is_file(pool_.sprintf("%s.hash", segment(i))));
+    }
+    ASSERT_FALSE(sd_->is_file(pool_.sprintf("%s.hash", segment(segments - 1))));
+
+    ASSERT_EQ(segments_size(), data_size(storage));
+
+    auto state = newest_state();
+    ASSERT_EQ(state.segment, segments - 1);
+    ASSERT_EQ(state.next_record, records);
+    ASSERT_EQ(state.segment_first_record, (segments - 1) * 4);
+    ASSERT_EQ(state.total_size, data_size(storage));
+}
+
+TEST_F(BackupSuite, FallsBackToOlderStateWhenNewestIsCorrupted) {
+    Storage storage{ memory_, pool_, false };
+    ASSERT_TRUE(storage.begin());
+
+    write_records(storage, 10);
+
+    BackupWorker first{ BackupSegmentSize, 4 };
+    ASSERT_TRUE(first.backup(storage, pool_));
+
+    auto newest = newest_state();
+    auto records = data_records(storage);
+    ASSERT_EQ(newest.next_record, records);
+
+    auto data = sd_->file(path(newest.sequence % 2 == 0 ? "state-0" : "state-1"));
+    ASSERT_NE(data, nullptr);
+    (*data)[offsetof(BackupState, next_record)] ^= 0xff;
+
+    // The older state is one batch behind, so the segment holds more than
+    // it says and is cut back to where that state left off.
+    BackupWorker second{ BackupSegmentSize, 4 };
+    ASSERT_TRUE(second.backup(storage, pool_));
+
+    auto state = newest_state();
+    ASSERT_EQ(state.sequence, newest.sequence);
+    ASSERT_EQ(state.next_record, records);
+    ASSERT_EQ(state.segment, 0u);
+    ASSERT_EQ(memcmp(state.running_hash, newest.running_hash, sizeof(state.running_hash)), 0);
+
+    ASSERT_FALSE(sd_->is_file(pool_.sprintf("%s.hash", segment(0))));
+    ASSERT_FALSE(sd_->is_file(segment(1)));
+    ASSERT_EQ(sd_->file(segment(0))->size(), data_size(storage));
+    ASSERT_EQ(state.segment_size, data_size(storage));
+}
+
+TEST_F(BackupSuite, RestartsShortSegment) {
+    Storage storage{ memory_, pool_, false };
+    ASSERT_TRUE(storage.begin());
+
+    write_records(storage, 10);
+
+    BackupWorker first{ BackupSegmentSize, 4 };
+    ASSERT_TRUE(first.backup(storage, pool_));
+
+    auto newest = newest_state();
+    auto copied = *sd_->file(segment(0));
+
+    // Lose the end of what was saved as written.
+    sd_->file(segment(0))->resize(copied.size() / 2);
+
+    BackupWorker second{ BackupSegmentSize, 4 };
+    ASSERT_TRUE(second.backup(storage, pool_));
+
+    auto state = newest_state();
+    ASSERT_EQ(state.next_record, newest.next_record);
+    ASSERT_EQ(state.segment, 0u);
+    ASSERT_EQ(state.segment_size, data_size(storage));
+    ASSERT_EQ(state.total_size, data_size(storage));
+    ASSERT_EQ(memcmp(state.running_hash, newest.running_hash, sizeof(state.running_hash)), 0);
+    ASSERT_EQ(memcmp(state.segment_hash, newest.segment_hash, sizeof(state.segment_hash)), 0);
+    ASSERT_EQ(*sd_->file(segment(0)), copied);
+}
+
+TEST_F(BackupSuite, StartsOverEmptySegmentWithMismatchedSize) {
+    Storage storage{ memory_, pool_, false };
+    ASSERT_TRUE(storage.begin());
+
+    write_records(storage, 4);
+
+    ASSERT_TRUE(sd_->mkdir(directory()));
+
+    // Left behind by a backup interrupted before it saved any state.
+    auto leftover = sd_->open(segment(0), OpenFlags::Write, pool_);
+    ASSERT_TRUE(*leftover);
+    ASSERT_EQ(leftover->write((uint8_t *)"garbage", 7), 7);
+    ASSERT_TRUE(leftover->close());
+
+    BackupWorker worker;
+    ASSERT_TRUE(worker.backup(storage, pool_));
+
+    ASSERT_EQ(sd_->file(segment(0))->size(), data_size(storage));
+    ASSERT_FALSE(sd_->is_file(segment(1)));
+    ASSERT_EQ(newest_state().segment, 0u);
+}
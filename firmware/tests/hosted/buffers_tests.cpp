@@ -3,6 +3,9 @@
 #include "collections.h"
 #include "buffers.h"
 #include "io.h"
+#include "protobuf.h"
+
+#include <fk-data-protocol.h>
 
 using namespace fk;
 
@@ -50,4 +53,153 @@ TEST_F(BuffersSuite, CopyInto) {
     buffer->copy_into((uint8_t const *)"World", 5);
     ASSERT_EQ(buffer->length(), 10u);
     ASSERT_EQ(memcmp(buffer->buffer(), "HelloWorld", 10), 0);
-}
\ No newline at end of file
+}
+
+static fk_data_DataRecord log_record(const char *message) {
+    fk_data_DataRecord record = fk_data_DataRecord_init_default;
+    record.has_log = true;
+    record.log.uptime = 1000;
+    record.log.facility.arg = (void *)"facility";
+    record.log.facility.funcs.encode = pb_encode_string;
+    record.log.message.arg = (void *)message;
+    record.log.message.funcs.encode = pb_encode_string;
+    return record;
+}
+
+static std::vector<uint8_t> encode_twice(fk_data_DataRecord const &record, bool delimited) {
+    size_t size = 0;
+    EXPECT_TRUE(pb_get_encoded_size(&size, fk_data_DataRecord_fields, &record));
+    std::vector<uint8_t> buffer(size + (delimited ? pb_varint_size(size) : 0));
+    auto stream = pb_ostream_from_buffer(buffer.data(), buffer.size());
+    if (delimited) {
+        EXPECT_TRUE(pb_encode_delimited(&stream, fk_data_DataRecord_fields, &record));
+    } else {
+        EXPECT_TRUE(pb_encode(&stream, fk_data_DataRecord_fields, &record));
+    }
+    EXPECT_EQ(stream.bytes_written, buffer.size());
+    return buffer;
+}
+
+static std::vector<uint8_t> flatten(BufferPtr const *chain) {
+    std::vector<uint8_t> bytes;
+    for (auto iter = chain; iter != nullptr; iter = iter->link()) {
+        bytes.insert(bytes.end(), iter->buffer(), iter->buffer() + iter->position());
+    }
+    return bytes;
+}
+
+TEST_F(BuffersSuite, PoolEncoder_SmallMessage) {
+    StandardPool pool{ "top" };
+
+    auto record = log_record("short");
+    auto expected = encode_twice(record, true);
+
+    auto used = pool.used();
+    auto encoded = pool.encode(fk_data_DataRecord_fields, &record);
+    ASSERT_NE(encoded, nullptr);
+    ASSERT_TRUE(encoded->solo());
+    ASSERT_EQ(std::vector<uint8_t>(encoded->buffer(), encoded->buffer() + encoded->position()), expected);
+
+    // Everything past the message is given back to the pool.
+    ASSERT_LT(pool.used() - used, LinkedBufferSize);
+}
+
+TEST_F(BuffersSuite, PoolEncoder_LargeMessage) {
+    StandardPool pool{ "top" };
+
+    for (auto length : { 200u, 251u, 256u, 1000u, 5000u }) {
+        std::string message(length, 'a');
+        auto record = log_record(message.c_str());
+
+        for (auto delimited : { true, false }) {
+            auto expected = encode_twice(record, delimited);
+
+            auto used = pool.used();
+
+            PoolEncoder encoder{ pool, delimited };
+            ASSERT_TRUE(encoder.encode(fk_data_DataRecord_fields, &record));
+            ASSERT_EQ(encoder.size(), expected.size());
+
+            // Grown in place, so there's nothing to copy.
+            auto contiguous = encoder.contiguous();
+            ASSERT_TRUE(contiguous->solo());
+            ASSERT_EQ(flatten(contiguous), expected);
+            ASSERT_LT(pool.used() - used, expected.size() + 128);
+
+            auto chain = encoder.chain();
+            ASSERT_TRUE(chain->solo());
+            ASSERT_EQ(flatten(chain), expected);
+
+            pool.clear();
+        }
+    }
+}
+
+TEST_F(BuffersSuite, PoolEncoder_ChainsWhenItCantGrow) {
+    StandardPool pool{ "top" };
+
+    std::string message(5000, 'a');
+    auto record = log_record(message.c_str());
+    auto expected = encode_twice(record, true);
+
+    // Leaves room for the first chunk and little else, the rest of the
+    // message goes into the next page.
+    pool.malloc(StandardPageSize - LinkedBufferSize * 2);
+
+    PoolEncoder encoder{ pool, true };
+    ASSERT_TRUE(encoder.encode(fk_data_DataRecord_fields, &record));
+
+    auto chain = encoder.chain();
+    ASSERT_FALSE(chain->solo());
+    ASSERT_EQ(chain->length(), expected.size());
+    ASSERT_EQ(flatten(chain), expected);
+
+    auto contiguous = encoder.contiguous();
+    ASSERT_TRUE(contiguous->solo());
+    ASSERT_EQ(flatten(contiguous), expected);
+}
+
+TEST_F(BuffersSuite, PoolEncoder_Limit) {
+    StandardPool pool{ "top" };
+
+    std::string message(1000, 'a');
+    auto record = log_record(message.c_str());
+    auto expected = encode_twice(record, true);
+
+    PoolEncoder fits{ pool, true };
+    fits.limit(expected.size());
+    ASSERT_TRUE(fits.encode(fk_data_DataRecord_fields, &record));
+    ASSERT_FALSE(fits.exceeded());
+    ASSERT_EQ(flatten(fits.chain()), expected);
+
+    auto used = pool.used();
+
+    PoolEncoder over{ pool, true };
+    over.limit(500);
+    ASSERT_FALSE(over.encode(fk_data_DataRecord_fields, &record));
+    ASSERT_TRUE(over.exceeded());
+    ASSERT_LT(pool.used() - used, 500u + 128u);
+}
+
+TEST_F(BuffersSuite, PoolEncoder_IntoBuffer) {
+    StandardPool pool{ "top" };
+
+    std::string message(500, 'a');
+    auto first = log_record("first");
+    auto second = log_record(message.c_str());
+    auto expected = encode_twice(first, false);
+    auto expected_second = encode_twice(second, false);
+    expected.insert(expected.end(), expected_second.begin(), expected_second.end());
+
+    uint8_t buffer[64];
+    PoolEncoder encoder{ pool, buffer, sizeof(buffer) };
+    ASSERT_TRUE(encoder.encode(fk_data_DataRecord_fields, &first));
+    ASSERT_LE(encoder.size(), sizeof(buffer));
+    ASSERT_TRUE(encoder.encode(fk_data_DataRecord_fields, &second));
+    ASSERT_EQ(encoder.size(), expected.size());
+
+    auto chain = encoder.chain();
+    ASSERT_EQ(chain->buffer(), buffer);
+    ASSERT_FALSE(chain->solo());
+    ASSERT_EQ(flatten(chain), expected);
+}
@@ -1,9 +1,13 @@
 #include <fk-app-protocol.h>
+#include <fk-data-protocol.h>
 
 #include "tests.h"
 #include "networking/networking.h"
 
 #include <http_parser.h>
+#include <chrono>
+#include <string>
+#include <vector>
 
 #define TOKEN                                                                                                                              \
     "000000000000000000000000000000000000."                                                                                                \
@@ -13,6 +17,8 @@
 
 using namespace fk;
 
+FK_DECLARE_LOGGER("tests");
+
 class HttpBasicParsingSuite : public ::testing::Test {
 protected:
     StandardPool pool_{ "tests" };
@@ -103,6 +109,173 @@ TEST_F(HttpRoutingSuite, WithMultipleBasicRoutes) {
     ASSERT_EQ(router.route("/fk/v1"), &handlers[0]);
 }
 
+TEST_F(HttpRoutingSuite, FirstRouteForAUrlWins) {
+    HttpRouter router;
+    DummyHandler handlers[2];
+    HttpRoute routes[2]{ { "/fk/v1", &handlers[0] }, { "/fk/v1", &handlers[1] } };
+
+    ASSERT_TRUE(router.add_route(&routes[0]));
+    ASSERT_TRUE(router.add_route(&routes[1]));
+
+    ASSERT_EQ(router.route("/fk/v1"), &handlers[0]);
+}
+
+TEST_F(HttpRoutingSuite, WithPrefixesOfOtherRoutes) {
+    HttpRouter router;
+    DummyHandler handlers[3];
+    HttpRoute routes[3]{ { "/fk/v1", &handlers[0] }, { "/fk/v1/download/data", &handlers[1] }, { "/fk/v1/download/meta", &handlers[2] } };
+
+    for (auto i = (size_t)0; i < 3; ++i) {
+        router.add_route(&routes[i]);
+    }
+
+    ASSERT_EQ(router.route("/fk"), nullptr);
+    ASSERT_EQ(router.route("/fk/v1/download"), nullptr);
+    ASSERT_EQ(router.route("/fk/v1/download/dat"), nullptr);
+    ASSERT_EQ(router.route("/fk/v1/download/data/more"), nullptr);
+    ASSERT_EQ(router.route("/fk/v1/"), nullptr);
+    ASSERT_EQ(router.route("fk/v1"), nullptr);
+    ASSERT_EQ(router.route("/fk/v1"), &handlers[0]);
+    ASSERT_EQ(router.route("/fk/v1/download/data"), &handlers[1]);
+    ASSERT_EQ(router.route("/fk/v1/download/meta"), &handlers[2]);
+}
+
+TEST_F(HttpRoutingSuite, WithParameters) {
+    StandardPool pool{ "routes" };
+    HttpRouter router;
+    DummyHandler handlers[3];
+    HttpRoute routes[3]{ { "/fk/v1/modules/:position", &handlers[0] },
+                         { "/fk/v1/modules/all", &handlers[1] },
+                         { "/fk/v1/files/:file/:block", &handlers[2] } };
+
+    for (auto i = (size_t)0; i < 3; ++i) {
+        router.add_route(&routes[i]);
+    }
+
+    HttpRouteParameters parameters;
+
+    ASSERT_EQ(router.route("/fk/v1/modules/3", &parameters), &handlers[0]);
+    ASSERT_EQ(parameters.size(), 1u);
+    ASSERT_EQ(parameters.integer("position"), 3);
+    ASSERT_EQ(parameters.integer("file"), -1);
+
+    ASSERT_EQ(router.route("/fk/v1/modules/wat", &parameters), &handlers[0]);
+    ASSERT_EQ(parameters.integer("position"), -1);
+    ASSERT_STREQ(parameters.string("position", pool), "wat");
+
+    // Literal segments win over parameters.
+    ASSERT_EQ(router.route("/fk/v1/modules/all", &parameters), &handlers[1]);
+    ASSERT_EQ(parameters.size(), 0u);
+
+    ASSERT_EQ(router.route("/fk/v1/files/12/345", &parameters), &handlers[2]);
+    ASSERT_EQ(parameters.size(), 2u);
+    ASSERT_EQ(parameters.integer("file"), 12);
+    ASSERT_EQ(parameters.integer("block"), 345);
+
+    ASSERT_EQ(router.route("/fk/v1/modules", &parameters), nullptr);
+    ASSERT_EQ(router.route("/fk/v1/modules/", &parameters), nullptr);
+    ASSERT_EQ(router.route("/fk/v1/files/12", &parameters), nullptr);
+    ASSERT_EQ(parameters.size(), 0u);
+}
+
+TEST_F(HttpRoutingSuite, PrefixSharedByEveryRoute) {
+    HttpRouter router;
+    DummyHandler handlers[4];
+    HttpRoute routes[4]{ { "/fk/v1/modules/:position", &handlers[0] },
+                         { "/fk/v1/download/data", &handlers[1] },
+                         { "/fk/v1", &handlers[2] },
+                         { "/other", &handlers[3] } };
+
+    for (auto i = (size_t)0; i < 3; ++i) {
+        router.add_route(&routes[i]);
+    }
+
+    ASSERT_EQ(router.route("/fk/v10"), nullptr);
+    ASSERT_EQ(router.route("/fk/v"), nullptr);
+    ASSERT_EQ(router.route("/fk"), nullptr);
+    ASSERT_EQ(router.route(""), nullptr);
+    ASSERT_EQ(router.route("/fk/v1"), &handlers[2]);
+    ASSERT_EQ(router.route("/fk/v1/modules/1"), &handlers[0]);
+    ASSERT_EQ(router.route("/fk/v1/download/data"), &handlers[1]);
+    ASSERT_EQ(router.route("/other"), nullptr);
+
+    // Routes registered later can shorten the prefix.
+    router.add_route(&routes[3]);
+
+    ASSERT_EQ(router.route("/other"), &handlers[3]);
+    ASSERT_EQ(router.route("/fk/v1"), &handlers[2]);
+    ASSERT_EQ(router.route("/fk/v1/modules/1"), &handlers[0]);
+}
+
+TEST_F(HttpRoutingSuite, DISABLED_Benchmark_Route) {
+    constexpr size_t Lookups = 1000000;
+
+    StandardPool pool{ "routes" };
+    DummyHandler handler;
+
+    const char *fixed[] = { "/fk/v1/download/logs", "/fk/v1/download/data", "/fk/v1/download/meta", "/fk/v1/download/file",
+                            "/fk/v1/upload/firmware", "/fk/v1/memory/qspi", "/fk/v1" };
+
+    // What we used to register, a route per module and then the fixed
+    // ones, compared in order.
+    const char *urls[MaximumNumberOfPhysicalModules + HttpFixedRoutes];
+    auto nurls = 0u;
+    for (auto i = 0u; i < MaximumNumberOfPhysicalModules; ++i) {
+        urls[nurls++] = pool.sprintf("/fk/v1/modules/%d", i);
+    }
+    for (auto url : fixed) {
+        urls[nurls++] = url;
+    }
+
+    // Same as DefaultRoutes registers now.
+    HttpRouter router;
+    HttpRoute modules{ "/fk/v1/modules/:position", &handler };
+    ASSERT_TRUE(router.add_route(&modules));
+    for (auto url : fixed) {
+        ASSERT_TRUE(router.add_route(new (pool) HttpRoute(url, &handler)));
+    }
+
+    // Copies, so nothing gets to cheat by comparing pointers. The status
+    // route is the one apps hammer and was the last one registered.
+    char requested[MaximumNumberOfPhysicalModules + HttpFixedRoutes][64];
+    for (auto i = 0u; i < nurls; ++i) {
+        strncpy(requested[i], urls[i], sizeof(requested[i]));
+        ASSERT_EQ(router.route(requested[i]), &handler);
+    }
+
+    volatile uintptr_t sink = 0;
+
+    auto saved = log_get_level();
+    log_configure_level(LogLevels::INFO);
+
+    for (auto which : { (size_t)0, MaximumNumberOfPhysicalModules - 1, (size_t)nurls - 1 }) {
+        auto url = requested[which];
+
+        auto started = std::chrono::steady_clock::now();
+        for (auto i = 0u; i < Lookups; ++i) {
+            for (auto j = 0u; j < nurls; ++j) {
+                auto length = strlen(urls[j]);
+                if (length == strlen(url) && strncmp(urls[j], url, length) == 0) {
+                    sink = sink + j;
+                    break;
+                }
+            }
+        }
+        auto linear = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        HttpRouteParameters parameters;
+        started = std::chrono::steady_clock::now();
+        for (auto i = 0u; i < Lookups; ++i) {
+            sink = sink + (uintptr_t)router.route(url, &parameters);
+        }
+        auto compiled = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        loginfo("route-bench url=%s ns/lookup linear=%.1f trie=%.1f", url, linear * 1e9 / Lookups, compiled * 1e9 / Lookups);
+    }
+
+    log_configure_level((LogLevels)saved);
+}
+
 class HttpParsingQuerySuite : public ::testing::Test {
 protected:
     StandardPool pool_{ "tests" };
@@ -128,3 +301,253 @@ TEST_F(HttpParsingQuerySuite, SimpleGet1) {
     ASSERT_STREQ(req.url(), "/");
     ASSERT_EQ(req.length(), (uint32_t)3);
 }
+
+class FakeNetworkConnection : public NetworkConnection {
+public:
+    std::string incoming;
+    std::vector<std::string> writes;
+    bool stopped{ false };
+
+public:
+    NetworkConnectionStatus status() override {
+        return stopped ? NetworkConnectionStatus::Disconnected : NetworkConnectionStatus::Connected;
+    }
+
+    bool available() override {
+        return incoming.size() > 0;
+    }
+
+    int32_t read(uint8_t *buffer, size_t size) override {
+        auto reading = std::min(size, incoming.size());
+        memcpy(buffer, incoming.data(), reading);
+        incoming.erase(0, reading);
+        return reading;
+    }
+
+    int32_t write(const uint8_t *buffer, size_t size) override {
+        writes.emplace_back((const char *)buffer, size);
+        return size;
+    }
+
+    int32_t writef(const char *str, ...) override {
+        va_list args;
+        va_start(args, str);
+        auto r = vwritef(str, args);
+        va_end(args);
+        return r;
+    }
+
+    int32_t vwritef(const char *str, va_list args) override {
+        char buffer[256];
+        auto size = tiny_vsnprintf(buffer, sizeof(buffer), str, args);
+        return write((uint8_t const *)buffer, size);
+    }
+
+    int32_t write(const char *str) override {
+        return write((uint8_t const *)str, strlen(str));
+    }
+
+    int32_t flush() override {
+        return 0;
+    }
+
+    int32_t try_flush_all(size_t bytes, uint32_t delay) override {
+        return bytes;
+    }
+
+    uint32_t remote_address() override {
+        return 0;
+    }
+
+    bool stop() override {
+        stopped = true;
+        return true;
+    }
+};
+
+class ReplyingHandler : public HttpHandler {
+public:
+    bool handle(HttpServerConnection *connection, Pool &pool) override {
+        auto reply = "{ \"ok\": true }";
+        connection->write(HttpStatus::Ok, "ok", (uint8_t const *)reply, strlen(reply), pool);
+        connection->close();
+        return true;
+    }
+};
+
+class HexReplyingHandler : public HttpHandler {
+public:
+    bool handle(HttpServerConnection *connection, Pool &pool) override {
+        auto reply = "{ \"ok\": true }";
+        connection->hex_encoding(true);
+        connection->write(HttpStatus::Ok, "ok", (uint8_t const *)reply, strlen(reply), pool);
+        connection->close();
+        return true;
+    }
+};
+
+class RecordReplyingHandler : public HttpHandler {
+public:
+    std::string message;
+    size_t pool_used{ 0 };
+
+public:
+    fk_data_DataRecord record() {
+        fk_data_DataRecord record = fk_data_DataRecord_init_default;
+        record.has_log = true;
+        record.log.uptime = 1000;
+        record.log.facility.arg = (void *)"facility";
+        record.log.facility.funcs.encode = pb_encode_string;
+        record.log.message.arg = (void *)message.c_str();
+        record.log.message.funcs.encode = pb_encode_string;
+        return record;
+    }
+
+    bool handle(HttpServerConnection *connection, Pool &pool) override {
+        auto reply = record();
+        auto used = pool.used();
+        connection->write(HttpStatus::Ok, "ok", &reply, fk_data_DataRecord_fields, pool);
+        pool_used = pool.used() - used;
+        connection->close();
+        return true;
+    }
+};
+
+class HttpServerConnectionSuite : public ::testing::Test {
+protected:
+    StandardPool pool_{ "tests" };
+    FakeNetworkConnection conn_;
+    ReplyingHandler handler_;
+    HexReplyingHandler hex_handler_;
+    RecordReplyingHandler record_handler_;
+    HttpRoute route_{ "/fk/v1", &handler_ };
+    HttpRoute hex_route_{ "/fk/hex", &hex_handler_ };
+    HttpRoute record_route_{ "/fk/record", &record_handler_ };
+    HttpRouter router_;
+
+protected:
+    void SetUp() override {
+        router_.add_route(&route_);
+        router_.add_route(&hex_route_);
+        router_.add_route(&record_route_);
+    }
+};
+
+TEST_F(HttpServerConnectionSuite, HeadersAndBodyInOneWrite) {
+    HttpServerConnection connection{ &pool_, &conn_, 1, &router_ };
+
+    conn_.incoming = "GET /fk/v1 HTTP/1.1\n\n";
+
+    ASSERT_TRUE(connection.service());
+    ASSERT_EQ(conn_.writes.size(), 1u);
+    ASSERT_NE(conn_.writes[0].find("HTTP/1.1 200 ok\n"), std::string::npos);
+    ASSERT_NE(conn_.writes[0].find("Content-Length: 14\n"), std::string::npos);
+    ASSERT_NE(conn_.writes[0].find("Connection: close\n\n{ \"ok\": true }"), std::string::npos);
+    ASSERT_TRUE(conn_.stopped);
+
+    ASSERT_TRUE(connection.closed());
+}
+
+TEST_F(HttpServerConnectionSuite, PlainInOneWrite) {
+    HttpServerConnection connection{ &pool_, &conn_, 1, &router_ };
+
+    conn_.incoming = "GET /missing HTTP/1.1\n\n";
+
+    ASSERT_TRUE(connection.service());
+    ASSERT_EQ(conn_.writes.size(), 1u);
+    ASSERT_EQ(conn_.writes[0].find("HTTP/1.1 404 not found\n"), 0u);
+    ASSERT_NE(conn_.writes[0].find("Content-Type: text/plain\n"), std::string::npos);
+    ASSERT_NE(conn_.writes[0].find("\n\n404: not found, no handler"), std::string::npos);
+}
+
+TEST_F(HttpServerConnectionSuite, KeepAliveWhenAsked) {
+    HttpServerConnection connection{ &pool_, &conn_, 1, &router_ };
+
+    for (auto i = 0u; i < HttpKeepAliveMaximumRequests; ++i) {
+        conn_.incoming = "GET /fk/v1 HTTP/1.1\nConnection: keep-alive\n\n";
+
+        ASSERT_TRUE(connection.service());
+        ASSERT_EQ(conn_.writes.size(), i + 1);
+
+        if (i + 1 < HttpKeepAliveMaximumRequests) {
+            ASSERT_NE(conn_.writes[i].find("Connection: keep-alive\n"), std::string::npos);
+            ASSERT_FALSE(conn_.stopped);
+            ASSERT_TRUE(connection.service());
+        } else {
+            // The last request the connection will serve says so.
+            ASSERT_NE(conn_.writes[i].find("Connection: close\n"), std::string::npos);
+            ASSERT_TRUE(conn_.stopped);
+            ASSERT_TRUE(connection.closed());
+        }
+    }
+}
+
+TEST_F(HttpServerConnectionSuite, HexEncodedContentLength) {
+    HttpServerConnection connection{ &pool_, &conn_, 1, &router_ };
+
+    conn_.incoming = "GET /fk/hex HTTP/1.1\n\n";
+
+    ASSERT_TRUE(connection.service());
+    ASSERT_EQ(conn_.writes.size(), 1u);
+
+    auto &written = conn_.writes[0];
+    ASSERT_NE(written.find("Content-Length: 28\n"), std::string::npos);
+    auto body = written.find("\n\n");
+    ASSERT_NE(body, std::string::npos);
+    ASSERT_EQ(written.size() - (body + 2), 28u);
+}
+
+TEST_F(HttpServerConnectionSuite, KeepAlivePipelined) {
+    HttpServerConnection connection{ &pool_, &conn_, 1, &router_ };
+
+    conn_.incoming = "GET /fk/v1 HTTP/1.1\nConnection: keep-alive\n\n"
+                     "GET /missing HTTP/1.1\n\n";
+
+    ASSERT_TRUE(connection.service());
+    ASSERT_EQ(conn_.writes.size(), 1u);
+    ASSERT_NE(conn_.writes[0].find("Connection: keep-alive\n"), std::string::npos);
+    ASSERT_TRUE(conn_.incoming.empty());
+
+    // The second request came in with the first and is served from what
+    // was left in the buffer.
+    ASSERT_TRUE(connection.service());
+    ASSERT_TRUE(connection.service());
+    ASSERT_EQ(conn_.writes.size(), 2u);
+    ASSERT_EQ(conn_.writes[1].find("HTTP/1.1 404 not found\n"), 0u);
+}
+
+TEST_F(HttpServerConnectionSuite, LargeRepliesAreNotBuffered) {
+    for (auto length : { (size_t)100, HttpMaximumBufferedReplySize * 2 }) {
+        HttpServerConnection connection{ &pool_, &conn_, 1, &router_ };
+
+        record_handler_.message = std::string(length, 'a');
+
+        auto reply = record_handler_.record();
+        size_t size = 0;
+        ASSERT_TRUE(pb_get_encoded_size(&size, fk_data_DataRecord_fields, &reply));
+        std::string expected(size + pb_varint_size(size), 0);
+        auto stream = pb_ostream_from_buffer((uint8_t *)&expected[0], expected.size());
+        ASSERT_TRUE(pb_encode_delimited(&stream, fk_data_DataRecord_fields, &reply));
+
+        conn_.writes.clear();
+        conn_.stopped = false;
+        conn_.incoming = "GET /fk/record HTTP/1.1\n\n";
+
+        ASSERT_TRUE(connection.service());
+
+        std::string written;
+        for (auto &w : conn_.writes) {
+            written += w;
+        }
+
+        auto header = pool_.sprintf("Content-Length: %zu\n", expected.size());
+        ASSERT_NE(written.find(header), std::string::npos);
+        auto body = written.find("\n\n");
+        ASSERT_NE(body, std::string::npos);
+        ASSERT_EQ(written.substr(body + 2), expected);
+
+        if (expected.size() > HttpMaximumBufferedReplySize) {
+            ASSERT_LT(record_handler_.pool_used, HttpMaximumBufferedReplySize + StandardPageSize / 4);
+        }
+    }
+}
@@ -0,0 +1,222 @@
+#include <tiny_printf.h>
+
+#include "tests.h"
+
+#include "log_binary.h"
+
+using namespace fk;
+
+class LogBinarySuite : public ::testing::Test {
+};
+
+static void append_rendered(char c, void *arg) {
+    reinterpret_cast<std::string *>(arg)->push_back(c);
+}
+
+static size_t encode(uint8_t *buffer, size_t size, LogMessage const *m, const char *task, const char *f, ...) {
+    va_list args;
+    va_start(args, f);
+    auto encoded = log_binary_encode(buffer, size, m, task, f, args);
+    va_end(args);
+    return encoded;
+}
+
+static size_t encode_from(uint32_t image, uint8_t *buffer, size_t size, LogMessage const *m, const char *task, const char *f, ...) {
+    va_list args;
+    va_start(args, f);
+    auto encoded = log_binary_encode(buffer, size, image, m, task, f, args);
+    va_end(args);
+    return encoded;
+}
+
+static std::string expected(LogMessage const *m, const char *task, const char *f, ...) {
+    char prefix[128];
+    tiny_snprintf(prefix, sizeof(prefix), "%08" PRIu32 " %-10s %-7s %s%s: ", m->uptime, task, alog_get_log_level((LogLevels)m->level),
+                  m->scope, m->facility);
+
+    char message[256];
+    va_list args;
+    va_start(args, f);
+    tiny_vsnprintf(message, sizeof(message), f, args);
+    va_end(args);
+
+    return std::string{ prefix } + message + "\n";
+}
+
+static LogMessage message() {
+    LogMessage m;
+    bzero(&m, sizeof(m));
+    m.uptime = 123456;
+    m.level = (uint8_t)LogLevels::DEBUG;
+    m.facility = "tests";
+    m.scope = "";
+    return m;
+}
+
+#define ASSERT_ROUND_TRIP(f, ...)                                                                                                          \
+    {                                                                                                                                      \
+        uint8_t record[BinaryLogMaximumRecordSize];                                                                                        \
+        auto size = encode(record, sizeof(record), &m, "task", f, ##__VA_ARGS__);                                                          \
+        ASSERT_GT(size, 0u);                                                                                                               \
+        ASSERT_EQ(memchr(record, 0, size), nullptr);                                                                                       \
+        std::string rendered;                                                                                                              \
+        ASSERT_GT(log_binary_render(record, size, append_rendered, &rendered), 0);                                                         \
+        ASSERT_EQ(rendered, expected(&m, "task", f, ##__VA_ARGS__));                                                                       \
+    }
+
+TEST_F(LogBinarySuite, RendersLikeText) {
+    auto m = message();
+
+    ASSERT_ROUND_TRIP("no arguments");
+    ASSERT_ROUND_TRIP("100%% done");
+    ASSERT_ROUND_TRIP("ints %d %" PRIu32 " %" PRId32 " %x %08" PRIx32, -5, (uint32_t)4000000000u, (int32_t)-70000, 0xbeef, (uint32_t)0);
+    ASSERT_ROUND_TRIP("longs %ld %lu %lld %llu", -1L, 1UL << 20, -(1LL << 40), 1ULL << 60);
+    ASSERT_ROUND_TRIP("sizes %zu %zd", (size_t)1234, (ssize_t)-1234);
+    ASSERT_ROUND_TRIP("floats %f %.2f %6.1f", 3.25, -0.5f, 100.04);
+    ASSERT_ROUND_TRIP("strings '%s' '%-10s' '%5s'", "hello", "left", "r");
+    ASSERT_ROUND_TRIP("stars '%*d' '%.*f'", 6, 42, 3, 1.23456);
+    ASSERT_ROUND_TRIP("char %c", 'x');
+}
+
+TEST_F(LogBinarySuite, ScopeIsCopied) {
+    char scope[16];
+    strcpy(scope, "scope ");
+
+    auto m = message();
+    m.scope = scope;
+
+    uint8_t record[BinaryLogMaximumRecordSize];
+    auto size = encode(record, sizeof(record), &m, "task", "after %s", "change");
+    ASSERT_GT(size, 0u);
+
+    auto wanted = expected(&m, "task", "after %s", "change");
+    strcpy(scope, "XXXXXX");
+
+    std::string rendered;
+    ASSERT_GT(log_binary_render(record, size, append_rendered, &rendered), 0);
+    ASSERT_EQ(rendered, wanted);
+}
+
+TEST_F(LogBinarySuite, LongStringsAreTruncated) {
+    auto m = message();
+
+    std::string long_string(BinaryLogMaximumStringLength * 2, 'a');
+
+    uint8_t record[BinaryLogMaximumRecordSize];
+    auto size = encode(record, sizeof(record), &m, "task", "%s!", long_string.c_str());
+    ASSERT_GT(size, 0u);
+
+    std::string rendered;
+    ASSERT_GT(log_binary_render(record, size, append_rendered, &rendered), 0);
+    ASSERT_NE(rendered.find(std::string(BinaryLogMaximumStringLength, 'a') + "!"), std::string::npos);
+}
+
+TEST_F(LogBinarySuite, RecordsThatDontFitLoseTrailingArguments) {
+    auto m = message();
+
+    std::string s(BinaryLogMaximumStringLength, 's');
+    auto str = s.c_str();
+
+    uint8_t record[BinaryLogMaximumRecordSize];
+    auto size = encode(record, sizeof(record), &m, "task", "%s %s %s %s %s", str, str, str, str, str);
+    ASSERT_GT(size, 0u);
+    ASSERT_LE(size, BinaryLogMaximumRecordSize);
+
+    std::string rendered;
+    ASSERT_GT(log_binary_render(record, size, append_rendered, &rendered), 0);
+    ASSERT_NE(rendered.find(s + " " + s + " " + s + " ?"), std::string::npos);
+}
+
+TEST_F(LogBinarySuite, RenderingMixedBuffer) {
+    auto m = message();
+
+    char buffer[1024];
+    log_buffer lb{ buffer, sizeof(buffer) };
+    lb.zero();
+
+    lb.append("plain text\n");
+
+    uint8_t record[BinaryLogMaximumRecordSize];
+    auto size = encode(record, sizeof(record), &m, "task", "binary %d", 256);
+    auto app = lb.start();
+    for (auto i = 0u; i < size; ++i) {
+        app.append((char)record[i]);
+    }
+    app.append((char)0);
+
+    lb.append("more text\n");
+
+    std::string rendered;
+    auto iter = lb.begin();
+    auto rendered_size = log_binary_render_buffer(lb, iter, append_rendered, &rendered);
+    ASSERT_EQ(rendered_size, rendered.size());
+    ASSERT_EQ(rendered, "plain text\n" + expected(&m, "task", "binary %d", 256) + "more text\n");
+    ASSERT_TRUE(iter == lb.end());
+}
+
+TEST_F(LogBinarySuite, RenderingSavedBuffer) {
+    char buffer[1024];
+    log_buffer lb{ buffer, sizeof(buffer) };
+    lb.zero();
+
+    auto m = message();
+
+    lb.append("plain text\n");
+
+    uint8_t record[BinaryLogMaximumRecordSize];
+    auto size = encode(record, sizeof(record), &m, "task", "binary %d", 256);
+    auto app = lb.start();
+    for (auto i = 0u; i < size; ++i) {
+        app.append((char)record[i]);
+    }
+    app.append((char)0);
+
+    std::string rendered;
+    log_binary_render_saved(buffer, sizeof(buffer), append_rendered, &rendered);
+    ASSERT_EQ(rendered, "plain text\n" + expected(&m, "task", "binary %d", 256));
+}
+
+TEST_F(LogBinarySuite, RenderingSavedBufferAfterWrapping) {
+    char buffer[40];
+    log_buffer lb{ buffer, sizeof(buffer) };
+    lb.zero();
+
+    char line[8];
+    for (auto i = 0; i < 10; ++i) {
+        tiny_snprintf(line, sizeof(line), "rec%d\n", i);
+        lb.append(line);
+    }
+
+    // The start of the buffer is the end of rec6, which wrapped, and so is
+    // rendered last. What's left of rec3 after the head can't be told
+    // apart from a record.
+    std::string rendered;
+    log_binary_render_saved(buffer, sizeof(buffer), append_rendered, &rendered);
+    ASSERT_EQ(rendered, "rec7\nrec8\nrec9\nc3\nrec4\nrec5\nrec6\n");
+}
+
+TEST_F(LogBinarySuite, RefusesRecordsFromAnotherImage) {
+    auto m = message();
+
+    uint8_t record[BinaryLogMaximumRecordSize];
+    auto size = encode_from(log_binary_image_id() + 1, record, sizeof(record), &m, "task", "binary %d", 256);
+    ASSERT_GT(size, 0u);
+
+    std::string rendered;
+    ASSERT_LT(log_binary_render(record, size, append_rendered, &rendered), 0);
+    ASSERT_EQ(rendered, "");
+
+    char buffer[1024];
+    log_buffer lb{ buffer, sizeof(buffer) };
+    lb.zero();
+
+    lb.append("plain text\n");
+    auto app = lb.start();
+    for (auto i = 0u; i < size; ++i) {
+        app.append((char)record[i]);
+    }
+    app.append((char)0);
+
+    log_binary_render_saved(buffer, sizeof(buffer), append_rendered, &rendered);
+    ASSERT_EQ(rendered, "plain text\n");
+}
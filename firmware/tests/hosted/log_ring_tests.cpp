@@ -0,0 +1,165 @@
+#include <thread>
+#include <vector>
+
+#include "tests.h"
+
+#include "log_ring.h"
+
+using namespace fk;
+
+class LogRingSuite : public ::testing::Test {
+};
+
+using test_ring = log_ring<8, 32>;
+
+static bool append(test_ring &ring, const char *message) {
+    uint32_t reserved = 0;
+    auto s = ring.reserve(reserved);
+    if (s == nullptr) {
+        return false;
+    }
+    auto size = strlen(message);
+    memcpy(s->data, message, size);
+    return ring.commit(s, reserved, size);
+}
+
+static std::string pop(test_ring &ring) {
+    std::string popped;
+    ring.pop([&](test_ring::slot &s) { popped = std::string{ s.data, s.size }; });
+    return popped;
+}
+
+TEST_F(LogRingSuite, Basic) {
+    test_ring ring;
+
+    ASSERT_EQ(pop(ring), "");
+
+    ASSERT_TRUE(append(ring, "Jacob1"));
+    ASSERT_TRUE(append(ring, "Jacob2"));
+    ASSERT_EQ(ring.pending(), 2u);
+
+    ASSERT_EQ(pop(ring), "Jacob1");
+    ASSERT_EQ(pop(ring), "Jacob2");
+    ASSERT_EQ(pop(ring), "");
+    ASSERT_EQ(ring.pending(), 0u);
+}
+
+TEST_F(LogRingSuite, ReserveFailsWhenFull) {
+    test_ring ring;
+
+    for (auto i = 0u; i < ring.capacity(); ++i) {
+        ASSERT_TRUE(append(ring, "message"));
+    }
+
+    ASSERT_FALSE(append(ring, "refused"));
+    ASSERT_EQ(ring.dropped(), 0u);
+
+    ASSERT_EQ(ring.drain([](test_ring::slot &s) {}), ring.capacity());
+
+    // Wraps around, many times over.
+    for (auto i = 0u; i < ring.capacity() * 10; ++i) {
+        char message[16];
+        tiny_snprintf(message, sizeof(message), "message-%d", i);
+        ASSERT_TRUE(append(ring, message));
+        ASSERT_EQ(pop(ring), message);
+    }
+}
+
+TEST_F(LogRingSuite, UnpublishedSlotsHoldUpTheConsumer) {
+    test_ring ring;
+
+    uint32_t position = 0;
+    auto reserved = ring.reserve(position);
+    ASSERT_NE(reserved, nullptr);
+    ASSERT_TRUE(append(ring, "after"));
+
+    ASSERT_EQ(pop(ring), "");
+    ASSERT_EQ(ring.tail(), 0u);
+
+    memcpy(reserved->data, "before", 6);
+    ASSERT_TRUE(ring.commit(reserved, position, 6));
+
+    ASSERT_EQ(pop(ring), "before");
+    ASSERT_EQ(pop(ring), "after");
+}
+
+TEST_F(LogRingSuite, SkippingStalledSlots) {
+    test_ring ring;
+
+    ASSERT_FALSE(ring.skip());
+
+    uint32_t position = 0;
+    auto stalled = ring.reserve(position);
+    ASSERT_NE(stalled, nullptr);
+    ASSERT_TRUE(append(ring, "after"));
+
+    // Published slots are popped, not skipped.
+    ASSERT_EQ(pop(ring), "");
+    ASSERT_TRUE(ring.skip());
+    ASSERT_FALSE(ring.skip());
+    ASSERT_EQ(ring.dropped(), 1u);
+    ASSERT_EQ(pop(ring), "after");
+
+    // Once the slot's been reused a late commit can't publish it.
+    for (auto i = 0u; i < ring.capacity() - 2; ++i) {
+        ASSERT_TRUE(append(ring, "filler"));
+    }
+    uint32_t reused = 0;
+    ASSERT_EQ(ring.reserve(reused), stalled);
+    ASSERT_FALSE(ring.commit(stalled, position, 4));
+    ASSERT_TRUE(ring.commit(stalled, reused, 6));
+
+    ASSERT_EQ(ring.drain([](test_ring::slot &s) {}), ring.capacity() - 1);
+    ASSERT_EQ(ring.pending(), 0u);
+}
+
+struct LoggedRecord {
+    uint32_t producer;
+    uint32_t sequence;
+};
+
+TEST_F(LogRingSuite, ManyProducersKeepTheirOrder) {
+    constexpr uint32_t Producers = 4;
+    constexpr uint32_t Records = 2000;
+
+    using ring_type = log_ring<64, sizeof(LoggedRecord)>;
+    auto ring = new ring_type();
+
+    std::vector<std::thread> threads;
+    for (auto p = 0u; p < Producers; ++p) {
+        threads.emplace_back([=]() {
+            for (auto i = 0u; i < Records; ++i) {
+                ring_type::slot *s = nullptr;
+                uint32_t reserved = 0;
+                while ((s = ring->reserve(reserved)) == nullptr) {
+                    std::this_thread::yield();
+                }
+                LoggedRecord record{ p, i };
+                memcpy(s->data, &record, sizeof(record));
+                ring->commit(s, reserved, sizeof(record));
+            }
+        });
+    }
+
+    uint32_t expected[Producers] = { 0 };
+    auto consumed = 0u;
+    while (consumed < Producers * Records) {
+        ring->drain([&](ring_type::slot &s) {
+            LoggedRecord record;
+            memcpy(&record, s.data, sizeof(record));
+            ASSERT_EQ(record.sequence, expected[record.producer]);
+            expected[record.producer]++;
+            consumed++;
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (auto p = 0u; p < Producers; ++p) {
+        ASSERT_EQ(expected[p], Records);
+    }
+
+    delete ring;
+}
@@ -20,7 +20,7 @@ TEST_F(LoraPacketizerSuite, SingleReading) {
     state::DynamicState dynamic;
     state::AttachedModule am{ ModulePosition::from(0), header, nullptr, nullptr, pool };
     am.add_sensor(state::AttachedSensor{ nullptr, 0, SensorReading{ 0, 23.0f } });
-    dynamic.attached()->add_module(am);
+    dynamic.attached()->add_module(std::move(am));
 
     GlobalState gs;
     gs.readings.time = 1600000000;
@@ -47,7 +47,7 @@ TEST_F(LoraPacketizerSuite, OneModuleMultipleReadings) {
     am.add_sensor(state::AttachedSensor{ nullptr, 2, SensorReading{ 0, 9348839.0f } });
     am.add_sensor(state::AttachedSensor{ nullptr, 3, SensorReading{ 0, 100.0f } });
     am.add_sensor(state::AttachedSensor{ nullptr, 4, SensorReading{ 0, 39843.0f } });
-    dynamic.attached()->add_module(am);
+    dynamic.attached()->add_module(std::move(am));
 
     GlobalState gs;
     gs.readings.time = 1600000000;
@@ -74,12 +74,12 @@ TEST_F(LoraPacketizerSuite, TwoModulesMultipleReadings) {
     am1.add_sensor(state::AttachedSensor{ nullptr, 2, SensorReading{ 0, 9348839.0f } });
     am1.add_sensor(state::AttachedSensor{ nullptr, 3, SensorReading{ 0, 100.0f } });
     am1.add_sensor(state::AttachedSensor{ nullptr, 4, SensorReading{ 0, 39843.0f } });
-    dynamic.attached()->add_module(am1);
+    dynamic.attached()->add_module(std::move(am1));
     state::AttachedModule am2{ ModulePosition::from(1), header, nullptr, nullptr, pool };
     am2.add_sensor(state::AttachedSensor{ nullptr, 0, SensorReading{ 0, 23.0f } });
     am2.add_sensor(state::AttachedSensor{ nullptr, 1, SensorReading{ 0, 100.0f } });
     am2.add_sensor(state::AttachedSensor{ nullptr, 2, SensorReading{ 0, 39843.0f } });
-    dynamic.attached()->add_module(am2);
+    dynamic.attached()->add_module(std::move(am2));
 
     GlobalState gs;
     gs.readings.time = 1600000000;
@@ -104,7 +104,7 @@ TEST_F(LoraPacketizerSuite, MultipleModulesVerifyLength1) {
     am1.add_sensor(state::AttachedSensor{ nullptr, 0, SensorReading{ 0, 1725.0f } });
     am1.add_sensor(state::AttachedSensor{ nullptr, 1, SensorReading{ 0, 1726.0f } });
     am1.add_sensor(state::AttachedSensor{ nullptr, 2, SensorReading{ 0, 1727.0f } });
-    dynamic.attached()->add_module(am1);
+    dynamic.attached()->add_module(std::move(am1));
     auto i = 0u;
     state::AttachedModule am2{ ModulePosition::from(1), header, nullptr, nullptr, pool };
     am2.add_sensor(state::AttachedSensor{ nullptr, i++, SensorReading{ 0, 24.196228 } });
@@ -118,7 +118,7 @@ TEST_F(LoraPacketizerSuite, MultipleModulesVerifyLength1) {
     am2.add_sensor(state::AttachedSensor{ nullptr, i++, SensorReading{ 0, 9.600000 } });
     am2.add_sensor(state::AttachedSensor{ nullptr, i++, SensorReading{ 0, 8.067230 } });
     am2.add_sensor(state::AttachedSensor{ nullptr, i++, SensorReading{ 0, 147.000000 } });
-    dynamic.attached()->add_module(am2);
+    dynamic.attached()->add_module(std::move(am2));
 
     GlobalState gs;
     gs.readings.time = 1600000000;
@@ -152,7 +152,7 @@ TEST_F(LoraPacketizerSuite, MultipleModulesVerifyLength2) {
     am1.add_sensor(state::AttachedSensor{ nullptr, 0, SensorReading{ 0, 1726.0f } });
     am1.add_sensor(state::AttachedSensor{ nullptr, 1, SensorReading{ 0, 1727.0f } });
     am1.add_sensor(state::AttachedSensor{ nullptr, 2, SensorReading{ 0, 1728.0f } });
-    dynamic.attached()->add_module(am1);
+    dynamic.attached()->add_module(std::move(am1));
 
     GlobalState gs;
     gs.readings.time = 1600000000;
@@ -213,7 +213,7 @@ TEST_F(LoraPacketizerSuite, MultipleModulesVerifyLength3) {
     am1.add_sensor(state::AttachedSensor{ nullptr, 0, SensorReading{ 0, 1221.0f } });
     am1.add_sensor(state::AttachedSensor{ nullptr, 1, SensorReading{ 0, 1222.0f } });
     am1.add_sensor(state::AttachedSensor{ nullptr, 2, SensorReading{ 0, 1222.0f } });
-    dynamic.attached()->add_module(am1);
+    dynamic.attached()->add_module(std::move(am1));
     state::AttachedModule am2{ ModulePosition::from(6), header, nullptr, nullptr, pool };
     auto i = 0u;
     am2.add_sensor(state::AttachedSensor{ nullptr, i++, SensorReading{ 0, 44.954605 } });
@@ -227,7 +227,7 @@ TEST_F(LoraPacketizerSuite, MultipleModulesVerifyLength3) {
     am2.add_sensor(state::AttachedSensor{ nullptr, i++, SensorReading{ 0, 9.600000 } });
     am2.add_sensor(state::AttachedSensor{ nullptr, i++, SensorReading{ 0, 0.000000 } });
     am2.add_sensor(state::AttachedSensor{ nullptr, i++, SensorReading{ 0, 0.000000 } });
-    dynamic.attached()->add_module(am2);
+    dynamic.attached()->add_module(std::move(am2));
 
     GlobalState gs;
     gs.readings.time = 1600000000;
@@ -0,0 +1,176 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "tests.h"
+
+#include "hal/overlapped.h"
+
+using namespace fk;
+
+class OverlappedSuite : public ::testing::Test {
+};
+
+class CollectingWriter : public Writer {
+private:
+    uint8_t data_[10000];
+    uint32_t position_{ 0 };
+    std::atomic<uint32_t> writes_{ 0 };
+    std::atomic<bool> blocked_{ false };
+    bool failing_{ false };
+
+public:
+    uint32_t writes() const {
+        return writes_;
+    }
+
+    uint32_t position() const {
+        return position_;
+    }
+
+    uint8_t const *data() const {
+        return data_;
+    }
+
+    void block(bool blocked) {
+        blocked_ = blocked;
+    }
+
+    void fail() {
+        failing_ = true;
+    }
+
+    int32_t write(uint8_t const *buffer, size_t size) override {
+        writes_++;
+
+        while (blocked_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        if (failing_) {
+            return -1;
+        }
+
+        memcpy(data_ + position_, buffer, size);
+        position_ += size;
+        return size;
+    }
+};
+
+TEST_F(OverlappedSuite, WritesEverythingInOrder) {
+    StandardPool pool{ "tests" };
+
+    uint8_t source[10000];
+    for (auto i = 0u; i < sizeof(source); ++i) {
+        source[i] = (uint8_t)i;
+    }
+
+    CollectingWriter writer;
+    auto overlapped = create_overlapped_writer(pool);
+    ASSERT_NE(overlapped, nullptr);
+    ASSERT_TRUE(overlapped->begin(&writer));
+
+    auto position = 0u;
+    auto written = 0u;
+    OverlappedWriter::Chunk chunk;
+    while (position < sizeof(source)) {
+        if (!overlapped->writable()) {
+            ASSERT_TRUE(overlapped->written(chunk));
+            ASSERT_GT(chunk.size, 0);
+            ASSERT_EQ(chunk.buffer, source + written);
+            written += chunk.size;
+        }
+        auto size = std::min<uint32_t>(256, sizeof(source) - position);
+        overlapped->write(source + position, size);
+        position += size;
+    }
+
+    while (overlapped->written(chunk)) {
+        ASSERT_EQ(chunk.buffer, source + written);
+        written += chunk.size;
+    }
+
+    overlapped->stop();
+
+    ASSERT_EQ(written, sizeof(source));
+    ASSERT_EQ(writer.position(), sizeof(source));
+    ASSERT_EQ(memcmp(writer.data(), source, sizeof(source)), 0);
+}
+
+TEST_F(OverlappedSuite, StoppingWithNothingQueued) {
+    StandardPool pool{ "tests" };
+
+    CollectingWriter writer;
+    auto overlapped = create_overlapped_writer(pool);
+    ASSERT_NE(overlapped, nullptr);
+    ASSERT_TRUE(overlapped->begin(&writer));
+
+    OverlappedWriter::Chunk chunk;
+    ASSERT_FALSE(overlapped->written(chunk));
+
+    overlapped->stop();
+
+    ASSERT_EQ(writer.writes(), 0u);
+}
+
+TEST_F(OverlappedSuite, WritesOverlapTheCaller) {
+    StandardPool pool{ "tests" };
+
+    uint8_t source[512] = { 0 };
+
+    CollectingWriter writer;
+    auto overlapped = create_overlapped_writer(pool);
+    ASSERT_NE(overlapped, nullptr);
+    ASSERT_TRUE(overlapped->begin(&writer));
+
+    // With the writer stuck in the first write we can still queue the
+    // second, a serial writer would never give us control back.
+    writer.block(true);
+    overlapped->write(source, 256);
+    ASSERT_TRUE(overlapped->writable());
+    overlapped->write(source + 256, 256);
+    ASSERT_FALSE(overlapped->writable());
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (writer.writes() < 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(writer.writes(), 1u);
+
+    writer.block(false);
+
+    OverlappedWriter::Chunk chunk;
+    ASSERT_TRUE(overlapped->written(chunk));
+    ASSERT_EQ(chunk.buffer, source);
+    ASSERT_TRUE(overlapped->written(chunk));
+    ASSERT_EQ(chunk.buffer, source + 256);
+
+    overlapped->stop();
+
+    ASSERT_EQ(writer.position(), 512u);
+}
+
+TEST_F(OverlappedSuite, FailureSkipsTheRest) {
+    StandardPool pool{ "tests" };
+
+    uint8_t source[512] = { 0 };
+
+    CollectingWriter writer;
+    auto overlapped = create_overlapped_writer(pool);
+    ASSERT_NE(overlapped, nullptr);
+    ASSERT_TRUE(overlapped->begin(&writer));
+
+    writer.fail();
+    overlapped->write(source, 256);
+    overlapped->write(source + 256, 256);
+
+    OverlappedWriter::Chunk chunk;
+    ASSERT_TRUE(overlapped->written(chunk));
+    ASSERT_LT(chunk.size, 0);
+    ASSERT_TRUE(overlapped->written(chunk));
+    ASSERT_LT(chunk.size, 0);
+
+    overlapped->stop();
+
+    ASSERT_EQ(writer.writes(), 1u);
+}
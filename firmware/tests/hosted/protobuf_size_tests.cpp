@@ -1,9 +1,11 @@
+#include <chrono>
 #include <fstream>
 
 #include <fk-data-protocol.h>
 
 #include "hal/hal.h"
 #include "networking/http_reply.h"
+#include "networking/status_reply_cache.h"
 #include "storage/meta_record.h"
 #include "update_readings_listener.h"
 
@@ -164,6 +166,36 @@ static void fake_modules(GlobalState &gs, Pool &pool) {
     gs.dynamic = std::move(dynamic);
 }
 
+static void fake_maximum_modules(GlobalState &gs, Pool &pool) {
+    state::DynamicState dynamic;
+
+    auto attached = dynamic.attached();
+
+    for (auto i = 0u; i < MaximumNumberOfPhysicalModules; ++i) {
+        ModuleHeader header = {
+            .manufacturer = 1,
+            .kind = 2,
+            .version = 3,
+        };
+        fake_data(header.id.data);
+        attached->modules().emplace(ModulePosition::from(i), header, &fk_test_module_fake_3, fk_test_module_fake_3.ctor(pool), pool);
+    }
+
+    NoopMutex mutex;
+    TwoWireWrapper module_bus{ &mutex, "modules", nullptr };
+    ScanningContext ctx{ get_modmux(), gs.location(pool), module_bus, pool };
+    for (auto &attached_module : attached->modules()) {
+        auto sub_ctx = ctx.open_module(attached_module.position(), pool);
+        attached_module.initialize(sub_ctx, &pool);
+    }
+
+    UpdateReadingsListener listener{ pool };
+    attached->take_readings(&listener, pool);
+    listener.flush();
+
+    gs.dynamic = std::move(dynamic);
+}
+
 static void dump_binary(std::ostream &stream, std::string prefix, BufferPtr *message) {
     stream << prefix << " ";
     for (auto i = 0u; i < message->position(); ++i) {
@@ -334,6 +366,150 @@ TEST_F(ProtoBufSizeSuite, Modules) {
     ASSERT_EQ(encoded->position(), 1001u);
 }
 
+TEST_F(ProtoBufSizeSuite, DISABLED_Benchmark_EncodeSinglePass) {
+    constexpr size_t Iterations = 1000;
+
+    GlobalState gs;
+    fake_global_state(gs, pool_);
+    fake_modules(gs, pool_);
+
+    MetaRecord record{ pool_ };
+    record.include_modules(&gs, get_fake_header(), pool_);
+
+    StandardPool loop{ "loop" };
+
+    // What Pool::encode used to do, size and then encode.
+    auto started = std::chrono::steady_clock::now();
+    for (auto i = 0u; i < Iterations; ++i) {
+        size_t size = 0;
+        ASSERT_TRUE(pb_get_encoded_size(&size, fk_data_DataRecord_fields, record.record()));
+        size += pb_varint_size(size);
+        auto buffer = (uint8_t *)loop.malloc(size);
+        auto stream = pb_ostream_from_buffer(buffer, size);
+        ASSERT_TRUE(pb_encode_delimited(&stream, fk_data_DataRecord_fields, record.record()));
+        loop.clear();
+    }
+    auto two_pass = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+
+    size_t encoded_size = 0;
+    started = std::chrono::steady_clock::now();
+    for (auto i = 0u; i < Iterations; ++i) {
+        auto encoded = loop.encode(fk_data_DataRecord_fields, record.record());
+        ASSERT_NE(encoded, nullptr);
+        encoded_size = encoded->position();
+        loop.clear();
+    }
+    auto single_pass = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+
+    ASSERT_EQ(encoded_size, 1001u);
+
+    auto saved = log_get_level();
+    log_configure_level(LogLevels::INFO);
+    loginfo("encode-bench bytes=%zu two-pass=%.2fus single-pass=%.2fus", encoded_size, two_pass / Iterations, single_pass / Iterations);
+    log_configure_level((LogLevels)saved);
+}
+
+static size_t decoded_pool_bytes(BufferPtr *encoded, fk_data_DataRecord &record, Pool &pool) {
+    auto before = pool.used();
+    fk_data_record_decoding_new(&record, &pool);
+    auto stream = pb_istream_from_buffer(encoded->buffer(), encoded->position());
+    EXPECT_TRUE(pb_decode_delimited(&stream, fk_data_DataRecord_fields, &record));
+    return pool.used() - before;
+}
+
+TEST_F(ProtoBufSizeSuite, DecodeMaximumModulesPoolUsage) {
+    GlobalState gs;
+    fake_global_state(gs, pool_);
+    fake_maximum_modules(gs, pool_);
+
+    MetaRecord meta{ pool_ };
+    meta.include_modules(&gs, get_fake_header(), pool_);
+    auto encoded_meta = pool_.encode(fk_data_DataRecord_fields, meta.record());
+    ASSERT_NE(encoded_meta, nullptr);
+
+    DataRecord data{ pool_ };
+    data.include_readings(&gs, get_fake_header(), 1, pool_);
+    auto encoded_data = pool_.encode(fk_data_DataRecord_fields, &data.record());
+    ASSERT_NE(encoded_data, nullptr);
+
+    StandardPool decoding{ "decoding" };
+
+    fk_data_DataRecord modules_record;
+    auto modules_bytes = decoded_pool_bytes(encoded_meta, modules_record, decoding);
+
+    fk_data_DataRecord readings_record;
+    auto readings_bytes = decoded_pool_bytes(encoded_data, readings_record, decoding);
+
+    auto modules_array = reinterpret_cast<pb_array_t *>(modules_record.modules.arg);
+    ASSERT_EQ(modules_array->length, MaximumNumberOfPhysicalModules);
+    for (auto i = 0u; i < modules_array->length; ++i) {
+        auto sensors_array = reinterpret_cast<pb_array_t *>(modules_array->item<fk_data_ModuleInfo>(i)->sensors.arg);
+        ASSERT_EQ(sensors_array->length, 10u);
+        ASSERT_STREQ((const char *)sensors_array->item<fk_data_SensorInfo>(9)->name.arg, "sensor-9");
+    }
+
+    auto groups_array = reinterpret_cast<pb_array_t *>(readings_record.readings.sensorGroups.arg);
+    ASSERT_EQ(groups_array->length, MaximumNumberOfPhysicalModules);
+    for (auto i = 0u; i < groups_array->length; ++i) {
+        auto values_array = reinterpret_cast<pb_array_t *>(groups_array->item<fk_data_SensorGroup>(i)->readings.arg);
+        ASSERT_EQ(values_array->length, 10u);
+    }
+
+    // Doubling and copying the arrays as they grew used 11436 and 3384
+    // bytes decoding these.
+    ASSERT_LT(modules_bytes, 11436u);
+    ASSERT_LT(readings_bytes, 3384u);
+
+    auto items = MaximumNumberOfPhysicalModules * (sizeof(fk_data_ModuleInfo) + 10 * sizeof(fk_data_SensorInfo));
+    auto saved = log_get_level();
+    log_configure_level(LogLevels::INFO);
+    loginfo("decode-pool modules=%zu encoded=%zu/%zu modules-bytes=%zu readings-bytes=%zu module-items=%zu", modules_array->length,
+            encoded_meta->position(), encoded_data->position(), modules_bytes, readings_bytes, items);
+    log_configure_level((LogLevels)saved);
+}
+
+TEST_F(ProtoBufSizeSuite, AppendedArrayEncodesAcrossSegments) {
+    constexpr size_t Items = ProtobufArraySegmentItems * 2 + 3;
+
+    auto array = fk_array_new_protobuf<fk_data_SensorAndValue>(fk_data_SensorAndValue_fields, &pool_);
+    for (auto i = 0u; i < Items; ++i) {
+        fk_data_SensorAndValue sav = fk_data_SensorAndValue_init_default;
+        sav.sensor = i;
+        sav.which_calibrated = fk_data_SensorAndValue_calibratedValue_tag;
+        sav.calibrated.calibratedValue = (float)i;
+        ASSERT_EQ(pb_append_array(array, &sav), i + 1);
+    }
+
+    ASSERT_EQ(array->item<fk_data_SensorAndValue>(Items - 1)->sensor, Items - 1);
+
+    fk_data_SensorGroup group = fk_data_SensorGroup_init_default;
+    pb_set_array_encode(group.readings, array);
+
+    auto encoded = pool_.encode(fk_data_SensorGroup_fields, &group);
+    ASSERT_NE(encoded, nullptr);
+
+    fk_data_SensorGroup decoded = fk_data_SensorGroup_init_default;
+    auto decoding = fk_array_new_protobuf<fk_data_SensorAndValue>(fk_data_SensorAndValue_fields, &pool_);
+    decoding->decode_item_fn = [](pb_istream_t *stream, pb_array_t *array) {
+        fk_data_SensorAndValue sav = fk_data_SensorAndValue_init_default;
+        if (!pb_decode(stream, fk_data_SensorAndValue_fields, &sav)) {
+            return false;
+        }
+        pb_append_array(array, &sav);
+        return true;
+    };
+    decoded.readings.funcs.decode = pb_decode_array;
+    decoded.readings.arg = decoding;
+
+    auto stream = pb_istream_from_buffer(encoded->buffer(), encoded->position());
+    ASSERT_TRUE(pb_decode_delimited(&stream, fk_data_SensorGroup_fields, &decoded));
+    ASSERT_EQ(decoding->length, Items);
+    for (auto i = 0u; i < Items; ++i) {
+        ASSERT_EQ(decoding->item<fk_data_SensorAndValue>(i)->sensor, i);
+        ASSERT_EQ(decoding->item<fk_data_SensorAndValue>(i)->calibrated.calibratedValue, (float)i);
+    }
+}
+
 TEST_F(ProtoBufSizeSuite, HttpReplyStatus) {
     GlobalState gs;
     fake_global_state(gs, pool_);
@@ -347,6 +523,81 @@ TEST_F(ProtoBufSizeSuite, HttpReplyStatus) {
     ASSERT_EQ(encoded->position(), 1762u);
 }
 
+static fk_app_HttpReply decode_status(BufferPtr *buffer) {
+    fk_app_HttpReply reply = fk_app_HttpReply_init_default;
+    auto stream = pb_istream_from_buffer(buffer->buffer(), buffer->position());
+    EXPECT_TRUE(pb_decode_delimited(&stream, fk_app_HttpReply_fields, &reply));
+    EXPECT_EQ(stream.bytes_left, 0u);
+    return reply;
+}
+
+TEST_F(ProtoBufSizeSuite, HttpReplyStatusCached) {
+    GlobalState gs;
+    fake_global_state(gs, pool_);
+
+    uint8_t buffer[StatusReplyCacheSize];
+    StatusReplyCache cache{ buffer, sizeof(buffer) };
+
+    auto first = cache.encode(&gs, 1, 1580763366, 327638, get_fake_header(), pool_);
+    ASSERT_NE(first.buffer, nullptr);
+    ASSERT_FALSE(first.hit);
+
+    // Same size as encoding everything, just in a different order.
+    HttpReply reply(pool_, &gs);
+    reply.include_status(1580763366, 327638, false, get_fake_header());
+    auto encoded = pool_.encode(fk_app_HttpReply_fields, reply.reply());
+    ASSERT_EQ(first.buffer->position(), encoded->position());
+
+    auto decoded = decode_status(first.buffer);
+    ASSERT_EQ(decoded.type, fk_app_ReplyType_REPLY_STATUS);
+    ASSERT_TRUE(decoded.has_status);
+    ASSERT_EQ(decoded.status.version, 1u);
+    ASSERT_EQ(decoded.status.uptime, 327638u);
+    ASSERT_EQ(decoded.status.time, 1580763366u);
+    ASSERT_TRUE(decoded.status.has_recording);
+    ASSERT_EQ(decoded.status.recording.startedTime, gs.general.recording);
+
+    auto second = cache.encode(&gs, 1, 1580763400, 400000, get_fake_header(), pool_);
+    ASSERT_TRUE(second.hit);
+    decoded = decode_status(second.buffer);
+    ASSERT_EQ(decoded.status.uptime, 400000u);
+    ASSERT_EQ(decoded.status.time, 1580763400u);
+    ASSERT_EQ(decoded.status.recording.startedTime, gs.general.recording);
+
+    gs.general.recording = 0;
+    auto third = cache.encode(&gs, 2, 1580763400, 400000, get_fake_header(), pool_);
+    ASSERT_FALSE(third.hit);
+    decoded = decode_status(third.buffer);
+    ASSERT_FALSE(decoded.status.recording.enabled);
+    ASSERT_EQ(decoded.status.recording.startedTime, 0u);
+
+    ASSERT_EQ(cache.hits(), 1u);
+    ASSERT_EQ(cache.misses(), 2u);
+}
+
+TEST_F(ProtoBufSizeSuite, HttpReplyStatusTooLargeToCache) {
+    GlobalState gs;
+    fake_global_state(gs, pool_);
+
+    uint8_t buffer[64];
+    StatusReplyCache cache{ buffer, sizeof(buffer) };
+
+    uint8_t large_buffer[StatusReplyCacheSize];
+    StatusReplyCache large{ large_buffer, sizeof(large_buffer) };
+
+    for (auto i = 0u; i < 2; ++i) {
+        auto encoded = cache.encode(&gs, 1, 1580763366, 327638 + i, get_fake_header(), pool_);
+        ASSERT_NE(encoded.buffer, nullptr);
+        ASSERT_FALSE(encoded.hit);
+        ASSERT_EQ(decode_status(encoded.buffer).status.uptime, 327638u + i);
+
+        // Same bytes as a reply that fit.
+        auto cached = large.encode(&gs, 1, 1580763366, 327638 + i, get_fake_header(), pool_);
+        ASSERT_EQ(encoded.buffer->position(), cached.buffer->position());
+        ASSERT_EQ(memcmp(encoded.buffer->buffer(), cached.buffer->buffer(), cached.buffer->position()), 0);
+    }
+}
+
 TEST_F(ProtoBufSizeSuite, HttpReplyReadings) {
     GlobalState gs;
     fake_global_state(gs, pool_);
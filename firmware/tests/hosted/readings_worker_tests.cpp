@@ -8,6 +8,7 @@
 #include "state_manager.h"
 #include "state_ref.h"
 #include "storage_suite.h"
+#include "storage/storage_session.h"
 #include "test_modules.h"
 
 using namespace fk;
@@ -46,6 +47,38 @@ TEST_F(ReadingsWorkerSuite, OnlyDiagnosticsModule_SecondReading) {
     ASSERT_EQ(gs.get()->readings.nreadings, 2u);
 }
 
+TEST_F(ReadingsWorkerSuite, OnlyDiagnosticsModule_MountsStorageOnce) {
+    auto gs = get_global_state_ro();
+    auto session = get_storage_session();
+
+    factory_wipe();
+
+    ASSERT_FALSE(session->mounted());
+
+    auto mounts = session->statistics().nmounts;
+
+    ReadingsWorker readings_worker{ true, false, false, ModulePowerState::Unknown };
+    // A pool per run like the scheduler does, the session unmounts when
+    // pages run low.
+    for (auto i = 0u; i < 3u; ++i) {
+        StandardPool run{ "run" };
+        readings_worker.run(run);
+    }
+
+    ASSERT_EQ(gs.get()->readings.nreadings, 3u);
+    ASSERT_TRUE(session->mounted());
+    ASSERT_EQ(session->statistics().nmounts, mounts + 1);
+
+    // Anybody else mounting means the session can't trust what it has.
+    Storage storage{ memory_, pool_, false };
+    ASSERT_TRUE(storage.begin());
+    ASSERT_FALSE(session->mounted());
+
+    auto attributes = storage.data_ops()->attributes(pool_);
+    ASSERT_TRUE(attributes);
+    ASSERT_EQ(attributes->nreadings, 3u);
+}
+
 TEST_F(ReadingsWorkerSuite, ScannedModule_InvalidHeader) {
     auto mm = (LinuxModMux *)get_modmux();
 
@@ -1 +1,394 @@
+#include <chrono>
+
 #include "storage_suite.h"
+#include "storage/phylum.h"
+#include "storage/phylum_data_file.h"
+#include "storage/sequential_memory.h"
+#include "networking/file_transfer.h"
+
+using namespace fk;
+
+FK_DECLARE_LOGGER("tests");
+
+static void fake_log_record(fk_data_DataRecord &record, uint32_t seed) {
+    record = fk_data_DataRecord_init_default;
+    record.has_log = true;
+    record.log.uptime = seed;
+    record.log.time = seed * 1000;
+    record.log.level = (uint32_t)LogLevels::INFO;
+    record.log.facility.arg = (void *)"facility";
+    record.log.facility.funcs.encode = pb_encode_string;
+    record.log.message.arg = (void *)"reading taken during the benchmark";
+    record.log.message.funcs.encode = pb_encode_string;
+}
+
+TEST_F(StorageSuite, DISABLED_Benchmark_PhylumPageCache) {
+    constexpr size_t Records = 2048;
+    constexpr size_t Reads = 256;
+
+    {
+        Phylum phylum{ memory_, pool_ };
+        ASSERT_TRUE(phylum.format());
+
+        PhylumDataFile file{ phylum, pool_ };
+        ASSERT_EQ(file.create("d/00000000", pool_), 0);
+        ASSERT_EQ(file.open("d/00000000", pool_), 0);
+
+        fk_data_DataRecord record;
+        for (auto i = 0u; i < Records; ++i) {
+            StandardPool loop{ "loop" };
+            fake_log_record(record, i);
+            ASSERT_GT(file.append_always(RecordType::Data, fk_data_DataRecord_fields, &record, nullptr, loop).bytes, 0);
+        }
+
+        ASSERT_EQ(file.close(), 0);
+        ASSERT_TRUE(phylum.sync());
+    }
+
+    uint32_t flash_reads[2] = { 0, 0 };
+
+    for (auto cached : { false, true }) {
+        Phylum phylum{ memory_, pool_, cached };
+        ASSERT_TRUE(phylum.mount());
+
+        auto &stats = statistics_memory_.statistics();
+        clear_statistics();
+
+        auto started = std::chrono::steady_clock::now();
+
+        for (auto i = 0u; i < Reads; ++i) {
+            // Stride through the file so we aren't just reading from the
+            // working buffers.
+            auto number = (uint32_t)((i * 997u) % Records);
+
+            StandardPool loop{ "loop" };
+            PhylumDataFile reading{ phylum, loop };
+            ASSERT_EQ(reading.open("d/00000000", loop), 0);
+            ASSERT_GE(reading.seek_record(number), 0);
+
+            fk_data_DataRecord record = fk_data_DataRecord_init_default;
+            record.log.facility.arg = (void *)&loop;
+            record.log.facility.funcs.decode = pb_decode_string;
+            record.log.message.arg = (void *)&loop;
+            record.log.message.funcs.decode = pb_decode_string;
+            ASSERT_GT(reading.read(fk_data_DataRecord_fields, &record, loop), 0);
+            ASSERT_EQ(record.log.uptime, number);
+
+            ASSERT_EQ(reading.close(), 0);
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        auto &cache = phylum.page_cache_statistics();
+        flash_reads[cached] = stats.nreads;
+
+        auto saved = log_get_level();
+        log_configure_level(LogLevels::INFO);
+        loginfo("page-cache-bench %s reads=%zu flash-reads=%" PRIu32 " per-read=%.2f us/read=%.1f entries=%zu hits=%" PRIu32
+                " misses=%" PRIu32,
+                cached ? "on" : "off", Reads, stats.nreads, stats.nreads / (double)Reads,
+                std::chrono::duration<double, std::micro>(elapsed).count() / Reads, cache.entries, cache.hits, cache.misses);
+        log_configure_level((LogLevels)saved);
+
+        if (cached) {
+            ASSERT_GT(cache.entries, 0u);
+            ASSERT_GT(cache.hits, 0u);
+        } else {
+            ASSERT_EQ(cache.hits, 0u);
+        }
+    }
+
+    ASSERT_LT(flash_reads[1], flash_reads[0]);
+}
+
+TEST_F(StorageSuite, PhylumFindsFreeSectorsThroughVolumeEntry) {
+    {
+        Phylum phylum{ memory_, pool_ };
+        ASSERT_TRUE(phylum.format());
+        ASSERT_TRUE(phylum.sync());
+    }
+
+    Phylum phylum{ memory_, pool_ };
+    ASSERT_TRUE(phylum.mount());
+
+    directory_type dir{ phylum.pc(), 0 };
+    ASSERT_EQ(dir.mount(), 0);
+
+    auto head = dir.free_chain();
+    ASSERT_NE(head, phylum::InvalidSector);
+
+    phylum::free_sectors_chain free_sectors{ phylum.pc(), phylum::head_tail_t{ head, phylum::InvalidSector } };
+    ASSERT_EQ(free_sectors.mount(), 0);
+}
+
+TEST_F(StorageSuite, BufferedPageMemory_CoalescesWritesPerPage) {
+    auto &stats = statistics_memory_.statistics();
+    auto page_size = g_.real_page_size;
+
+    uint8_t data[64];
+    memset(data, 0xa5, sizeof(data));
+
+    {
+        BufferedPageMemory cache{ memory_, pool_, 2, &stats };
+
+        // Erased pages are read once and then written back once.
+        for (auto i = 0u; i < 8; ++i) {
+            ASSERT_EQ(cache.write(i * sizeof(data), data, sizeof(data)), (int32_t)sizeof(data));
+        }
+        ASSERT_EQ(cache.write(page_size + 16, data, sizeof(data)), (int32_t)sizeof(data));
+
+        ASSERT_EQ(stats.nwrites, 0u);
+        ASSERT_EQ(stats.cache_misses, 2u);
+        ASSERT_EQ(stats.cache_hits, 7u);
+
+        // A third page writes both back, in order, and then evicts the
+        // least recently used one.
+        uint8_t reading[64];
+        ASSERT_EQ(cache.read(page_size * 2, reading, sizeof(reading)), (int32_t)sizeof(reading));
+        ASSERT_EQ(stats.nwrites, 2u);
+        ASSERT_EQ(stats.bytes_wrote, 8u * sizeof(data) + sizeof(data));
+
+        ASSERT_EQ(cache.read(page_size + 16, reading, sizeof(reading)), (int32_t)sizeof(reading));
+        ASSERT_EQ(memcmp(reading, data, sizeof(data)), 0);
+        ASSERT_EQ(stats.cache_misses, 3u);
+
+        ASSERT_TRUE(cache.flush());
+        ASSERT_EQ(stats.nwrites, 2u);
+    }
+
+    uint8_t reading[64];
+    ASSERT_EQ(memory_->read(page_size + 16, reading, sizeof(reading)), (int32_t)sizeof(reading));
+    ASSERT_EQ(memcmp(reading, data, sizeof(data)), 0);
+}
+
+TEST_F(StorageSuite, BufferedPageMemory_HoldsPageOnlyUntilFlushed) {
+    uint8_t data[64];
+    memset(data, 0xa5, sizeof(data));
+
+    BufferedPageMemory cache{ memory_, pool_, 2, &statistics_memory_.statistics() };
+
+    uint8_t reading[64];
+    ASSERT_EQ(cache.read(0, reading, sizeof(reading)), (int32_t)sizeof(reading));
+    ASSERT_EQ(fk_standard_page_owned("page-cache"), 0u);
+
+    ASSERT_EQ(cache.write(0, data, sizeof(data)), (int32_t)sizeof(data));
+    ASSERT_EQ(fk_standard_page_owned("page-cache"), 1u);
+
+    ASSERT_EQ(cache.read(0, reading, sizeof(reading)), (int32_t)sizeof(reading));
+    ASSERT_EQ(memcmp(reading, data, sizeof(data)), 0);
+
+    ASSERT_TRUE(cache.flush());
+    ASSERT_EQ(fk_standard_page_owned("page-cache"), 0u);
+
+    ASSERT_EQ(cache.read(0, reading, sizeof(reading)), (int32_t)sizeof(reading));
+    ASSERT_EQ(memcmp(reading, data, sizeof(data)), 0);
+    ASSERT_EQ(fk_standard_page_owned("page-cache"), 0u);
+}
+
+TEST_F(StorageSuite, BufferedPageMemory_EraseDropsCachedPages) {
+    uint8_t garbage[64];
+    memset(garbage, 0x5a, sizeof(garbage));
+
+    BufferedPageMemory cache{ memory_, pool_, 2, &statistics_memory_.statistics() };
+
+    ASSERT_EQ(cache.write(0, garbage, sizeof(garbage)), (int32_t)sizeof(garbage));
+
+    uint8_t reading[64];
+    ASSERT_EQ(cache.read(0, reading, sizeof(reading)), (int32_t)sizeof(reading));
+    ASSERT_EQ(memcmp(reading, garbage, sizeof(garbage)), 0);
+
+    ASSERT_GE(cache.erase(0, g_.block_size), 0);
+
+    ASSERT_EQ(cache.read(0, reading, sizeof(reading)), (int32_t)sizeof(reading));
+    for (auto i = 0u; i < sizeof(reading); ++i) {
+        ASSERT_EQ(reading[i], 0xff);
+    }
+}
+
+class VectorWriter : public Writer {
+public:
+    std::vector<uint8_t> data;
+
+public:
+    int32_t write(uint8_t const *buffer, size_t size) override {
+        data.insert(data.end(), buffer, buffer + size);
+        return size;
+    }
+};
+
+TEST_F(StorageSuite, TransferFile_SendsFileFromRetainedBuffers) {
+    Storage storage{ memory_, pool_, false };
+    ASSERT_TRUE(storage.clear());
+
+    fk_data_DataRecord record;
+    for (auto i = 0u; i < 512; ++i) {
+        StandardPool loop{ "loop" };
+        fake_log_record(record, i);
+        ASSERT_TRUE(storage.data_ops()->write_readings(&record, loop));
+    }
+
+    size_t size = 0;
+    auto expected = storage.file_reader(Storage::Data, pool_);
+    ASSERT_EQ(expected->get_file_size(size), 0);
+    ASSERT_GT(size, 2 * NetworkBufferSize);
+    ASSERT_TRUE(expected->seek_record(0, pool_));
+
+    std::vector<uint8_t> data(size);
+    ASSERT_EQ(expected->read(data.data(), size), (int32_t)size);
+
+    auto reader = storage.file_reader(Storage::Data, pool_);
+    ASSERT_TRUE(reader->seek_record(0, pool_));
+
+    NoopProgressCallbacks callbacks;
+    ProgressTracker tracker{ &callbacks, Operation::Download, "tests", "", (uint32_t)size };
+    VectorWriter writer;
+    auto stats = transfer_file(reader, &writer, size, tracker, pool_);
+    ASSERT_FALSE(stats.failed);
+    ASSERT_TRUE(stats.overlapped);
+    ASSERT_EQ(stats.bytes, size);
+    ASSERT_EQ(stats.copied, 0u);
+    ASSERT_EQ(writer.data, data);
+}
+
+TEST_F(StorageSuite, ClearAfterFailedMount) {
+    uint8_t garbage[256];
+    memset(garbage, 0x5a, sizeof(garbage));
+    for (auto address = 0u; address < g_.block_size; address += sizeof(garbage)) {
+        ASSERT_EQ(memory_->write(address, garbage, sizeof(garbage)), (int32_t)sizeof(garbage));
+    }
+
+    {
+        Storage storage{ memory_, pool_, false };
+        ASSERT_FALSE(storage.begin());
+        ASSERT_TRUE(storage.clear());
+    }
+
+    get_storage_session()->invalidate();
+
+    Storage storage{ memory_, pool_, false };
+    ASSERT_TRUE(storage.begin());
+}
+
+TEST_F(StorageSuite, Session_ReleaseAfterClearDoesNotFlush) {
+    auto session = get_storage_session();
+    auto lock = storage_mutex.acquire(UINT32_MAX);
+
+    factory_wipe();
+
+    {
+        BorrowedStorage borrowed{ lock, memory_ };
+        ASSERT_TRUE(borrowed);
+
+        StandardPool loop{ "loop" };
+        fk_data_DataRecord record = fk_data_DataRecord_init_default;
+        ASSERT_TRUE(borrowed->data_ops()->write_readings(&record, loop));
+
+        {
+            Storage storage{ memory_, pool_, false };
+            ASSERT_TRUE(storage.clear());
+        }
+
+        clear_logs();
+    }
+
+    // Anything flushed now would land on freshly formatted flash.
+    for (auto i = 0u; i < MemoryFactory::NumberOfDataMemoryBanks; ++i) {
+        ASSERT_EQ(bank(i).log().number_of(OperationType::Write), 0);
+    }
+
+    ASSERT_FALSE(session->mounted());
+
+    Storage storage{ memory_, pool_, false };
+    ASSERT_TRUE(storage.begin());
+    ASSERT_EQ(storage.data_ops()->attributes(pool_)->records, 0u);
+}
+
+TEST_F(StorageSuite, Session_UnmountsWhenLowOnPages) {
+    auto session = get_storage_session();
+    auto lock = storage_mutex.acquire(UINT32_MAX);
+
+    factory_wipe();
+
+    void *pages[FK_MEMORY_PAGES];
+    auto npages = 0u;
+
+    {
+        BorrowedStorage borrowed{ lock, memory_ };
+        ASSERT_TRUE(borrowed);
+
+        while (fk_standard_page_meminfo().free >= StorageSessionReservedPages) {
+            pages[npages++] = fk_standard_page_malloc(StandardPageSize, "tests");
+        }
+    }
+
+    ASSERT_FALSE(session->mounted());
+
+    for (auto i = 0u; i < npages; ++i) {
+        fk_standard_page_free(pages[i]);
+    }
+
+    {
+        BorrowedStorage borrowed{ lock, memory_ };
+        ASSERT_TRUE(borrowed);
+    }
+
+    ASSERT_TRUE(session->mounted());
+}
+
+TEST_F(StorageSuite, Session_ReclaimGivesPagesBack) {
+    auto session = get_storage_session();
+    auto lock = storage_mutex.acquire(UINT32_MAX);
+
+    factory_wipe();
+
+    auto free = fk_standard_page_meminfo().free;
+
+    {
+        BorrowedStorage borrowed{ lock, memory_ };
+        ASSERT_TRUE(borrowed);
+
+        // Nobody takes storage out from under a borrower.
+        ASSERT_FALSE(session->reclaim());
+        ASSERT_TRUE(session->mounted());
+    }
+
+    ASSERT_TRUE(session->mounted());
+    ASSERT_LT(fk_standard_page_meminfo().free, free);
+
+    ASSERT_TRUE(session->reclaim());
+    ASSERT_FALSE(session->mounted());
+    ASSERT_EQ(fk_standard_page_meminfo().free, free);
+}
+
+TEST_F(StorageSuite, Session_ReclaimedWhenOutOfPages) {
+    auto session = get_storage_session();
+    auto lock = storage_mutex.acquire(UINT32_MAX);
+
+    factory_wipe();
+
+    auto free = fk_standard_page_meminfo().free;
+
+    {
+        BorrowedStorage borrowed{ lock, memory_ };
+        ASSERT_TRUE(borrowed);
+    }
+
+    ASSERT_TRUE(session->mounted());
+
+    // Running out unmounts the session rather than waiting on it.
+    void *pages[FK_MEMORY_PAGES];
+    auto npages = 0u;
+    while (true) {
+        auto ptr = fk_standard_page_malloc_wait(StandardPageSize, "tests", 0);
+        if (ptr == nullptr) {
+            break;
+        }
+        pages[npages++] = ptr;
+    }
+
+    ASSERT_FALSE(session->mounted());
+    ASSERT_EQ(npages, free);
+
+    for (auto i = 0u; i < npages; ++i) {
+        fk_standard_page_free(pages[i]);
+    }
+}
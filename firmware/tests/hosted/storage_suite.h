@@ -4,6 +4,7 @@
 #include "pool.h"
 #include "hal/linux/linux.h"
 #include "storage/storage.h"
+#include "storage/storage_session.h"
 #include "storage/factory_wipe.h"
 #include "state_ref.h"
 #include "protobuf.h"
@@ -36,6 +37,9 @@ protected:
         g_ = memory_->geometry();
         pool_.clear();
 
+        // Erasing underneath a mounted session would leave it stale.
+        get_storage_session()->invalidate();
+
         for (auto i = 0u; i < MemoryFactory::NumberOfDataMemoryBanks; ++i) {
             banks_[i]->erase_all();
         }
@@ -47,6 +51,8 @@ protected:
     }
 
     void TearDown() override {
+        get_storage_session()->invalidate();
+
         auto erases = 0;
         auto reads = 0;
         auto writes = 0;
@@ -1,6 +1,15 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include "tests.h"
 #include "worker.h"
 #include "collections.h"
+#include "hal/mutex.h"
+#include "modules/registry.h"
+#include "modules/unknown.h"
+#include "state/modules.h"
+#include "test_modules.h"
 
 using namespace fk;
 
@@ -118,6 +127,95 @@ TEST_F(PoolSuite, SimpleCollection) {
     nested.emplace(0, std::move(integers));
 }
 
+template <size_t ChunkSize> static void check_collection(Pool &pool) {
+    collection<uint32_t, ChunkSize> integers{ pool };
+    ASSERT_EQ(integers.size(), 0u);
+    ASSERT_EQ(integers.get(0), nullptr);
+    ASSERT_FALSE(integers.begin() != integers.end());
+
+    for (auto i = 0u; i < 21; ++i) {
+        integers.add(i * 10);
+        ASSERT_EQ(integers.size(), i + 1);
+        ASSERT_EQ(*integers.get(i), i * 10);
+    }
+
+    ASSERT_EQ(integers.get(21), nullptr);
+
+    auto expected = 0u;
+    for (auto i : integers) {
+        ASSERT_EQ(i, expected * 10);
+        expected++;
+    }
+    ASSERT_EQ(expected, 21u);
+
+    for (auto i = 0u; i < 21; ++i) {
+        ASSERT_EQ(*integers.get(i), i * 10);
+    }
+
+    // Going backwards starts over from the head.
+    ASSERT_EQ(*integers.get(3), 30u);
+    ASSERT_EQ(*integers.get(1), 10u);
+
+    auto moved = std::move(integers);
+    ASSERT_EQ(integers.size(), 0u);
+    ASSERT_EQ(moved.size(), 21u);
+    ASSERT_EQ(*moved.get(20), 200u);
+}
+
+TEST_F(PoolSuite, CollectionAppendSizeAndIndex) {
+    StaticPool<2048> pool("Pool");
+    check_collection<1>(pool);
+    check_collection<4>(pool);
+    check_collection<7>(pool);
+}
+
+TEST_F(PoolSuite, CollectionCopiesAreIndependent) {
+    StandardPool pool{ "pool" };
+    collection<uint32_t, 3> integers{ pool };
+
+    for (auto i = 0u; i < 4; ++i) {
+        integers.add(i);
+    }
+
+    collection<uint32_t, 3> copy{ integers };
+    ASSERT_EQ(copy.size(), 4u);
+
+    copy.add(100);
+    integers.add(200);
+    *integers.get(0) = 300;
+
+    ASSERT_EQ(integers.size(), 5u);
+    ASSERT_EQ(copy.size(), 5u);
+    ASSERT_EQ(*integers.get(0), 300u);
+    ASSERT_EQ(*integers.get(4), 200u);
+    ASSERT_EQ(*copy.get(0), 0u);
+    ASSERT_EQ(*copy.get(4), 100u);
+
+    auto n = 0u;
+    for (auto i : copy) {
+        ASSERT_EQ(i, n < 4 ? n : 100u);
+        n++;
+    }
+    ASSERT_EQ(n, 5u);
+}
+
+TEST_F(PoolSuite, CollectionSort) {
+    StaticPool<2048> pool("Pool");
+    collection<int32_t, 3> integers{ pool };
+    for (auto i : { 5, 3, 9, 1, 7, 2, 8 }) {
+        integers.add(i);
+    }
+
+    ASSERT_TRUE(integers.sort([](int32_t i) { return i; }));
+    ASSERT_FALSE(integers.sort([](int32_t i) { return i; }));
+
+    auto previous = 0;
+    for (auto i : integers) {
+        ASSERT_GT(i, previous);
+        previous = i;
+    }
+}
+
 TEST_F(PoolSuite, SimpleHashMap) {
     StaticPool<2048> pool("Pool");
     hash_map<uint32_t, uint32_t> integers{ pool };
@@ -234,6 +332,129 @@ TEST_F(PoolSuite, AllocatingSiblings) {
     fk_standard_page_log();
 }
 
+TEST_F(PoolSuite, StandardPageFreeListAndOwners) {
+    auto owned = fk_standard_page_owned("test-owner");
+
+    auto p1 = fk_standard_page_malloc(StandardPageSize, "test-owner");
+    auto p2 = fk_standard_page_malloc(StandardPageSize, "test-owner");
+    ASSERT_NE(p1, p2);
+    ASSERT_EQ(fk_standard_page_owned("test-owner"), owned + 2u);
+
+    // Last freed is the first reused.
+    fk_standard_page_free(p1);
+    ASSERT_EQ(fk_standard_page_owned("test-owner"), owned + 1u);
+    auto p3 = fk_standard_page_malloc(StandardPageSize, "other-owner");
+    ASSERT_EQ(p3, p1);
+    ASSERT_EQ(fk_standard_page_owned("other-owner"), 1u);
+
+    fk_standard_page_free(p2);
+    fk_standard_page_free(p3);
+    ASSERT_EQ(fk_standard_page_owned("test-owner"), owned);
+    ASSERT_EQ(fk_standard_page_owned("other-owner"), 0u);
+}
+
+TEST_F(PoolSuite, StandardPageMallocWaitGivesUp) {
+    auto before = fk_standard_page_meminfo();
+    ASSERT_GT(before.free, 0u);
+
+    void *taken[FK_MEMORY_PAGES] = { nullptr };
+    auto ntaken = 0u;
+    while (true) {
+        auto ptr = fk_standard_page_malloc_wait(StandardPageSize, "test-wait", 0);
+        if (ptr == nullptr) {
+            break;
+        }
+        taken[ntaken++] = ptr;
+    }
+
+    ASSERT_EQ(ntaken, before.free);
+    ASSERT_EQ(fk_standard_page_meminfo().free, 0u);
+    ASSERT_EQ(fk_standard_page_meminfo().highwater, before.total);
+    ASSERT_EQ(fk_standard_page_malloc_wait(StandardPageSize, "test-wait", 100), nullptr);
+
+    fk_standard_page_free(taken[--ntaken]);
+    auto ptr = fk_standard_page_malloc_wait(StandardPageSize, "test-wait", 100);
+    ASSERT_NE(ptr, nullptr);
+    taken[ntaken++] = ptr;
+
+    for (auto i = 0u; i < ntaken; ++i) {
+        fk_standard_page_free(taken[i]);
+    }
+
+    ASSERT_EQ(fk_standard_page_meminfo().free, before.free);
+    ASSERT_EQ(fk_standard_page_owned("test-wait"), 0u);
+}
+
+TEST_F(PoolSuite, StandardPageMallocWaitGetsFreedPage) {
+    auto before = fk_standard_page_meminfo();
+
+    void *taken[FK_MEMORY_PAGES] = { nullptr };
+    auto ntaken = 0u;
+    while (true) {
+        auto ptr = fk_standard_page_malloc_wait(StandardPageSize, "test-wait", 0);
+        if (ptr == nullptr) {
+            break;
+        }
+        taken[ntaken++] = ptr;
+    }
+
+    ASSERT_EQ(fk_standard_page_meminfo().free, 0u);
+
+    std::atomic<bool> waiting{ false };
+    auto freeing = taken[--ntaken];
+    std::thread other([&]() {
+        while (!waiting) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        fk_standard_page_free(freeing);
+    });
+
+    // Delays return immediately when hosted, so this is really the number
+    // of times we'll look for a page, plenty to outlast the other thread.
+    auto started = std::chrono::steady_clock::now();
+    waiting = true;
+    auto ptr = fk_standard_page_malloc_wait(StandardPageSize, "test-wait", UINT32_MAX / 2);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    other.join();
+
+    ASSERT_EQ(ptr, freeing);
+    ASSERT_GE(elapsed, std::chrono::milliseconds(50));
+    taken[ntaken++] = ptr;
+
+    for (auto i = 0u; i < ntaken; ++i) {
+        fk_standard_page_free(taken[i]);
+    }
+
+    ASSERT_EQ(fk_standard_page_meminfo().free, before.free);
+    ASSERT_EQ(fk_standard_page_owned("test-wait"), 0u);
+}
+
+TEST_F(PoolSuite, LocksHeldAreCounted) {
+    NoopMutex mutex;
+
+    ASSERT_EQ(fk_task_locks_held(), 0u);
+
+    {
+        auto outer = mutex.acquire(UINT32_MAX);
+        ASSERT_EQ(fk_task_locks_held(), 1u);
+
+        {
+            auto inner = mutex.acquire(UINT32_MAX);
+            auto moved = std::move(inner);
+            ASSERT_EQ(fk_task_locks_held(), 2u);
+        }
+
+        ASSERT_EQ(fk_task_locks_held(), 1u);
+
+        std::thread other([&]() { ASSERT_EQ(fk_task_locks_held(), 0u); });
+        other.join();
+    }
+
+    ASSERT_EQ(fk_task_locks_held(), 0u);
+}
+
 TEST_F(PoolSuite, Subpool) {
     StandardPool pool{ "top" };
 
@@ -366,3 +587,185 @@ TEST_F(PoolSuite, PoolCopyBufferPtr) {
     ASSERT_EQ(cloned->length(), buffer->length());
     ASSERT_EQ(cloned->size(), buffer->size());
 }
+
+TEST_F(PoolSuite, PoolMapPutGetRemove) {
+    pool_map<uint32_t, uint32_t, 8> map;
+
+    ASSERT_EQ(map.size(), 0u);
+    ASSERT_EQ(map.NumberOfSlots, 16u);
+
+    for (auto i = 0u; i < 8; ++i) {
+        ASSERT_TRUE(map.put(i * 16, i));
+    }
+
+    ASSERT_TRUE(map.full());
+    ASSERT_FALSE(map.put(1000, 1000));
+
+    // Replacing doesn't need room.
+    ASSERT_TRUE(map.put(32, 100));
+    ASSERT_EQ(map.size(), 8u);
+
+    uint32_t value = 0;
+    ASSERT_TRUE(map.get(32, value));
+    ASSERT_EQ(value, 100u);
+    ASSERT_FALSE(map.get(1000, value));
+
+    // Removing from the middle of runs has to keep the rest reachable.
+    for (auto i = 0u; i < 8; i += 2) {
+        ASSERT_TRUE(map.remove(i * 16));
+    }
+    ASSERT_FALSE(map.remove(0));
+    ASSERT_EQ(map.size(), 4u);
+
+    for (auto i = 0u; i < 8; ++i) {
+        ASSERT_EQ(map.find(i * 16) != nullptr, i % 2 == 1);
+    }
+
+    map.clear();
+    ASSERT_EQ(map.size(), 0u);
+    ASSERT_EQ(map.find(16), nullptr);
+}
+
+TEST_F(PoolSuite, PoolMapModulesByIdFollowsChanges) {
+    StandardPool pool{ "modules" };
+    state::AttachedModules attached{ pool };
+
+    ModuleHeader headers[MaximumNumberOfPhysicalModules];
+    for (auto i = 0u; i < MaximumNumberOfPhysicalModules; ++i) {
+        bzero(&headers[i], sizeof(ModuleHeader));
+        fk_uuid_generate(&headers[i].id);
+        attached.modules().emplace(ModulePosition::from(i), headers[i], &fk_test_module_fake_1, nullptr, pool);
+    }
+
+    for (auto i = 0u; i < MaximumNumberOfPhysicalModules; ++i) {
+        ASSERT_EQ(attached.get_by_id(headers[i].id)->position(), ModulePosition::from(i));
+    }
+
+    // Rescanning can find as many modules as before, just not the same ones.
+    ModuleHeader replaced[MaximumNumberOfPhysicalModules];
+    attached.modules() = collection<state::AttachedModule>{ pool };
+    for (auto i = 0u; i < MaximumNumberOfPhysicalModules; ++i) {
+        bzero(&replaced[i], sizeof(ModuleHeader));
+        fk_uuid_generate(&replaced[i].id);
+        attached.modules().emplace(ModulePosition::from(i), replaced[i], &fk_test_module_fake_1, nullptr, pool);
+    }
+
+    for (auto i = 0u; i < MaximumNumberOfPhysicalModules; ++i) {
+        ASSERT_EQ(attached.get_by_id(headers[i].id), nullptr);
+        ASSERT_EQ(attached.get_by_id(replaced[i].id)->position(), ModulePosition::from(i));
+    }
+}
+
+static void log_lookups_per_second(const char *name, size_t nlookups, std::chrono::steady_clock::duration elapsed) {
+    auto saved = log_get_level();
+    log_configure_level(LogLevels::INFO);
+
+    auto seconds = std::chrono::duration<double>(elapsed).count();
+    loginfo("lookup-bench %s lookups=%zu elapsed=%.3fs ns/lookup=%.1f", name, nlookups, seconds, seconds * 1e9 / nlookups);
+
+    log_configure_level((LogLevels)saved);
+}
+
+TEST_F(PoolSuite, DISABLED_Benchmark_PoolMapModuleRegistry) {
+    constexpr size_t Lookups = 1000000;
+    constexpr size_t Modules = 4;
+
+    static ModuleMetadata metas[Modules];
+    ModuleHeader headers[Modules + 1];
+    for (auto i = 0u; i < Modules; ++i) {
+        metas[i] = fk_test_module_fake_2;
+        metas[i].kind = 0x70 + i;
+        fk_modules_builtin_register(&metas[i]);
+
+        bzero(&headers[i], sizeof(ModuleHeader));
+        headers[i].manufacturer = metas[i].manufacturer;
+        headers[i].kind = metas[i].kind;
+        headers[i].version = metas[i].version;
+    }
+
+    // And one we'll never find.
+    bzero(&headers[Modules], sizeof(ModuleHeader));
+    headers[Modules].kind = 0xff;
+
+    ModuleRegistry registry;
+    for (auto i = 0u; i < Modules; ++i) {
+        ASSERT_EQ(registry.resolve(headers[i]), &metas[i]);
+    }
+    ASSERT_EQ(registry.resolve(headers[Modules]), &fk_unknown_module);
+
+    // What resolve did before, walking every builtin module.
+    ModuleMetadata const *table[20];
+    for (auto i = 0u; i < 20; ++i) {
+        table[i] = i < 20 - Modules ? &fk_test_module_fake_1 : &metas[i - (20 - Modules)];
+    }
+
+    volatile uintptr_t sink = 0;
+
+    auto started = std::chrono::steady_clock::now();
+    for (auto i = 0u; i < Lookups; ++i) {
+        auto &header = headers[i % (Modules + 1)];
+        ModuleMetadata const *found = &fk_unknown_module;
+        for (auto meta : table) {
+            if (header.manufacturer == meta->manufacturer && header.kind == meta->kind && header.version == meta->version) {
+                found = meta;
+                break;
+            }
+        }
+        sink = sink + (uintptr_t)found;
+    }
+    log_lookups_per_second("registry-linear", Lookups, std::chrono::steady_clock::now() - started);
+
+    started = std::chrono::steady_clock::now();
+    for (auto i = 0u; i < Lookups; ++i) {
+        sink = sink + (uintptr_t)registry.resolve(headers[i % (Modules + 1)]);
+    }
+    log_lookups_per_second("registry-map", Lookups, std::chrono::steady_clock::now() - started);
+}
+
+TEST_F(PoolSuite, DISABLED_Benchmark_PoolMapModulesById) {
+    constexpr size_t Lookups = 1000000;
+
+    StandardPool pool{ "modules" };
+    state::AttachedModules attached{ pool };
+
+    ModuleHeader headers[MaximumNumberOfPhysicalModules];
+    for (auto i = 0u; i < MaximumNumberOfPhysicalModules; ++i) {
+        bzero(&headers[i], sizeof(ModuleHeader));
+        fk_uuid_generate(&headers[i].id);
+        attached.modules().emplace(ModulePosition::from(i), headers[i], &fk_test_module_fake_1, nullptr, pool);
+    }
+
+    for (auto i = 0u; i < MaximumNumberOfPhysicalModules; ++i) {
+        auto am = attached.get_by_id(headers[i].id);
+        ASSERT_NE(am, nullptr);
+        ASSERT_EQ(am->position(), ModulePosition::from(i));
+    }
+
+    // Modules added afterwards are picked up too.
+    ModuleHeader added;
+    bzero(&added, sizeof(ModuleHeader));
+    fk_uuid_generate(&added.id);
+    ASSERT_EQ(attached.get_by_id(added.id), nullptr);
+    attached.modules().emplace(ModulePosition::from(MaximumNumberOfPhysicalModules), added, &fk_test_module_fake_1, nullptr, pool);
+    ASSERT_NE(attached.get_by_id(added.id), nullptr);
+
+    volatile uintptr_t sink = 0;
+
+    auto started = std::chrono::steady_clock::now();
+    for (auto i = 0u; i < Lookups; ++i) {
+        auto &id = headers[i % MaximumNumberOfPhysicalModules].id;
+        for (auto &am : attached.modules()) {
+            if (am.has_id(id)) {
+                sink = sink + (uintptr_t)&am;
+                break;
+            }
+        }
+    }
+    log_lookups_per_second("modules-by-id-linear", Lookups, std::chrono::steady_clock::now() - started);
+
+    started = std::chrono::steady_clock::now();
+    for (auto i = 0u; i < Lookups; ++i) {
+        sink = sink + (uintptr_t)attached.get_by_id(headers[i % MaximumNumberOfPhysicalModules].id);
+    }
+    log_lookups_per_second("modules-by-id-map", Lookups, std::chrono::steady_clock::now() - started);
+}
@@ -0,0 +1,144 @@
+#include "tests.h"
+
+#include "hal/ipc.h"
+#include "hal/worker_queue.h"
+
+using namespace fk;
+
+class WorkerQueueSuite : public ::testing::Test {
+};
+
+class PriorityWorker : public TaskWorker {
+private:
+    const char *name_;
+    uint8_t priority_;
+
+public:
+    PriorityWorker(const char *name, uint8_t priority) : name_(name), priority_(priority) {
+    }
+
+public:
+    void run() override {
+    }
+
+    uint8_t priority() const override {
+        return priority_;
+    }
+
+    const char *name() const override {
+        return name_;
+    }
+};
+
+static auto always = [](WorkerCategory category, bool concurrency_allowed) { return true; };
+
+TEST_F(WorkerQueueSuite, HighestPriorityFirstThenInOrder) {
+    PriorityWorker low1{ "low1", 1 };
+    PriorityWorker low2{ "low2", 1 };
+    PriorityWorker high{ "high", 5 };
+
+    WorkerQueue queue;
+    ASSERT_TRUE(queue.push(WorkerCategory::None, &low1, false, 10));
+    ASSERT_TRUE(queue.push(WorkerCategory::None, &high, false, 20));
+    ASSERT_TRUE(queue.push(WorkerCategory::None, &low2, false, 30));
+    ASSERT_EQ(queue.size(), 3u);
+
+    QueuedWorker popped;
+    ASSERT_TRUE(queue.pop(popped, 100, always));
+    ASSERT_STREQ(popped.worker->name(), "high");
+    ASSERT_TRUE(queue.pop(popped, 100, always));
+    ASSERT_STREQ(popped.worker->name(), "low1");
+    ASSERT_TRUE(queue.pop(popped, 100, always));
+    ASSERT_STREQ(popped.worker->name(), "low2");
+    ASSERT_FALSE(queue.pop(popped, 100, always));
+
+    auto &stats = queue.statistics();
+    ASSERT_EQ(stats.queued, 3u);
+    ASSERT_EQ(stats.started, 3u);
+    ASSERT_EQ(stats.total_wait, 90u + 80u + 70u);
+    ASSERT_EQ(stats.longest_wait, 90u);
+}
+
+TEST_F(WorkerQueueSuite, SkipsCategoriesThatCantLaunch) {
+    PriorityWorker readings{ "readings", 5 };
+    PriorityWorker upload{ "upload", 1 };
+
+    WorkerQueue queue;
+    ASSERT_TRUE(queue.push(WorkerCategory::Readings, &readings, false, 0));
+    ASSERT_TRUE(queue.push(WorkerCategory::Transfer, &upload, false, 0));
+    ASSERT_EQ(queue.count(WorkerCategory::Readings), 1u);
+
+    QueuedWorker popped;
+    auto no_readings = [](WorkerCategory category, bool concurrency_allowed) { return category != WorkerCategory::Readings; };
+    ASSERT_TRUE(queue.pop(popped, 0, no_readings));
+    ASSERT_STREQ(popped.worker->name(), "upload");
+    ASSERT_FALSE(queue.pop(popped, 0, no_readings));
+    ASSERT_TRUE(queue.pop(popped, 0, always));
+    ASSERT_STREQ(popped.worker->name(), "readings");
+}
+
+TEST_F(WorkerQueueSuite, Bounded) {
+    PriorityWorker worker{ "worker", 1 };
+
+    WorkerQueue queue;
+    for (auto i = 0u; i < WorkerQueueSize; ++i) {
+        ASSERT_TRUE(queue.push(WorkerCategory::None, &worker, false, 0));
+    }
+    ASSERT_FALSE(queue.push(WorkerCategory::None, &worker, false, 0));
+    ASSERT_EQ(queue.statistics().dropped, 1u);
+}
+
+TEST_F(WorkerQueueSuite, RemovingCategory) {
+    PriorityWorker lora1{ "lora1", 1 };
+    PriorityWorker other{ "other", 1 };
+    PriorityWorker lora2{ "lora2", 1 };
+
+    WorkerQueue queue;
+    ASSERT_TRUE(queue.push(WorkerCategory::Lora, &lora1, false, 0));
+    ASSERT_TRUE(queue.push(WorkerCategory::None, &other, false, 0));
+    ASSERT_TRUE(queue.push(WorkerCategory::Lora, &lora2, false, 0));
+
+    auto removed = 0u;
+    ASSERT_EQ(queue.remove(WorkerCategory::Lora, [&](TaskWorker *worker) { removed++; }), 2u);
+    ASSERT_EQ(removed, 2u);
+    ASSERT_EQ(queue.size(), 1u);
+    ASSERT_STREQ(queue[0].worker->name(), "other");
+}
+
+TEST_F(WorkerQueueSuite, StartsQueuedOnTasksThatFinishedEmptyHanded) {
+    PriorityWorker late{ "late", 1 };
+    PriorityWorker readings{ "readings", 5 };
+
+    // Both tasks are running, though task 1 has already been told there's
+    // nothing queued for it and is on its way out.
+    bool running[2] = { true, true };
+    TaskWorker *started[2] = { nullptr, nullptr };
+    auto idle = [&](size_t task) { return !running[task]; };
+    auto start = [&](size_t task, QueuedWorker &queued) {
+        running[task] = true;
+        started[task] = queued.worker;
+    };
+    auto no_readings = [](WorkerCategory category, bool concurrency_allowed) { return category != WorkerCategory::Readings; };
+
+    WorkerQueue queue;
+    ASSERT_TRUE(queue.push(WorkerCategory::Readings, &readings, false, 0));
+    ASSERT_TRUE(queue.push(WorkerCategory::None, &late, false, 10));
+
+    ASSERT_EQ(queue.start_idle(2, 20, idle, no_readings, start), 0u);
+    ASSERT_EQ(queue.size(), 2u);
+
+    running[1] = false;
+
+    ASSERT_EQ(queue.start_idle(2, 30, idle, no_readings, start), 1u);
+    ASSERT_EQ(started[0], nullptr);
+    ASSERT_EQ(started[1], &late);
+    ASSERT_EQ(queue.size(), 1u);
+    ASSERT_EQ(queue.statistics().longest_wait, 20u);
+
+    // Readings wait for can_launch to allow them, even with a task idle.
+    running[0] = false;
+    ASSERT_EQ(queue.start_idle(2, 40, idle, no_readings, start), 0u);
+    ASSERT_EQ(queue.start_idle(2, 40, idle, always, start), 1u);
+    ASSERT_EQ(started[0], &readings);
+    ASSERT_TRUE(queue.empty());
+}
@@ -33,7 +33,9 @@
 #if !defined(le64toh)
 #define le64toh(x)          (x)
 #endif
-#define pgm_read_byte(x)    (*(x))
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define BLAKE2B_LITTLE_ENDIAN 1
+#endif
 
 void clean(void *dest, size_t size);
 
@@ -224,6 +226,14 @@ void BLAKE2b::reset(const void *key, size_t keyLen, uint8_t outputLength)
     state.lengthHigh = 0;
 }
 
+inline void BLAKE2b::addLength(size_t len)
+{
+    uint64_t temp = state.lengthLow;
+    state.lengthLow += len;
+    if (state.lengthLow < temp)
+        ++state.lengthHigh;
+}
+
 void BLAKE2b::update(const void *data, size_t len)
 {
     // Break the input up into 1024-bit chunks and process each in turn.
@@ -232,18 +242,34 @@ void BLAKE2b::update(const void *data, size_t len)
         if (state.chunkSize == 128) {
             // Previous chunk was full and we know that it wasn't the
             // last chunk, so we can process it now with f0 set to zero.
-            processChunk(0);
+            processChunk(state.m, 0);
             state.chunkSize = 0;
         }
+        if (state.chunkSize == 0) {
+            // Whole chunks are compressed straight from the caller's
+            // buffer when it's aligned, always holding the last one back
+            // in case it turns out to be the final chunk.
+            while (len > 128) {
+                addLength(128);
+#if defined(BLAKE2B_LITTLE_ENDIAN)
+                if (((uintptr_t)d & (sizeof(uint64_t) - 1)) == 0) {
+                    processChunk((const uint64_t *)d, 0);
+                } else
+#endif
+                {
+                    memcpy(state.m, d, 128);
+                    processChunk(state.m, 0);
+                }
+                len -= 128;
+                d += 128;
+            }
+        }
         uint8_t size = 128 - state.chunkSize;
         if (size > len)
             size = len;
         memcpy(((uint8_t *)state.m) + state.chunkSize, d, size);
         state.chunkSize += size;
-        uint64_t temp = state.lengthLow;
-        state.lengthLow += size;
-        if (state.lengthLow < temp)
-            ++state.lengthHigh;
+        addLength(size);
         len -= size;
         d += size;
     }
@@ -253,7 +279,7 @@ void BLAKE2b::finalize(void *hash, size_t len)
 {
     // Pad the last chunk and hash it with f0 set to all-ones.
     memset(((uint8_t *)state.m) + state.chunkSize, 0, 128 - state.chunkSize);
-    processChunk(0xFFFFFFFFFFFFFFFFULL);
+    processChunk(state.m, 0xFFFFFFFFFFFFFFFFULL);
 
     // Convert the hash into little-endian in the message buffer.
     for (uint8_t posn = 0; posn < 8; ++posn)
@@ -271,11 +297,52 @@ void BLAKE2b::clear()
     reset();
 }
 
+/**
+ * \brief Saves the state of a hash in progress so that it can be resumed
+ * later, possibly after a restart.
+ *
+ * \param buffer Receives StateSize bytes of state.
+ *
+ * \sa restoreState()
+ */
+void BLAKE2b::saveState(void *buffer) const
+{
+    uint8_t *p = (uint8_t *)buffer;
+    memcpy(p, state.h, sizeof(state.h));
+    p += sizeof(state.h);
+    memcpy(p, state.m, sizeof(state.m));
+    p += sizeof(state.m);
+    memcpy(p, &state.lengthLow, sizeof(state.lengthLow));
+    p += sizeof(state.lengthLow);
+    memcpy(p, &state.lengthHigh, sizeof(state.lengthHigh));
+    p += sizeof(state.lengthHigh);
+    *p = state.chunkSize;
+}
+
+/**
+ * \brief Resumes a hash from state saved by saveState().
+ *
+ * \param buffer Points to StateSize bytes of state.
+ */
+void BLAKE2b::restoreState(const void *buffer)
+{
+    const uint8_t *p = (const uint8_t *)buffer;
+    memcpy(state.h, p, sizeof(state.h));
+    p += sizeof(state.h);
+    memcpy(state.m, p, sizeof(state.m));
+    p += sizeof(state.m);
+    memcpy(&state.lengthLow, p, sizeof(state.lengthLow));
+    p += sizeof(state.lengthLow);
+    memcpy(&state.lengthHigh, p, sizeof(state.lengthHigh));
+    p += sizeof(state.lengthHigh);
+    state.chunkSize = *p;
+}
+
 void BLAKE2b::resetHMAC(const void *key, size_t keyLen)
 {
     formatHMACKey(state.m, key, keyLen, 0x36);
     state.lengthLow += 128;
-    processChunk(0);
+    processChunk(state.m, 0);
 }
 
 void BLAKE2b::finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen)
@@ -284,7 +351,7 @@ void BLAKE2b::finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t ha
     finalize(temp, sizeof(temp));
     formatHMACKey(state.m, key, keyLen, 0x5C);
     state.lengthLow += 128;
-    processChunk(0);
+    processChunk(state.m, 0);
     update(temp, sizeof(temp));
     finalize(hash, hashLen);
     clean(temp);
@@ -306,62 +373,74 @@ static const uint8_t sigma[12][16] = {
     {14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3},
 };
 
-// Perform a BLAKE2b quarter round operation.
-#define quarterRound(a, b, c, d, i)    \
+// Perform a BLAKE2b mixing operation on one column or diagonal. The
+// working state lives in locals rather than an array so the compiler can
+// keep it in registers.
+#define G(r, i, a, b, c, d) \
     do { \
-        uint64_t _b = (b); \
-        uint64_t _a = (a) + _b + state.m[pgm_read_byte(&(sigma[index][2 * (i)]))]; \
-        uint64_t _d = rightRotate32_64((d) ^ _a); \
-        uint64_t _c = (c) + _d; \
-        _b = rightRotate24_64(_b ^ _c); \
-        _a += _b + state.m[pgm_read_byte(&(sigma[index][2 * (i) + 1]))]; \
-        (d) = _d = rightRotate16_64(_d ^ _a); \
-        _c += _d; \
-        (a) = _a; \
-        (b) = rightRotate63_64(_b ^ _c); \
-        (c) = _c; \
+        a += b + m[sigma[r][2 * (i)]]; \
+        d = rightRotate32_64(d ^ a); \
+        c += d; \
+        b = rightRotate24_64(b ^ c); \
+        a += b + m[sigma[r][2 * (i) + 1]]; \
+        d = rightRotate16_64(d ^ a); \
+        c += d; \
+        b = rightRotate63_64(b ^ c); \
     } while (0)
 
-void BLAKE2b::processChunk(uint64_t f0)
-{
-    uint8_t index;
-    uint64_t v[16];
+#define ROUND(r) \
+    do { \
+        G(r, 0, v0, v4, v8,  v12); \
+        G(r, 1, v1, v5, v9,  v13); \
+        G(r, 2, v2, v6, v10, v14); \
+        G(r, 3, v3, v7, v11, v15); \
+        G(r, 4, v0, v5, v10, v15); \
+        G(r, 5, v1, v6, v11, v12); \
+        G(r, 6, v2, v7, v8,  v13); \
+        G(r, 7, v3, v4, v9,  v14); \
+    } while (0)
 
-    // Byte-swap the message buffer into little-endian if necessary.
-#if !defined(CRYPTO_LITTLE_ENDIAN)
-    for (index = 0; index < 16; ++index)
-        state.m[index] = le64toh(state.m[index]);
+void BLAKE2b::processChunk(const uint64_t *block, uint64_t f0)
+{
+#if defined(BLAKE2B_LITTLE_ENDIAN)
+    const uint64_t *m = block;
+#else
+    uint64_t m[16];
+    for (uint8_t index = 0; index < 16; ++index)
+        m[index] = le64toh(block[index]);
 #endif
 
     // Format the block to be hashed.
-    memcpy(v, state.h, sizeof(state.h));
-    v[8]  = BLAKE2b_IV0;
-    v[9]  = BLAKE2b_IV1;
-    v[10] = BLAKE2b_IV2;
-    v[11] = BLAKE2b_IV3;
-    v[12] = BLAKE2b_IV4 ^ state.lengthLow;
-    v[13] = BLAKE2b_IV5 ^ state.lengthHigh;
-    v[14] = BLAKE2b_IV6 ^ f0;
-    v[15] = BLAKE2b_IV7;
+    uint64_t v0 = state.h[0];
+    uint64_t v1 = state.h[1];
+    uint64_t v2 = state.h[2];
+    uint64_t v3 = state.h[3];
+    uint64_t v4 = state.h[4];
+    uint64_t v5 = state.h[5];
+    uint64_t v6 = state.h[6];
+    uint64_t v7 = state.h[7];
+    uint64_t v8 = BLAKE2b_IV0;
+    uint64_t v9 = BLAKE2b_IV1;
+    uint64_t v10 = BLAKE2b_IV2;
+    uint64_t v11 = BLAKE2b_IV3;
+    uint64_t v12 = BLAKE2b_IV4 ^ state.lengthLow;
+    uint64_t v13 = BLAKE2b_IV5 ^ state.lengthHigh;
+    uint64_t v14 = BLAKE2b_IV6 ^ f0;
+    uint64_t v15 = BLAKE2b_IV7;
 
     // Perform the 12 BLAKE2b rounds.
-    for (index = 0; index < 12; ++index) {
-        // Column round.
-        quarterRound(v[0], v[4], v[8],  v[12], 0);
-        quarterRound(v[1], v[5], v[9],  v[13], 1);
-        quarterRound(v[2], v[6], v[10], v[14], 2);
-        quarterRound(v[3], v[7], v[11], v[15], 3);
-
-        // Diagonal round.
-        quarterRound(v[0], v[5], v[10], v[15], 4);
-        quarterRound(v[1], v[6], v[11], v[12], 5);
-        quarterRound(v[2], v[7], v[8],  v[13], 6);
-        quarterRound(v[3], v[4], v[9],  v[14], 7);
-    }
+    for (uint8_t r = 0; r < 12; ++r)
+        ROUND(r);
 
     // Combine the new and old hash values.
-    for (index = 0; index < 8; ++index)
-        state.h[index] ^= (v[index] ^ v[index + 8]);
+    state.h[0] ^= v0 ^ v8;
+    state.h[1] ^= v1 ^ v9;
+    state.h[2] ^= v2 ^ v10;
+    state.h[3] ^= v3 ^ v11;
+    state.h[4] ^= v4 ^ v12;
+    state.h[5] ^= v5 ^ v13;
+    state.h[6] ^= v6 ^ v14;
+    state.h[7] ^= v7 ^ v15;
 }
 
 /**
@@ -43,6 +43,11 @@ public:
 
     void clear();
 
+    static const size_t StateSize = 8 * 8 + 16 * 8 + 8 + 8 + 1;
+
+    void saveState(void *buffer) const;
+    void restoreState(const void *buffer);
+
     void resetHMAC(const void *key, size_t keyLen);
     void finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen);
 
@@ -55,7 +60,8 @@ private:
         uint8_t chunkSize;
     } state;
 
-    void processChunk(uint64_t f0);
+    void addLength(size_t len);
+    void processChunk(const uint64_t *block, uint64_t f0);
     void formatHMACKey(void *block, const void *key, size_t len, uint8_t pad);
 };
 
@@ -10,6 +10,10 @@ int32_t data_chain::write_header(page_lock &lock) {
 
     db().emplace<data_chain_header_t>();
 
+    if (track_records_) {
+        db().emplace<data_chain_records_t>();
+    }
+
     db().terminate();
 
     lock.dirty();
@@ -77,7 +81,26 @@ int32_t data_chain::skip_records(record_number_t skipping) {
     record_number_t records = 0;
     file_size_t bytes = 0;
 
+    // Only a sector's first record can use its sub-index, so look at
+    // each sector's once rather than for every record in it. A sector
+    // entered by reading a delimiter, rather than by skipping the tail of
+    // a record, is looked at from its second record and is just decoded.
+    auto indexed = false;
+    auto indexed_sector = (dhara_sector_t)InvalidSector;
+
     while (records < skipping) {
+        if (!indexed || sector() != indexed_sector) {
+            err = skip_indexed_records(skipping - records);
+            if (err < 0) {
+                phyerrorf("skip-records: skip-indexed failed (%d/%d)", records, skipping);
+                return err;
+            }
+
+            records += err;
+            indexed = true;
+            indexed_sector = sector();
+        }
+
         uint32_t record_size = 0;
         err = read_delimiter(&record_size);
         if (err < 0) {
@@ -105,6 +128,143 @@ int32_t data_chain::skip_records(record_number_t skipping) {
     return records;
 }
 
+int32_t data_chain::skip_indexed_records(record_number_t skipping) {
+    assert_valid();
+
+    auto lock = db().reading(sector());
+
+    auto err = ensure_loaded(lock);
+    if (err < 0) {
+        return err;
+    }
+
+    if (db().position() == 0) {
+        err = db().seek_end();
+        if (err < 0) {
+            return err;
+        }
+
+        assert(constrain() >= 0);
+    }
+
+    // At the end of this sector's data the next record begins in a
+    // following sector, so move there to check its sub-index.
+    auto start = data_start();
+    if (db().position() - start == db().header<data_chain_header_t>()->bytes) {
+        err = forward(lock);
+        if (err <= 0) {
+            return err;
+        }
+
+        position_at_start_of_sector_ = position_;
+
+        err = db().seek_end();
+        if (err < 0) {
+            return err;
+        }
+
+        assert(constrain() >= 0);
+
+        start = data_start();
+    }
+
+    auto index = records_index();
+    if (index == nullptr || !index->valid() || index->records == 0) {
+        return 0;
+    }
+
+    // Only useful from the first record, otherwise we don't know how
+    // many of this sector's records are behind us.
+    auto offset = db().position() - start;
+    if (offset != index->first || skipping < index->records) {
+        return 0;
+    }
+
+    // Jump to the last record that begins in this sector, that one may
+    // continue into the following sectors so it's skipped normally.
+    db().position(start + index->last);
+    position_ += index->last - offset;
+
+    phyverbosef("skip-indexed sector=%d records=%d first=%d last=%d", sector(), index->records, index->first, index->last);
+
+    return index->records - 1;
+}
+
+bool data_chain::record_started(file_size_t position) {
+    if (!track_records_ || npending_records_ == MaximumPendingRecords) {
+        return false;
+    }
+
+    pending_records_[npending_records_++] = position;
+
+    return true;
+}
+
+size_t data_chain::data_start() {
+    auto iter = db().begin();
+    auto start = iter.position() + iter.size_of_record();
+
+    ++iter;
+    if (iter != db().end() && iter.size_of_record() == (int32_t)sizeof(data_chain_records_t)) {
+        if ((*iter).as<entry_t>()->type == entry_type::DataRecords) {
+            start = iter.position() + iter.size_of_record();
+        }
+    }
+
+    // Null terminator.
+    return start + 1;
+}
+
+data_chain_records_t *data_chain::records_index() {
+    auto iter = db().begin();
+    if (iter == db().end()) {
+        return nullptr;
+    }
+
+    ++iter;
+    if (iter == db().end() || iter.size_of_record() != (int32_t)sizeof(data_chain_records_t)) {
+        return nullptr;
+    }
+
+    auto rp = *iter;
+    if (rp.as<entry_t>()->type != entry_type::DataRecords) {
+        return nullptr;
+    }
+
+    return db().as_mutable<data_chain_records_t>(rp);
+}
+
+void data_chain::update_records_index(size_t offset, size_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+
+    auto index = records_index();
+    if (index != nullptr && index->valid() && !track_records_) {
+        phyverbosef("records-index: invalidated sector=%d", sector());
+        index->records = InvalidRecordsCount;
+    }
+
+    // Apply pending records that begin in the bytes being written and
+    // keep those beyond them.
+    auto kept = 0u;
+    for (auto i = 0u; i < npending_records_; ++i) {
+        auto position = pending_records_[i];
+        if (position >= position_ + bytes) {
+            pending_records_[kept++] = position;
+        } else if (position >= position_ && index != nullptr && index->valid()) {
+            auto record_offset = (uint16_t)(offset + (position - position_));
+            if (index->records == 0) {
+                index->first = record_offset;
+            }
+            index->last = record_offset;
+            index->records++;
+        }
+    }
+
+    npending_records_ = kept;
+}
+
 int32_t data_chain::seek_end_of_buffer(page_lock & /*lock*/) {
     auto err = db().seek_end();
     if (err < 0) {
@@ -200,6 +360,15 @@ int32_t data_chain::read(uint8_t *data, size_t size) {
     return read_chain(writer);
 }
 
+int32_t data_chain::read(io_writer &writer, size_t size) {
+    logged_task lt{ "dc-read", name() };
+
+    assert_valid();
+
+    limited_writer limited{ &writer, size };
+    return read_chain(limited);
+}
+
 file_size_t data_chain::total_bytes() {
     logged_task lt{ "total-bytes", name() };
 
@@ -277,6 +446,8 @@ int32_t data_chain::write_chain(page_lock &lock, io_reader &reader) {
             });
             assert(err == 0);
 
+            update_records_index(wb.position() - data_start(), bytes_read);
+
             written += bytes_read;
             position_ += bytes_read;
 
@@ -320,24 +491,22 @@ int32_t data_chain::write_chain(page_lock &lock, io_reader &reader) {
 }
 
 int32_t data_chain::constrain() {
-    auto iter = db().begin();
     auto hdr = db().header<data_chain_header_t>();
-    auto total = hdr->bytes + iter.position() + iter.size_of_record() + 1 /* Null terminator */;
-    phydebugf("constrain hdr-bytes=%d + hdr-pos=%d + hdr->size=%d + 1 <null> = total=%d", hdr->bytes, iter.position(),
-              iter.size_of_record(), total);
+    auto start = data_start();
+    auto total = hdr->bytes + start;
+    phydebugf("constrain hdr-bytes=%d + data-start=%d = total=%d", hdr->bytes, start, total);
     assert(db().constrain(total) >= 0);
 
     /**
      * Due to a bug somewhere, if the sector is empty, then the
      * delimited buffer position could be just before the null
      * terminator. This seems like an ok sanity check, that the
-     * position should never be before the minimum position and will
+     * position should never be before the start of the data and will
      * hold us over until I can find the real off by one issue.
      */
-    auto minimum = 2 + sizeof(data_chain_header_t) + 1;
-    if (db().position() < minimum) {
-        phyverbosef("constraining to minimum position=%d", minimum);
-        db().position(minimum);
+    if (db().position() < start) {
+        phyverbosef("constraining to minimum position=%d", start);
+        db().position(start);
     }
     return 0;
 }
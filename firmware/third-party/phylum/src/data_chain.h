@@ -30,10 +30,16 @@ struct data_chain_cursor {
 };
 
 class data_chain : public sector_chain, public io_writer {
+private:
+    static constexpr size_t MaximumPendingRecords = 16;
+
 private:
     head_tail_t chain_{ };
     file_size_t position_{ 0 };
     file_size_t position_at_start_of_sector_{ 0 };
+    bool track_records_{ false };
+    file_size_t pending_records_[MaximumPendingRecords];
+    size_t npending_records_{ 0 };
 
 public:
     data_chain(phyctx pc, head_tail_t chain, const char *prefix = "dc")
@@ -47,12 +53,41 @@ public:
     int32_t write(uint8_t const *data, size_t size) override;
     int32_t truncate(uint8_t const *data, size_t size);
     int32_t read(uint8_t *data, size_t size);
+
+    /**
+     * Hands up to size bytes to writer straight from the sector's
+     * working buffer, the pointer given to writer is only valid during
+     * that call.
+     */
+    int32_t read(io_writer &writer, size_t size);
+
     int32_t read_delimiter(uint32_t *delimiter);
     int32_t seek_sector(dhara_sector_t new_sector, file_size_t position_at_start_of_sector, file_size_t desired_position);
     int32_t skip_bytes(file_size_t bytes);
     int32_t skip_records(record_number_t number_records);
     file_size_t total_bytes();
 
+    /**
+     * Enables counting the records that begin in the data sectors this
+     * chain writes, \see data_chain_records_t. Sectors that receive
+     * data while this is disabled have their counts invalidated.
+     */
+    void track_records(bool enabled) {
+        track_records_ = enabled;
+    }
+
+    bool tracking_records() const {
+        return track_records_;
+    }
+
+    /**
+     * Queue the start of a record at the given position, which is
+     * applied to the sector that position lands in when the data is
+     * written. Returns false if records aren't being tracked or too
+     * many are pending.
+     */
+    bool record_started(file_size_t position);
+
     using sector_chain::truncate;
 
 public:
@@ -74,6 +109,14 @@ protected:
 
     int32_t read_chain(io_writer &writer);
 
+    int32_t skip_indexed_records(record_number_t skipping);
+
+    size_t data_start();
+
+    data_chain_records_t *records_index();
+
+    void update_records_index(size_t offset, size_t bytes);
+
     int32_t constrain();
 
 };
@@ -40,6 +40,8 @@ int32_t file_appender::write(uint8_t const *data, size_t size) {
 
     phyverbosef("appender-write: position=%d buffer=%d size=%d", cursor().position, buffer_.position(), size);
 
+    wrote_ = true;
+
     auto wrote = buffer_.fill_from_buffer_ptr(data, size, [&](simple_buffer &) -> int32_t {
         auto flushing = buffer_.position();
         auto err = flush();
@@ -60,11 +62,18 @@ int32_t file_appender::make_data_chain() {
         return err;
     }
 
+    // Data stored inline was never counted, so the sector it lands in
+    // can't be either.
+    auto tracking = data_chain_.tracking_records();
+    data_chain_.track_records(false);
+
     err = directory_->read(file_.id, data_chain_);
     if (err < 0) {
         return err;
     }
 
+    data_chain_.track_records(tracking);
+
     if (buffer_.position() > 0) {
         auto err = buffer_.read_to_position([&](read_buffer rb) -> int32_t {
             return data_chain_.write(rb.ptr(), rb.size());
@@ -81,6 +90,34 @@ int32_t file_appender::make_data_chain() {
     return 0;
 }
 
+int32_t file_appender::begin_record() {
+    if (!wrote_) {
+        data_chain_.track_records(true);
+    }
+
+    if (!data_chain_.tracking_records()) {
+        return 0;
+    }
+
+    auto record_position = position();
+    if (data_chain_.record_started(record_position)) {
+        return 0;
+    }
+
+    // Too many records pending, flushing writes them.
+    auto err = flush();
+    if (err < 0) {
+        return err;
+    }
+
+    if (!data_chain_.record_started(record_position)) {
+        phywarnf("unable to track record, disabling");
+        data_chain_.track_records(false);
+    }
+
+    return 0;
+}
+
 int32_t file_appender::index_necessary() {
     // We use the appender cursor so that we don't keep indexing at
     // the start, while data chain cursor hasn't moved because we're
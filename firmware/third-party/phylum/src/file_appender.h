@@ -16,6 +16,7 @@ private:
     simple_buffer buffer_;
     data_chain data_chain_;
     bool truncated_{ false };
+    bool wrote_{ false };
 
 public:
     file_appender(phyctx pc, directory *directory, found_file file);
@@ -30,11 +31,24 @@ public:
     file_size_t position();
 
 public:
+    /**
+     * Marks the current position as the start of a record, so the data
+     * sectors can count the records beginning in them. Counts are only
+     * kept if every record written is marked, beginning before the
+     * first write.
+     */
+    int32_t begin_record();
+
     int32_t write_delimiter(size_t delimited_size) {
+        auto err = begin_record();
+        if (err < 0) {
+            return err;
+        }
+
         uint8_t buffer[4];
         auto size_of_delimiter = varint_encoding_length(delimited_size);
         varint_encode(delimited_size, buffer, sizeof(buffer));
-        auto err = write(buffer, size_of_delimiter);
+        err = write(buffer, size_of_delimiter);
         if (err < 0) {
             return err;
         }
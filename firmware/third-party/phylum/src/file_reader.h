@@ -30,6 +30,21 @@ public:
 
     int32_t read(size_t size) override;
 
+    /**
+     * Reads up to size bytes into writer without copying them out of
+     * the working buffers first, \see data_chain::read
+     */
+    int32_t read(io_writer &writer, size_t size);
+
+    /**
+     * Keeps the working buffer holding a pointer handed to a writer by
+     * read around after the read returns, until it's released. Returns
+     * false for pointers outside the working buffers, like inline data.
+     */
+    bool retain(void const *ptr);
+
+    void release(void const *ptr);
+
     int32_t close();
 
 public:
@@ -82,6 +97,8 @@ public:
     }
 
 private:
+    int32_t read_inline(io_writer &writer, size_t size);
+
     bool has_chain() const {
         return data_chain_.valid();
     }
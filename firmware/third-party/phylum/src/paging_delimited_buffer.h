@@ -51,11 +51,21 @@ private:
     sector_map *sectors_{ nullptr };
     dhara_sector_t sector_{ InvalidSector };
     bool valid_{ false };
+    bool pinned_{ false };
 
 public:
-    paging_delimited_buffer(working_buffers &buffers, sector_map &sectors);
+    paging_delimited_buffer(working_buffers &buffers, sector_map &sectors, bool pinned = false);
 
 public:
+    /**
+     * Pinned buffers hold tree and directory sectors, which eviction
+     * policies may choose to keep around longer than data.
+     */
+    void pinned(bool pinned) {
+        pinned_ = pinned;
+    }
+
+
     page_lock reading(dhara_sector_t sector);
 
     page_lock writing(dhara_sector_t sector);
@@ -9,6 +9,7 @@
 #include "dhara_map.h"
 #include "working_buffers.h"
 #include "sector_allocator.h"
+#include "free_sectors_chain.h"
 #include "file_ops.h"
 #include "memory_flash_memory.h"
 #include "cobs.h"
@@ -258,6 +258,11 @@ int32_t sector_chain::log(bool graph) {
             phyinfof("data-chain-sector (%zu) p=%d n=%d bytes=%d", record.size_of_record(), sh->pp, sh->np, sh->bytes);
             break;
         }
+        case entry_type::DataRecords: {
+            auto dr = record.as<data_chain_records_t>();
+            phyinfof("data-records (%zu) records=%d first=%d last=%d", record.size_of_record(), dr->records, dr->first, dr->last);
+            break;
+        }
         case entry_type::FreeChainSector: {
             auto sh = record.as<free_chain_header_t>();
             phyinfof("free-chain-sector (%zu) p=%d n=%d", record.size_of_record(), sh->pp, sh->np);
@@ -303,6 +308,11 @@ int32_t sector_chain::log(bool graph) {
             phyinfof("free-sectors (%zu) head=%d", record.size_of_record(), node->head);
             break;
         }
+        case entry_type::VolumeEntry: {
+            auto volume = record.as<dirtree_volume_t>();
+            phyinfof("volume (%zu) version=%d free-chain=%d", record.size_of_record(), volume->version, volume->free_chain);
+            break;
+        }
         }
         return 0;
     };
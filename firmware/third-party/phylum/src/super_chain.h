@@ -7,6 +7,7 @@ namespace phylum {
 class super_chain : public record_chain {
 private:
     tree_ptr_t directory_tree_;
+    uint32_t version_{ 0 };
 
 public:
     super_chain(phyctx pc, dhara_sector_t head) : record_chain(pc, head_tail_t{ head, InvalidSector }, "super-chain") {
@@ -24,6 +25,13 @@ public:
         return directory_tree_;
     }
 
+    /**
+     * Format version of the mounted volume, \see FormatVersion.
+     */
+    uint32_t version() const {
+        return version_;
+    }
+
 protected:
     int32_t write_header(page_lock &page_lock) override;
 
@@ -1,11 +1,13 @@
 #pragma once
 
-#if defined(__linux__)
-#include <map>
-#endif
-
 #include "simple_buffer.h"
 
+// Number of sectors to keep read/write/miss statistics for, zero
+// disables them. This comes from alloc_memory, so it's opt-in.
+#if !defined(PHYLUM_SECTOR_STATISTICS_SIZE)
+#define PHYLUM_SECTOR_STATISTICS_SIZE 0
+#endif
+
 namespace phylum {
 
 class buffer_memory {
@@ -17,40 +19,110 @@ public:
 
 };
 
+/**
+ * Decides which idle list an unreferenced page belongs to. When a page
+ * is needed the idle lists are searched in order, taking the least
+ * recently used page from the first non-empty one.
+ */
+class eviction_policy {
+public:
+    static constexpr uint8_t MaximumLists = 4;
+
+public:
+    virtual uint8_t number_of_lists() const = 0;
+    virtual uint8_t list_for(bool dirty, bool pinned) const = 0;
+
+};
+
+/**
+ * Plain LRU, clean pages are always reused before dirty ones.
+ */
+class lru_eviction_policy : public eviction_policy {
+public:
+    uint8_t number_of_lists() const override {
+        return 2;
+    }
+
+    uint8_t list_for(bool dirty, bool /*pinned*/) const override {
+        return dirty ? 1 : 0;
+    }
+};
+
+/**
+ * LRU that keeps tree and directory sectors around for as long as there
+ * are data pages that can be reused instead, even dirty ones.
+ */
+class pinning_eviction_policy : public eviction_policy {
+public:
+    uint8_t number_of_lists() const override {
+        return 4;
+    }
+
+    uint8_t list_for(bool dirty, bool pinned) const override {
+        return (pinned ? 2 : 0) + (dirty ? 1 : 0);
+    }
+};
+
 class working_buffers : free_buffer_callback {
 protected:
+    static constexpr int16_t InvalidSlot = -1;
+
     struct page_t {
         uint8_t *buffer{ nullptr };
         size_t size{ 0 };
         dhara_sector_t sector{ InvalidSector };
         bool dirty{ false };
+        bool pinned{ false };
         int32_t refs{ 0 };
         int32_t hits{ 0 };
         uint32_t wrote{ 0 };
         uint32_t used{ 0 };
+        int16_t sector_chain{ InvalidSlot };
+        int16_t buffer_chain{ InvalidSlot };
+        int16_t prev{ InvalidSlot };
+        int16_t next{ InvalidSlot };
+        int8_t list{ -1 };
+    };
+
+    struct idle_list_t {
+        int16_t head{ InvalidSlot };
+        int16_t tail{ InvalidSlot };
+    };
+
+    struct sector_statistics_t {
+        dhara_sector_t sector;
+        uint32_t reads;
+        uint32_t writes;
+        uint32_t misses;
     };
 
     buffer_memory *mem_{ nullptr };
+    eviction_policy *policy_{ nullptr };
     size_t buffer_size_{ 0 };
     size_t size_{ 0 };
     page_t *pages_{ nullptr };
+    int16_t *sector_buckets_{ nullptr };
+    int16_t *buffer_buckets_{ nullptr };
+    uint8_t bucket_bits_{ 0 };
+    idle_list_t idle_[eviction_policy::MaximumLists];
+    size_t in_use_{ 0 };
     size_t highwater_{ 0 };
     uint32_t counter_{ 0 };
     size_t reads_{ 0 };
     size_t writes_{ 0 };
     size_t misses_{ 0 };
-
-#if defined(__linux__)
-    struct sector_statistics_t {
-        size_t reads{ 0 };
-        size_t writes{ 0 };
-        size_t misses{ 0 };
-    };
-    std::map<dhara_sector_t, sector_statistics_t> statistics_;
-#endif
+    sector_statistics_t *statistics_{ nullptr };
+    sector_statistics_t untracked_{ InvalidSector, 0, 0, 0 };
 
 public:
-    working_buffers(buffer_memory *mem, size_t buffer_size, size_t maximum_pages) : mem_(mem), buffer_size_(buffer_size), size_(maximum_pages) {
+    working_buffers(buffer_memory *mem, size_t buffer_size, size_t maximum_pages, eviction_policy *policy = nullptr)
+        : mem_(mem), policy_(policy), buffer_size_(buffer_size), size_(maximum_pages) {
+        static lru_eviction_policy default_policy;
+        if (policy_ == nullptr) {
+            policy_ = &default_policy;
+        }
+        assert(maximum_pages > 0 && maximum_pages < INT16_MAX);
+        assert(policy_->number_of_lists() <= eviction_policy::MaximumLists);
     }
 
     virtual ~working_buffers() {
@@ -64,7 +136,15 @@ public:
                 }
             }
             mem_->free_memory(pages_);
+            mem_->free_memory(sector_buckets_);
+            mem_->free_memory(buffer_buckets_);
             pages_ = nullptr;
+            sector_buckets_ = nullptr;
+            buffer_buckets_ = nullptr;
+        }
+        if (statistics_ != nullptr) {
+            mem_->free_memory(statistics_);
+            statistics_ = nullptr;
         }
     }
 
@@ -73,14 +153,30 @@ public:
         return buffer_size_;
     }
 
+    size_t highwater() const {
+        return highwater_;
+    }
+
 public:
     int32_t clear() {
         if (pages_ != nullptr) {
+            for (auto b = 0u; b < number_of_buckets(); ++b) {
+                sector_buckets_[b] = InvalidSlot;
+            }
             for (auto i = 0u; i < size_; ++i) {
-                if (pages_[i].buffer != nullptr) {
-                    memset(pages_[i].buffer, 0xff, pages_[i].size);
-                    pages_[i].sector = InvalidSector;
-                    pages_[i].dirty = false;
+                auto &p = pages_[i];
+                if (p.buffer != nullptr) {
+                    if (p.refs == 0) {
+                        memset(p.buffer, 0xff, p.size);
+                    }
+                    p.sector = InvalidSector;
+                    p.sector_chain = InvalidSlot;
+                    p.dirty = false;
+                    p.pinned = false;
+                    if (p.list >= 0) {
+                        idle_remove(i);
+                        idle_insert(i);
+                    }
                 }
             }
         }
@@ -88,171 +184,119 @@ public:
     }
 
     int32_t dirty_sector(dhara_sector_t sector) {
-        auto err = -1;
-
         assert(pages_ != nullptr);
 
-        for (auto i = 0u; i < size_; ++i) {
-            auto &p = pages_[i];
-            if (p.buffer != nullptr) {
-                if (p.sector == sector) {
-                    phyverbosef("wbuffers[%d] dirty sector=%d", i, sector);
-                    p.dirty = true;
-                    err = 0;
-                }
-            }
+        auto i = find_sector(sector);
+        if (i == InvalidSlot) {
+            return -1;
         }
 
-        return err;
+        phyverbosef("wbuffers[%d] dirty sector=%d", i, sector);
+
+        update_state(i, true, pages_[i].pinned);
+
+        return 0;
     }
 
     template<typename FlushFunction>
     int32_t flush_sector(dhara_sector_t sector, FlushFunction flush) {
-        auto flushed = false;
-
         assert(pages_ != nullptr);
 
-        for (auto i = 0u; i < size_; ++i) {
-            auto &p = pages_[i];
-            if (p.buffer != nullptr) {
-                if (p.sector == sector) {
-                    if (flushed) {
-                        debug();
-                        assert(!flushed);
-                    }
-                    if (!p.dirty) {
-                        phywarnf("flush of clean page sector");
-                    }
-
-                    phyverbosef("wbuffers[%d] flush sector=%d", i, sector);
+        auto i = find_sector(sector);
+        if (i == InvalidSlot) {
+            return -1;
+        }
 
-                    auto err = flush(sector, p.buffer, buffer_size_);
-                    if (err < 0) {
-                        return err;
-                    }
+        auto &p = pages_[i];
+        if (!p.dirty) {
+            phywarnf("flush of clean page sector");
+        }
 
-                    flushed = true;
-                    p.dirty = false;
-                    p.wrote = ++writes_;
+        phyverbosef("wbuffers[%d] flush sector=%d", i, sector);
 
-#if defined(__linux__)
-                    statistics_[sector].writes++;
-#endif
-                }
-            }
+        auto err = flush(sector, p.buffer, buffer_size_);
+        if (err < 0) {
+            return err;
         }
 
-        if (!flushed) {
-            return -1;
-        }
+        update_state(i, false, p.pinned);
+        p.wrote = ++writes_;
+
+        sector_statistics(sector).writes++;
 
         return 0;
     }
 
     template<typename MissFunction, typename FlushFunction>
     uint8_t *open_sector(dhara_sector_t sector, bool read_only, MissFunction miss, FlushFunction flush) {
-        auto selected = -1;
-        auto flushing = -1;
+        return open_sector(sector, read_only, false, miss, flush);
+    }
 
+    template<typename MissFunction, typename FlushFunction>
+    uint8_t *open_sector(dhara_sector_t sector, bool read_only, bool pinned, MissFunction miss, FlushFunction flush) {
         allocate();
 
         reads_++;
-#if defined(__linux__)
-        statistics_[sector].reads++;
-#endif
-
-        for (auto i = 0u; i < size_; ++i) {
-            auto &p = pages_[i];
-            if (p.buffer == nullptr) break;
-            if (p.sector == InvalidSector) {
-                // Free page.
-            }
-            if (p.sector == sector) {
-                // Otherwise, this sector is open for writing as we
-                // speak. Which should never happen.
-                if (read_only && p.refs >= 0) {
-                    assert(p.refs >= 0);
-                    p.refs++;
-                }
-                else {
-                    assert(p.refs <= 0);
-                    p.refs--;
-                }
-
-                counter_++;
+        sector_statistics(sector).reads++;
 
-                p.used = counter_;
-                p.hits++;
-
-                phyverbosef("wbuffers[%d]: reusing refs=%d", i, p.refs);
-
-                if (false) {
-                    phydebug_dump_memory("reuse[%d, sector=%d] ", p.buffer, buffer_size_, i, p.sector);
-                }
+        auto found = find_sector(sector);
+        if (found != InvalidSlot) {
+            auto &p = pages_[found];
 
-                return p.buffer;
+            // Otherwise, this sector is open for writing as we
+            // speak. Which should never happen.
+            if (read_only && p.refs >= 0) {
+                assert(p.refs >= 0);
+                reference(found, 1);
             }
             else {
-                if (p.refs == 0) {
-                    if (p.dirty) {
-                        if (p.sector != InvalidSector) {
-                            if (flushing == -1) {
-                                flushing = i;
-                            }
-                            else {
-                                if (better_drop_candidate(p, pages_[flushing])) {
-                                    flushing = i;
-                                }
-                            }
-                        }
-                    }
-                    else {
-                        if (selected == -1)  {
-                            selected = i;
-                        }
-                        else {
-                            if (better_drop_candidate(p, pages_[selected])) {
-                                selected = i;
-                            }
-                        }
-                    }
-                }
+                assert(p.refs <= 0);
+                reference(found, -1);
             }
-        }
 
-        if (selected < 0) {
-            if (flushing >= 0) {
-                phydebugf("wbuffers[%d]: flush-alloc", flushing);
+            counter_++;
 
-                debug();
+            p.used = counter_;
+            p.hits++;
+            p.pinned = p.pinned || pinned;
 
-                auto &p = pages_[flushing];
-                assert(p.refs == 0);
+            phyverbosef("wbuffers[%d]: reusing refs=%d", found, p.refs);
 
-                auto err = flush(p.sector, p.buffer, buffer_size_);
-                if (err < 0) {
-                    assert(err >= 0);
-                    return { };
-                }
+            if (false) {
+                phydebug_dump_memory("reuse[%d, sector=%d] ", p.buffer, buffer_size_, found, p.sector);
+            }
+
+            return p.buffer;
+        }
 
-                p.dirty = false;
-                p.sector = InvalidSector;
-                p.wrote = 0;
-                writes_++;
+        auto selected = select_idle();
+        if (selected == InvalidSlot) {
+            debug();
+            assert(selected != InvalidSlot);
+            return { };
+        }
 
-                selected = flushing;
-            }
-            else {
-                debug();
-                assert(selected >= 0);
+        auto &p = pages_[selected];
+        if (p.dirty && p.sector != InvalidSector) {
+            phydebugf("wbuffers[%d]: flush-alloc", selected);
+
+            auto err = flush(p.sector, p.buffer, buffer_size_);
+            if (err < 0) {
+                assert(err >= 0);
+                return { };
             }
+
+            p.wrote = 0;
+            writes_++;
         }
         else {
             phyverbosef("wbuffers[%d]: allocating sector=%d", selected, sector);
         }
 
+        unindex_sector(selected);
+        p.dirty = false;
+
         // Load the sector.
-        auto &p = pages_[selected];
         memset(p.buffer, 0xff, buffer_size_);
         auto err = miss(sector, p.buffer, buffer_size_);
         if (err < 0) {
@@ -264,31 +308,25 @@ public:
         // this'll have the number of bytes we read.
         if (err > 0) {
             misses_++;
-#if defined(__linux__)
-            statistics_[sector].misses++;
-#endif
+            sector_statistics(sector).misses++;
         }
 
-        if (read_only) {
-            p.refs++;
-        }
-        else {
-            p.refs--;
-        }
+        reference(selected, read_only ? 1 : -1);
 
         counter_++;
 
         p.sector = sector;
+        p.pinned = pinned;
         p.used = counter_;
         p.hits = 0;
         p.wrote = 0;
 
+        index_sector(selected);
+
         if (false) {
             phydebug_dump_memory("alloc[%d, sector=%d] ", p.buffer, buffer_size_, selected, sector);
         }
 
-        update_highwater();
-
         return p.buffer;
     }
 
@@ -297,19 +335,27 @@ public:
             for (auto i = 0u; i < size_; ++i) {
                 auto &p = pages_[i];
                 if (p.buffer != nullptr) {
-                    phydebugf("wbuffers[%d] sector=%d dirty=%d refs=%d hits=%d used=%d", i, p.sector, p.dirty, p.refs, p.hits, p.used);
+                    phydebugf("wbuffers[%d] sector=%d dirty=%d pinned=%d refs=%d hits=%d used=%d", i, p.sector, p.dirty,
+                              p.pinned, p.refs, p.hits, p.used);
                 }
             }
         }
 
-#if defined(__linux__)
         if (false) {
-            for (auto i : statistics_) {
-                phydebugf("wbuffers[-] sector=%d reads=%zu writes=%zu misses=%zu",
-                        i.first, i.second.reads, i.second.writes, i.second.misses);
+#if PHYLUM_SECTOR_STATISTICS_SIZE > 0
+            if (statistics_ != nullptr) {
+                for (auto i = 0u; i < PHYLUM_SECTOR_STATISTICS_SIZE; ++i) {
+                    auto &s = statistics_[i];
+                    if (s.sector != InvalidSector) {
+                        phydebugf("wbuffers[-] sector=%d reads=%" PRIu32 " writes=%" PRIu32 " misses=%" PRIu32, s.sector,
+                                  s.reads, s.writes, s.misses);
+                    }
+                }
             }
-        }
 #endif
+            phydebugf("wbuffers[-] untracked reads=%" PRIu32 " writes=%" PRIu32 " misses=%" PRIu32, untracked_.reads,
+                      untracked_.writes, untracked_.misses);
+        }
 
         return 0;
     }
@@ -319,37 +365,30 @@ public:
 
         allocate();
 
-        update_highwater();
-
-        auto selected = -1;
-
-        for (auto i = 0u; i < size_; ++i) {
-            auto &p = pages_[i];
-            if (p.buffer == nullptr) break;
-            if (p.refs == 0) {
-                if (selected < 0) {
-                    selected = i;
-                }
-                else {
-                    if (pages_[selected].sector != InvalidSector && p.sector == InvalidSector) {
-                        selected = i;
-                    }
-                }
-            }
+        auto selected = select_idle();
+        if (selected == InvalidSlot) {
+            debug();
+            assert(selected != InvalidSlot);
+            return simple_buffer{ };
         }
 
-        assert(selected >= 0);
+        auto &p = pages_[selected];
+        if (p.dirty && p.sector != InvalidSector) {
+            phywarnf("wbuffers[%d]: allocate over dirty sector=%d", selected, p.sector);
+        }
 
         counter_++;
 
-        auto &p = pages_[selected];
+        unindex_sector(selected);
+
         p.used = counter_;
         p.sector = InvalidSector;
+        p.dirty = false;
+        p.pinned = false;
         p.hits = 0;
         p.wrote = 0;
-        p.refs--;
 
-        update_highwater();
+        reference(selected, -1);
 
         phyverbosef("wbuffers[%d]: allocate sector=%d hw=%zu", selected, p.sector, highwater_);
         return simple_buffer{ p.buffer, size, this };
@@ -359,74 +398,295 @@ public:
         assert(pages_ != nullptr);
 
         assert(ptr != nullptr);
-        for (auto i = 0u; i < size_; ++i) {
-            auto &p = pages_[i];
-            if (p.buffer == ptr) {
-                phyverbosef("wbuffers[%d]: free refs-before=%d sector=%d", i, p.refs, p.sector);
 
-                assert(p.refs != 0);
+        auto i = find_buffer(ptr);
+        if (i == InvalidSlot) {
+            return;
+        }
 
-                if (p.refs > 0) {
-                    p.refs--;
-                }
-                else {
-                    p.refs++;
-                }
+        auto &p = pages_[i];
 
-                if (false) {
-                    phydebug_dump_memory("free[%d, sector=%d] ", p.buffer, buffer_size_, i, p.sector);
-                }
-                break;
-            }
+        phyverbosef("wbuffers[%d]: free refs-before=%d sector=%d", i, p.refs, p.sector);
+
+        assert(p.refs != 0);
+
+        reference(i, p.refs > 0 ? -1 : 1);
+
+        if (false) {
+            phydebug_dump_memory("free[%d, sector=%d] ", p.buffer, buffer_size_, i, p.sector);
         }
     }
 
+    /**
+     * Takes another read only reference on the page holding ptr, which
+     * can point anywhere inside the page, so the page stays put until
+     * it's released. This lets a page outlive the read that opened it.
+     * Fails if ptr isn't one of ours or the page is open for writing.
+     */
+    bool retain(void const *ptr) {
+        auto i = find_containing(ptr);
+        if (i == InvalidSlot || pages_[i].refs < 0) {
+            return false;
+        }
+
+        phyverbosef("wbuffers[%d]: retain refs-before=%d sector=%d", i, pages_[i].refs, pages_[i].sector);
+
+        reference(i, 1);
+
+        return true;
+    }
+
+    /**
+     * Drops a reference taken by retain.
+     */
+    void release(void const *ptr) {
+        auto i = find_containing(ptr);
+        assert(i != InvalidSlot);
+        assert(pages_[i].refs > 0);
+
+        phyverbosef("wbuffers[%d]: release refs-before=%d sector=%d", i, pages_[i].refs, pages_[i].sector);
+
+        reference(i, -1);
+    }
+
 private:
     void allocate() {
         if (pages_ == nullptr) {
+            bucket_bits_ = 1;
+            while ((1u << bucket_bits_) < size_ * 2) {
+                bucket_bits_++;
+            }
+
             pages_ = (page_t *)mem_->alloc_memory(sizeof(page_t) * size_);
+            sector_buckets_ = (int16_t *)mem_->alloc_memory(sizeof(int16_t) * number_of_buckets());
+            buffer_buckets_ = (int16_t *)mem_->alloc_memory(sizeof(int16_t) * number_of_buckets());
+            for (auto b = 0u; b < number_of_buckets(); ++b) {
+                sector_buckets_[b] = InvalidSlot;
+                buffer_buckets_[b] = InvalidSlot;
+            }
+
             for (auto i = 0u; i < size_; ++i) {
-                pages_[i] = { };
-                pages_[i].buffer = (uint8_t *)mem_->alloc_page(buffer_size_);
+                auto &p = pages_[i];
+                p = { };
+                p.buffer = (uint8_t *)mem_->alloc_page(buffer_size_);
+                if (p.buffer != nullptr) {
+                    p.size = buffer_size_;
+                    auto b = bucket(buffer_key(p.buffer));
+                    p.buffer_chain = buffer_buckets_[b];
+                    buffer_buckets_[b] = i;
+                    idle_insert(i);
+                }
+            }
+
+#if PHYLUM_SECTOR_STATISTICS_SIZE > 0
+            statistics_ = (sector_statistics_t *)mem_->alloc_memory(sizeof(sector_statistics_t) * PHYLUM_SECTOR_STATISTICS_SIZE);
+            if (statistics_ != nullptr) {
+                for (auto i = 0u; i < PHYLUM_SECTOR_STATISTICS_SIZE; ++i) {
+                    statistics_[i] = { InvalidSector, 0, 0, 0 };
+                }
+            }
+#endif
+        }
+    }
+
+    size_t number_of_buckets() const {
+        return 1u << bucket_bits_;
+    }
+
+    size_t bucket(uint32_t key) const {
+        return (size_t)((key * 2654435761u) >> (32 - bucket_bits_));
+    }
+
+    static uint32_t buffer_key(void const *ptr) {
+        return (uint32_t)((uintptr_t)ptr >> 2);
+    }
+
+    int16_t find_sector(dhara_sector_t sector) const {
+        if (pages_ == nullptr || sector == InvalidSector) {
+            return InvalidSlot;
+        }
+        for (auto i = sector_buckets_[bucket(sector)]; i != InvalidSlot; i = pages_[i].sector_chain) {
+            if (pages_[i].sector == sector) {
+                return i;
+            }
+        }
+        return InvalidSlot;
+    }
+
+    int16_t find_buffer(void const *ptr) const {
+        for (auto i = buffer_buckets_[bucket(buffer_key(ptr))]; i != InvalidSlot; i = pages_[i].buffer_chain) {
+            if (pages_[i].buffer == ptr) {
+                return i;
             }
         }
+        return InvalidSlot;
     }
 
-    bool better_drop_candidate(page_t const &candidate, page_t const &selected) {
-        // Favor pages that don't have a sector in them over those that do.
-        if (candidate.sector == InvalidSector && selected.sector != InvalidSector) {
-            return true;
+    int16_t find_containing(void const *ptr) const {
+        if (pages_ == nullptr) {
+            return InvalidSlot;
         }
+        auto address = (uint8_t const *)ptr;
+        for (auto i = 0u; i < size_; ++i) {
+            auto &p = pages_[i];
+            if (p.buffer != nullptr && address >= p.buffer && address < p.buffer + p.size) {
+                return (int16_t)i;
+            }
+        }
+        return InvalidSlot;
+    }
+
+    void index_sector(int16_t i) {
+        auto &p = pages_[i];
+        assert(p.sector != InvalidSector);
+        auto b = bucket(p.sector);
+        p.sector_chain = sector_buckets_[b];
+        sector_buckets_[b] = i;
+    }
 
-        // Favor older written pages over one recently written as
-        // well as favoring unwritten pages over written ones.
-        if (selected.wrote > 0 && candidate.wrote < selected.wrote) {
-            return true;
+    void unindex_sector(int16_t i) {
+        auto &p = pages_[i];
+        if (p.sector == InvalidSector) {
+            return;
         }
 
-        // Favor pages that were used further ago than the selected one.
-        if (candidate.used < selected.used) {
-            return true;
+        auto *link = &sector_buckets_[bucket(p.sector)];
+        while (*link != InvalidSlot) {
+            if (*link == i) {
+                *link = p.sector_chain;
+                break;
+            }
+            link = &pages_[*link].sector_chain;
         }
 
-        return false;
+        p.sector_chain = InvalidSlot;
     }
 
-    int32_t update_highwater() {
-        auto hw = 0u;
+    void idle_insert(int16_t i) {
+        auto &p = pages_[i];
+        assert(p.list < 0);
+
+        auto l = policy_->list_for(p.dirty, p.pinned);
+        auto &list = idle_[l];
+        p.list = l;
+
+        // Pages without a sector are the best candidates, so they go
+        // to the front of the line. Everything else is most recently
+        // used and so goes to the back.
+        if (p.sector == InvalidSector) {
+            p.prev = InvalidSlot;
+            p.next = list.head;
+            if (list.head != InvalidSlot) {
+                pages_[list.head].prev = i;
+            }
+            else {
+                list.tail = i;
+            }
+            list.head = i;
+        }
+        else {
+            p.next = InvalidSlot;
+            p.prev = list.tail;
+            if (list.tail != InvalidSlot) {
+                pages_[list.tail].next = i;
+            }
+            else {
+                list.head = i;
+            }
+            list.tail = i;
+        }
+    }
 
-        for (auto i = 0u; i < size_; ++i) {
-            if (pages_[i].buffer == nullptr) break;
-            if (pages_[i].refs != 0) {
-                hw++;
+    void idle_remove(int16_t i) {
+        auto &p = pages_[i];
+        assert(p.list >= 0);
+
+        auto &list = idle_[p.list];
+        if (p.prev != InvalidSlot) {
+            pages_[p.prev].next = p.next;
+        }
+        else {
+            list.head = p.next;
+        }
+        if (p.next != InvalidSlot) {
+            pages_[p.next].prev = p.prev;
+        }
+        else {
+            list.tail = p.prev;
+        }
+
+        p.prev = InvalidSlot;
+        p.next = InvalidSlot;
+        p.list = -1;
+    }
+
+    int16_t select_idle() {
+        for (auto l = 0u; l < policy_->number_of_lists(); ++l) {
+            auto i = idle_[l].head;
+            if (i != InvalidSlot) {
+                return i;
             }
         }
+        return InvalidSlot;
+    }
 
-        if (hw > highwater_) {
-            highwater_ = hw;
+    void update_state(int16_t i, bool dirty, bool pinned) {
+        auto &p = pages_[i];
+        auto idle = p.list >= 0;
+        if (idle) {
+            idle_remove(i);
         }
+        p.dirty = dirty;
+        p.pinned = pinned;
+        if (idle) {
+            idle_insert(i);
+        }
+    }
 
-        return 0;
+    void reference(int16_t i, int32_t delta) {
+        auto &p = pages_[i];
+        auto was_idle = p.refs == 0;
+
+        p.refs += delta;
+
+        if (was_idle && p.refs != 0) {
+            idle_remove(i);
+            in_use_++;
+            if (in_use_ > highwater_) {
+                highwater_ = in_use_;
+            }
+        }
+        else if (!was_idle && p.refs == 0) {
+            idle_insert(i);
+            assert(in_use_ > 0);
+            in_use_--;
+        }
+    }
+
+    sector_statistics_t &sector_statistics(dhara_sector_t sector) {
+        if (statistics_ == nullptr) {
+            return untracked_;
+        }
+
+        // Open addressing with a short probe, once the neighborhood is
+        // full new sectors are lumped together so this never allocates
+        // and never degrades into a scan of the whole table.
+        constexpr size_t MaximumProbes = 8;
+        auto size = (size_t)PHYLUM_SECTOR_STATISTICS_SIZE;
+        auto slot = (size_t)((sector * 2654435761u) % size);
+        for (auto n = 0u; n < size && n < MaximumProbes; ++n) {
+            auto &s = statistics_[slot];
+            if (s.sector == sector) {
+                return s;
+            }
+            if (s.sector == InvalidSector) {
+                s.sector = sector;
+                return s;
+            }
+            slot = slot + 1 == size ? 0 : slot + 1;
+        }
+
+        return untracked_;
     }
 
 };
@@ -73,6 +73,50 @@ public:
 
 };
 
+/**
+ * Passes at most a fixed number of bytes along to another writer.
+ */
+class limited_writer : public io_writer {
+private:
+    io_writer *target_{ nullptr };
+    size_t remaining_{ 0 };
+
+public:
+    limited_writer(io_writer *target, size_t remaining) : target_(target), remaining_(remaining) {
+    }
+
+public:
+    int32_t write(uint8_t const *data, size_t size) override;
+
+    size_t remaining() const {
+        return remaining_;
+    }
+};
+
+/**
+ * Drops the first skip bytes it's given and then passes at most size
+ * bytes along to another writer. Everything is always taken, so the
+ * number of bytes passed along is in written().
+ */
+class window_writer : public io_writer {
+private:
+    io_writer *target_{ nullptr };
+    size_t skip_{ 0 };
+    size_t remaining_{ 0 };
+    size_t written_{ 0 };
+
+public:
+    window_writer(io_writer *target, size_t skip, size_t size) : target_(target), skip_(skip), remaining_(size) {
+    }
+
+public:
+    int32_t write(uint8_t const *data, size_t size) override;
+
+    size_t written() const {
+        return written_;
+    }
+};
+
 class varint_decoder : public io_writer {
 private:
     int32_t width_{ 0 };
@@ -13,6 +13,7 @@ TEST(General, EntrySizes) {
     EXPECT_EQ(sizeof(super_block_t), 38u);
     EXPECT_EQ(sizeof(directory_chain_header_t), 10u);
     EXPECT_EQ(sizeof(data_chain_header_t), 12u);
+    EXPECT_EQ(sizeof(data_chain_records_t), 7u);
     EXPECT_EQ(sizeof(file_data_t), 41u);
     EXPECT_EQ(sizeof(file_attribute_t), 7u);
     EXPECT_EQ(sizeof(file_entry_t), 71u);
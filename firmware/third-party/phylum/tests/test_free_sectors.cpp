@@ -3,6 +3,10 @@
 #include <free_sectors_chain.h>
 #include <data_chain.h>
 #include <tree_sector.h>
+#include <file_appender.h>
+#include <file_reader.h>
+#include <super_chain.h>
+#include <file_ops.h>
 
 #include "phylum_tests.h"
 #include "geometry.h"
@@ -280,3 +284,125 @@ TYPED_TEST(FreeSectorsFixture, FreeSectorsChain_Trees_Large) {
         ASSERT_EQ(total_dequeued, 51u);
     });
 }
+
+TYPED_TEST(FreeSectorsFixture, FreeSectorsChain_Trees_RootedAtSectorZero) {
+    using tree_type = typename TypeParam::second_type;
+    typename TypeParam::first_type layout;
+    FlashMemory memory{ layout.sector_size };
+
+    auto &allocator = memory.allocator();
+
+    memory.begin(true);
+
+    // Tree sectors link back towards the root, so sector 0 is the last
+    // one in the chain and is not where it ends.
+    tree_type tree{ memory.pc(), tree_ptr_t{ allocator.allocate() } };
+    ASSERT_EQ(tree.to_tree_ptr().root, 0u);
+    ASSERT_EQ(tree.create(), 0);
+
+    {
+        suppress_logs sl;
+        auto nsectors = allocator.allocated() + 2;
+        for (auto i = 0u; allocator.allocated() < nsectors; ++i) {
+            ASSERT_EQ(tree.add(i, i), 0);
+        }
+    }
+
+    free_sectors_chain fsc{ memory.pc(), head_tail_t{ } };
+    ASSERT_EQ(fsc.create_if_necessary(), 0);
+
+    ASSERT_EQ(fsc.add_tree(tree.to_tree_ptr()), 0);
+
+    std::map<dhara_sector_t, bool> returned;
+    dhara_sector_t sector = InvalidSector;
+    while (fsc.dequeue(&sector) == 1) {
+        ASSERT_FALSE(returned[sector]);
+        returned[sector] = true;
+    }
+
+    ASSERT_EQ(returned.size(), 3u);
+    ASSERT_TRUE(returned[0]);
+}
+
+class FreeSectorsStressFixture : public PhylumFixture {};
+
+using stress_tree_type = tree_sector<uint32_t, uint32_t, 201>;
+using stress_file_ops_type = file_ops<directory_tree, stress_tree_type>;
+
+static void write_file(stress_file_ops_type &fops, open_file_config file_cfg, size_t records) {
+    ASSERT_EQ(fops.dir().find("data.bin", file_cfg), 1);
+
+    file_appender opened{ fops.pc(), &fops.dir(), fops.dir().open() };
+
+    for (auto record = 0u; record < records; ++record) {
+        ASSERT_GE(fops.index_if_necessary(opened, record), 0);
+        ASSERT_EQ(opened.write_delimiter(100), 1);
+        ASSERT_EQ(opened.write((uint8_t *)lorem1k, 100), 100);
+    }
+
+    ASSERT_EQ(opened.close(), 0);
+}
+
+static void verify_file(stress_file_ops_type &fops, size_t records) {
+    ASSERT_EQ(fops.dir().find("data.bin", open_file_config{ }), 1);
+
+    file_reader reader{ fops.pc(), &fops.dir(), fops.dir().open() };
+
+    uint8_t buffer[101];
+    for (auto record = 0u; record < records; ++record) {
+        ASSERT_EQ(reader.read(buffer, sizeof(buffer)), (int32_t)sizeof(buffer));
+        ASSERT_EQ(buffer[0], 100);
+        ASSERT_EQ(memcmp(buffer + 1, lorem1k, 100), 0);
+    }
+
+    ASSERT_EQ(reader.read(buffer, sizeof(buffer)), 0);
+    ASSERT_EQ(reader.close(), 0);
+}
+
+TEST_F(FreeSectorsStressFixture, CreateTruncateAndUnlink_SectorsStopGrowing) {
+    layout_2048 layout;
+    FlashMemory memory{ layout.sector_size };
+
+    auto &allocator = memory.allocator();
+
+    constexpr size_t Iterations = 200;
+    constexpr size_t WarmupIterations = 2;
+    constexpr size_t Records = 500;
+
+    memory.mounted<super_chain>([&](super_chain &super) {
+        free_sectors_chain fsc{ memory.pc(), head_tail_t{ } };
+        ASSERT_EQ(fsc.create_if_necessary(), 0);
+        ASSERT_EQ(fsc.mount(), 0);
+        ASSERT_EQ(allocator.begin(&fsc), 0);
+
+        stress_file_ops_type fops{ memory.pc(), super };
+        ASSERT_EQ(fops.format(), 0);
+
+        auto highwater = allocator.allocated();
+
+        for (auto i = 0u; i < Iterations; ++i) {
+            suppress_logs sl;
+
+            ASSERT_EQ(fops.touch("data.bin", file_cfg()), 0);
+            write_file(fops, file_cfg(), Records);
+            write_file(fops, file_cfg(open_file_flags::Truncate), Records / 2);
+            verify_file(fops, Records / 2);
+            ASSERT_EQ(fops.dir().unlink("data.bin"), 0);
+
+            if (i < WarmupIterations) {
+                highwater = allocator.allocated();
+            } else {
+                ASSERT_EQ(allocator.allocated(), highwater);
+            }
+        }
+
+        temporary_log_level info{ LogLevels::INFO };
+        phyinfof("free-sectors-stress iterations=%zu allocated=%" PRIu32 " reused=%" PRIu32 " map-size=%d", Iterations,
+                 allocator.allocated(), allocator.reused(), memory.sectors().size());
+
+        ASSERT_GT(allocator.reused(), 0u);
+
+        // The free chain goes out of scope here.
+        ASSERT_EQ(allocator.begin(), 0);
+    });
+}
@@ -1,6 +1,7 @@
 #include <directory_chain.h>
 #include <directory_tree.h>
 #include <file_appender.h>
+#include <file_reader.h>
 #include <tree_sector.h>
 
 #include "phylum_tests.h"
@@ -119,3 +120,55 @@ TYPED_TEST(LargeFileFixture, WriteLargeFileIndexed_ContinuousWrites) {
         position_index.log();
     });
 }
+
+TYPED_TEST(LargeFileFixture, SequentialRead) {
+    using layout_type = typename TypeParam::layout_type;
+    using directory_type = typename TypeParam::directory_type;
+
+    layout_type layout;
+    FlashMemory memory{ layout.sector_size };
+
+    memory.mounted<directory_type>([&](auto &dir) {
+        ASSERT_EQ(dir.touch("data.txt"), 0);
+
+        ASSERT_EQ(dir.find("data.txt", open_file_config{ }), 1);
+
+        auto written = 0u;
+
+        {
+            suppress_logs sl;
+
+            file_appender opened{ memory.pc(), &dir, dir.open() };
+            while (written < 1024u * 1024u) {
+                auto wrote = opened.write(lorem1k);
+                ASSERT_GT(wrote, 0);
+                written += wrote;
+            }
+
+            ASSERT_EQ(opened.flush(), 0);
+        }
+
+        ASSERT_EQ(dir.find("data.txt", open_file_config{ }), 1);
+
+        file_reader reader{ memory.pc(), &dir, dir.open() };
+
+        auto nread = 0u;
+        {
+            suppress_logs sl;
+
+            uint8_t buffer[1024];
+            while (true) {
+                auto err = reader.read(buffer, sizeof(buffer));
+                ASSERT_GE(err, 0);
+                if (err == 0) {
+                    break;
+                }
+                ASSERT_EQ(memcmp(buffer, lorem1k, err), 0);
+                nread += err;
+            }
+        }
+
+        ASSERT_EQ(nread, written);
+        ASSERT_EQ(reader.close(), 0);
+    });
+}
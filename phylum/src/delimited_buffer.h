@@ -281,6 +281,26 @@ public:
         phydebug_dump_memory(prefix, ptr(), bytes);
     }
 
+    /**
+     * Finds the record whose delimiter begins at the given position
+     * without walking the records before it. Returns false if there's
+     * no well formed record there.
+     */
+    bool record_at(size_t position, record_ptr &record) const {
+        ensure_valid();
+        read_buffer buffer{ buffer_.ptr(), buffer_.size(), position };
+        uint32_t record_size = 0u;
+        if (!buffer.try_read(record_size) || record_size == 0) {
+            return false;
+        }
+        auto position_end_of_record = buffer.position() + record_size;
+        if (position_end_of_record > buffer_.size()) {
+            return false;
+        }
+        record = record_ptr{ read_buffer{ buffer_.ptr(), position_end_of_record, position }, record_size };
+        return true;
+    }
+
     template<typename T>
     T* as_mutable(record_ptr &record_ptr) {
         return reinterpret_cast<T*>(buffer_.ptr() + record_ptr.start_of_record());
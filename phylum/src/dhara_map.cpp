@@ -68,6 +68,9 @@ int32_t dhara_sector_map::begin(bool force_create) {
         return err;
     }
 
+    // Any cached pages belong to whatever state the map was in before.
+    page_cache_->clear();
+
     dhara_error_t derr;
     if (force_create) {
         phywarnf("dhara clearing");
@@ -136,6 +139,10 @@ int32_t dhara_sector_map::find(dhara_sector_t sector, dhara_page_t *page) {
 
     assert(page_size_ > 0);
 
+    if (page_cache_->get(sector, page)) {
+        return 0;
+    }
+
     dhara_error_t derr;
     auto err = dhara_map_find(&dmap_, sector, page, &derr);
     if (err < 0) {
@@ -143,6 +150,8 @@ int32_t dhara_sector_map::find(dhara_sector_t sector, dhara_page_t *page) {
         return err;
     }
 
+    page_cache_->set(sector, *page);
+
     return 0;
 }
 
@@ -158,6 +167,8 @@ int32_t dhara_sector_map::trim(dhara_sector_t sector) {
         return err;
     }
 
+    page_cache_->invalidate(sector);
+
     return 0;
 }
 
@@ -202,6 +213,8 @@ int32_t dhara_sector_map::read(dhara_sector_t sector, uint8_t *data, size_t size
 int32_t dhara_sector_map::clear() {
     dhara_map_clear(&dmap_);
 
+    page_cache_->clear();
+
     return 0;
 }
 
@@ -291,6 +304,8 @@ int dhara_sector_map::dhara_copy(const struct dhara_nand */*n*/, dhara_page_t sr
         return -1;
     }
 
+    page_cache_->relocate(src, dst);
+
     if (err != nullptr) {
         *err = DHARA_E_NONE;
     }
@@ -15,6 +15,7 @@ private:
 public:
     directory_chain(phyctx pc, dhara_sector_t head)
         : record_chain(pc, head_tail_t{ head, InvalidSector }, "dir-chain") {
+        db().pinned(true);
     }
 
     virtual ~directory_chain() {
@@ -12,13 +12,80 @@ int32_t directory_tree::mount() {
         return -1;
     }
 
+    dir_node_type node;
+    auto err = tree_.find(VolumeId, &node);
+    if (err < 0) {
+        return err;
+    }
+
+    auto versioned = err > 0 && node.u.e.type == entry_type::VolumeEntry;
+    // Trees from before versioning could have a file using the key,
+    // and that file is left alone.
+    volume_key_taken_ = err > 0 && !versioned;
+    if (versioned) {
+        volume_ = node.u.volume;
+    } else {
+        volume_ = dirtree_volume_t{};
+        volume_.version = 1;
+    }
+
+    // Older versions are missing things, and are read around. Newer
+    // versions may lay sectors out in ways we'd misread.
+    if (volume_.version == 0 || volume_.version > FormatVersion) {
+        phyerrorf("dir-tree: unsupported version %d (maximum %d)", volume_.version, FormatVersion);
+        return -1;
+    }
+
+    // Anything we write from here on is in this version's format, so
+    // claim the volume for it.
+    if (volume_.version < FormatVersion && !volume_key_taken_) {
+        err = write_volume();
+        if (err < 0) {
+            return err;
+        }
+    }
+
     return 0;
 }
 
 int32_t directory_tree::format() {
     logged_task lt{ "dir-tree-format" };
 
-    return tree_.create();
+    auto err = tree_.create();
+    if (err < 0) {
+        return err;
+    }
+
+    volume_ = dirtree_volume_t{};
+    volume_key_taken_ = false;
+
+    return write_volume();
+}
+
+int32_t directory_tree::free_chain(dhara_sector_t head) {
+    logged_task lt{ "dir-tree-free-chain" };
+
+    if (volume_key_taken_) {
+        return -1;
+    }
+
+    volume_.free_chain = head;
+
+    return write_volume();
+}
+
+int32_t directory_tree::write_volume() {
+    volume_.version = FormatVersion;
+
+    dir_node_type node = {};
+    node.u.volume = volume_;
+
+    auto err = tree_.add(VolumeId, &node, nullptr);
+    if (err < 0) {
+        return err;
+    }
+
+    return 0;
 }
 
 int32_t directory_tree::touch(const char *name) {
@@ -27,6 +94,9 @@ int32_t directory_tree::touch(const char *name) {
     phydebugf("touch '%s'", name);
 
     auto id = make_file_id(name);
+    if (id == VolumeId) {
+        return -1;
+    }
 
     file_ = {};
     file_.id = id;
@@ -54,6 +124,9 @@ int32_t directory_tree::unlink(const char *name) {
     phydebugf("unlink '%s'", name);
 
     auto id = make_file_id(name);
+    if (id == VolumeId) {
+        return -1;
+    }
 
     file_ = {};
 
@@ -62,7 +135,10 @@ int32_t directory_tree::unlink(const char *name) {
         return err;
     }
 
+    dirtree_file_t unlinked{ name };
+
     err = flush([&](dir_node_type *node) -> int32_t {
+        unlinked = node->u.file;
         *node = dir_node_type{};
         node->u.file = dirtree_file_t(name, (uint16_t)FsDirTreeFlags::Deleted);
         return 1;
@@ -71,6 +147,21 @@ int32_t directory_tree::unlink(const char *name) {
         return err;
     }
 
+    // The entry is gone, so at worst a failure here leaks these.
+    dhara_sector_t chains[] = {
+        unlinked.chain.head,
+        unlinked.attributes.root,
+        unlinked.position_index.tail,
+        unlinked.record_index.tail,
+    };
+
+    for (auto head : chains) {
+        err = allocator_->free_chain(head);
+        if (err < 0) {
+            return err;
+        }
+    }
+
     return 0;
 }
 
@@ -85,6 +176,11 @@ int32_t directory_tree::find(const char *name, open_file_config file_cfg) {
     file_.cfg = file_cfg;
     file_.id = id;
 
+    if (id == VolumeId) {
+        phydebugf("no file");
+        return 0;
+    }
+
     // Zero attribute values before we scan.
     for (auto i = 0u; i < file_cfg.nattrs; ++i) {
         auto &attr = file_cfg.attributes[i];
@@ -173,7 +269,7 @@ int32_t directory_tree::file_data(file_id_t id, file_size_t position, uint8_t co
         memcpy(node->data + position, buffer, size);
         node->u.file.directory_size = position + size;
 
-        return 0;
+        return 1;
     });
     if (err < 0) {
         return err;
@@ -17,6 +17,8 @@ public:
     using dir_node_type = dirtree_tree_value_t<DataCapacity>;
     using dir_tree_type = tree_sector<uint32_t, dir_node_type, 4>;
     using attribute_storage_type = flat_attribute_storage;
+    // Key of the dirtree_volume_t entry, no file may use it.
+    static constexpr file_id_t VolumeId = 0;
 
 private:
     working_buffers *buffers_{ nullptr };
@@ -25,6 +27,8 @@ private:
     dir_tree_type tree_;
     tree_value_ptr_t file_node_ptr_;
     found_file file_;
+    dirtree_volume_t volume_;
+    bool volume_key_taken_{ false };
 
 public:
     directory_tree(phyctx pc, tree_ptr_t tree)
@@ -51,11 +55,31 @@ public:
         return tree_.log();
     }
 
+    /**
+     * Format version of the mounted tree, \see FormatVersion.
+     */
+    uint32_t version() const {
+        return volume_.version;
+    }
+
+    /**
+     * Head of the volume's free sectors chain, or InvalidSector when it
+     * has none.
+     */
+    dhara_sector_t free_chain() const {
+        return volume_.free_chain;
+    }
+
+    int32_t free_chain(dhara_sector_t head);
+
     int32_t touch(const char *name) override;
 
     template<typename TreeType>
     int32_t touch_indexed(const char *name, open_file_config file_cfg) {
         auto id = make_file_id(name);
+        if (id == VolumeId) {
+            return -1;
+        }
 
         dir_node_type node = {};
         node.u.file = dirtree_file_t(name);
@@ -141,6 +165,8 @@ private:
         return phyctx{ *buffers_, *sectors_, *allocator_ };
     }
 
+    int32_t write_volume();
+
     template<typename FlushFunction>
     int32_t flush(FlushFunction fn) {
         assert(file_node_ptr_.node.sector != InvalidSector);
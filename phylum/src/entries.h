@@ -81,6 +81,8 @@ enum entry_type : uint8_t {
     TreeNode = 10,
     FileAttribute = 11,
     FreeSectors = 12,
+    DataRecords = 13,
+    VolumeEntry = 14,
 };
 
 struct PHY_PACKED entry_t {
@@ -110,15 +112,25 @@ struct PHY_PACKED sector_chain_header_t : entry_t {
     }
 };
 
+/**
+ * Version 2 added the data_chain_records_t sub-index to data
+ * sectors. Version 1 data sectors are still read, they just lack the
+ * sub-index. Mounting a super block or directory tree with a newer
+ * version fails.
+ */
+constexpr uint32_t FormatVersion = 2;
+
+constexpr const char *SuperBlockMagic = "phylum";
+
 struct PHY_PACKED super_block_t : sector_chain_header_t {
     char magic[8];
-    uint32_t version{ 1 };
+    uint32_t version{ FormatVersion };
     tree_ptr_t directory_tree{ };
     head_tail_t free_chain{ };
 
     super_block_t() : sector_chain_header_t(entry_type::SuperBlock) {
         bzero(magic, sizeof(magic));
-        strncpy(magic, "phylum", sizeof(magic));
+        strncpy(magic, SuperBlockMagic, sizeof(magic));
     }
 };
 
@@ -157,6 +169,28 @@ struct PHY_PACKED data_chain_header_t : sector_chain_header_t {
     }
 };
 
+constexpr uint16_t InvalidRecordsCount = 0xffff;
+
+/**
+ * Follows the data_chain_header_t in data sectors written by a chain
+ * that's tracking records and counts the records that begin in the
+ * sector, along with where the first and last of them begin. Offsets
+ * are relative to the start of the sector's data. Seeking by record
+ * can then skip whole sectors without decoding every delimiter.
+ */
+struct PHY_PACKED data_chain_records_t : entry_t {
+    uint16_t records{ 0 };
+    uint16_t first{ 0 };
+    uint16_t last{ 0 };
+
+    data_chain_records_t() : entry_t(entry_type::DataRecords) {
+    }
+
+    bool valid() const {
+        return records != InvalidRecordsCount;
+    }
+};
+
 inline uint32_t make_file_id(const char *path) {
     return crc32_checksum(path);
 }
@@ -198,12 +232,26 @@ struct PHY_PACKED dirtree_file_t : dirtree_entry_t {
     }
 };
 
+/**
+ * Volumes rooted at a directory tree have no super block, so their
+ * format version and free chain are kept in the tree itself, under a
+ * reserved key. Trees without one predate it and are version 1.
+ */
+struct PHY_PACKED dirtree_volume_t : entry_t {
+    uint32_t version{ FormatVersion };
+    dhara_sector_t free_chain{ InvalidSector };
+
+    dirtree_volume_t() : entry_t(entry_type::VolumeEntry) {
+    }
+};
+
 template<size_t Storage>
 struct PHY_PACKED dirtree_tree_value_t {
     union PHY_PACKED entry_union {
         dirtree_entry_t e;
         dirtree_dir_t dir;
         dirtree_file_t file;
+        dirtree_volume_t volume;
 
         entry_union() {
         }
@@ -41,24 +41,61 @@ int32_t file_reader::read(uint8_t *data, size_t size) {
         return nread;
     }
 
-    // Right now all inline data has to be read in a single
-    // call. Gotta start somewhere. More often than not this will be
-    // the case, can fix later. I'm only doing this check here because
-    // we have the file size. There's a similar warning inside
-    // directory_chain::read
-    assert(size >= file_.directory_size);
+    if (data == nullptr) {
+        noop_writer writer;
+        return read_inline(writer, size);
+    }
 
     simple_buffer filling{ data, size };
     buffer_writer writer{ filling };
 
-    auto err = directory_->read(file_.id, writer);
+    return read_inline(writer, size);
+}
+
+int32_t file_reader::read(io_writer &writer, size_t size) {
+    logged_task lt{ "fr-read" };
+
+    if (has_chain()) {
+        auto nread = 0u;
+        while (nread < size) {
+            auto err = data_chain_.read(writer, size - nread);
+            if (err < 0) {
+                return err;
+            }
+            if (err == 0) {
+                break;
+            }
+
+            nread += err;
+        }
+
+        return nread;
+    }
+
+    return read_inline(writer, size);
+}
+
+int32_t file_reader::read_inline(io_writer &writer, size_t size) {
+    // Inline data is always handed over whole, so skip what's already
+    // been read and keep at most size bytes of the rest.
+    window_writer window{ &writer, inline_position_, size };
+
+    auto err = directory_->read(file_.id, window);
     if (err < 0) {
         return err;
     }
 
-    inline_position_ += err;
+    inline_position_ += window.written();
+
+    return window.written();
+}
+
+bool file_reader::retain(void const *ptr) {
+    return pc_.buffers_.retain(ptr);
+}
 
-    return err;
+void file_reader::release(void const *ptr) {
+    pc_.buffers_.release(ptr);
 }
 
 int32_t file_reader::close() {
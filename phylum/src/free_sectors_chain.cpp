@@ -8,11 +8,101 @@ free_sectors_chain::free_sectors_chain(phyctx pc, head_tail_t chain) : record_ch
 free_sectors_chain::~free_sectors_chain() {
 }
 
+int32_t free_sectors_chain::mount() {
+    logged_task lt{ "fc-mount" };
+
+    dhara_page_t page = 0;
+    if (sectors()->find(head(), &page) < 0) {
+        phywarnf("sector=%d is missing", head());
+        return -1;
+    }
+
+    {
+        auto page_lock = db().reading(head());
+
+        auto hdr = db().header<sector_chain_header_t>();
+        if (hdr->type != entry_type::FreeChainSector) {
+            phywarnf("sector=%d is not a free chain", head());
+            return -1;
+        }
+    }
+
+    auto err = scan();
+    if (err < 0) {
+        return err;
+    }
+
+    return 0;
+}
+
+int32_t free_sectors_chain::scan() {
+    logged_task lt{ "fc-scan" };
+
+    cursor_sector_ = InvalidSector;
+    cursor_position_ = 0;
+    live_ = 0;
+
+    auto page_lock = db().reading(head());
+
+    assert(back_to_head(page_lock) >= 0);
+
+    while (true) {
+        for (auto iter = db().begin(); iter != db().end(); ++iter) {
+            auto rp = *iter;
+            auto entry = rp.as<entry_t>();
+            assert(entry != nullptr);
+
+            if (entry->type == entry_type::FreeSectors) {
+                auto fs = rp.as<free_sectors_t>();
+                if (fs->head != InvalidSector) {
+                    if (live_ == 0) {
+                        cursor_sector_ = sector();
+                        cursor_position_ = rp.position();
+                    }
+                    live_++;
+                }
+            }
+        }
+
+        auto err = forward(page_lock);
+        if (err < 0) {
+            return err;
+        }
+        if (err == 0) {
+            break;
+        }
+    }
+
+    scanned_ = true;
+
+    phydebugf("live=%" PRIu32 " cursor=%d:%zu", live_, cursor_sector_, cursor_position_);
+
+    return 0;
+}
+
 int32_t free_sectors_chain::add_free_sectors(free_sectors_t record) {
     assert(record.head != InvalidSector);
 
     logged_task lt{ "fc-add-sectors" };
 
+    // Growing this chain may allocate, and those allocations can't come
+    // from the chain we're in the middle of modifying.
+    adding_ = true;
+
+    auto err = append_free_sectors(record);
+
+    adding_ = false;
+
+    if (err < 0) {
+        return err;
+    }
+
+    live_++;
+
+    return 0;
+}
+
+int32_t free_sectors_chain::append_free_sectors(free_sectors_t record) {
     auto page_lock = db().writing(sector());
 
     assert(back_to_head(page_lock) >= 0);
@@ -77,65 +167,62 @@ int32_t free_sectors_chain::dequeue(dhara_sector_t *sector) {
 
     *sector = InvalidSector;
 
-    auto page_lock = db().writing(head());
+    if (adding_) {
+        return 0;
+    }
 
-    assert(back_to_head(page_lock) >= 0);
+    if (!scanned_ || (live_ > 0 && cursor_sector_ == InvalidSector)) {
+        auto err = scan();
+        if (err < 0) {
+            return err;
+        }
+    }
 
-    while (true) {
-        for (auto iter = db().begin(); iter != db().end(); ++iter) {
-            auto rp = *iter;
-            auto entry = rp.as<entry_t>();
-            assert(entry != nullptr);
+    if (live_ == 0) {
+        return 0;
+    }
 
-            if (entry->type == entry_type::FreeSectors) {
-                auto fs = rp.as<free_sectors_t>();
-                auto new_head = fs->head;
+    this->sector(cursor_sector_);
 
-                int32_t err = 0;
+    auto page_lock = db().writing(cursor_sector_);
 
-                if (fs->head != InvalidSector) {
-                    phydebugf("walk: free-sectors(chain): %d", fs->head);
+    record_ptr rp;
+    if (!db().record_at(cursor_position_, rp)) {
+        phyerrorf("invalid cursor %d:%zu", cursor_sector_, cursor_position_);
+        return -1;
+    }
 
-                    free_sectors_chain chain{ pc(), head_tail_t{ fs->head, InvalidSector } };
-                    err = chain.dequeue_sector(sector);
-                    if (err < 0) {
-                        return err;
-                    }
+    auto fs = rp.as<free_sectors_t>();
+    assert(fs->type == entry_type::FreeSectors);
+    assert(fs->head != InvalidSector);
 
-                    new_head = chain.head();
-                }
+    phydebugf("walk: free-sectors(chain): %d", fs->head);
 
-                if (err > 0) {
-                    if (fs->head != new_head) {
-                        phydebugf("walk: head changed %d vs %d", fs->head, new_head);
+    free_sectors_chain chain{ pc(), head_tail_t{ fs->head, InvalidSector } };
+    auto err = chain.dequeue_sector(sector);
+    if (err < 0) {
+        return err;
+    }
 
-                        auto mutable_record = db().as_mutable<free_sectors_t>(rp);
+    auto new_head = chain.head();
 
-                        mutable_record->head = new_head;
+    auto mutable_record = db().as_mutable<free_sectors_t>(rp);
 
-                        page_lock.dirty();
+    mutable_record->head = new_head;
 
-                        err = page_lock.flush(this->sector());
-                        if (err < 0) {
-                            return err;
-                        }
-                    }
+    page_lock.dirty();
 
-                    return 1;
-                }
-            }
-        }
+    err = page_lock.flush(this->sector());
+    if (err < 0) {
+        return err;
+    }
 
-        auto err = forward(page_lock);
-        if (err < 0) {
-            return err;
-        }
-        if (err == 0) {
-            break;
-        }
+    if (new_head == InvalidSector) {
+        cursor_sector_ = InvalidSector;
+        live_--;
     }
 
-    return 0;
+    return 1;
 }
 
 int32_t free_sectors_chain::write_header(page_lock &page_lock) {
@@ -4,19 +4,37 @@
 
 namespace phylum {
 
-class free_sectors_chain : public record_chain {
+class free_sectors_chain : public record_chain, public free_sectors_store {
+private:
+    /**
+     * Location of the first record that still has sectors, kept so
+     * dequeuing doesn't walk the whole chain every time.
+     */
+    dhara_sector_t cursor_sector_{ InvalidSector };
+    size_t cursor_position_{ 0 };
+    uint32_t live_{ 0 };
+    bool scanned_{ false };
+    bool adding_{ false };
+
 public:
     free_sectors_chain(phyctx pc, head_tail_t chain);
 
     virtual ~free_sectors_chain();
 
 public:
-    int32_t add_chain(dhara_sector_t head);
+    int32_t mount();
+    int32_t add_chain(dhara_sector_t head) override;
     int32_t add_tree(tree_ptr_t tree);
-    int32_t dequeue(dhara_sector_t *sector);
+    int32_t dequeue(dhara_sector_t *sector) override;
+
+    uint32_t live() const {
+        return live_;
+    }
 
 private:
+    int32_t scan();
     int32_t add_free_sectors(free_sectors_t record);
+    int32_t append_free_sectors(free_sectors_t record);
     int32_t write_header(page_lock &page_lock) override;
     int32_t seek_end_of_buffer(page_lock &page_lock) override;
 
@@ -10,7 +10,9 @@ simple_page_cache::simple_page_cache(simple_buffer buffer) : buffer_(std::move(b
     phyverbosef("page-cache-ready size=%d", size_);
 }
 
-simple_page_cache::simple_page_cache(simple_page_cache &&other) : buffer_(std::move(other.buffer_)){
+simple_page_cache::simple_page_cache(simple_page_cache &&other)
+    : buffer_(std::move(other.buffer_)), entries_(std::exchange(other.entries_, nullptr)), size_(std::exchange(other.size_, 0)),
+      counter_(other.counter_), statistics_(other.statistics_) {
 }
 
 simple_page_cache::~simple_page_cache() {
@@ -22,10 +24,13 @@ bool simple_page_cache::get(dhara_sector_t sector, dhara_page_t *page) {
         if (e.sector == sector) {
             phyverbosef("page-cache-got sector=%d page=%d age=%d", sector, e.page, e.age);
             *page = e.page;
+            statistics_.hits++;
             return true;
         }
     }
 
+    statistics_.misses++;
+
     return false;
 }
 
@@ -67,6 +72,9 @@ bool simple_page_cache::set(dhara_sector_t sector, dhara_page_t page) {
     assert(selected >= 0);
 
     auto &e = entries_[selected];
+    if (e.sector != InvalidSector && e.sector != sector) {
+        statistics_.evictions++;
+    }
     e.sector = sector;
     e.page = page;
     e.age = ++counter_;
@@ -76,6 +84,29 @@ bool simple_page_cache::set(dhara_sector_t sector, dhara_page_t page) {
     return true;
 }
 
+void simple_page_cache::invalidate(dhara_sector_t sector) {
+    for (auto i = 0u; i < size_; ++i) {
+        auto &e = entries_[i];
+        if (e.sector == sector) {
+            e.sector = InvalidSector;
+            e.age = 0;
+        }
+    }
+}
+
+void simple_page_cache::relocate(dhara_page_t src, dhara_page_t dst) {
+    for (auto i = 0u; i < size_; ++i) {
+        auto &e = entries_[i];
+        if (e.sector != InvalidSector && e.page == src) {
+            e.page = dst;
+        }
+    }
+}
+
+void simple_page_cache::clear() {
+    buffer_.clear(0xff);
+}
+
 void simple_page_cache::debug() {
     phyinfof("page-cache size=%zu", size_);
     for (auto i = 0u; i < size_; ++i) {
@@ -86,4 +117,161 @@ void simple_page_cache::debug() {
     }
 }
 
+clock_page_cache::clock_page_cache(simple_buffer buffer) : buffer_(std::move(buffer)) {
+    size_ = buffer_.size() / sizeof(cache_entry_t);
+    capacity_ = std::max<size_t>(size_ * 3 / 4, 1);
+    entries_ = (cache_entry_t *)buffer_.ptr();
+    assert(size_ > 1);
+    buffer_.clear(0xff);
+    phyverbosef("page-cache-ready size=%d capacity=%d", size_, capacity_);
+}
+
+clock_page_cache::clock_page_cache(clock_page_cache &&other)
+    : buffer_(std::move(other.buffer_)), entries_(std::exchange(other.entries_, nullptr)), size_(std::exchange(other.size_, 0)),
+      capacity_(std::exchange(other.capacity_, 0)), used_(std::exchange(other.used_, 0)), hand_(other.hand_),
+      statistics_(other.statistics_) {
+}
+
+clock_page_cache::~clock_page_cache() {
+}
+
+int32_t clock_page_cache::find_slot(dhara_sector_t sector) const {
+    auto slot = home(sector);
+    for (auto i = 0u; i < size_; ++i) {
+        auto &e = entries_[slot];
+        if (e.sector == sector) {
+            return (int32_t)slot;
+        }
+        if (e.sector == InvalidSector) {
+            return -1;
+        }
+        slot = next(slot);
+    }
+
+    return -1;
+}
+
+bool clock_page_cache::get(dhara_sector_t sector, dhara_page_t *page) {
+    auto slot = find_slot(sector);
+    if (slot < 0) {
+        statistics_.misses++;
+        return false;
+    }
+
+    auto &e = entries_[slot];
+    e.referenced = 1;
+    *page = e.page;
+    statistics_.hits++;
+
+    phyverbosef("page-cache-got sector=%d page=%d slot=%d", sector, e.page, slot);
+
+    return true;
+}
+
+bool clock_page_cache::set(dhara_sector_t sector, dhara_page_t page) {
+    assert(sector != InvalidSector);
+
+    auto existing = find_slot(sector);
+    if (existing >= 0) {
+        entries_[existing].page = page;
+        return true;
+    }
+
+    if (used_ >= capacity_) {
+        evict();
+    }
+
+    auto slot = home(sector);
+    while (entries_[slot].sector != InvalidSector) {
+        slot = next(slot);
+    }
+
+    auto &e = entries_[slot];
+    e.sector = sector;
+    e.page = page;
+    e.referenced = 0;
+    used_++;
+
+    phyverbosef("page-cache-set sector=%d page=%d slot=%d", sector, page, slot);
+
+    return true;
+}
+
+void clock_page_cache::invalidate(dhara_sector_t sector) {
+    auto slot = find_slot(sector);
+    if (slot >= 0) {
+        remove_slot(slot);
+    }
+}
+
+void clock_page_cache::relocate(dhara_page_t src, dhara_page_t dst) {
+    // This is rare, only happens during garbage collection and pages
+    // aren't indexed, so we scan.
+    for (auto i = 0u; i < size_; ++i) {
+        auto &e = entries_[i];
+        if (e.sector != InvalidSector && e.page == src) {
+            e.page = dst;
+        }
+    }
+}
+
+void clock_page_cache::clear() {
+    buffer_.clear(0xff);
+    used_ = 0;
+    hand_ = 0;
+}
+
+void clock_page_cache::remove_slot(size_t slot) {
+    // Backward shift deletion, pull any entries that probed past this
+    // slot back so lookups never need tombstones.
+    auto hole = slot;
+    auto i = next(slot);
+    while (entries_[i].sector != InvalidSector) {
+        auto wanted = home(entries_[i].sector);
+        auto stays = hole <= i ? (hole < wanted && wanted <= i) : (hole < wanted || wanted <= i);
+        if (!stays) {
+            entries_[hole] = entries_[i];
+            hole = i;
+        }
+        i = next(i);
+    }
+
+    memset(&entries_[hole], 0xff, sizeof(cache_entry_t));
+    used_--;
+}
+
+void clock_page_cache::evict() {
+    assert(used_ > 0);
+
+    while (true) {
+        auto &e = entries_[hand_];
+        if (e.sector != InvalidSector) {
+            if (e.referenced) {
+                e.referenced = 0;
+            }
+            else {
+                phyverbosef("page-cache-evict sector=%d page=%d slot=%d", e.sector, e.page, hand_);
+                // Shifting may move a newer entry into this slot, it
+                // gets a pass because the hand moves on anyway.
+                remove_slot(hand_);
+                hand_ = next(hand_);
+                statistics_.evictions++;
+                return;
+            }
+        }
+        hand_ = next(hand_);
+    }
+}
+
+void clock_page_cache::debug() {
+    phyinfof("page-cache size=%zu used=%zu hits=%" PRIu32 " misses=%" PRIu32 " evictions=%" PRIu32, size_, used_,
+             statistics_.hits, statistics_.misses, statistics_.evictions);
+    for (auto i = 0u; i < size_; ++i) {
+        auto &e = entries_[i];
+        if (e.sector != InvalidSector) {
+            phydebugf("page-cache[%4d] sector=%d page=%d ref=%d", i, e.sector, e.page, e.referenced);
+        }
+    }
+}
+
 } // namespace phylum
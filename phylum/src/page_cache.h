@@ -12,11 +12,31 @@ extern "C" {
 
 namespace phylum {
 
+struct page_cache_statistics {
+    uint32_t hits{ 0 };
+    uint32_t misses{ 0 };
+    uint32_t evictions{ 0 };
+};
+
 class sector_page_cache {
 public:
     virtual bool get(dhara_sector_t sector, dhara_page_t *page) = 0;
     virtual bool set(dhara_sector_t sector, dhara_page_t page) = 0;
 
+    /**
+     * Forget any page cached for the given sector, called when the
+     * sector is trimmed.
+     */
+    virtual void invalidate(dhara_sector_t sector) = 0;
+
+    /**
+     * Called when dhara copies a live page during garbage collection
+     * or recovery, any sector cached at src now lives at dst.
+     */
+    virtual void relocate(dhara_page_t src, dhara_page_t dst) = 0;
+
+    virtual void clear() = 0;
+
 };
 
 class noop_page_cache : public sector_page_cache {
@@ -25,10 +45,19 @@ public:
         return false;
     }
 
-    bool set(dhara_sector_t /*sector*/, dhara_page_t /*page*/) {
+    bool set(dhara_sector_t /*sector*/, dhara_page_t /*page*/) override {
         return true;
     }
 
+    void invalidate(dhara_sector_t /*sector*/) override {
+    }
+
+    void relocate(dhara_page_t /*src*/, dhara_page_t /*dst*/) override {
+    }
+
+    void clear() override {
+    }
+
     void debug() {
     }
 };
@@ -44,6 +73,7 @@ private:
     cache_entry_t *entries_{ nullptr };
     size_t size_{ 0 };
     uint32_t counter_{ 0 };
+    page_cache_statistics statistics_;
 
 public:
     simple_page_cache(simple_buffer buffer);
@@ -53,11 +83,90 @@ public:
 public:
     bool get(dhara_sector_t sector, dhara_page_t *page) override;
     bool set(dhara_sector_t sector, dhara_page_t page) override;
+    void invalidate(dhara_sector_t sector) override;
+    void relocate(dhara_page_t src, dhara_page_t dst) override;
+    void clear() override;
     void debug();
 
+    size_t size() const {
+        return size_;
+    }
+
+    page_cache_statistics const &statistics() const {
+        return statistics_;
+    }
+
 private:
     bool better_drop_candidate(cache_entry_t const &candidate, cache_entry_t const &selected);
 
 };
 
+/**
+ * Open addressing (linear probing) table of sector to page mappings
+ * with CLOCK eviction, so lookups and replacement are O(1) on average
+ * rather than scanning every entry. Entries are carved out of the
+ * given buffer, just like simple_page_cache. Table is never allowed to
+ * fill past 3/4 of the slots so probe sequences stay short.
+ */
+class clock_page_cache : public sector_page_cache {
+private:
+    struct cache_entry_t {
+        dhara_sector_t sector;
+        dhara_page_t page;
+        uint8_t referenced;
+    };
+
+    simple_buffer buffer_;
+    cache_entry_t *entries_{ nullptr };
+    size_t size_{ 0 };
+    size_t capacity_{ 0 };
+    size_t used_{ 0 };
+    size_t hand_{ 0 };
+    page_cache_statistics statistics_;
+
+public:
+    clock_page_cache(simple_buffer buffer);
+    clock_page_cache(clock_page_cache &&other);
+    virtual ~clock_page_cache();
+
+public:
+    bool get(dhara_sector_t sector, dhara_page_t *page) override;
+    bool set(dhara_sector_t sector, dhara_page_t page) override;
+    void invalidate(dhara_sector_t sector) override;
+    void relocate(dhara_page_t src, dhara_page_t dst) override;
+    void clear() override;
+    void debug();
+
+    size_t size() const {
+        return size_;
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    size_t used() const {
+        return used_;
+    }
+
+    page_cache_statistics const &statistics() const {
+        return statistics_;
+    }
+
+private:
+    size_t home(dhara_sector_t sector) const {
+        // Fibonacci hashing, sectors tend to be allocated sequentially.
+        return (size_t)((sector * 2654435761u) % size_);
+    }
+
+    size_t next(size_t slot) const {
+        return slot + 1 == size_ ? 0 : slot + 1;
+    }
+
+    int32_t find_slot(dhara_sector_t sector) const;
+    void remove_slot(size_t slot);
+    void evict();
+
+};
+
 } // namespace phylum
@@ -74,7 +74,8 @@ int32_t page_lock::dirty(bool dirty) {
     return 0;
 }
 
-paging_delimited_buffer::paging_delimited_buffer(working_buffers &buffers, sector_map &sectors) : buffers_(&buffers), sectors_(&sectors) {
+paging_delimited_buffer::paging_delimited_buffer(working_buffers &buffers, sector_map &sectors, bool pinned)
+    : buffers_(&buffers), sectors_(&sectors), pinned_(pinned) {
 }
 
 page_lock paging_delimited_buffer::reading(dhara_sector_t sector) {
@@ -130,7 +131,7 @@ int32_t paging_delimited_buffer::replace(dhara_sector_t sector, bool read_only,
         return sectors_->write(page_sector, buffer, size);
     };
 
-    auto opened = buffers_->open_sector(sector, read_only, miss_fn, flush_fn);
+    auto opened = buffers_->open_sector(sector, read_only, pinned_, miss_fn, flush_fn);
 
     if (ptr() != nullptr) {
         phyverbosef("page-lock: freeing previous buffer");
@@ -4,33 +4,83 @@
 
 namespace phylum {
 
+/**
+ * Keeps sectors that are no longer in use until they're allocated
+ * again, on flash this is a free_sectors_chain.
+ */
+class free_sectors_store {
+public:
+    virtual ~free_sectors_store() {
+    }
+
+public:
+    /**
+     * Releases every sector in the chain starting at head.
+     */
+    virtual int32_t add_chain(dhara_sector_t head) = 0;
+
+    /**
+     * Returns 1 when a free sector was dequeued, 0 when the store is
+     * empty and < 0 on errors.
+     */
+    virtual int32_t dequeue(dhara_sector_t *sector) = 0;
+};
+
 class sector_allocator {
 private:
     sector_map &sectors_;
+    free_sectors_store *free_{ nullptr };
     dhara_sector_t counter_{ 0 };
+    uint32_t reused_{ 0 };
 
 public:
     sector_allocator(sector_map &sectors) : sectors_(sectors) {
     }
 
 public:
-    int32_t begin() {
+    int32_t begin(free_sectors_store *free = nullptr) {
         counter_ = sectors_.size() + 1;
+        free_ = free;
+        reused_ = 0;
 
         return 0;
     }
 
     virtual dhara_sector_t allocate() {
-        // TODO We should also maintain a free sector collection. We
-        // can do this by just keeping a sector chain with their
-        // numbers.
+        if (free_ != nullptr) {
+            dhara_sector_t sector = InvalidSector;
+            auto err = free_->dequeue(&sector);
+            if (err < 0) {
+                phywarnf("free sectors dequeue failed (%d)", err);
+            } else if (err > 0) {
+                reused_++;
+                return sector;
+            }
+        }
+
         return counter_++;
     }
 
+    /**
+     * Hands the sectors in a chain back for reuse, this is a no-op
+     * when there's nowhere to keep them.
+     */
+    int32_t free_chain(dhara_sector_t head) {
+        if (free_ == nullptr || head == InvalidSector) {
+            return 0;
+        }
+
+        return free_->add_chain(head);
+    }
+
     dhara_sector_t allocated() {
         return counter_;
     }
 
+    uint32_t reused() const {
+        return reused_;
+    }
+
 };
 
 } // namespace phylum
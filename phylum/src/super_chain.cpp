@@ -11,7 +11,19 @@ int32_t super_chain::mount() {
     }
 
     auto hdr = db().header<super_block_t>();
+    if (strncmp(hdr->magic, SuperBlockMagic, sizeof(hdr->magic)) != 0) {
+        phyerrorf("super-block: bad magic");
+        return -1;
+    }
+
+    // Older versions are missing things, and are read around. Newer
+    // versions may lay sectors out in ways we'd misread.
+    if (hdr->version == 0 || hdr->version > FormatVersion) {
+        phyerrorf("super-block: unsupported version %d (maximum %d)", hdr->version, FormatVersion);
+        return -1;
+    }
 
+    version_ = hdr->version;
     directory_tree_ = hdr->directory_tree;
 
     return 0;
@@ -37,6 +49,12 @@ int32_t super_chain::update(tree_ptr_t directory_tree) {
             header->directory_tree = directory_tree;
             modified = true;
         }
+        // Anything we've written since mounting is in this version's
+        // format, so claim the volume for it.
+        if (header->version != FormatVersion) {
+            header->version = FormatVersion;
+            modified = true;
+        }
         return 0;
     }) == 0);
 
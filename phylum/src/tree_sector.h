@@ -12,26 +12,38 @@ namespace phylum {
 class Keys {
 public:
     // Returns the position where 'key' should be inserted in a leaf node
-    // that has the given keys.
-    // NOTE: These and the following methods do a simple linear search, which is
-    // just fine for N or M < 100. Any large and a Binary Search is better.
+    // that has the given keys, which is the first key not less than
+    // 'key'. Nodes hold hundreds of keys so these are binary searches.
     template <typename KEY, typename NODE> static inline index_type leaf_position_for(const KEY &key, const NODE &node) {
-        index_type k = 0;
-        while ((k < node.number_keys) && (node.keys[k] < key)) {
-            ++k;
+        index_type low = 0;
+        index_type high = node.number_keys;
+        while (low < high) {
+            index_type middle = low + (high - low) / 2;
+            if (node.keys[middle] < key) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
         }
-        assert(k <= node.number_keys);
-        return k;
+        assert(low <= node.number_keys);
+        return low;
     }
 
     // Returns the position where 'key' should be inserted in an inner node
-    // that has the given keys.
+    // that has the given keys, which is the first key greater than 'key'.
     template <typename KEY, typename NODE> static inline index_type inner_position_for(const KEY &key, const NODE &node) {
-        index_type k = 0;
-        while ((k < node.number_keys) && ((node.keys[k] < key) || (node.keys[k] == key))) {
-            ++k;
+        index_type low = 0;
+        index_type high = node.number_keys;
+        while (low < high) {
+            index_type middle = low + (high - low) / 2;
+            if (key < node.keys[middle]) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
         }
-        return k;
+        assert(low <= node.number_keys);
+        return low;
     }
 };
 
@@ -110,30 +122,33 @@ protected:
 
 private:
     static persisted_node_t find_root_in_sector(dhara_sector_t sector, delimited_buffer &db) {
-        persisted_node_t selected;
+        // The root node is created immediately after the sector header
+        // and never moves, growing the tree copies the old root into a
+        // new node instead. So the first node in the sector is the root.
         for (auto iter = db.begin(); iter != db.end(); ++iter) {
             auto rp = *iter;
             if (rp.as<entry_t>()->type == entry_type::TreeNode) {
                 auto node = db.as_mutable<default_node_type>(rp);
-                if (selected.node == nullptr || selected.node->depth < node->depth) {
-                    selected = persisted_node_t{ node, node_ptr_t{ sector, (sector_offset_t)rp.position() } };
-                }
+                phyverbosef("found root=%d:%zu", sector, rp.position());
+                return persisted_node_t{ node, node_ptr_t{ sector, (sector_offset_t)rp.position() } };
             }
         }
-        phyverbosef("found root=%d:%d", selected.ptr.sector, selected.ptr.position);
-        return selected;
+        return persisted_node_t{};
     }
 
     static persisted_node_t find_node_in_sector(delimited_buffer &db, node_ptr_t ptr) {
-        persisted_node_t selected;
-        for (auto iter = db.begin(); iter != db.end(); ++iter) {
-            auto rp = *iter;
-            if (rp.position() == ptr.position) {
-                auto node = db.as_mutable<default_node_type>(rp);
-                return persisted_node_t{ node, ptr };
-            }
-        }
-        return persisted_node_t{};
+        // Node pointers are the offset of the node's record in the
+        // sector, so we can go straight to it rather than walking the
+        // records before it.
+        record_ptr rp;
+        if (!db.record_at(ptr.position, rp)) {
+            return persisted_node_t{};
+        }
+        if (rp.delimited_size() != sizeof(default_node_type) || rp.as<entry_t>()->type != entry_type::TreeNode) {
+            return persisted_node_t{};
+        }
+        auto node = db.as_mutable<default_node_type>(rp);
+        return persisted_node_t{ node, ptr };
     }
 
 private:
@@ -146,7 +161,7 @@ private:
 
     template<typename TAccess>
     int32_t dereference_root(TAccess fn) {
-        buffer_type buffer{ *buffers_, *sectors_ };
+        buffer_type buffer{ *buffers_, *sectors_, true };
 
         phyverbosef("dereference-root: %d", root_);
 
@@ -170,7 +185,7 @@ private:
     int32_t dereference(bool read_only, node_ptr_t node_ptr, TAccess fn) {
         assert(node_ptr.sector != InvalidSector);
 
-        buffer_type buffer{ *buffers_, *sectors_ };
+        buffer_type buffer{ *buffers_, *sectors_, true };
 
         phyverbosef("dereference-node: %d:%d", node_ptr.sector, node_ptr.position);
 
@@ -233,17 +248,19 @@ private:
             }
         }
 
-        buffer_type buffer{ *buffers_, *sectors_ };
+        buffer_type buffer{ *buffers_, *sectors_, true };
 
         auto allocated = allocator_->allocate();
 
-        auto child_lock = buffer.writing(allocated);
+        auto child_lock = buffer.overwrite(allocated);
 
         auto &db = child_lock.db();
 
         phydebugf("%s grow! allocated=%d", name(), allocated);
 
-        db.rewind();
+        // Allocated sectors may have been reused, so clear out whatever
+        // was there before.
+        db.clear();
 
         db.template emplace<sector_chain_header_t>(entry_type::TreeSector, InvalidSector, tail_);
 
@@ -277,7 +294,7 @@ private:
 
     int32_t follow_node_ptr(page_lock &lock, node_ptr_t &ptr, persisted_node_t &followed) {
         if (ptr.sector != lock.sector()) {
-            phyinfof("follow %d -> %d:%d (load-sector)", lock.sector(), ptr.sector, ptr.position);
+            phyverbosef("follow %d -> %d:%d (load-sector)", lock.sector(), ptr.sector, ptr.position);
 
             assert(!lock.is_dirty());
 
@@ -288,7 +305,7 @@ private:
 
             phydebugf("follow %d:%d (done) page-lock-sector=%d", ptr.sector, ptr.position, lock.sector());
         } else {
-            phyinfof("follow %d -> %d:%d (same-sector)", lock.sector(), ptr.sector, ptr.position);
+            phyverbosef("follow %d -> %d:%d (same-sector)", lock.sector(), ptr.sector, ptr.position);
         }
 
         followed = find_node_in_sector(lock.db(), ptr);
@@ -387,54 +404,39 @@ private:
         node_ptr_t insertion_ptr;
 
         auto err = dereference(false, node_ptr, [this, &insertion_ptr, node_ptr, &key, &value, found_ptr](page_lock &lock, default_node_type *node) -> int32_t {
-            index_type index = node->number_keys - 1;
-
             assert(node->number_keys < (index_type)Size);
 
             if (node->type == node_type::Leaf) {
-                // Check for an overwrite before we shift. Is there a
-                // faster way?
-                auto overwrite = false;
-                for (auto i = 0; i < node->number_keys; ++i) {
-                    if (node->keys[i] == key) {
-                        phydebugf("replace leaf=%d:%d index=%d key=%d nkeys=%d", node_ptr.sector, node_ptr.position, i, key, node->number_keys);
-                        if (value != nullptr) {
-                            node->d.values[i] = *value;
-                        }
-                        if (found_ptr != nullptr) {
-                            found_ptr->node = node_ptr;
-                            found_ptr->index = i;
-                        }
-                        overwrite = true;
-                        break;
+                auto position = Keys::leaf_position_for(key, *node);
+                if (position < node->number_keys && node->keys[position] == key) {
+                    phydebugf("replace leaf=%d:%d index=%d key=%d nkeys=%d", node_ptr.sector, node_ptr.position, position, key, node->number_keys);
+                    if (value != nullptr) {
+                        node->d.values[position] = *value;
                     }
                 }
-
-                if (!overwrite) {
-                    while (index >= 0 && node->keys[index] > key) {
-                        node->keys[index + 1] = node->keys[index];
-                        node->d.values[index + 1] = node->d.values[index];
-                        index--;
+                else {
+                    for (auto j = node->number_keys; j > position; --j) {
+                        node->keys[j] = node->keys[j - 1];
+                        node->d.values[j] = node->d.values[j - 1];
                     }
 
-                    phydebugf("value leaf=%d:%d index=%d key=%d nkeys=%d", node_ptr.sector, node_ptr.position, index + 1, key, node->number_keys);
-                    node->keys[index + 1] = key;
+                    phydebugf("value leaf=%d:%d index=%d key=%d nkeys=%d", node_ptr.sector, node_ptr.position, position, key, node->number_keys);
+                    node->keys[position] = key;
                     if (value != nullptr) {
-                        node->d.values[index + 1] = *value;
-                    }
-                    if (found_ptr != nullptr) {
-                        found_ptr->node = node_ptr;
-                        found_ptr->index = index + 1;
+                        node->d.values[position] = *value;
                     }
                     node->number_keys++;
                 }
 
+                if (found_ptr != nullptr) {
+                    found_ptr->node = node_ptr;
+                    found_ptr->index = position;
+                }
+
                 lock.dirty();
             }
             else {
-                while (index >= 0 && node->keys[index] > key) {
-                    index--;
-                }
+                index_type index = Keys::inner_position_for(key, *node) - 1;
 
                 auto child_ptr = node->d.children[index + 1];
                 auto err = dereference(false, child_ptr, [this, &lock, &index, &key, child_ptr, node_ptr, node](page_lock &child_lock, default_node_type *child) -> int32_t {
@@ -586,12 +588,14 @@ public:
 
         phydebugf("creating");
 
-        buffer_type db{ *buffers_, *sectors_ };
+        buffer_type db{ *buffers_, *sectors_, true };
 
         auto lock = db.overwrite(root_);
 
         assert(db.empty());
 
+        db.clear();
+
         db.template emplace<sector_chain_header_t>(entry_type::TreeSector);
 
         phydebugf("creating new tree position=%d node-size=%d sector-size=%d", db.position(), sizeof(default_node_type), db.size());
@@ -740,7 +744,7 @@ public:
 
         phydebugf("finding %d", key);
 
-        buffer_type db{ *buffers_, *sectors_ };
+        buffer_type db{ *buffers_, *sectors_, true };
 
         auto lock = db.reading(root_);
 
@@ -795,7 +799,7 @@ public:
 
         phydebugf("finding %d", key);
 
-        buffer_type db{ *buffers_, *sectors_ };
+        buffer_type db{ *buffers_, *sectors_, true };
 
         auto lock = db.reading(root_);
 
@@ -862,7 +866,7 @@ public:
     int32_t log(bool graph = false) {
         logged_task lt{ name(), "tree-log" };
 
-        buffer_type db{ *buffers_, *sectors_ };
+        buffer_type db{ *buffers_, *sectors_, true };
 
         auto lock = db.reading(root_);
 
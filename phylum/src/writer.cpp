@@ -12,6 +12,40 @@ int32_t noop_writer::write(uint8_t const * /*data*/, size_t size) {
     return copying;
 }
 
+int32_t limited_writer::write(uint8_t const *data, size_t size) {
+    auto writing = std::min<size_t>(remaining_, size);
+    if (writing == 0) {
+        return 0;
+    }
+
+    auto err = target_->write(data, writing);
+    if (err < 0) {
+        return err;
+    }
+
+    remaining_ -= err;
+
+    return err;
+}
+
+int32_t window_writer::write(uint8_t const *data, size_t size) {
+    auto skipping = std::min<size_t>(skip_, size);
+    skip_ -= skipping;
+
+    auto writing = std::min<size_t>(remaining_, size - skipping);
+    if (writing > 0) {
+        auto err = target_->write(data + skipping, writing);
+        if (err < 0) {
+            return err;
+        }
+
+        remaining_ -= err;
+        written_ += err;
+    }
+
+    return size;
+}
+
 int32_t varint_decoder::write(uint8_t const *data, size_t size) {
     auto nread = 0;
 
@@ -55,7 +55,7 @@ private:
     working_buffers buffers_{ &buffer_memory_, sector_size_, 32 };
     memory_flash_memory memory_{ sector_size_ };
     // noop_page_cache page_cache_;
-    simple_page_cache page_cache_{ buffers_.allocate(sector_size_) };
+    clock_page_cache page_cache_{ buffers_.allocate(sector_size_) };
     dhara_sector_map sectors_{ buffers_, memory_, &page_cache_ };
     test_sector_allocator allocator_{ sectors_ };
     bool formatted_{ false };
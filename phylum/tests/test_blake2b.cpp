@@ -0,0 +1,255 @@
+#include <chrono>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <blake2b.h>
+
+#include "phylum_tests.h"
+
+using namespace phylum;
+
+class Blake2bFixture : public PhylumFixture {};
+
+/**
+ * Straight from RFC 7693, so the optimized kernel has something obviously
+ * correct to be compared against.
+ */
+class rfc7693_blake2b {
+private:
+    uint8_t b_[128];
+    uint64_t h_[8];
+    uint64_t t_[2];
+    size_t c_;
+    size_t outlen_;
+
+    static uint64_t rotr64(uint64_t x, uint32_t n) {
+        return (x >> n) ^ (x << (64 - n));
+    }
+
+    static uint64_t get64(const uint8_t *p) {
+        uint64_t v = 0;
+        for (auto i = 0; i < 8; ++i) {
+            v |= (uint64_t)p[i] << (8 * i);
+        }
+        return v;
+    }
+
+    void compress(bool last) {
+        static const uint64_t iv[8] = { 0x6A09E667F3BCC908, 0xBB67AE8584CAA73B, 0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+                                        0x510E527FADE682D1, 0x9B05688C2B3E6C1F, 0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179 };
+        static const uint8_t sigma[12][16] = {
+            { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 }, { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+            { 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 }, { 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+            { 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 }, { 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+            { 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 }, { 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+            { 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 }, { 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+            { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 }, { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 }
+        };
+
+        uint64_t v[16], m[16];
+        for (auto i = 0; i < 8; ++i) {
+            v[i] = h_[i];
+            v[i + 8] = iv[i];
+        }
+        v[12] ^= t_[0];
+        v[13] ^= t_[1];
+        if (last) {
+            v[14] = ~v[14];
+        }
+        for (auto i = 0; i < 16; ++i) {
+            m[i] = get64(&b_[8 * i]);
+        }
+
+        auto g = [&](int a, int b, int c, int d, uint64_t x, uint64_t y) {
+            v[a] = v[a] + v[b] + x;
+            v[d] = rotr64(v[d] ^ v[a], 32);
+            v[c] = v[c] + v[d];
+            v[b] = rotr64(v[b] ^ v[c], 24);
+            v[a] = v[a] + v[b] + y;
+            v[d] = rotr64(v[d] ^ v[a], 16);
+            v[c] = v[c] + v[d];
+            v[b] = rotr64(v[b] ^ v[c], 63);
+        };
+
+        for (auto i = 0; i < 12; ++i) {
+            g(0, 4, 8, 12, m[sigma[i][0]], m[sigma[i][1]]);
+            g(1, 5, 9, 13, m[sigma[i][2]], m[sigma[i][3]]);
+            g(2, 6, 10, 14, m[sigma[i][4]], m[sigma[i][5]]);
+            g(3, 7, 11, 15, m[sigma[i][6]], m[sigma[i][7]]);
+            g(0, 5, 10, 15, m[sigma[i][8]], m[sigma[i][9]]);
+            g(1, 6, 11, 12, m[sigma[i][10]], m[sigma[i][11]]);
+            g(2, 7, 8, 13, m[sigma[i][12]], m[sigma[i][13]]);
+            g(3, 4, 9, 14, m[sigma[i][14]], m[sigma[i][15]]);
+        }
+
+        for (auto i = 0; i < 8; ++i) {
+            h_[i] ^= v[i] ^ v[i + 8];
+        }
+    }
+
+public:
+    rfc7693_blake2b(size_t outlen) : c_(0), outlen_(outlen) {
+        static const uint64_t iv[8] = { 0x6A09E667F3BCC908, 0xBB67AE8584CAA73B, 0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+                                        0x510E527FADE682D1, 0x9B05688C2B3E6C1F, 0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179 };
+        for (auto i = 0; i < 8; ++i) {
+            h_[i] = iv[i];
+        }
+        h_[0] ^= 0x01010000 ^ outlen;
+        t_[0] = t_[1] = 0;
+    }
+
+    void update(const uint8_t *in, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            if (c_ == 128) {
+                t_[0] += c_;
+                if (t_[0] < c_) {
+                    t_[1]++;
+                }
+                compress(false);
+                c_ = 0;
+            }
+            b_[c_++] = in[i];
+        }
+    }
+
+    void finalize(uint8_t *out) {
+        t_[0] += c_;
+        if (t_[0] < c_) {
+            t_[1]++;
+        }
+        while (c_ < 128) {
+            b_[c_++] = 0;
+        }
+        compress(true);
+        for (size_t i = 0; i < outlen_; ++i) {
+            out[i] = (h_[i >> 3] >> (8 * (i & 7))) & 0xFF;
+        }
+    }
+};
+
+static std::vector<uint8_t> test_data(size_t size) {
+    std::vector<uint8_t> data(size);
+    for (auto i = 0u; i < size; ++i) {
+        data[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    return data;
+}
+
+TEST_F(Blake2bFixture, KnownAnswer) {
+    // RFC 7693, Appendix A
+    uint8_t expected[64] = { 0xBA, 0x80, 0xA5, 0x3F, 0x98, 0x1C, 0x4D, 0x0D, 0x6A, 0x27, 0x97, 0xB6, 0x9F, 0x12, 0xF6, 0xE9,
+                             0x4C, 0x21, 0x2F, 0x14, 0x68, 0x5A, 0xC4, 0xB7, 0x4B, 0x12, 0xBB, 0x6F, 0xDB, 0xFF, 0xA2, 0xD1,
+                             0x7D, 0x87, 0xC5, 0x39, 0x2A, 0xAB, 0x79, 0x2D, 0xC2, 0x52, 0xD5, 0xDE, 0x45, 0x33, 0xCC, 0x95,
+                             0x18, 0xD3, 0x8A, 0xA8, 0xDB, 0xF1, 0x92, 0x5A, 0xB9, 0x23, 0x86, 0xED, 0xD4, 0x00, 0x99, 0x23 };
+
+    BLAKE2b b2b;
+    b2b.reset(64);
+    b2b.update("abc", 3);
+
+    uint8_t actual[64];
+    b2b.finalize(actual, sizeof(actual));
+
+    ASSERT_EQ(memcmp(expected, actual, sizeof(expected)), 0);
+}
+
+TEST_F(Blake2bFixture, MatchesReferenceForAnySplitAndAlignment) {
+    auto data = test_data(1024 + 8);
+
+    for (auto size : { 0u, 1u, 127u, 128u, 129u, 255u, 256u, 257u, 384u, 1000u, 1024u }) {
+        for (auto offset : { 0u, 1u, 4u }) {
+            uint8_t expected[32];
+            rfc7693_blake2b reference{ sizeof(expected) };
+            reference.update(data.data() + offset, size);
+            reference.finalize(expected);
+
+            for (auto step : { 1u, 3u, 64u, 127u, 128u, 129u, 300u, 1024u }) {
+                BLAKE2b b2b;
+                b2b.reset(sizeof(expected));
+
+                auto p = data.data() + offset;
+                for (auto i = 0u; i < size; i += step) {
+                    b2b.update(p + i, std::min(step, size - i));
+                }
+
+                uint8_t actual[32];
+                b2b.finalize(actual, sizeof(actual));
+
+                ASSERT_EQ(memcmp(expected, actual, sizeof(expected)), 0) << "size=" << size << " offset=" << offset << " step=" << step;
+            }
+        }
+    }
+}
+
+TEST_F(Blake2bFixture, SaveAndRestoreState) {
+    auto data = test_data(1000);
+
+    BLAKE2b whole;
+    whole.reset(32);
+    whole.update(data.data(), data.size());
+
+    uint8_t expected[32];
+    whole.finalize(expected, sizeof(expected));
+
+    uint8_t saved[BLAKE2b::StateSize];
+
+    {
+        BLAKE2b first;
+        first.reset(32);
+        first.update(data.data(), 300);
+        first.saveState(saved);
+    }
+
+    BLAKE2b second;
+    second.restoreState(saved);
+    second.update(data.data() + 300, data.size() - 300);
+
+    uint8_t actual[32];
+    second.finalize(actual, sizeof(actual));
+
+    ASSERT_EQ(memcmp(expected, actual, sizeof(expected)), 0);
+}
+
+static uint64_t read_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+TEST_F(Blake2bFixture, DISABLED_Benchmark_CyclesPerByte) {
+    constexpr size_t Total = 4 * 1024 * 1024;
+
+    auto data = test_data(Total + 8);
+
+    temporary_log_level info{ LogLevels::INFO };
+
+    // Sizes are the ones we see in practice: records, network buffers
+    // and whole pages.
+    for (auto step : { 64u, 256u, 1446u, 4096u }) {
+        for (auto offset : { 0u, 1u }) {
+            BLAKE2b b2b;
+            b2b.reset(32);
+
+            auto p = data.data() + offset;
+            auto started = std::chrono::steady_clock::now();
+            auto cycles_started = read_cycles();
+
+            for (auto i = 0u; i < Total; i += step) {
+                b2b.update(p + i, std::min<size_t>(step, Total - i));
+            }
+
+            uint8_t hash[32];
+            b2b.finalize(hash, sizeof(hash));
+
+            auto cycles = read_cycles() - cycles_started;
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+
+            phyinfof("blake2b-bench step=%u offset=%u cycles/byte=%.2f MB/s=%.1f", step, offset, (double)cycles / Total,
+                     (double)Total / elapsed.count() * 1000.0);
+        }
+    }
+}
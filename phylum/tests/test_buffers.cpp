@@ -15,3 +15,149 @@ TEST_F(BuffersFixture, SimpleMalloc) {
         phydebugf("%d", sizeof(b1));
     }
 }
+
+class counting_sectors {
+public:
+    size_t misses{ 0 };
+    size_t flushes{ 0 };
+
+public:
+    auto miss() {
+        return [this](dhara_sector_t sector, uint8_t *buffer, size_t size) -> int32_t {
+            memset(buffer, (uint8_t)sector, size);
+            misses++;
+            return size;
+        };
+    }
+
+    auto flush() {
+        return [this](dhara_sector_t /*sector*/, uint8_t const * /*buffer*/, size_t /*size*/) -> int32_t {
+            flushes++;
+            return 0;
+        };
+    }
+};
+
+TEST_F(BuffersFixture, OpenSector_ReusesLoadedSector) {
+    standard_library_malloc buffer_memory;
+    working_buffers buffers{ &buffer_memory, 256, 4 };
+    counting_sectors sectors;
+
+    auto b1 = buffers.open_sector(10, true, sectors.miss(), sectors.flush());
+    auto b2 = buffers.open_sector(10, true, sectors.miss(), sectors.flush());
+    ASSERT_EQ(b1, b2);
+    ASSERT_EQ(b1[0], 10);
+    ASSERT_EQ(sectors.misses, 1u);
+
+    buffers.free_buffer(b1);
+    buffers.free_buffer(b2);
+
+    auto b3 = buffers.open_sector(10, false, sectors.miss(), sectors.flush());
+    ASSERT_EQ(b1, b3);
+    ASSERT_EQ(sectors.misses, 1u);
+    buffers.free_buffer(b3);
+
+    ASSERT_EQ(buffers.highwater(), 1u);
+}
+
+TEST_F(BuffersFixture, OpenSector_EvictsLeastRecentlyUsed) {
+    standard_library_malloc buffer_memory;
+    working_buffers buffers{ &buffer_memory, 256, 4 };
+    counting_sectors sectors;
+
+    for (auto sector = 1u; sector <= 4; ++sector) {
+        buffers.free_buffer(buffers.open_sector(sector, true, sectors.miss(), sectors.flush()));
+    }
+
+    // Touch 1, leaving 2 as the least recently used.
+    buffers.free_buffer(buffers.open_sector(1, true, sectors.miss(), sectors.flush()));
+    ASSERT_EQ(sectors.misses, 4u);
+
+    buffers.free_buffer(buffers.open_sector(5, true, sectors.miss(), sectors.flush()));
+    ASSERT_EQ(sectors.misses, 5u);
+
+    buffers.free_buffer(buffers.open_sector(1, true, sectors.miss(), sectors.flush()));
+    ASSERT_EQ(sectors.misses, 5u);
+
+    buffers.free_buffer(buffers.open_sector(2, true, sectors.miss(), sectors.flush()));
+    ASSERT_EQ(sectors.misses, 6u);
+}
+
+TEST_F(BuffersFixture, OpenSector_FlushesDirtyOnlyWhenNecessary) {
+    standard_library_malloc buffer_memory;
+    working_buffers buffers{ &buffer_memory, 256, 2 };
+    counting_sectors sectors;
+
+    auto dirty = buffers.open_sector(1, false, sectors.miss(), sectors.flush());
+    ASSERT_EQ(buffers.dirty_sector(1), 0);
+    buffers.free_buffer(dirty);
+
+    buffers.free_buffer(buffers.open_sector(2, true, sectors.miss(), sectors.flush()));
+    buffers.free_buffer(buffers.open_sector(3, true, sectors.miss(), sectors.flush()));
+    ASSERT_EQ(sectors.flushes, 0u);
+
+    auto b3 = buffers.open_sector(3, true, sectors.miss(), sectors.flush());
+    buffers.free_buffer(buffers.open_sector(4, true, sectors.miss(), sectors.flush()));
+    ASSERT_EQ(sectors.flushes, 1u);
+    buffers.free_buffer(b3);
+
+    ASSERT_EQ(buffers.dirty_sector(1), -1);
+}
+
+TEST_F(BuffersFixture, OpenSector_PinningPolicyKeepsPinnedSectors) {
+    standard_library_malloc buffer_memory;
+    pinning_eviction_policy policy;
+    working_buffers buffers{ &buffer_memory, 256, 4, &policy };
+    counting_sectors sectors;
+
+    // Sector 1 is a tree/directory sector and is the oldest.
+    buffers.free_buffer(buffers.open_sector(1, true, true, sectors.miss(), sectors.flush()));
+    for (auto sector = 100u; sector < 200; ++sector) {
+        buffers.free_buffer(buffers.open_sector(sector, true, sectors.miss(), sectors.flush()));
+    }
+
+    auto misses = sectors.misses;
+    buffers.free_buffer(buffers.open_sector(1, true, true, sectors.miss(), sectors.flush()));
+    ASSERT_EQ(sectors.misses, misses);
+}
+
+TEST_F(BuffersFixture, Allocate_PrefersEmptyPages) {
+    standard_library_malloc buffer_memory;
+    working_buffers buffers{ &buffer_memory, 256, 4 };
+    counting_sectors sectors;
+
+    buffers.free_buffer(buffers.open_sector(1, true, sectors.miss(), sectors.flush()));
+
+    {
+        auto b1 = buffers.allocate(256);
+        auto b2 = buffers.allocate(256);
+        auto b3 = buffers.allocate(256);
+        ASSERT_EQ(buffers.highwater(), 3u);
+    }
+
+    buffers.free_buffer(buffers.open_sector(1, true, sectors.miss(), sectors.flush()));
+    ASSERT_EQ(sectors.misses, 1u);
+}
+
+TEST_F(BuffersFixture, Retain_KeepsPageAfterItsFreed) {
+    standard_library_malloc buffer_memory;
+    working_buffers buffers{ &buffer_memory, 256, 2 };
+    counting_sectors sectors;
+
+    auto b1 = buffers.open_sector(1, true, sectors.miss(), sectors.flush());
+    ASSERT_TRUE(buffers.retain(b1 + 100));
+    buffers.free_buffer(b1);
+
+    // With the retained page held there's only one page to go around.
+    buffers.free_buffer(buffers.open_sector(2, true, sectors.miss(), sectors.flush()));
+    buffers.free_buffer(buffers.open_sector(3, true, sectors.miss(), sectors.flush()));
+    ASSERT_EQ(b1[100], 1);
+
+    buffers.release(b1 + 100);
+
+    buffers.free_buffer(buffers.open_sector(1, true, sectors.miss(), sectors.flush()));
+    ASSERT_EQ(sectors.misses, 3u);
+
+    uint8_t outside[16];
+    ASSERT_FALSE(buffers.retain(outside));
+}
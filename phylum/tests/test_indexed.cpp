@@ -1,3 +1,6 @@
+#include <chrono>
+#include <random>
+
 #include "string_format.h"
 
 #include <directory_chain.h>
@@ -476,3 +479,153 @@ TYPED_TEST(IndexedFixture, WriteFile_IndexedSeekAndAppend) {
         ASSERT_EQ(opened.visited_sectors(), 0u);
     });
 }
+
+static size_t numbered_record_size(record_number_t record) {
+    // Under 128 bytes so delimiters are always a single byte, varied
+    // so that records straddle sector boundaries.
+    return 48 + (record * 37) % 80;
+}
+
+template <typename tree_type, typename file_ops_type>
+static void write_numbered_records(file_ops_type &fops, record_number_t first, record_number_t nrecords, bool mark_records) {
+    suppress_logs sl;
+
+    file_appender opened{ fops.pc(), &fops.dir(), fops.dir().open() };
+    ASSERT_GE(opened.seek_position<tree_type>(UINT32_MAX), 0);
+
+    for (record_number_t record = first; record < first + nrecords; ++record) {
+        ASSERT_GE(fops.index_if_necessary(opened, record), 0);
+
+        uint8_t body[128];
+        auto size = numbered_record_size(record);
+        memcpy(body, lorem1k, size);
+        memcpy(body, &record, sizeof(record));
+
+        if (mark_records) {
+            ASSERT_EQ(opened.write_delimiter(size), 1);
+        } else {
+            uint8_t delimiter = (uint8_t)size;
+            ASSERT_EQ(opened.write(&delimiter, sizeof(delimiter)), 1);
+        }
+
+        ASSERT_EQ(opened.write(body, size), (int32_t)size);
+    }
+
+    ASSERT_EQ(opened.close(), 0);
+}
+
+TYPED_TEST(IndexedFixture, WriteFile_Records_SeekRandom) {
+    using layout_type = typename TypeParam::layout_type;
+    using directory_type = typename TypeParam::directory_type;
+    using tree_type = typename TypeParam::tree_type;
+    using file_ops_type = file_ops<directory_type, tree_type>;
+
+    layout_type layout;
+    FlashMemory memory{ layout.sector_size };
+
+    constexpr record_number_t Records = 20000;
+    constexpr size_t Seeks = 500;
+
+    memory.mounted<super_chain>([&](super_chain &super) {
+        file_ops_type fops{ memory.pc(), super };
+        ASSERT_EQ(fops.format(), 0);
+        ASSERT_EQ(fops.touch("plain.bin"), 0);
+        ASSERT_EQ(fops.touch("marked.bin"), 0);
+
+        ASSERT_EQ(fops.dir().find("plain.bin", open_file_config{ }), 1);
+        write_numbered_records<tree_type>(fops, 0, Records, false);
+
+        ASSERT_EQ(fops.dir().find("marked.bin", open_file_config{ }), 1);
+        write_numbered_records<tree_type>(fops, 0, Records, true);
+    });
+
+    memory.mounted<super_chain>([&](super_chain &super) {
+        file_ops_type fops{ memory.pc(), super };
+
+        for (auto name : { "plain.bin", "marked.bin" }) {
+            std::mt19937 rng{ 0x5eed };
+            std::chrono::nanoseconds elapsed{ 0 };
+
+            for (auto i = 0u; i < Seeks; ++i) {
+                auto desired = (record_number_t)(rng() % Records);
+
+                ASSERT_EQ(fops.dir().find(name, open_file_config{ }), 1);
+                file_reader reader{ memory.pc(), &fops.dir(), fops.dir().open() };
+
+                {
+                    suppress_logs sl;
+
+                    auto started = std::chrono::steady_clock::now();
+                    ASSERT_EQ(fops.seek_record(reader, desired), (int32_t)desired);
+                    elapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+                }
+
+                uint8_t delimiter = 0;
+                record_number_t found = 0;
+                ASSERT_EQ(reader.read(&delimiter, sizeof(delimiter)), 1);
+                ASSERT_EQ(delimiter, numbered_record_size(desired));
+                ASSERT_EQ(reader.read((uint8_t *)&found, sizeof(found)), (int32_t)sizeof(found));
+                ASSERT_EQ(found, desired);
+            }
+
+            ASSERT_EQ(fops.dir().find(name, open_file_config{ }), 1);
+            file_reader reader{ memory.pc(), &fops.dir(), fops.dir().open() };
+            ASSERT_EQ(fops.seek_record(reader, UINT32_MAX), (int32_t)Records);
+
+            temporary_log_level info{ LogLevels::INFO };
+            phyinfof("seek-record %s sector-size=%zu records=%" PRIu32 " us/seek=%.1f", name, layout.sector_size, Records,
+                     (double)elapsed.count() / Seeks / 1000.0);
+        }
+    });
+}
+
+TYPED_TEST(IndexedFixture, WriteFile_Records_UnmarkedThenMarked) {
+    using layout_type = typename TypeParam::layout_type;
+    using directory_type = typename TypeParam::directory_type;
+    using tree_type = typename TypeParam::tree_type;
+    using file_ops_type = file_ops<directory_type, tree_type>;
+
+    layout_type layout;
+    FlashMemory memory{ layout.sector_size };
+
+    // Chains written before records were counted get appended to by
+    // newer code, so the sub-index has to start partway through.
+    constexpr record_number_t Records = 4000;
+
+    memory.mounted<super_chain>([&](super_chain &super) {
+        file_ops_type fops{ memory.pc(), super };
+        ASSERT_EQ(fops.format(), 0);
+        ASSERT_EQ(fops.touch("data.bin"), 0);
+
+        ASSERT_EQ(fops.dir().find("data.bin", open_file_config{ }), 1);
+        write_numbered_records<tree_type>(fops, 0, Records / 2, false);
+    });
+
+    memory.mounted<super_chain>([&](super_chain &super) {
+        file_ops_type fops{ memory.pc(), super };
+        ASSERT_EQ(fops.dir().find("data.bin", open_file_config{ }), 1);
+        write_numbered_records<tree_type>(fops, Records / 2, Records / 2, true);
+    });
+
+    memory.mounted<super_chain>([&](super_chain &super) {
+        file_ops_type fops{ memory.pc(), super };
+
+        for (auto desired = 0u; desired < Records; desired += 97) {
+            ASSERT_EQ(fops.dir().find("data.bin", open_file_config{ }), 1);
+            file_reader reader{ memory.pc(), &fops.dir(), fops.dir().open() };
+
+            ASSERT_EQ(fops.seek_record(reader, desired), (int32_t)desired);
+
+            uint8_t delimiter = 0;
+            record_number_t found = 0;
+            ASSERT_EQ(reader.read(&delimiter, sizeof(delimiter)), 1);
+            ASSERT_EQ(delimiter, numbered_record_size(desired));
+            ASSERT_EQ(reader.read((uint8_t *)&found, sizeof(found)), (int32_t)sizeof(found));
+            ASSERT_EQ(found, desired);
+        }
+
+        ASSERT_EQ(fops.dir().find("data.bin", open_file_config{ }), 1);
+        file_reader reader{ memory.pc(), &fops.dir(), fops.dir().open() };
+        ASSERT_EQ(fops.seek_record(reader, UINT32_MAX), (int32_t)Records);
+    });
+}
@@ -0,0 +1,179 @@
+#include <chrono>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <page_cache.h>
+
+#include "phylum_tests.h"
+
+using namespace phylum;
+
+class PageCacheFixture : public PhylumFixture {};
+
+constexpr size_t PageCacheEntrySize = sizeof(dhara_sector_t) + sizeof(dhara_page_t) + sizeof(uint32_t);
+
+class page_cache_memory {
+private:
+    std::vector<uint8_t> memory_;
+
+public:
+    page_cache_memory(size_t entries) : memory_(entries * PageCacheEntrySize) {
+    }
+
+public:
+    simple_buffer buffer() {
+        return simple_buffer{ memory_.data(), memory_.size() };
+    }
+};
+
+TEST_F(PageCacheFixture, Clock_GetAndSet) {
+    page_cache_memory memory{ 64 };
+    clock_page_cache cache{ memory.buffer() };
+
+    dhara_page_t page = 0;
+    ASSERT_FALSE(cache.get(1, &page));
+
+    ASSERT_TRUE(cache.set(1, 100));
+    ASSERT_TRUE(cache.set(2, 200));
+    ASSERT_TRUE(cache.get(1, &page));
+    ASSERT_EQ(page, 100u);
+    ASSERT_TRUE(cache.get(2, &page));
+    ASSERT_EQ(page, 200u);
+
+    ASSERT_TRUE(cache.set(1, 101));
+    ASSERT_TRUE(cache.get(1, &page));
+    ASSERT_EQ(page, 101u);
+    ASSERT_EQ(cache.used(), 2u);
+
+    ASSERT_EQ(cache.statistics().hits, 3u);
+    ASSERT_EQ(cache.statistics().misses, 1u);
+    ASSERT_EQ(cache.statistics().evictions, 0u);
+}
+
+TEST_F(PageCacheFixture, Clock_InvalidateKeepsCollisionsReachable) {
+    page_cache_memory memory{ 16 };
+    clock_page_cache cache{ memory.buffer() };
+
+    // Sectors that are a multiple of the table size apart all hash to
+    // the same home slot.
+    auto size = (dhara_sector_t)cache.size();
+    for (auto i = 0u; i < cache.capacity(); ++i) {
+        ASSERT_TRUE(cache.set(i * size, i));
+    }
+
+    cache.invalidate(0);
+
+    dhara_page_t page = 0;
+    ASSERT_FALSE(cache.get(0, &page));
+    for (auto i = 1u; i < cache.capacity(); ++i) {
+        ASSERT_TRUE(cache.get(i * size, &page));
+        ASSERT_EQ(page, i);
+    }
+}
+
+TEST_F(PageCacheFixture, Clock_EvictsUnreferencedFirst) {
+    page_cache_memory memory{ 16 };
+    clock_page_cache cache{ memory.buffer() };
+
+    for (auto i = 0u; i < cache.capacity(); ++i) {
+        ASSERT_TRUE(cache.set(i, 1000 + i));
+    }
+
+    // Everything but sector 3 gets a second chance.
+    dhara_page_t page = 0;
+    for (auto i = 0u; i < cache.capacity(); ++i) {
+        if (i != 3) {
+            ASSERT_TRUE(cache.get(i, &page));
+        }
+    }
+
+    ASSERT_TRUE(cache.set(5000, 5000));
+    ASSERT_EQ(cache.used(), cache.capacity());
+    ASSERT_EQ(cache.statistics().evictions, 1u);
+    ASSERT_FALSE(cache.get(3, &page));
+    ASSERT_TRUE(cache.get(5000, &page));
+    ASSERT_EQ(page, 5000u);
+}
+
+TEST_F(PageCacheFixture, Clock_Relocate) {
+    page_cache_memory memory{ 64 };
+    clock_page_cache cache{ memory.buffer() };
+
+    ASSERT_TRUE(cache.set(7, 70));
+    cache.relocate(70, 700);
+
+    dhara_page_t page = 0;
+    ASSERT_TRUE(cache.get(7, &page));
+    ASSERT_EQ(page, 700u);
+
+    cache.clear();
+    ASSERT_FALSE(cache.get(7, &page));
+    ASSERT_EQ(cache.used(), 0u);
+}
+
+TEST_F(PageCacheFixture, Clock_ManyRandomOperations) {
+    page_cache_memory memory{ 512 };
+    clock_page_cache cache{ memory.buffer() };
+    std::map<dhara_sector_t, dhara_page_t> expected;
+    std::mt19937 rng{ 0x5eed };
+
+    for (auto i = 0u; i < 100000; ++i) {
+        auto sector = (dhara_sector_t)(rng() % 2048);
+        dhara_page_t page = 0;
+        if (rng() % 8 == 0) {
+            cache.invalidate(sector);
+            expected.erase(sector);
+        }
+        else if (cache.get(sector, &page)) {
+            ASSERT_EQ(expected[sector], page);
+        }
+        else {
+            ASSERT_TRUE(cache.set(sector, i));
+            expected[sector] = i;
+        }
+        ASSERT_LE(cache.used(), cache.capacity());
+    }
+}
+
+template<typename CacheType>
+static void page_cache_benchmark(const char *name, size_t entries) {
+    page_cache_memory memory{ entries };
+    CacheType cache{ memory.buffer() };
+    std::mt19937 rng{ 0x5eed };
+
+    // Working set twice the number of entries, skewed so that lower
+    // sectors (directory, tree roots) are hotter.
+    constexpr size_t Operations = 200000;
+    std::vector<dhara_sector_t> sectors(Operations);
+    for (auto &sector : sectors) {
+        auto a = rng() % (entries * 2);
+        auto b = rng() % (entries * 2);
+        sector = (dhara_sector_t)std::min(a, b);
+    }
+
+    auto started = std::chrono::steady_clock::now();
+
+    for (auto sector : sectors) {
+        dhara_page_t page = 0;
+        if (!cache.get(sector, &page)) {
+            cache.set(sector, sector + 1);
+        }
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+    auto &stats = cache.statistics();
+
+    temporary_log_level info{ LogLevels::INFO };
+    phyinfof("page-cache-bench %s entries=%zu ops=%zu ns/op=%.1f hits=%" PRIu32 " misses=%" PRIu32 " evictions=%" PRIu32,
+             name, entries, Operations, (double)elapsed.count() / Operations, stats.hits, stats.misses, stats.evictions);
+
+    ASSERT_EQ(stats.hits + stats.misses, Operations);
+}
+
+TEST_F(PageCacheFixture, DISABLED_Benchmark_LinearVersusClock) {
+    for (auto entries : { 64u, 512u, 4096u }) {
+        page_cache_benchmark<simple_page_cache>("linear", entries);
+        page_cache_benchmark<clock_page_cache>("clock", entries);
+    }
+}
@@ -1,3 +1,5 @@
+#include <vector>
+
 #include <directory_chain.h>
 #include <directory_tree.h>
 #include <file_appender.h>
@@ -173,6 +175,100 @@ TYPED_TEST(ReadFixture, ReadDataChain_TwoBlocks) {
     });
 }
 
+class collecting_writer : public io_writer {
+public:
+    std::vector<uint8_t> data;
+    size_t calls{ 0 };
+
+public:
+    int32_t write(uint8_t const *ptr, size_t size) override {
+        data.insert(data.end(), ptr, ptr + size);
+        calls++;
+        return size;
+    }
+};
+
+TYPED_TEST(ReadFixture, ReadDataChain_TwoBlocks_IntoWriter) {
+    using dir_type = typename TypeParam::second_type;
+    typename TypeParam::first_type layout;
+    FlashMemory memory{ layout.sector_size };
+
+    auto hello = "Hello, world! How are you!";
+    std::vector<uint8_t> expected;
+
+    memory.mounted<dir_type>([&](auto &chain) {
+        ASSERT_EQ(chain.touch("data.txt"), 0);
+
+        ASSERT_EQ(chain.find("data.txt", open_file_config{ }), 1);
+        file_appender opened{ memory.pc(), &chain, chain.open() };
+
+        for (auto i = 0u; i < 2 * memory.sector_size() / strlen(hello); ++i) {
+            ASSERT_GT(opened.write(hello), 0);
+            expected.insert(expected.end(), hello, hello + strlen(hello));
+        }
+        ASSERT_EQ(opened.close(), 0);
+    });
+
+    memory.mounted<dir_type>([&](auto &chain) {
+        ASSERT_EQ(chain.find("data.txt", open_file_config{ }), 1);
+        file_reader reader{ memory.pc(), &chain, chain.open() };
+
+        collecting_writer writer;
+        while (writer.data.size() < expected.size()) {
+            auto before = writer.data.size();
+            auto nread = reader.read(writer, 100);
+            ASSERT_GT(nread, 0);
+            ASSERT_LE(nread, 100);
+            ASSERT_EQ(writer.data.size() - before, (size_t)nread);
+            ASSERT_EQ(reader.position(), writer.data.size());
+        }
+
+        ASSERT_EQ(reader.read(writer, 100), 0);
+        ASSERT_EQ(writer.data, expected);
+        ASSERT_EQ(reader.close(), 0);
+    });
+}
+
+TYPED_TEST(ReadFixture, ReadInlineWrite_InPieces) {
+    using dir_type = typename TypeParam::second_type;
+    typename TypeParam::first_type layout;
+    FlashMemory memory{ layout.sector_size };
+
+    auto hello = "Hello, world! How are you?";
+    auto length = strlen(hello);
+
+    memory.mounted<dir_type>([&](auto &chain) {
+        ASSERT_EQ(chain.touch("data.txt"), 0);
+
+        ASSERT_EQ(chain.find("data.txt", open_file_config{ }), 1);
+        file_appender opened{ memory.pc(), &chain, chain.open() };
+        ASSERT_GT(opened.write(hello), 0);
+        ASSERT_EQ(opened.close(), 0);
+    });
+
+    memory.mounted<dir_type>([&](auto &chain) {
+        ASSERT_EQ(chain.find("data.txt", open_file_config{ }), 1);
+        file_reader reader{ memory.pc(), &chain, chain.open() };
+
+        uint8_t buffer[10];
+        ASSERT_EQ(reader.read(buffer, sizeof(buffer)), (int32_t)sizeof(buffer));
+        ASSERT_EQ(memcmp(buffer, hello, sizeof(buffer)), 0);
+        ASSERT_EQ(reader.position(), sizeof(buffer));
+
+        collecting_writer writer;
+        while (reader.position() < length) {
+            auto nread = reader.read(writer, 7);
+            ASSERT_GT(nread, 0);
+            ASSERT_LE(nread, 7);
+        }
+
+        ASSERT_EQ(reader.read(writer, 7), 0);
+        ASSERT_EQ(reader.read(buffer, sizeof(buffer)), 0);
+        ASSERT_EQ(writer.data, std::vector<uint8_t>(hello + sizeof(buffer), hello + length));
+        ASSERT_EQ(reader.close(), 0);
+    });
+}
+
 TYPED_TEST(ReadFixture, ReadDataChain_TwoBlocks_Binary) {
     using dir_type = typename TypeParam::second_type;
     typename TypeParam::first_type layout;
@@ -18,6 +18,31 @@ typedef ::testing::Types<test_types<layout_4096>,
 
 TYPED_TEST_SUITE(SuperChainFixture, Implementations);
 
+/**
+ * Formats super blocks claiming to be some other version.
+ */
+class versioned_super_chain : public super_chain {
+private:
+    uint32_t writing_version_;
+
+public:
+    versioned_super_chain(phyctx pc, dhara_sector_t head, uint32_t version) : super_chain(pc, head), writing_version_(version) {
+    }
+
+protected:
+    int32_t write_header(page_lock &page_lock) override {
+        auto err = super_chain::write_header(page_lock);
+        if (err < 0) {
+            return err;
+        }
+
+        return db().write_header<super_block_t>([&](super_block_t *header) {
+            header->version = writing_version_;
+            return 0;
+        });
+    }
+};
+
 TYPED_TEST(SuperChainFixture, MountFormatMount) {
     using layout_type = typename TypeParam::layout_type;
 
@@ -50,3 +75,110 @@ TYPED_TEST(SuperChainFixture, FormatPersists) {
         ASSERT_EQ(super.mount(), 0);
     });
 }
+
+TYPED_TEST(SuperChainFixture, MountRejectsNewerVersion) {
+    using layout_type = typename TypeParam::layout_type;
+
+    layout_type layout;
+    FlashMemory memory{ layout.sector_size };
+
+    memory.begin(true);
+
+    memory.sync([&]() {
+        versioned_super_chain super{ memory.pc(), 0, FormatVersion + 1 };
+        ASSERT_EQ(super.format(), 0);
+    });
+
+    memory.sync([&]() {
+        super_chain super{ memory.pc(), 0 };
+        ASSERT_EQ(super.mount(), -1);
+    });
+}
+
+TYPED_TEST(SuperChainFixture, MountOlderVersionAndUpgrade) {
+    using layout_type = typename TypeParam::layout_type;
+
+    layout_type layout;
+    FlashMemory memory{ layout.sector_size };
+
+    memory.begin(true);
+
+    memory.sync([&]() {
+        versioned_super_chain super{ memory.pc(), 0, 1 };
+        ASSERT_EQ(super.format(), 0);
+    });
+
+    memory.sync([&]() {
+        super_chain super{ memory.pc(), 0 };
+        ASSERT_EQ(super.mount(), 0);
+        ASSERT_EQ(super.version(), 1u);
+        ASSERT_EQ(super.update(super.directory_tree()), 0);
+    });
+
+    memory.sync([&]() {
+        super_chain super{ memory.pc(), 0 };
+        ASSERT_EQ(super.mount(), 0);
+        ASSERT_EQ(super.version(), FormatVersion);
+    });
+}
+
+/**
+ * Formats a directory tree the way another version would, without a
+ * volume entry when the version is 1.
+ */
+static void format_versioned_tree(phyctx pc, uint32_t version) {
+    directory_tree::dir_tree_type tree{ pc, tree_ptr_t{ 0, 0 }, "dir-tree" };
+    ASSERT_EQ(tree.create(), 0);
+
+    if (version > 1) {
+        directory_tree::dir_node_type node = {};
+        node.u.volume = dirtree_volume_t{};
+        node.u.volume.version = version;
+        ASSERT_EQ(tree.add(directory_tree::VolumeId, &node, nullptr), 0);
+    }
+}
+
+TYPED_TEST(SuperChainFixture, DirectoryTreeRejectsNewerVersion) {
+    using layout_type = typename TypeParam::layout_type;
+
+    layout_type layout;
+    FlashMemory memory{ layout.sector_size };
+
+    memory.begin(true);
+
+    memory.sync([&]() {
+        format_versioned_tree(memory.pc(), FormatVersion + 1);
+    });
+
+    memory.sync([&]() {
+        directory_tree dir{ memory.pc(), 0 };
+        ASSERT_EQ(dir.mount(), -1);
+    });
+}
+
+TYPED_TEST(SuperChainFixture, DirectoryTreeMountUnversionedAndUpgrade) {
+    using layout_type = typename TypeParam::layout_type;
+
+    layout_type layout;
+    FlashMemory memory{ layout.sector_size };
+
+    memory.begin(true);
+
+    memory.sync([&]() {
+        format_versioned_tree(memory.pc(), 1);
+    });
+
+    memory.sync([&]() {
+        directory_tree dir{ memory.pc(), 0 };
+        ASSERT_EQ(dir.mount(), 0);
+        ASSERT_EQ(dir.version(), FormatVersion);
+        ASSERT_EQ(dir.find("test.logs", open_file_config{}), 0);
+    });
+
+    memory.sync([&]() {
+        directory_tree::dir_tree_type tree{ memory.pc(), tree_ptr_t{ 0, 0 }, "dir-tree" };
+        directory_tree::dir_node_type node;
+        ASSERT_EQ(tree.find(directory_tree::VolumeId, &node), 1);
+        ASSERT_EQ(node.u.volume.version, FormatVersion);
+    });
+}
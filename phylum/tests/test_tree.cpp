@@ -1,3 +1,6 @@
+#include <chrono>
+#include <random>
+
 #include <directory_chain.h>
 #include <directory_tree.h>
 #include <file_appender.h>
@@ -263,3 +266,65 @@ TYPED_TEST(TreeFixture, DISABLED_Truncate_SingleSector) {
         }
     });
 }
+
+template<typename LayoutType, typename TreeType>
+static void tree_benchmark(const char *name, uint32_t nrecords) {
+    LayoutType layout;
+    FlashMemory memory{ layout.sector_size };
+
+    memory.mounted<directory_chain>([&](auto &chain) {
+        auto first = memory.allocator().allocate();
+        TreeType tree{ memory.pc(), tree_ptr_t{ first }, "tree" };
+
+        ASSERT_EQ(tree.create(), 0);
+
+        // Index trees are keyed by record number or position, so keys
+        // arrive in ascending order with gaps between them.
+        constexpr uint32_t Stride = 10;
+        constexpr size_t Lookups = 100000;
+
+        std::chrono::nanoseconds add_elapsed;
+        std::chrono::nanoseconds find_elapsed;
+
+        {
+            suppress_logs sl;
+
+            auto started = std::chrono::steady_clock::now();
+
+            for (auto i = 1u; i <= nrecords; ++i) {
+                ASSERT_EQ(tree.add(i * Stride, i), 0);
+            }
+
+            add_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+
+            std::mt19937 rng{ 0x5eed };
+            std::vector<uint32_t> keys(Lookups);
+            for (auto &key : keys) {
+                key = Stride + 1 + rng() % (nrecords * Stride);
+            }
+
+            started = std::chrono::steady_clock::now();
+
+            for (auto key : keys) {
+                uint32_t value = 0;
+                uint32_t found_key = 0;
+                ASSERT_TRUE(tree.find_last_less_then(key, &value, &found_key));
+                ASSERT_LT(found_key, key);
+                ASSERT_EQ(found_key, value * Stride);
+            }
+
+            find_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+        }
+
+        temporary_log_level info{ LogLevels::INFO };
+        phyinfof("tree-bench %s records=%" PRIu32 " add-ns/op=%.1f find-last-less-ns/op=%.1f",
+                 name, nrecords, (double)add_elapsed.count() / nrecords, (double)find_elapsed.count() / Lookups);
+    });
+}
+
+TEST(TreeInfo, DISABLED_Benchmark_AddAndFindLastLessThen) {
+    constexpr uint32_t Records = 1024 * 1024;
+    tree_benchmark<layout_2048, tree_sector<uint32_t, uint32_t, 201>>("2048/201", Records);
+    tree_benchmark<layout_4096, tree_sector<uint32_t, uint32_t, 201>>("4096/201", Records);
+    tree_benchmark<layout_4096, tree_sector<uint32_t, uint32_t, 405>>("4096/405", Records);
+}